@@ -0,0 +1,67 @@
+// Event-loop lag and throughput of the synchronous OrderBook against
+// AsyncOrderBook, under a flow of resting orders and deep sweeps.
+//
+//   node bench/async-event-loop-lag.js [orders] [sweepEvery]
+const { monitorEventLoopDelay, performance } = require('perf_hooks');
+const { OrderBook, AsyncOrderBook } = require('../index');
+
+const ORDERS = parseInt(process.argv[2] || '200000', 10);
+const SWEEP_EVERY = parseInt(process.argv[3] || '1000', 10);
+// Orders submitted per turn of the event loop, as a busy server would
+const CHUNK = 500;
+
+function orderFlow(i) {
+  // Mostly resting asks over 100 levels, with a bid that sweeps them
+  if (i % SWEEP_EVERY === SWEEP_EVERY - 1) {
+    return [true, 1100, 100 * SWEEP_EVERY];
+  }
+  return [false, 1000 + (i % 100), 100];
+}
+
+async function run(name, book, isAsync) {
+  const histogram = monitorEventLoopDelay({ resolution: 1 });
+  // Stand-in for other HTTP requests: how often does a 1ms timer get to run?
+  let ticks = 0;
+  const ticker = setInterval(() => { ++ticks; }, 1);
+  histogram.enable();
+
+  const start = performance.now();
+  let inFlight = [];
+  for (let i = 0; i < ORDERS; i += CHUNK) {
+    for (let j = i; j < Math.min(i + CHUNK, ORDERS); ++j) {
+      const [isBuy, price, quantity] = orderFlow(j);
+      const result = book.addOrder(isBuy, price, quantity, 0, false, false);
+      if (isAsync) {
+        inFlight.push(result);
+      }
+    }
+    if (isAsync) {
+      await Promise.all(inFlight);
+      inFlight = [];
+    } else {
+      // Yield so the timer can run between chunks
+      await new Promise(resolve => setImmediate(resolve));
+    }
+  }
+  const elapsed = performance.now() - start;
+
+  histogram.disable();
+  clearInterval(ticker);
+  if (isAsync) {
+    book.close();
+  }
+
+  const ms = ns => (ns / 1e6).toFixed(2);
+  console.log(`${name}`);
+  console.log(`  orders/s        ${Math.round(ORDERS / (elapsed / 1000))}`);
+  console.log(`  loop delay p50  ${ms(histogram.percentile(50))} ms`);
+  console.log(`  loop delay p99  ${ms(histogram.percentile(99))} ms`);
+  console.log(`  loop delay max  ${ms(histogram.max)} ms`);
+  console.log(`  timer ticks/s   ${Math.round(ticks / (elapsed / 1000))}`);
+}
+
+(async () => {
+  console.log(`${ORDERS} orders, a sweep every ${SWEEP_EVERY}`);
+  await run('OrderBook (event loop)', new OrderBook('SYNC'), false);
+  await run('AsyncOrderBook (native thread)', new AsyncOrderBook('ASYNC'), true);
+})();
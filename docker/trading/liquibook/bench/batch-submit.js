@@ -0,0 +1,77 @@
+// Orders per second through single addOrder calls against the columnar
+// and packed batch entry points.
+//
+//   node bench/batch-submit.js [orders] [batchSize]
+const { performance } = require('perf_hooks');
+const { OrderBook, Batch } = require('../index');
+
+const ORDERS = parseInt(process.argv[2] || '1000000', 10);
+const BATCH = parseInt(process.argv[3] || '1000', 10);
+
+// The same flow for every run: resting orders around a mid, some crossing
+function flow(i) {
+  const isBuy = (i & 1) === 0;
+  const offset = (i * 7919) % 20;
+  return [isBuy, isBuy ? 990 + offset : 1000 + offset, 100 * (1 + (i % 5))];
+}
+
+function report(name, elapsed) {
+  console.log(`${name.padEnd(24)} ${Math.round(ORDERS / (elapsed / 1000)).toLocaleString()} orders/s`);
+}
+
+function single() {
+  const book = new OrderBook('SINGLE');
+  const start = performance.now();
+  for (let i = 0; i < ORDERS; ++i) {
+    const [isBuy, price, quantity] = flow(i);
+    book.addOrder(isBuy, price, quantity, 0, false, false);
+  }
+  report('addOrder', performance.now() - start);
+}
+
+function columnar() {
+  const book = new OrderBook('COLUMNAR');
+  const isBuy = new Uint8Array(BATCH);
+  const prices = new Float64Array(BATCH);
+  const quantities = new Float64Array(BATCH);
+  const results = new Float64Array(BATCH * Batch.RESULT_FIELDS);
+  const start = performance.now();
+  for (let base = 0; base < ORDERS; base += BATCH) {
+    const count = Math.min(BATCH, ORDERS - base);
+    for (let j = 0; j < count; ++j) {
+      const [buy, price, quantity] = flow(base + j);
+      isBuy[j] = buy ? 1 : 0;
+      prices[j] = price;
+      quantities[j] = quantity;
+    }
+    book.addOrders(isBuy.subarray(0, count), prices.subarray(0, count),
+      quantities.subarray(0, count), null, null, results);
+  }
+  report('addOrders (columnar)', performance.now() - start);
+}
+
+function packed() {
+  const book = new OrderBook('PACKED');
+  const records = new Float64Array(BATCH * Batch.RECORD_FIELDS);
+  const results = new Float64Array(BATCH * Batch.RESULT_FIELDS);
+  const start = performance.now();
+  for (let base = 0; base < ORDERS; base += BATCH) {
+    const count = Math.min(BATCH, ORDERS - base);
+    for (let j = 0; j < count; ++j) {
+      const [buy, price, quantity] = flow(base + j);
+      const r = j * Batch.RECORD_FIELDS;
+      records[r] = buy ? 1 : 0;
+      records[r + 1] = price;
+      records[r + 2] = quantity;
+      records[r + 3] = 0;
+      records[r + 4] = 0;
+    }
+    book.addOrdersPacked(records.subarray(0, count * Batch.RECORD_FIELDS), results);
+  }
+  report('addOrdersPacked', performance.now() - start);
+}
+
+console.log(`${ORDERS.toLocaleString()} orders, batches of ${BATCH}`);
+single();
+columnar();
+packed();
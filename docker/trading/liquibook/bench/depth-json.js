@@ -0,0 +1,79 @@
+// Requests per second for GET /orderbook/:symbol with depth built as JS
+// objects and sent with res.json(), against the native JSON Buffer.
+//
+//   node bench/depth-json.js [seconds] [connections] [restingOrders]
+const http = require('http');
+const express = require('express');
+const { OrderBook } = require('../index');
+
+const SECONDS = parseFloat(process.argv[2] || '5');
+const CONNECTIONS = parseInt(process.argv[3] || '32', 10);
+const RESTING = parseInt(process.argv[4] || '10000', 10);
+
+const book = new OrderBook('BENCH');
+for (let i = 0; i < RESTING; ++i) {
+  const isBuy = (i & 1) === 0;
+  const offset = 1 + ((i * 7919) % 500);
+  book.addOrder(isBuy, isBuy ? 1000 - offset : 1000 + offset, 100 * (1 + (i % 5)));
+}
+
+const app = express();
+// The handler of server.js before native serialization
+app.get('/object/:symbol', (req, res) => {
+  res.json({
+    symbol: req.params.symbol,
+    timestamp: new Date().toISOString(),
+    depth: book.getDepth()
+  });
+});
+app.get('/native/:symbol', (req, res) => {
+  res.type('json').send(book.getDepthJson(new Date().toISOString()));
+});
+app.get('/object-full/:symbol', (req, res) => {
+  res.json({
+    symbol: req.params.symbol,
+    timestamp: new Date().toISOString(),
+    orderBook: book.getOrderBook()
+  });
+});
+app.get('/native-full/:symbol', (req, res) => {
+  res.type('json').send(book.getOrderBookJson(new Date().toISOString()));
+});
+
+function load(port, path) {
+  const agent = new http.Agent({ keepAlive: true, maxSockets: CONNECTIONS });
+  const deadline = Date.now() + SECONDS * 1000;
+  let completed = 0;
+  return new Promise((resolve) => {
+    let open = CONNECTIONS;
+    function next() {
+      if (Date.now() >= deadline) {
+        if (--open === 0) {
+          agent.destroy();
+          resolve(completed / SECONDS);
+        }
+        return;
+      }
+      http.get({ port, path, agent }, (res) => {
+        res.resume();
+        res.on('end', () => {
+          ++completed;
+          next();
+        });
+      });
+    }
+    for (let i = 0; i < CONNECTIONS; ++i) {
+      next();
+    }
+  });
+}
+
+const server = app.listen(0, async () => {
+  const port = server.address().port;
+  console.log(`${RESTING.toLocaleString()} resting orders, ${CONNECTIONS} connections, ${SECONDS}s per run`);
+  for (const path of ['/object/BENCH', '/native/BENCH', '/object-full/BENCH', '/native-full/BENCH']) {
+    const rate = await load(port, path);
+    console.log(`${path.padEnd(20)} ${Math.round(rate).toLocaleString()} requests/s`);
+  }
+  server.close();
+});
@@ -0,0 +1,48 @@
+// Cost of polling depth while the book changes once every N polls:
+// getDepth(), answered from the cached value between changes, against
+// getDepthSince() applying only the changed levels to a local copy.
+//
+//   node bench/depth-poll.js [polls] [pollsPerChange]
+const { OrderBook } = require('../index');
+
+const POLLS = parseInt(process.argv[2] || '1000000', 10);
+const POLLS_PER_CHANGE = parseInt(process.argv[3] || '100', 10);
+
+function run(name, poll) {
+  const book = new OrderBook('BENCH');
+  for (let i = 0; i < 1000; ++i) {
+    const isBuy = (i & 1) === 0;
+    book.addOrder(isBuy, isBuy ? 990 - (i % 20) : 1010 + (i % 20), 100);
+  }
+  let change = 0;
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < POLLS; ++i) {
+    if (i % POLLS_PER_CHANGE === 0) {
+      // Add to the best bid or the best ask in turn
+      const isBuy = (change & 1) === 0;
+      book.addOrder(isBuy, isBuy ? 990 : 1010, 10 + (change % 7));
+      ++change;
+    }
+    poll(book);
+  }
+  const elapsed = Number(process.hrtime.bigint() - start);
+  console.log(`${name.padEnd(16)} ${(elapsed / POLLS).toFixed(0)} ns/poll`);
+}
+
+console.log(`${POLLS.toLocaleString()} polls, one change per ${POLLS_PER_CHANGE}`);
+
+run('getDepth', (book) => book.getDepth());
+
+let version = 0;
+const bids = [];
+const asks = [];
+run('getDepthSince', (book) => {
+  const changes = book.getDepthSince(version);
+  for (const level of changes.bids) {
+    bids[level.level] = level;
+  }
+  for (const level of changes.asks) {
+    asks[level.level] = level;
+  }
+  version = changes.version;
+});
@@ -0,0 +1,38 @@
+// Reads per second of depth and the full book as JS objects against the
+// typed array snapshots, on a deep book.
+//
+//   node bench/snapshot-read.js [restingOrders] [reads]
+const { performance } = require('perf_hooks');
+const { OrderBook, Snapshot } = require('../index');
+
+const RESTING = parseInt(process.argv[2] || '10000', 10);
+const READS = parseInt(process.argv[3] || '1000', 10);
+
+// Non-crossing bids below 1000 and asks above it
+const book = new OrderBook('SNAPSHOT');
+for (let i = 0; i < RESTING; ++i) {
+  const isBuy = (i & 1) === 0;
+  const offset = 1 + ((i * 7919) % 500);
+  book.addOrder(isBuy, isBuy ? 1000 - offset : 1000 + offset, 100 * (1 + (i % 5)));
+}
+
+function run(name, read) {
+  let sink = 0;
+  const start = performance.now();
+  for (let i = 0; i < READS; ++i) {
+    sink += read();
+  }
+  const elapsed = performance.now() - start;
+  console.log(`${name.padEnd(28)} ${Math.round(READS / (elapsed / 1000)).toLocaleString()} reads/s (${sink})`);
+}
+
+console.log(`${RESTING.toLocaleString()} resting orders, ${READS.toLocaleString()} reads`);
+
+run('getDepth', () => book.getDepth().bids.length);
+const depth = new Float64Array(Snapshot.DEPTH_FIELDS);
+run('getDepthSnapshot', () => book.getDepthSnapshot(depth)[1]);
+const depth64 = new BigUint64Array(Snapshot.DEPTH_FIELDS);
+run('getDepthSnapshot (BigInt)', () => Number(book.getDepthSnapshot(depth64)[1]));
+
+run('getOrderBook', () => book.getOrderBook().bids.length);
+run('getOrderBookSnapshot', () => book.getOrderBookSnapshot()[0]);
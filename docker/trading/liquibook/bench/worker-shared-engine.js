@@ -0,0 +1,76 @@
+// Worker threads submitting batches to one shared engine while reading
+// depth snapshots.  Prints commands per second for 1..workers threads.
+//
+//   node bench/worker-shared-engine.js [workers] [commandsPerWorker] [symbols]
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+const { performance } = require('perf_hooks');
+const { Engine } = require('../index');
+
+const BATCH = 1000;
+
+if (isMainThread) {
+  const WORKERS = parseInt(process.argv[2] || '4', 10);
+  const COMMANDS = parseInt(process.argv[3] || '200000', 10);
+  const SYMBOLS = parseInt(process.argv[4] || '16', 10);
+
+  function run(workers, round) {
+    return new Promise((resolve, reject) => {
+      const start = performance.now();
+      let running = workers;
+      for (let w = 0; w < workers; ++w) {
+        const worker = new Worker(__filename, {
+          workerData: { engine: `bench-${round}`, seed: w, commands: COMMANDS, symbols: SYMBOLS }
+        });
+        worker.on('error', reject);
+        worker.on('exit', () => {
+          if (--running === 0) {
+            resolve(performance.now() - start);
+          }
+        });
+      }
+    });
+  }
+
+  (async () => {
+    console.log(`${COMMANDS.toLocaleString()} commands per worker over ${SYMBOLS} symbols`);
+    for (let workers = 1; workers <= WORKERS; workers *= 2) {
+      // Holding the engine here keeps it alive between workers of a round
+      const engine = Engine.shared(`bench-${workers}`);
+      const elapsed = await run(workers, workers);
+      const stats = engine.getStats();
+      const rate = Math.round(workers * COMMANDS / (elapsed / 1000));
+      console.log(`${String(workers).padStart(2)} workers  ${rate.toLocaleString()} commands/s  ` +
+        `${stats.openOrders.toLocaleString()} open orders`);
+    }
+  })();
+} else {
+  const { engine: name, seed, commands, symbols } = workerData;
+  const engine = Engine.shared(name);
+  const ids = [];
+  for (let s = 0; s < symbols; ++s) {
+    ids.push(engine.symbolId(`SYM${s}`));
+  }
+
+  const batch = new Float64Array(BATCH * Engine.COMMAND_FIELDS);
+  const results = new Float64Array(BATCH * Engine.RESULT_FIELDS);
+  let depthReads = 0;
+  for (let base = 0; base < commands; base += BATCH) {
+    const count = Math.min(BATCH, commands - base);
+    for (let j = 0; j < count; ++j) {
+      const i = base + j + seed * 7;
+      const isBuy = (i & 1) === 0;
+      const r = j * Engine.COMMAND_FIELDS;
+      batch[r] = Engine.ADD;
+      batch[r + 1] = ids[i % symbols];
+      batch[r + 2] = isBuy ? 1 : 0;
+      batch[r + 3] = isBuy ? 990 + (i * 7919) % 20 : 1000 + (i * 7919) % 20;
+      batch[r + 4] = 100 * (1 + (i % 5));
+      batch[r + 5] = 0;
+      batch[r + 6] = 0;
+      batch[r + 7] = 0;
+    }
+    engine.submit(batch.subarray(0, count * Engine.COMMAND_FIELDS), results);
+    depthReads += engine.book(`SYM${base % symbols}`).getDepth().bids.length;
+  }
+  parentPort.postMessage(depthReads);
+}
@@ -4,7 +4,13 @@
       "target_name": "liquibook",
       "sources": [
         "src/addon.cc",
-        "src/order_book_wrapper.cc"
+        "src/order_book_wrapper.cc",
+        "src/node_order_book.cc",
+        "src/book_values.cc",
+        "src/book_json.cc",
+        "src/async_order_book_wrapper.cc",
+        "src/engine.cc",
+        "src/engine_wrapper.cc"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
@@ -1,4 +1,24 @@
 // Simple JavaScript-only OrderBook implementation for testing
+
+// Price levels the native depth tracker keeps visible
+const DEPTH_LEVELS = 5;
+
+// Aggregate sorted orders by price, best first, up to DEPTH_LEVELS levels
+function visibleLevels(orders) {
+  const levels = [];
+  for (const order of orders) {
+    const last = levels[levels.length - 1];
+    if (last && last.price === order.price) {
+      last.quantity += order.quantity;
+    } else if (levels.length < DEPTH_LEVELS) {
+      levels.push({ price: order.price, quantity: order.quantity });
+    } else {
+      break;
+    }
+  }
+  return levels;
+}
+
 class OrderBook {
   constructor(symbol = 'default') {
     this.symbol = symbol;
@@ -104,6 +124,32 @@ class OrderBook {
     };
   }
 
+  getAnalytics() {
+    // Same inputs as the native DepthAnalytics: the visible price levels
+    const bids = visibleLevels(this.buyOrders);
+    const asks = visibleLevels(this.sellOrders);
+    const topBid = bids[0];
+    const topAsk = asks[0];
+    const bidQuantity = bids.reduce((sum, level) => sum + level.quantity, 0);
+    const askQuantity = asks.reduce((sum, level) => sum + level.quantity, 0);
+    const total = bidQuantity + askQuantity;
+    const twoSided = topBid && topAsk;
+
+    return {
+      bestBid: topBid ? topBid.price : null,
+      bestAsk: topAsk ? topAsk.price : null,
+      spread: twoSided ? topAsk.price - topBid.price : null,
+      mid: twoSided ? (topBid.price + topAsk.price) / 2 : null,
+      microprice: twoSided
+        ? (topBid.price * topAsk.quantity + topAsk.price * topBid.quantity) /
+          (topBid.quantity + topAsk.quantity)
+        : null,
+      imbalance: total ? (bidQuantity - askQuantity) / total : 0,
+      bidQuantity,
+      askQuantity
+    };
+  }
+
   setMarketPrice(price) {
     this.marketPrice = price;
   }
@@ -3,12 +3,28 @@ const liquibook = require('./build/Release/liquibook.node');
 class OrderBook {
   constructor(symbol = 'default') {
     this.nativeOrderBook = new liquibook.OrderBook(symbol);
+    // Reused by the snapshot methods when no target is given
+    this.depthSnapshot = null;
+    this.bookSnapshot = null;
   }
 
   addOrder(isBuy, price, quantity, stopPrice = 0, allOrNone = false, immediateOrCancel = false) {
     return this.nativeOrderBook.addOrder(isBuy, price, quantity, stopPrice, allOrNone, immediateOrCancel);
   }
 
+  // Columnar batch: one native call for many orders.  results receives
+  // Batch.RESULT_FIELDS numbers per order: id, filled quantity, status
+  addOrders(isBuy, prices, quantities, stopPrices, conditions, results) {
+    return this.nativeOrderBook.addOrders(isBuy, prices, quantities,
+      stopPrices || null, conditions || null, results);
+  }
+
+  // Packed batch of Batch.RECORD_FIELDS doubles per order:
+  // isBuy, price, quantity, stopPrice, conditions
+  addOrdersPacked(records, results) {
+    return this.nativeOrderBook.addOrdersPacked(records, results);
+  }
+
   cancelOrder(orderId) {
     return this.nativeOrderBook.cancelOrder(orderId);
   }
@@ -21,15 +37,325 @@ class OrderBook {
     return this.nativeOrderBook.getOrderBook();
   }
 
+  // Frozen, and the same object until the depth changes
   getDepth() {
     return this.nativeOrderBook.getDepth();
   }
 
+  // Depth levels changed after version, by level index; a cleared level
+  // has price and quantity 0.  Pass the version of the last depth or
+  // changes applied.
+  getDepthSince(version) {
+    return this.nativeOrderBook.getDepthSince(version);
+  }
+
+  // Response documents as UTF-8 JSON Buffers, ready to send:
+  // {"symbol","timestamp","depth"|"orderBook"|"levels":{"bids","asks"}}
+  getDepthJson(timestamp = new Date().toISOString()) {
+    return this.nativeOrderBook.getDepthJson(timestamp);
+  }
+
+  getOrderBookJson(timestamp = new Date().toISOString()) {
+    return this.nativeOrderBook.getOrderBookJson(timestamp);
+  }
+
+  // count price levels per side, aggregated over the whole book, starting
+  // first levels from the top
+  getLevelsJson(first = 0, count = 20, timestamp = new Date().toISOString()) {
+    return this.nativeOrderBook.getLevelsJson(first, count, timestamp);
+  }
+
+  // Depth written into a Float64Array or BigUint64Array of at least
+  // Snapshot.DEPTH_FIELDS elements; without a target a pooled Float64Array
+  // is reused, so copy it before the next call if it must be kept
+  getDepthSnapshot(target) {
+    if (!target) {
+      if (!this.depthSnapshot) {
+        this.depthSnapshot = new Float64Array(liquibook.Snapshot.DEPTH_FIELDS);
+      }
+      target = this.depthSnapshot;
+    }
+    this.nativeOrderBook.getDepthInto(target);
+    return target;
+  }
+
+  // Every resting order written into a Float64Array; the pooled array
+  // grows to fit the book and is returned as a view of the written fields
+  getOrderBookSnapshot(target) {
+    if (target) {
+      const required = this.nativeOrderBook.getOrderBookInto(target);
+      if (required > target.length) {
+        throw new RangeError(`Order book snapshot needs ${required} fields`);
+      }
+      return target.subarray(0, required);
+    }
+    let pooled = this.bookSnapshot || new Float64Array(1024);
+    let required = this.nativeOrderBook.getOrderBookInto(pooled);
+    if (required > pooled.length) {
+      pooled = new Float64Array(Math.max(required, pooled.length * 2));
+      required = this.nativeOrderBook.getOrderBookInto(pooled);
+    }
+    this.bookSnapshot = pooled;
+    return pooled.subarray(0, required);
+  }
+
+  getAnalytics() {
+    return this.nativeOrderBook.getAnalytics();
+  }
+
   setMarketPrice(price) {
     this.nativeOrderBook.setMarketPrice(price);
   }
+
+  // Stream order events into a ring of capacity records; drain it with
+  // the returned EventStream
+  attachEvents(capacity = 65536) {
+    const stream = new EventStream(capacity);
+    this.nativeOrderBook.attachEvents(stream.buffer);
+    return stream;
+  }
+
+  detachEvents() {
+    this.nativeOrderBook.detachEvents();
+  }
+}
+
+// Every book behind one native object.  Symbols are interned to small ids
+// once; book(symbol) returns a handle with the OrderBook methods bound to
+// that id.  submit() routes a batch of Engine.COMMAND_FIELDS numbers per
+// command (type, symbol id, isBuy, price, quantity, stopPrice, conditions,
+// orderId) to the books, on threads worker threads when threads > 1.
+// Engines created with the same name share one native engine across all
+// worker_threads of the process; getDepth and getStats read snapshots
+// published after each command, so readers never wait for matching.
+class Engine {
+  constructor(threads = 0, name = null) {
+    this.nativeEngine = name === null ?
+      new liquibook.Engine(threads) : new liquibook.Engine(threads, name);
+    this.books = [];
+  }
+
+  // The process-wide engine called name, created with threads on first use
+  static shared(name = 'default', threads = 0) {
+    return new Engine(threads, name);
+  }
+
+  symbolId(symbol) {
+    return this.nativeEngine.symbolId(symbol);
+  }
+
+  symbols() {
+    return this.nativeEngine.symbols();
+  }
+
+  book(symbol) {
+    const id = this.nativeEngine.symbolId(symbol);
+    if (!this.books[id]) {
+      this.books[id] = new EngineBook(this.nativeEngine, id);
+    }
+    return this.books[id];
+  }
+
+  // results receives Engine.RESULT_FIELDS numbers per command: order id,
+  // filled quantity, status
+  submit(commands, results) {
+    return this.nativeEngine.submit(commands, results);
+  }
+
+  // Per book open orders, best prices, visible quantities and version
+  getStats() {
+    return this.nativeEngine.getStats();
+  }
+
+  getStatsInto(target) {
+    return this.nativeEngine.getStatsInto(target);
+  }
+}
+
+Engine.COMMAND_FIELDS = liquibook.Engine.COMMAND_FIELDS;
+Engine.RESULT_FIELDS = liquibook.Engine.RESULT_FIELDS;
+Engine.STATS_FIELDS = liquibook.Engine.STATS_FIELDS;
+Engine.ADD = liquibook.Engine.ADD;
+Engine.CANCEL = liquibook.Engine.CANCEL;
+Engine.REPLACE = liquibook.Engine.REPLACE;
+
+class EngineBook {
+  constructor(nativeEngine, symbolId) {
+    this.nativeEngine = nativeEngine;
+    this.symbolId = symbolId;
+  }
+
+  addOrder(isBuy, price, quantity, stopPrice = 0, allOrNone = false, immediateOrCancel = false) {
+    return this.nativeEngine.addOrder(this.symbolId, isBuy, price, quantity, stopPrice, allOrNone, immediateOrCancel);
+  }
+
+  cancelOrder(orderId) {
+    return this.nativeEngine.cancelOrder(this.symbolId, orderId);
+  }
+
+  replaceOrder(orderId, sizeDelta, newPrice) {
+    return this.nativeEngine.replaceOrder(this.symbolId, orderId, sizeDelta, newPrice);
+  }
+
+  getOrderBook() {
+    return this.nativeEngine.getOrderBook(this.symbolId);
+  }
+
+  getDepth() {
+    return this.nativeEngine.getDepth(this.symbolId);
+  }
+
+  getDepthSince(version) {
+    return this.nativeEngine.getDepthSince(this.symbolId, version);
+  }
+
+  getAnalytics() {
+    return this.nativeEngine.getAnalytics(this.symbolId);
+  }
+
+  getDepthJson(timestamp = new Date().toISOString()) {
+    return this.nativeEngine.getDepthJson(this.symbolId, timestamp);
+  }
+
+  getOrderBookJson(timestamp = new Date().toISOString()) {
+    return this.nativeEngine.getOrderBookJson(this.symbolId, timestamp);
+  }
+
+  getLevelsJson(first = 0, count = 20, timestamp = new Date().toISOString()) {
+    return this.nativeEngine.getLevelsJson(this.symbolId, first, count, timestamp);
+  }
+
+  setMarketPrice(price) {
+    this.nativeEngine.setMarketPrice(this.symbolId, price);
+  }
+
+  attachEvents(capacity = 65536) {
+    const stream = new EventStream(capacity);
+    this.nativeEngine.attachEvents(this.symbolId, stream.buffer);
+    return stream;
+  }
+}
+
+// Consumer side of the native event ring.  Records are Events.RECORD_FIELDS
+// numbers: sequence, type, order id, matched order id, quantity, price,
+// flags, delta.  The header is read with Atomics so the stream can be
+// drained from a worker sharing the SharedArrayBuffer.
+class EventStream {
+  constructor(capacity) {
+    const { HEADER_WORDS, RECORD_FIELDS } = liquibook.Events;
+    this.sharedBuffer = new SharedArrayBuffer(8 * (HEADER_WORDS + capacity * RECORD_FIELDS));
+    this.header = new BigUint64Array(this.sharedBuffer, 0, HEADER_WORDS);
+    this.buffer = new Float64Array(this.sharedBuffer);
+    this.records = new Float64Array(this.sharedBuffer, 8 * HEADER_WORDS);
+    this.nextSeq = 0;
+    this.gaps = 0;
+  }
+
+  // Rebuild a stream over a buffer received from another thread
+  static fromSharedBuffer(sharedBuffer) {
+    const stream = Object.create(EventStream.prototype);
+    const { HEADER_WORDS } = liquibook.Events;
+    stream.sharedBuffer = sharedBuffer;
+    stream.header = new BigUint64Array(sharedBuffer, 0, HEADER_WORDS);
+    stream.buffer = new Float64Array(sharedBuffer);
+    stream.records = new Float64Array(sharedBuffer, 8 * HEADER_WORDS);
+    stream.nextSeq = 0;
+    stream.gaps = 0;
+    return stream;
+  }
+
+  // Records waiting to be drained
+  backlog() {
+    return Number(Atomics.load(this.header, 0) - Atomics.load(this.header, 1));
+  }
+
+  // Events lost because the ring was full; non-zero means the consumer
+  // is falling behind
+  dropped() {
+    return Number(Atomics.load(this.header, 5));
+  }
+
+  highWater() {
+    return Number(Atomics.load(this.header, 6));
+  }
+
+  // Call handler(records, offset) for up to max pending records, then free
+  // their slots.  onGap(expected, received) is called when sequence
+  // numbers were skipped.  Returns the number of records drained.
+  drain(handler, max = Infinity, onGap = null) {
+    const { RECORD_FIELDS } = liquibook.Events;
+    const capacity = Number(this.header[2]);
+    const writePos = Atomics.load(this.header, 0);
+    let readPos = Atomics.load(this.header, 1);
+    let count = 0;
+    while (readPos < writePos && count < max) {
+      const offset = Number(readPos % BigInt(capacity)) * RECORD_FIELDS;
+      const seq = this.records[offset];
+      if (seq !== this.nextSeq) {
+        ++this.gaps;
+        if (onGap) {
+          onGap(this.nextSeq, seq);
+        }
+      }
+      this.nextSeq = seq + 1;
+      handler(this.records, offset);
+      ++readPos;
+      ++count;
+    }
+    Atomics.store(this.header, 1, readPos);
+    return count;
+  }
+}
+
+// Matches on a native thread; addOrder, cancelOrder, replaceOrder,
+// setMarketPrice, getOrderBook and getAnalytics return Promises settled in
+// the order they were called, getDepth reads the depth published after the
+// last matched batch
+class AsyncOrderBook {
+  constructor(symbol = 'default') {
+    this.nativeOrderBook = new liquibook.AsyncOrderBook(symbol);
+  }
+
+  // Resolves to { orderId, matched }
+  addOrder(isBuy, price, quantity, stopPrice = 0, allOrNone = false, immediateOrCancel = false) {
+    return this.nativeOrderBook.addOrder(isBuy, price, quantity, stopPrice, allOrNone, immediateOrCancel);
+  }
+
+  cancelOrder(orderId) {
+    return this.nativeOrderBook.cancelOrder(orderId);
+  }
+
+  replaceOrder(orderId, sizeDelta, newPrice) {
+    return this.nativeOrderBook.replaceOrder(orderId, sizeDelta, newPrice);
+  }
+
+  getOrderBook() {
+    return this.nativeOrderBook.getOrderBook();
+  }
+
+  getAnalytics() {
+    return this.nativeOrderBook.getAnalytics();
+  }
+
+  getDepth() {
+    return this.nativeOrderBook.getDepth();
+  }
+
+  setMarketPrice(price) {
+    return this.nativeOrderBook.setMarketPrice(price);
+  }
+
+  close() {
+    this.nativeOrderBook.close();
+  }
 }
 
 module.exports = {
-  OrderBook
+  OrderBook,
+  AsyncOrderBook,
+  Engine,
+  EventStream,
+  Batch: liquibook.Batch,
+  Events: liquibook.Events,
+  Snapshot: liquibook.Snapshot
 };
\ No newline at end of file
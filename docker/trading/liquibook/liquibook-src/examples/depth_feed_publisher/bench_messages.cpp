@@ -0,0 +1,80 @@
+#include "bench_messages.h"
+#include "template_consumer.h"
+#include <ctime>
+#include <Messages/FieldSet.h>
+#include <Messages/FieldSequence.h>
+#include <Messages/FieldString.h>
+#include <Messages/FieldUInt8.h>
+#include <Messages/FieldUInt32.h>
+#include <Messages/FieldUInt64.h>
+#include <Messages/Sequence.h>
+
+namespace liquibook { namespace examples {
+
+using namespace QuickFAST::Messages;
+
+namespace {
+  const int DEPTH_LEVELS = 5;
+
+  void
+  add_level(SequencePtr& level_seq, int level_index, uint32_t price)
+  {
+    FieldSetPtr level_fields(new FieldSet(4));
+    level_fields->addField(TemplateConsumer::id_level_num_,
+                           FieldUInt8::create(level_index));
+    level_fields->addField(TemplateConsumer::id_order_count_,
+                           FieldUInt32::create(3));
+    level_fields->addField(TemplateConsumer::id_price_,
+                           FieldUInt32::create(price));
+    level_fields->addField(TemplateConsumer::id_size_,
+                           FieldUInt32::create(500));
+    level_seq->addEntry(level_fields);
+  }
+
+  // Not measured, but required by the templates
+  void
+  add_latency_fields(FieldSet& message)
+  {
+    message.addField(TemplateConsumer::id_received_time_,
+                     FieldUInt64::create(0));
+    message.addField(TemplateConsumer::id_matched_time_,
+                     FieldUInt64::create(0));
+    message.addField(TemplateConsumer::id_published_time_,
+                     FieldUInt64::create(0));
+  }
+}
+
+void
+build_bench_depth_message(FieldSet& message,
+                          const std::string& symbol,
+                          uint32_t price)
+{
+  message.addField(TemplateConsumer::id_timestamp_,
+                   FieldUInt32::create(uint32_t(time(NULL))));
+  message.addField(TemplateConsumer::id_symbol_, FieldString::create(symbol));
+  add_latency_fields(message);
+  SequencePtr bid_seq(new Sequence(TemplateConsumer::id_bids_length_, 1));
+  SequencePtr ask_seq(new Sequence(TemplateConsumer::id_asks_length_, 1));
+  for (int index = 0; index < DEPTH_LEVELS; ++index) {
+    add_level(bid_seq, index, price - index);
+    add_level(ask_seq, index, price + 1 + index);
+  }
+  message.addField(TemplateConsumer::id_bids_, FieldSequence::create(bid_seq));
+  message.addField(TemplateConsumer::id_asks_, FieldSequence::create(ask_seq));
+}
+
+void
+build_bench_trade_message(FieldSet& message,
+                          const std::string& symbol,
+                          uint32_t qty,
+                          uint32_t cost)
+{
+  message.addField(TemplateConsumer::id_timestamp_,
+                   FieldUInt32::create(uint32_t(time(NULL))));
+  message.addField(TemplateConsumer::id_symbol_, FieldString::create(symbol));
+  add_latency_fields(message);
+  message.addField(TemplateConsumer::id_qty_, FieldUInt32::create(qty));
+  message.addField(TemplateConsumer::id_cost_, FieldUInt32::create(cost));
+}
+
+} } // End namespace
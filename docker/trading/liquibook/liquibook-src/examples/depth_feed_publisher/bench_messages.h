@@ -0,0 +1,20 @@
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <Application/QuickFAST.h>
+
+namespace liquibook { namespace examples {
+
+  // Messages for the feed benchmarks, shaped like the publisher's
+
+  // Full depth of DEPTH_LEVELS bids below price and asks above it
+  void build_bench_depth_message(QuickFAST::Messages::FieldSet& message,
+                                 const std::string& symbol,
+                                 uint32_t price);
+
+  void build_bench_trade_message(QuickFAST::Messages::FieldSet& message,
+                                 const std::string& symbol,
+                                 uint32_t qty,
+                                 uint32_t cost);
+} }
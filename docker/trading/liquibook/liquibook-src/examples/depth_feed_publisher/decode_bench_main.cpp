@@ -0,0 +1,213 @@
+// Subscriber decode throughput.  Full depth messages for a few symbols,
+// and a trade after every tenth, are encoded once, then decoded over and
+// over: first through QuickFAST's generic message builder with a lookup
+// per field and a depth map keyed by symbol, as the subscriber used to,
+// then straight into the book with DepthFeedDecoder.
+//
+//   depth_feed_decode_bench [-n messages]
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "bench_messages.h"
+#include "depth_feed_connection.h"
+#include "depth_feed_decoder.h"
+#include "template_consumer.h"
+#include <Codecs/DataSourceBuffer.h>
+#include <Codecs/Decoder.h>
+#include <Codecs/GenericMessageBuilder.h>
+#include <Codecs/SingleMessageConsumer.h>
+#include <Messages/FieldSet.h>
+#include <Messages/MessageAccessor.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+using namespace liquibook;
+using namespace liquibook::examples;
+using QuickFAST::ValueType;
+
+typedef std::map<std::string, book::Depth<5> > DepthMap;
+
+bool decode_generic(QuickFAST::Codecs::Decoder& decoder,
+                    const WorkingBufferPtr& body,
+                    DepthMap& depth_map);
+bool decode_levels(const QuickFAST::Messages::Message& msg,
+                   const QuickFAST::Messages::FieldIdentity& identity,
+                   book::DepthLevel* levels);
+int count_from_args(int argc, const char* argv[], const char* flag,
+                    int default_count);
+
+int main(int argc, const char* argv[])
+{
+  try
+  {
+    const int num_messages = count_from_args(argc, argv, "-n", 1000000);
+
+    // Encode with the publisher's connection, never opened
+    DepthFeedConnection connection(argc, argv);
+    static const char* symbols[] = {
+      "AAPL", "ADBE", "AMZN", "CSCO", "GOOG", "INTC", "MSFT", "ORCL" };
+    const size_t num_symbols = sizeof(symbols) / sizeof(symbols[0]);
+    std::vector<WorkingBufferPtr> bodies;
+    for (size_t i = 0; i < num_symbols; ++i) {
+      QuickFAST::Messages::FieldSet depth(20);
+      build_bench_depth_message(depth, symbols[i], uint32_t(1000 + i * 100));
+      bodies.push_back(connection.encode(
+          DepthFeedConnection::TID_DEPTH_MESSAGE, depth));
+    }
+    for (size_t i = 0; i < num_symbols; ++i) {
+      QuickFAST::Messages::FieldSet trade(20);
+      build_bench_trade_message(trade, symbols[i], 100, uint32_t(100000 + i));
+      bodies.push_back(connection.encode(
+          DepthFeedConnection::TID_TRADE_MESSAGE, trade));
+    }
+    // Nine depth messages to each trade
+    std::vector<WorkingBufferPtr> stream;
+    for (size_t i = 0; i < num_symbols * 10; ++i) {
+      stream.push_back(bodies[i % 10 == 9 ? num_symbols + i % num_symbols
+                                          : i % num_symbols]);
+    }
+
+    QuickFAST::Codecs::Decoder generic_decoder(connection.get_templates());
+    DepthMap depth_map;
+    boost::posix_time::ptime start =
+        boost::posix_time::microsec_clock::universal_time();
+    for (int i = 0; i < num_messages; ++i) {
+      if (!decode_generic(generic_decoder, stream[i % stream.size()],
+                          depth_map)) {
+        std::cerr << "Generic decode failed" << std::endl;
+        return -1;
+      }
+    }
+    boost::posix_time::ptime generic_done =
+        boost::posix_time::microsec_clock::universal_time();
+
+    DepthFeedDecoder decoder;
+    for (int i = 0; i < num_messages; ++i) {
+      const WorkingBufferPtr& body = stream[i % stream.size()];
+      if (!decoder.decode(body->begin(), body->size())) {
+        std::cerr << "Direct decode failed" << std::endl;
+        return -1;
+      }
+    }
+    boost::posix_time::ptime direct_done =
+        boost::posix_time::microsec_clock::universal_time();
+
+    // Both must arrive at the same depth
+    for (uint32_t id = 0; id < decoder.symbol_count(); ++id) {
+      book::Depth<5>& generic = depth_map[decoder.symbol(id)];
+      DepthFeedDecoder::SymbolDepth& direct = decoder.depth(id);
+      // Asks follow bids
+      for (int level = 0; level < 10; ++level) {
+        if (generic.bids()[level].price() != direct.bids()[level].price() ||
+            generic.bids()[level].aggregate_qty() !=
+                direct.bids()[level].aggregate_qty()) {
+          std::cerr << "Depth differs for " << decoder.symbol(id) << std::endl;
+          return -1;
+        }
+      }
+    }
+
+    double generic_secs = (generic_done - start).total_microseconds() / 1e6;
+    double direct_secs = (direct_done - generic_done).total_microseconds() / 1e6;
+    std::cout << num_messages << " messages" << std::endl;
+    std::cout << "  generic: " << generic_secs << " s, "
+              << size_t(num_messages / generic_secs) << " messages/s"
+              << std::endl;
+    std::cout << "  direct:  " << direct_secs << " s, "
+              << size_t(num_messages / direct_secs) << " messages/s"
+              << std::endl;
+  }
+  catch (const std::exception & ex)
+  {
+    std::cerr << "Exception caught at main level: " << ex.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+bool
+decode_generic(QuickFAST::Codecs::Decoder& decoder,
+               const WorkingBufferPtr& body,
+               DepthMap& depth_map)
+{
+  decoder.reset();
+  QuickFAST::Codecs::DataSourceBuffer source(body->begin(), body->size());
+  QuickFAST::Codecs::SingleMessageConsumer consumer;
+  QuickFAST::Codecs::GenericMessageBuilder builder(consumer);
+  decoder.decodeMessage(source, builder);
+  QuickFAST::Messages::Message& msg(consumer.message());
+
+  uint64_t msg_type, timestamp;
+  const QuickFAST::StringBuffer* string_buffer;
+  if (!msg.getUnsignedInteger(TemplateConsumer::id_msg_type_,
+                              ValueType::UINT32, msg_type) ||
+      !msg.getString(TemplateConsumer::id_symbol_,
+                     ValueType::ASCII, string_buffer) ||
+      !msg.getUnsignedInteger(TemplateConsumer::id_timestamp_,
+                              ValueType::UINT32, timestamp)) {
+    return false;
+  }
+  std::string symbol = (std::string)*string_buffer;
+  if (msg_type == 22) {
+    uint64_t qty, cost;
+    return msg.getUnsignedInteger(TemplateConsumer::id_qty_,
+                                  ValueType::UINT32, qty) &&
+           msg.getUnsignedInteger(TemplateConsumer::id_cost_,
+                                  ValueType::UINT32, cost);
+  }
+  book::Depth<5>& depth = depth_map.insert(
+      std::make_pair(symbol, book::Depth<5>())).first->second;
+  return decode_levels(msg, TemplateConsumer::id_bids_, depth.bids()) &&
+         decode_levels(msg, TemplateConsumer::id_asks_, depth.asks());
+}
+
+bool
+decode_levels(const QuickFAST::Messages::Message& msg,
+              const QuickFAST::Messages::FieldIdentity& identity,
+              book::DepthLevel* levels)
+{
+  size_t length;
+  if (!msg.getSequenceLength(identity, length)) {
+    return false;
+  }
+  for (size_t i = 0; i < length; ++i) {
+    const QuickFAST::Messages::MessageAccessor* accessor;
+    if (!msg.getSequenceEntry(identity, i, accessor)) {
+      return false;
+    }
+    uint64_t level_num, price, order_count, aggregate_qty;
+    bool found =
+        accessor->getUnsignedInteger(TemplateConsumer::id_level_num_,
+                                     ValueType::UINT8, level_num) &&
+        accessor->getUnsignedInteger(TemplateConsumer::id_price_,
+                                     ValueType::UINT32, price) &&
+        accessor->getUnsignedInteger(TemplateConsumer::id_order_count_,
+                                     ValueType::UINT32, order_count) &&
+        accessor->getUnsignedInteger(TemplateConsumer::id_size_,
+                                     ValueType::UINT32, aggregate_qty);
+    msg.endSequenceEntry(identity, i, accessor);
+    if (!found || level_num >= 5) {
+      return false;
+    }
+    levels[level_num].set(book::Price(price), book::Quantity(aggregate_qty),
+                          uint32_t(order_count));
+  }
+  return true;
+}
+
+int
+count_from_args(int argc, const char* argv[], const char* flag,
+                int default_count)
+{
+  bool next_is_count = false;
+  for (int i = 0; i < argc; ++i) {
+    if (next_is_count) {
+      return atoi(argv[i]);
+    } else if (strcmp(argv[i], flag) == 0) {
+      next_is_count = true;
+    }
+  }
+  return default_count;
+}
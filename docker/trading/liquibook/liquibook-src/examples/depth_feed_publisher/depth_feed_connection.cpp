@@ -1,134 +1,363 @@
 #include "depth_feed_connection.h"
+#include "latency.h"
 #include <iomanip>
 #include <boost/bind.hpp>
 #include "template_consumer.h"
-#include <Codecs/DataDestination.h>
 #include <Messages/FieldSet.h>
-#include <Messages/FieldUInt32.h>
 
 using namespace boost::asio::ip;
 
 namespace liquibook { namespace examples {
 
-QuickFAST::template_id_t DepthFeedSession::TID_TRADE_MESSAGE(1);
-QuickFAST::template_id_t DepthFeedSession::TID_DEPTH_MESSAGE(2);
+QuickFAST::template_id_t DepthFeedConnection::TID_TRADE_MESSAGE(1);
+QuickFAST::template_id_t DepthFeedConnection::TID_DEPTH_MESSAGE(2);
+const char* const SubscriptionRequest::ALL_SYMBOLS("*");
+
+void
+SubscriptionRequest::append(std::vector<unsigned char>& requests,
+                            Action action,
+                            const std::string& symbol)
+{
+  if (symbol.size() > MAX_SIZE - HEADER_SIZE) {
+    throw std::runtime_error("Symbol too long to subscribe to: " + symbol);
+  }
+  requests.push_back((unsigned char)action);
+  requests.push_back((unsigned char)symbol.size());
+  requests.insert(requests.end(), symbol.begin(), symbol.end());
+}
+
+void
+FrameHeader::set(uint32_t seq_num, size_t body_length,
+                 uint64_t encoded_time, uint64_t sent_time)
+{
+  put(bytes_.data(), seq_num);
+  put(bytes_.data() + 4, uint32_t(body_length));
+  put64(bytes_.data() + 8, encoded_time);
+  put64(bytes_.data() + 16, sent_time);
+}
+
+uint32_t
+FrameHeader::seq_num(const unsigned char* header)
+{
+  return get(header);
+}
+
+size_t
+FrameHeader::body_length(const unsigned char* header)
+{
+  return get(header + 4);
+}
+
+uint64_t
+FrameHeader::encoded_time(const unsigned char* header)
+{
+  return get64(header + 8);
+}
+
+uint64_t
+FrameHeader::sent_time(const unsigned char* header)
+{
+  return get64(header + 16);
+}
+
+void
+FrameHeader::put(unsigned char* out, uint32_t value)
+{
+  out[0] = (unsigned char)(value >> 24);
+  out[1] = (unsigned char)(value >> 16);
+  out[2] = (unsigned char)(value >> 8);
+  out[3] = (unsigned char)value;
+}
+
+uint32_t
+FrameHeader::get(const unsigned char* in)
+{
+  return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) |
+         (uint32_t(in[2]) << 8) | uint32_t(in[3]);
+}
+
+void
+FrameHeader::put64(unsigned char* out, uint64_t value)
+{
+  put(out, uint32_t(value >> 32));
+  put(out + 4, uint32_t(value));
+}
+
+uint64_t
+FrameHeader::get64(const unsigned char* in)
+{
+  return (uint64_t(get(in)) << 32) | get(in + 4);
+}
 
 DepthFeedSession::DepthFeedSession(
     boost::asio::io_service& ios,
-    DepthFeedConnection* connection,
-    QuickFAST::Codecs::TemplateRegistryPtr& templates)
+    DepthFeedConnection* connection)
 : connected_(false),
+  closing_(false),
   seq_num_(0),
+  dropped_trades_(0),
   ios_(ios),
   socket_(ios),
   connection_(connection),
-  encoder_(templates)
+  all_symbols_(false),
+  queue_(QUEUE_LIMIT * 2),
+  in_flight_(0)
 {
 }
 
-void
-DepthFeedSession::send_trade(QuickFAST::Messages::FieldSet& message)
+bool
+DepthFeedSession::set_subscribed(uint32_t symbol_id, bool subscribed)
 {
-  // Add or update sequence number in message
-  set_sequence_num(message);
-                            
-  std::cout << "sending trade message with " << message.size() << " fields" << std::endl;
+  if (subscriptions_.size() <= symbol_id) {
+    subscriptions_.resize(symbol_id + 1);
+  }
+  if (subscriptions_[symbol_id] == subscribed) {
+    return false;
+  }
+  subscriptions_[symbol_id] = subscribed;
+  if (!subscribed && !all_symbols_) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (symbol_id < sent_symbols_.size()) {
+      sent_symbols_[symbol_id] = false;
+    }
+    conflated_.erase(symbol_id);
+  }
+  return true;
+}
 
-  QuickFAST::Codecs::DataDestination dest;
-  encoder_.encodeMessage(dest, TID_TRADE_MESSAGE, message);
-  WorkingBufferPtr wb = connection_->reserve_send_buffer();
-  dest.toWorkingBuffer(*wb);
+bool
+DepthFeedSession::set_all_symbols(bool all_symbols)
+{
+  if (all_symbols_ == all_symbols) {
+    return false;
+  }
+  all_symbols_ = all_symbols;
+  if (!all_symbols) {
+    // Keep only what is subscribed to one by one
+    boost::mutex::scoped_lock lock(mutex_);
+    if (subscriptions_.size() < sent_symbols_.size()) {
+      subscriptions_.resize(sent_symbols_.size());
+    } else {
+      sent_symbols_.resize(subscriptions_.size());
+    }
+    sent_symbols_ &= subscriptions_;
+    Slots::iterator slot = conflated_.begin();
+    while (slot != conflated_.end()) {
+      if (subscriptions_[slot->first]) {
+        ++slot;
+      } else {
+        conflated_.erase(slot++);
+      }
+    }
+  }
+  return true;
+}
 
-  // Perform the send
-  SendHandler send_handler = boost::bind(&DepthFeedSession::on_send,
-                                         this, wb, _1, _2);
-  boost::asio::const_buffers_1 buffer(
-      boost::asio::buffer(wb->begin(), wb->size()));
-  socket_.async_send(buffer, 0, send_handler);
+bool
+DepthFeedSession::subscribed(uint32_t symbol_id) const
+{
+  return all_symbols_ ||
+         (symbol_id < subscriptions_.size() && subscriptions_[symbol_id]);
 }
 
 bool
-DepthFeedSession::send_incr_update(const std::string& symbol,
-                                   QuickFAST::Messages::FieldSet& message)
+DepthFeedSession::send_trade(const WorkingBufferPtr& body,
+                             uint64_t encoded_time)
 {
-  bool sent = false;
-  // If the session has been started for this symbol
-  if (sent_symbols_.find(symbol) != sent_symbols_.end()) {
-    QuickFAST::Codecs::DataDestination dest;
-    // Add or update sequence number in message
-    set_sequence_num(message);
-    encoder_.encodeMessage(dest, TID_DEPTH_MESSAGE, message);
-    WorkingBufferPtr wb = connection_->reserve_send_buffer();
-    dest.toWorkingBuffer(*wb);
-    SendHandler send_handler = boost::bind(&DepthFeedSession::on_send,
-                                           this, wb, _1, _2);
-    boost::asio::const_buffers_1 buffer(
-        boost::asio::buffer(wb->begin(), wb->size()));
-    socket_.async_send(buffer, 0, send_handler);
-    sent = true;
+  boost::mutex::scoped_lock lock(mutex_);
+  if (backed_up()) {
+    if (dropped_trades_++ == 0) {
+      std::cout << "Client behind, dropping trades" << std::endl;
+    }
+    return false;
   }
-  return sent;
+  enqueue(body, ++seq_num_, encoded_time);
+  return true;
+}
+
+bool
+DepthFeedSession::send_incr_update(uint32_t symbol_id,
+                                   const WorkingBufferPtr& body,
+                                   uint64_t encoded_time)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  // If the session has not been started for this symbol
+  if (symbol_id >= sent_symbols_.size() || !sent_symbols_[symbol_id]) {
+    return false;
+  }
+  // Behind, or already conflating: hold the change back for a full update
+  if (backed_up() || conflated_.find(symbol_id) != conflated_.end()) {
+    conflated_[symbol_id];
+    return false;
+  }
+  enqueue(body, ++seq_num_, encoded_time);
+  return true;
 }
 
 void
-DepthFeedSession::send_full_update(const std::string& symbol,
-                                   QuickFAST::Messages::FieldSet& message)
+DepthFeedSession::send_full_update(uint32_t symbol_id,
+                                   const WorkingBufferPtr& body,
+                                   uint64_t encoded_time)
 {
-  // Mark this symbols as sent
-  std::pair<StringSet::iterator, bool> result = sent_symbols_.insert(symbol);
+  boost::mutex::scoped_lock lock(mutex_);
+  // Mark this symbol as sent
+  if (sent_symbols_.size() <= symbol_id) {
+    sent_symbols_.resize(symbol_id + 1);
+  }
+  bool is_new = !sent_symbols_[symbol_id];
+  sent_symbols_[symbol_id] = true;
+  Slots::iterator slot = conflated_.find(symbol_id);
+  // Up to date with incremental updates
+  if (!is_new && slot == conflated_.end()) {
+    return;
+  }
+  if (backed_up()) {
+    // Replace whatever the slot held
+    Frame& held = conflated_[symbol_id];
+    held.encoded_time = encoded_time;
+    held.body = body;
+  } else {
+    if (slot != conflated_.end()) {
+      conflated_.erase(slot);
+    }
+    enqueue(body, ++seq_num_, encoded_time);
+  }
+}
 
-  // If this symbol is new for the session
-  if (result.second) {
-    QuickFAST::Codecs::DataDestination dest;
-    // Add or update sequence number in message
-    set_sequence_num(message);
-    encoder_.encodeMessage(dest, TID_DEPTH_MESSAGE, message);
-    WorkingBufferPtr wb = connection_->reserve_send_buffer();
-    dest.toWorkingBuffer(*wb);
+void
+DepthFeedSession::send(const WorkingBufferPtr& body, uint32_t seq_num)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  enqueue(body, seq_num, 0);
+}
 
-    // Perform the send
-    SendHandler send_handler = boost::bind(&DepthFeedSession::on_send,
-                                           this, wb, _1, _2);
-    boost::asio::const_buffers_1 buffer(
-        boost::asio::buffer(wb->begin(), wb->size()));
-    socket_.async_send(buffer, 0, send_handler);
+void
+DepthFeedSession::enqueue(const WorkingBufferPtr& body, uint32_t seq_num,
+                          uint64_t encoded_time)
+{
+  if (queue_.full()) {
+    queue_.set_capacity(queue_.capacity() * 2);
+  }
+  // Only the header is written per session; the body is shared
+  Frame frame = { seq_num, encoded_time, body };
+  queue_.push_back(frame);
+  if (!in_flight_) {
+    write_next();
   }
 }
 
 void
-DepthFeedSession::set_sequence_num(QuickFAST::Messages::FieldSet& message)
+DepthFeedSession::write_next()
 {
-  // Create the field
-  QuickFAST::Messages::FieldCPtr value = 
-      QuickFAST::Messages::FieldUInt32::create(++seq_num_);
-  // Update the sequence number
-  if (!message.replaceField(TemplateConsumer::id_seq_num_, value)) {
-    // Not found, add the sequence number
-    message.addField(TemplateConsumer::id_seq_num_, value);
+  // Gather every waiting frame, up to MAX_GATHER, into one write
+  in_flight_ = queue_.size() < MAX_GATHER ? queue_.size() : MAX_GATHER;
+  uint64_t sent_time = wall_clock_ns();
+  for (size_t i = 0; i < MAX_GATHER; ++i) {
+    if (i < in_flight_) {
+      const Frame& frame = queue_[i];
+      headers_[i].set(frame.seq_num, frame.body->size(),
+                      frame.encoded_time, sent_time);
+      gather_[i * 2] = boost::asio::buffer(headers_[i].data(),
+                                           FrameHeader::SIZE);
+      gather_[i * 2 + 1] = boost::asio::buffer(frame.body->begin(),
+                                               frame.body->size());
+    } else {
+      gather_[i * 2] = boost::asio::const_buffer();
+      gather_[i * 2 + 1] = boost::asio::const_buffer();
+    }
   }
+  boost::asio::async_write(socket_, gather_,
+      boost::bind(&DepthFeedSession::on_write, this, _1, _2));
 }
 
 void
-DepthFeedSession::on_send(WorkingBufferPtr wb,
-                          const boost::system::error_code& error,
-                          std::size_t bytes_transferred)
+DepthFeedSession::on_write(const boost::system::error_code& error,
+                           std::size_t bytes_transferred)
 {
+  boost::mutex::scoped_lock lock(mutex_);
+  // Releasing the frames lets their bodies be reused once every session
+  // is done with them
+  queue_.erase_begin(in_flight_);
   if (error) {
     std::cout << "Error " << error << " sending message" << std::endl;
     connected_ = false;
+    queue_.clear();
+    conflated_.clear();
+  } else if (queue_.empty()) {
+    // Caught up: bring conflated symbols up to date
+    flush_conflated();
   }
 
-  // Keep buffer for later
-  connection_->on_send(wb, error, bytes_transferred);
+  if (!queue_.empty()) {
+    write_next();
+  } else {
+    in_flight_ = 0;
+    if (closing_) {
+      close();
+    }
+  }
+}
+
+void
+DepthFeedSession::flush_conflated()
+{
+  Slots::iterator slot = conflated_.begin();
+  while (slot != conflated_.end()) {
+    // A slot waiting for its full update stays
+    if (slot->second.body) {
+      enqueue(slot->second.body, ++seq_num_, slot->second.encoded_time);
+      conflated_.erase(slot++);
+    } else {
+      ++slot;
+    }
+  }
+}
+
+void
+DepthFeedSession::close_when_sent()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  closing_ = true;
+  if (!in_flight_) {
+    close();
+  }
+}
+
+void
+DepthFeedSession::close()
+{
+  if (dropped_trades_) {
+    std::cout << "Closing client that missed " << dropped_trades_
+              << " trades" << std::endl;
+  }
+  boost::system::error_code ec;
+  socket_.shutdown(tcp::socket::shutdown_both, ec);
+  socket_.close(ec);
+  connected_ = false;
 }
 
 DepthFeedConnection::DepthFeedConnection(int argc, const char* argv[])
 : template_filename_(template_file_from_args(argc, argv)),
   host_(host_from_args(argc, argv)),
   port_(port_from_args(argc, argv)),
+  group_(group_from_args(argc, argv)),
+  mcast_port_(mcast_port_from_args(argc, argv)),
   templates_(TemplateConsumer::parse_templates(template_filename_)),
-  socket_(ios_)
+  encoder_(templates_),
+  snapshot_end_(new QuickFAST::WorkingBuffer()),
+  send_pool_next_(0),
+  send_pool_misses_(0),
+  all_symbols_subscribers_(0),
+  socket_(ios_),
+  mcast_socket_(ios_),
+  feed_seq_(0)
 {
+  // Allocate every body up front, so encoding does not
+  send_pool_.reserve(SEND_POOL_SIZE);
+  for (size_t i = 0; i < SEND_POOL_SIZE; ++i) {
+    send_pool_.push_back(WorkingBufferPtr(new QuickFAST::WorkingBuffer()));
+  }
+  set_subscriptions(symbols_from_args(argc, argv));
 }
 
 void
@@ -152,12 +381,76 @@ DepthFeedConnection::accept()
     acceptor_->bind(endpoint);
     acceptor_->listen();
   }
-  SessionPtr session(new DepthFeedSession(ios_, this, templates_));
+  SessionPtr session(new DepthFeedSession(ios_, this));
   acceptor_->async_accept(
       session->socket(), 
       boost::bind(&DepthFeedConnection::on_accept, this, session, _1));
 }
 
+void
+DepthFeedConnection::open_multicast()
+{
+  std::cout << "Publishing to " << group_ << ":" << mcast_port_ << std::endl;
+  mcast_endpoint_ = udp::endpoint(address::from_string(group_), mcast_port_);
+  mcast_socket_.open(mcast_endpoint_.protocol());
+  // Send through the host interface, and loop back to local subscribers
+  mcast_socket_.set_option(multicast::outbound_interface(
+      address::from_string(host_).to_v4()));
+  mcast_socket_.set_option(multicast::enable_loopback(true));
+}
+
+void
+DepthFeedConnection::join()
+{
+  std::cout << "Joining feed " << group_ << ":" << mcast_port_ << std::endl;
+  udp::endpoint endpoint(udp::v4(), mcast_port_);
+  mcast_socket_.open(endpoint.protocol());
+  mcast_socket_.set_option(udp::socket::reuse_address(true));
+  mcast_socket_.bind(endpoint);
+  mcast_socket_.set_option(multicast::join_group(
+      address::from_string(group_).to_v4(),
+      address::from_string(host_).to_v4()));
+  issue_mcast_read();
+}
+
+void
+DepthFeedConnection::request_snapshot()
+{
+  std::cout << "Requesting snapshot" << std::endl;
+  tcp::endpoint endpoint(address::from_string(host_), port_);
+  socket_.async_connect(endpoint,
+      boost::bind(&DepthFeedConnection::on_snapshot_connect, this, _1));
+}
+
+void
+DepthFeedConnection::send_snapshot_end(DepthFeedSession& session,
+                                       uint32_t seq_num)
+{
+  session.send(snapshot_end_, seq_num);
+}
+
+uint32_t
+DepthFeedConnection::send_multicast(QuickFAST::template_id_t tid,
+                                    QuickFAST::Messages::FieldSet& message)
+{
+  WorkingBufferPtr body = encode(tid, message);
+  uint64_t encoded_time = wall_clock_ns();
+  FrameHeader header;
+  header.set(++feed_seq_, body->size(), encoded_time, wall_clock_ns());
+
+  // One datagram for every subscriber
+  boost::array<boost::asio::const_buffer, 2> buffers = {{
+    boost::asio::buffer(header.data(), FrameHeader::SIZE),
+    boost::asio::buffer(body->begin(), body->size())
+  }};
+  boost::system::error_code ec;
+  mcast_socket_.send_to(buffers, mcast_endpoint_, 0, ec);
+  if (ec) {
+    std::cout << "Error " << ec << " sending multicast message" << std::endl;
+  }
+  return feed_seq_;
+}
+
 void
 DepthFeedConnection::run()
 {
@@ -179,6 +472,24 @@ DepthFeedConnection::set_reset_handler(ResetHandler handler)
   reset_handler_ = handler;
 }
 
+void
+DepthFeedConnection::set_snapshot_handler(SnapshotHandler handler)
+{
+  snapshot_handler_ = handler;
+}
+
+void
+DepthFeedConnection::set_snapshot_message_handler(MessageHandler handler)
+{
+  snapshot_msg_handler_ = handler;
+}
+
+void
+DepthFeedConnection::set_snapshot_done_handler(ResetHandler handler)
+{
+  snapshot_done_handler_ = handler;
+}
+
 BufferPtr
 DepthFeedConnection::reserve_recv_buffer()
 {
@@ -194,81 +505,187 @@ DepthFeedConnection::reserve_recv_buffer()
 WorkingBufferPtr
 DepthFeedConnection::reserve_send_buffer()
 {
-  if (unused_send_buffers_.empty()) {
-    return WorkingBufferPtr(new QuickFAST::WorkingBuffer());
-  } else {
-    WorkingBufferPtr wb = unused_send_buffers_.front();
-    unused_send_buffers_.pop_front();
-    return wb;
+  for (size_t tried = 0; tried < SEND_POOL_SIZE; ++tried) {
+    const WorkingBufferPtr& wb = send_pool_[send_pool_next_];
+    send_pool_next_ = (send_pool_next_ + 1) % SEND_POOL_SIZE;
+    // Held by no session
+    if (wb.unique()) {
+      return wb;
+    }
+  }
+  // Every body is queued somewhere; this one is freed when sent
+  if (send_pool_misses_++ == 0) {
+    std::cout << "Send pool exhausted, allocating" << std::endl;
+  }
+  return WorkingBufferPtr(new QuickFAST::WorkingBuffer());
+}
+
+uint32_t
+DepthFeedConnection::symbol_id(const std::string& symbol)
+{
+  boost::mutex::scoped_lock lock(sessions_mutex_);
+  return intern(symbol);
+}
+
+uint32_t
+DepthFeedConnection::intern(const std::string& symbol)
+{
+  std::pair<SymbolIds::iterator, bool> result = symbol_ids_.insert(
+      std::make_pair(symbol, uint32_t(symbol_ids_.size())));
+  if (result.second) {
+    subscriber_counts_.push_back(0);
+  }
+  return result.first->second;
+}
+
+bool
+DepthFeedConnection::has_subscribers(uint32_t symbol_id)
+{
+  boost::mutex::scoped_lock lock(sessions_mutex_);
+  return any_subscriber(symbol_id);
+}
+
+bool
+DepthFeedConnection::any_subscriber(uint32_t symbol_id) const
+{
+  return all_symbols_subscribers_ ||
+         (symbol_id < subscriber_counts_.size() &&
+          subscriber_counts_[symbol_id]);
+}
+
+void
+DepthFeedConnection::set_subscriptions(const char* symbols)
+{
+  subscriptions_.clear();
+  if (!symbols) {
+    SubscriptionRequest::append(subscriptions_, SubscriptionRequest::SUBSCRIBE,
+                                SubscriptionRequest::ALL_SYMBOLS);
+    return;
+  }
+  std::string list(symbols);
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    if (end > start) {
+      SubscriptionRequest::append(subscriptions_,
+                                  SubscriptionRequest::SUBSCRIBE,
+                                  list.substr(start, end - start));
+    }
+    start = end + 1;
   }
 }
 
 void
-DepthFeedConnection::send_trade(QuickFAST::Messages::FieldSet& message)
+DepthFeedConnection::send_trade(uint32_t symbol_id,
+                                QuickFAST::Messages::FieldSet& message)
 {
-  // For each session
+  std::cout << "sending trade message with " << message.size() << " fields" << std::endl;
+
+  boost::mutex::scoped_lock lock(sessions_mutex_);
+  if (!any_subscriber(symbol_id)) {
+    return;
+  }
+  // Encode once, for every session
+  WorkingBufferPtr body = encode(TID_TRADE_MESSAGE, message);
+  uint64_t encoded_time = wall_clock_ns();
   Sessions::iterator session;
   for (session = sessions_.begin(); session != sessions_.end(); ) {
     // If the session is connected
     if ((*session)->connected()) {
-      // conditionally send on that session
-      (*session)->send_trade(message);
+      // send on that session if subscribed, unless it is behind
+      if ((*session)->subscribed(symbol_id)) {
+        (*session)->send_trade(body, encoded_time);
+      }
       ++session;
     } else {
-      // Remove the session
-      session = sessions_.erase(session);
+      session = remove_session(session);
     }
   }
 }
 
 bool
-DepthFeedConnection::send_incr_update(const std::string& symbol,
+DepthFeedConnection::send_incr_update(uint32_t symbol_id,
                                       QuickFAST::Messages::FieldSet& message)
 {
   bool none_new = true;
+  boost::mutex::scoped_lock lock(sessions_mutex_);
+  if (!any_subscriber(symbol_id)) {
+    return none_new;
+  }
+  WorkingBufferPtr body = encode(TID_DEPTH_MESSAGE, message);
+  uint64_t encoded_time = wall_clock_ns();
   // For each session
   Sessions::iterator session;
   for (session = sessions_.begin(); session != sessions_.end(); ) {
     // If the session is connected
     if ((*session)->connected()) {
-      // send on that session
-      if (!(*session)->send_incr_update(symbol, message)) {
+      // send on that session if subscribed, or note that it needs a full
+      // update
+      if ((*session)->subscribed(symbol_id) &&
+          !(*session)->send_incr_update(symbol_id, body, encoded_time)) {
         none_new = false;
       }
       ++session;
     } else {
-      // Remove the session
-      session = sessions_.erase(session);
+      session = remove_session(session);
     }
   }
   return none_new;
 }
 
 void
-DepthFeedConnection::send_full_update(const std::string& symbol,
+DepthFeedConnection::send_full_update(uint32_t symbol_id,
                                       QuickFAST::Messages::FieldSet& message)
 {
+  boost::mutex::scoped_lock lock(sessions_mutex_);
+  if (!any_subscriber(symbol_id)) {
+    return;
+  }
+  WorkingBufferPtr body = encode(TID_DEPTH_MESSAGE, message);
+  uint64_t encoded_time = wall_clock_ns();
   // For each session
   Sessions::iterator session;
   for (session = sessions_.begin(); session != sessions_.end(); ) {
     // If the session is connected
     if ((*session)->connected()) {
       // conditionally send on that session
-      (*session)->send_full_update(symbol, message);
+      if ((*session)->subscribed(symbol_id)) {
+        (*session)->send_full_update(symbol_id, body, encoded_time);
+      }
       ++session;
     } else {
-      // Remove the session
-      session = sessions_.erase(session);
+      session = remove_session(session);
     }
   }
 }
 
+DepthFeedConnection::Sessions::iterator
+DepthFeedConnection::remove_session(Sessions::iterator session)
+{
+  const boost::dynamic_bitset<>& subscriptions = (*session)->subscriptions();
+  for (size_t id = subscriptions.find_first();
+       id != boost::dynamic_bitset<>::npos;
+       id = subscriptions.find_next(id)) {
+    --subscriber_counts_[id];
+  }
+  if ((*session)->all_symbols()) {
+    --all_symbols_subscribers_;
+  }
+  return sessions_.erase(session);
+}
+
 void
 DepthFeedConnection::on_connect(const boost::system::error_code& error)
 {
   if (!error) {
     std::cout << "connected to feed" << std::endl;
     reset_handler_();
+    // Ask for the symbols wanted; nothing is sent until then
+    boost::asio::async_write(socket_, boost::asio::buffer(subscriptions_),
+        boost::bind(&DepthFeedConnection::on_subscriptions_sent, this, _1, _2));
     issue_read();
   } else {
     std::cout << "on_connect, error=" << error << std::endl;
@@ -285,8 +702,28 @@ DepthFeedConnection::on_accept(SessionPtr session,
 {
   if (!error) {
     std::cout << "accepted client connection" << std::endl;
+    boost::mutex::scoped_lock lock(sessions_mutex_);
+    if (multicast()) {
+      // Forget snapshot sessions already answered
+      Sessions::iterator done;
+      for (done = sessions_.begin(); done != sessions_.end(); ) {
+        if ((*done)->connected()) {
+          ++done;
+        } else {
+          done = remove_session(done);
+        }
+      }
+    }
     sessions_.push_back(session);
     session->set_connected();
+    if (multicast()) {
+      // Answer the snapshot request, then let the client go
+      snapshot_handler_(*session);
+      session->close_when_sent();
+    } else {
+      // Sent nothing until it subscribes
+      issue_request_read(session);
+    }
   } else {
     std::cout << "on_accept, error=" << error << std::endl;
     session.reset();
@@ -296,6 +733,123 @@ DepthFeedConnection::on_accept(SessionPtr session,
   accept();
 }
 
+void
+DepthFeedConnection::issue_request_read(SessionPtr session)
+{
+  // The read holds the session until the client goes
+  boost::asio::async_read(session->socket(),
+      boost::asio::buffer(session->request(), SubscriptionRequest::HEADER_SIZE),
+      boost::bind(&DepthFeedConnection::on_request_header, this, session,
+                  _1, _2));
+}
+
+void
+DepthFeedConnection::on_request_header(SessionPtr session,
+                                       const boost::system::error_code& error,
+                                       std::size_t bytes_transferred)
+{
+  if (error == boost::asio::error::operation_aborted) {
+    // Closed already
+  } else if (error) {
+    // The client has gone; it is removed on the next send
+    session->close_when_sent();
+  } else {
+    size_t symbol_length = session->request()[1];
+    boost::asio::async_read(session->socket(),
+        boost::asio::buffer(
+            session->request() + SubscriptionRequest::HEADER_SIZE,
+            symbol_length),
+        boost::bind(&DepthFeedConnection::on_request, this, session,
+                    _1, _2));
+  }
+}
+
+void
+DepthFeedConnection::on_request(SessionPtr session,
+                                const boost::system::error_code& error,
+                                std::size_t bytes_transferred)
+{
+  if (error == boost::asio::error::operation_aborted) {
+    // Closed already
+  } else if (error) {
+    session->close_when_sent();
+  } else {
+    const unsigned char* request = session->request();
+    std::string symbol(
+        (const char*)request + SubscriptionRequest::HEADER_SIZE,
+        bytes_transferred);
+    {
+      boost::mutex::scoped_lock lock(sessions_mutex_);
+      subscribe(*session, SubscriptionRequest::Action(request[0]), symbol);
+    }
+    issue_request_read(session);
+  }
+}
+
+void
+DepthFeedConnection::subscribe(DepthFeedSession& session,
+                               SubscriptionRequest::Action action,
+                               const std::string& symbol)
+{
+  bool subscribing = (action == SubscriptionRequest::SUBSCRIBE);
+  if (!subscribing && action != SubscriptionRequest::UNSUBSCRIBE) {
+    std::cout << "Unknown subscription request " << int(action) << std::endl;
+    return;
+  }
+  std::cout << (subscribing ? "Subscribing to " : "Unsubscribing from ")
+            << symbol << std::endl;
+  size_t* count;
+  bool changed;
+  if (symbol == SubscriptionRequest::ALL_SYMBOLS) {
+    count = &all_symbols_subscribers_;
+    changed = session.set_all_symbols(subscribing);
+  } else {
+    uint32_t id = intern(symbol);
+    count = &subscriber_counts_[id];
+    changed = session.set_subscribed(id, subscribing);
+  }
+  if (changed) {
+    if (subscribing) {
+      ++*count;
+    } else {
+      --*count;
+    }
+  }
+}
+
+void
+DepthFeedConnection::on_subscriptions_sent(
+    const boost::system::error_code& error,
+    std::size_t bytes_transferred)
+{
+  // A broken connection is noticed by the read
+  if (error) {
+    std::cout << "Error " << error << " subscribing" << std::endl;
+  }
+}
+
+void
+DepthFeedConnection::on_receive_header(BufferPtr bp,
+                                       const boost::system::error_code& error,
+                                       std::size_t bytes_transferred)
+{
+  size_t body_length = FrameHeader::body_length(bp->data());
+  if (!error && body_length <= bp->size() - FrameHeader::SIZE) {
+    // Read the body into the same buffer
+    RecvHandler recv_handler = boost::bind(&DepthFeedConnection::on_receive,
+                                           this, bp, _1, _2);
+    boost::asio::async_read(socket_,
+        boost::asio::buffer(bp->data() + FrameHeader::SIZE, body_length),
+        recv_handler);
+  } else {
+    std::cout << "Error " << error << " receiving message header" << std::endl;
+    unused_recv_buffers_.push_back(bp);
+    socket_.close();
+    sleep(3);
+    connect();
+  }
+}
+
 void
 DepthFeedConnection::on_receive(BufferPtr bp,
                                 const boost::system::error_code& error,
@@ -305,8 +859,8 @@ DepthFeedConnection::on_receive(BufferPtr bp,
     // Next read
     issue_read();
 
-    // Handle the buffer
-    if (!msg_handler_(bp, bytes_transferred)) {
+    // Handle the message, header included
+    if (!msg_handler_(bp, FrameHeader::SIZE + bytes_transferred)) {
       socket_.close();
     }
   } else {
@@ -320,23 +874,134 @@ DepthFeedConnection::on_receive(BufferPtr bp,
 }
 
 void
-DepthFeedConnection::on_send(WorkingBufferPtr wb,
-                             const boost::system::error_code& error,
-                             std::size_t bytes_transferred)
+DepthFeedConnection::issue_read()
 {
-  // Keep buffer for later
-  unused_send_buffers_.push_back(wb);
+  // The publisher writes messages back to back, several to a write, so
+  // read each header, then its body
+  BufferPtr bp = reserve_recv_buffer();
+  RecvHandler recv_handler = boost::bind(&DepthFeedConnection::on_receive_header,
+                                         this, bp, _1, _2);
+  boost::asio::async_read(socket_,
+      boost::asio::buffer(bp->data(), FrameHeader::SIZE), recv_handler);
 }
 
 void
-DepthFeedConnection::issue_read()
+DepthFeedConnection::issue_mcast_read()
 {
   BufferPtr bp = reserve_recv_buffer();
-  RecvHandler recv_handler = boost::bind(&DepthFeedConnection::on_receive, 
+  RecvHandler recv_handler = boost::bind(&DepthFeedConnection::on_mcast_receive,
                                          this, bp, _1, _2);
-  boost::asio::mutable_buffers_1 buffer(
-      boost::asio::buffer(*bp, bp->size()));
-  socket_.async_receive(buffer, 0, recv_handler);
+  mcast_socket_.async_receive(boost::asio::buffer(*bp, bp->size()), 0,
+                              recv_handler);
+}
+
+void
+DepthFeedConnection::on_mcast_receive(BufferPtr bp,
+                                      const boost::system::error_code& error,
+                                      std::size_t bytes_transferred)
+{
+  // Next read
+  issue_mcast_read();
+  if (!error) {
+    // A datagram the handler rejects is lost like any other; the
+    // subscriber recovers from the sequence gap
+    msg_handler_(bp, bytes_transferred);
+  } else {
+    std::cout << "Error " << error << " receiving multicast message" << std::endl;
+  }
+  // Restore buffer
+  unused_recv_buffers_.push_back(bp);
+}
+
+void
+DepthFeedConnection::on_snapshot_connect(const boost::system::error_code& error)
+{
+  if (!error) {
+    issue_snapshot_read();
+  } else {
+    std::cout << "on_snapshot_connect, error=" << error << std::endl;
+    retry_snapshot();
+  }
+}
+
+void
+DepthFeedConnection::issue_snapshot_read()
+{
+  // Snapshot messages arrive back to back; read each header, then its body
+  BufferPtr bp = reserve_recv_buffer();
+  boost::asio::async_read(socket_,
+      boost::asio::buffer(bp->data(), FrameHeader::SIZE),
+      boost::bind(&DepthFeedConnection::on_snapshot_header, this, bp, _1, _2));
+}
+
+void
+DepthFeedConnection::on_snapshot_header(BufferPtr bp,
+                                        const boost::system::error_code& error,
+                                        std::size_t bytes_transferred)
+{
+  // Closing before the end frame, even at eof, leaves the snapshot
+  // incomplete
+  size_t body_length = FrameHeader::body_length(bp->data());
+  if (error || body_length > bp->size() - FrameHeader::SIZE) {
+    std::cout << "Error " << error << " receiving snapshot" << std::endl;
+    unused_recv_buffers_.push_back(bp);
+    retry_snapshot();
+    return;
+  }
+  if (body_length == 0) {
+    // The end frame carries the sequence number the snapshot is as of
+    socket_.close();
+    bool ok = snapshot_msg_handler_(bp, FrameHeader::SIZE);
+    unused_recv_buffers_.push_back(bp);
+    if (ok) {
+      snapshot_done_handler_();
+    } else {
+      retry_snapshot();
+    }
+    return;
+  }
+  boost::asio::async_read(socket_,
+      boost::asio::buffer(bp->data() + FrameHeader::SIZE, body_length),
+      boost::bind(&DepthFeedConnection::on_snapshot_body, this, bp, _1, _2));
+}
+
+void
+DepthFeedConnection::on_snapshot_body(BufferPtr bp,
+                                      const boost::system::error_code& error,
+                                      std::size_t bytes_transferred)
+{
+  if (error) {
+    std::cout << "Error " << error << " receiving snapshot" << std::endl;
+    retry_snapshot();
+  } else if (!snapshot_msg_handler_(bp, FrameHeader::SIZE + bytes_transferred)) {
+    retry_snapshot();
+  } else {
+    issue_snapshot_read();
+  }
+  // Restore buffer
+  unused_recv_buffers_.push_back(bp);
+}
+
+void
+DepthFeedConnection::retry_snapshot()
+{
+  socket_.close();
+  sleep(1);
+  request_snapshot();
+}
+
+WorkingBufferPtr
+DepthFeedConnection::encode(QuickFAST::template_id_t tid,
+                            QuickFAST::Messages::FieldSet& message)
+{
+  boost::mutex::scoped_lock lock(encode_mutex_);
+  // Start from an empty dictionary, as the subscriber does
+  encoder_.reset();
+  destination_.clear();
+  encoder_.encodeMessage(destination_, tid, message);
+  WorkingBufferPtr wb = reserve_send_buffer();
+  destination_.toWorkingBuffer(*wb);
+  return wb;
 }
 
 const char*
@@ -381,4 +1046,46 @@ DepthFeedConnection::port_from_args(int argc, const char* argv[])
   return 10003;
 }
 
+const char*
+DepthFeedConnection::group_from_args(int argc, const char* argv[])
+{
+  bool next_is_group = false;
+  for (int i = 0; i < argc; ++i) {
+    if (next_is_group) {
+      return argv[i];
+    } else if (strcmp(argv[i], "-g") == 0) {
+      next_is_group = true;
+    }
+  }
+  return NULL;
+}
+
+int
+DepthFeedConnection::mcast_port_from_args(int argc, const char* argv[])
+{
+  bool next_is_port = false;
+  for (int i = 0; i < argc; ++i) {
+    if (next_is_port) {
+      return atoi(argv[i]);
+    } else if (strcmp(argv[i], "-m") == 0) {
+      next_is_port = true;
+    }
+  }
+  return 10004;
+}
+
+const char*
+DepthFeedConnection::symbols_from_args(int argc, const char* argv[])
+{
+  bool next_is_symbols = false;
+  for (int i = 0; i < argc; ++i) {
+    if (next_is_symbols) {
+      return argv[i];
+    } else if (strcmp(argv[i], "-s") == 0) {
+      next_is_symbols = true;
+    }
+  }
+  return NULL;
+}
+
 } } // End namespace
@@ -2,21 +2,28 @@
 
 #include "asio_safe_include.h"
 #include "sleep.h"
+#include <boost/array.hpp>
+#include <boost/circular_buffer.hpp>
+#include <boost/dynamic_bitset.hpp>
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_array.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <Application/QuickFAST.h>
 #include <Common/WorkingBuffer.h>
 #include <deque>
-#include <set>
+#include <map>
+#include <vector>
+#include <Codecs/DataDestination.h>
 #include <Codecs/Encoder.h>
 #include <Codecs/TemplateRegistry_fwd.h>
 
 namespace liquibook { namespace examples {
   typedef boost::shared_ptr<QuickFAST::WorkingBuffer> WorkingBufferPtr;
   typedef std::deque<WorkingBufferPtr> WorkingBuffers;
-  typedef boost::array<unsigned char, 128> Buffer;
+  // Large enough for a full depth message in one datagram
+  typedef boost::array<unsigned char, 1024> Buffer;
   typedef boost::shared_ptr<Buffer> BufferPtr;
   typedef boost::function<bool (BufferPtr, size_t)> MessageHandler;
   typedef boost::function<void ()> ResetHandler;
@@ -25,14 +32,94 @@ namespace liquibook { namespace examples {
   typedef boost::function<void (const boost::system::error_code& error,
                                 std::size_t bytes_transferred)> RecvHandler;
 
-  class DepthFeedConnection;
+  // Every message goes out as a fixed header followed by its FAST encoded
+  // body.  Only the header differs between subscribers, so a body is
+  // encoded once and shared by every session that sends it.  The times,
+  // in nanoseconds since the epoch, are those of the stages after the
+  // body was built, for latency measurement; 0 if not measured.
+  //   [0-3]   sequence number within the session, big endian
+  //   [4-7]   length of the body, big endian
+  //   [8-15]  when encoding of the body completed, big endian
+  //   [16-23] when the write that carries it was issued, big endian
+  class FrameHeader {
+  public:
+    static const size_t SIZE = 24;
+
+    // Fill in the header for one send
+    void set(uint32_t seq_num, size_t body_length,
+             uint64_t encoded_time, uint64_t sent_time);
+
+    const unsigned char* data() const { return bytes_.data(); }
+
+    // Read the fields of a received header
+    static uint32_t seq_num(const unsigned char* header);
+    static size_t body_length(const unsigned char* header);
+    static uint64_t encoded_time(const unsigned char* header);
+    static uint64_t sent_time(const unsigned char* header);
+
+  private:
+    boost::array<unsigned char, SIZE> bytes_;
+
+    static void put(unsigned char* out, uint32_t value);
+    static uint32_t get(const unsigned char* in);
+    static void put64(unsigned char* out, uint64_t value);
+    static uint64_t get64(const unsigned char* in);
+  };
+
+  // One send on one session: its sequence number and the shared body,
+  // with when the body was encoded; the header is filled in when the frame
+  // is written
+  struct Frame {
+    uint32_t seq_num;
+    uint64_t encoded_time;
+    WorkingBufferPtr body;
+  };
 
-  // Session between a publisher and one subscriber
+  // A subscriber asks for the symbols it wants over its TCP session, and
+  // is sent nothing else.  Each request is
+  //   [0]   SUBSCRIBE or UNSUBSCRIBE
+  //   [1]   length of the symbol
+  //   [2-]  the symbol, or ALL_SYMBOLS for every one
+  class SubscriptionRequest {
+  public:
+    enum Action {
+      SUBSCRIBE = 'S',
+      UNSUBSCRIBE = 'U'
+    };
+    static const size_t HEADER_SIZE = 2;
+    static const size_t MAX_SIZE = HEADER_SIZE + 255;
+    static const char* const ALL_SYMBOLS;
+
+    // Append a request to those to be written
+    static void append(std::vector<unsigned char>& requests,
+                       Action action,
+                       const std::string& symbol);
+  };
+
+  class DepthFeedConnection;
+  class DepthFeedSession;
+  typedef boost::function<void (DepthFeedSession& session)> SnapshotHandler;
+
+  // Session between a publisher and one subscriber.  One write is in
+  // flight at a time; frames sent meanwhile wait in a queue, and the next
+  // write gathers up to MAX_GATHER of them into one writev.  Once
+  // QUEUE_LIMIT frames are waiting the subscriber has fallen behind:
+  // depth changes are conflated into one slot per symbol, holding the
+  // latest full depth, which is sent when the queue drains, and trades
+  // are dropped and counted.
+  //
+  // Symbols are known by the ids DepthFeedConnection gives them.  Which
+  // ones the session is subscribed to is changed and read under the
+  // connection's sessions lock.
   class DepthFeedSession : boost::noncopyable {
   public:
+    static const size_t QUEUE_LIMIT = 64;
+    // Frames per write; a header and a body each, within the 64 buffers
+    // asio passes to one writev
+    static const size_t MAX_GATHER = 32;
+
     DepthFeedSession(boost::asio::io_service& ios,
-                     DepthFeedConnection* connection,
-                     QuickFAST::Codecs::TemplateRegistryPtr& templates);
+                     DepthFeedConnection* connection);
 
     // Is this session connected?
     bool connected() const { return connected_; }
@@ -43,37 +130,102 @@ namespace liquibook { namespace examples {
     // Get the socket for this session
     boost::asio::ip::tcp::socket& socket() { return socket_; }
 
-    // Send a trade messsage to all clients
-    void send_trade(QuickFAST::Messages::FieldSet& message);
+    // Buffer the next subscription request is read into
+    unsigned char* request() { return request_.data(); }
+
+    // Subscribe to, or unsubscribe from, one symbol; unsubscribing drops
+    //   anything held back for it, and a later subscription starts from a
+    //   full update
+    //   return false if already so
+    bool set_subscribed(uint32_t symbol_id, bool subscribed);
+
+    // Subscribe to, or unsubscribe from, every symbol, apart from those
+    //   subscribed to one by one
+    //   return false if already so
+    bool set_all_symbols(bool all_symbols);
+
+    // Does this client want the symbol?
+    bool subscribed(uint32_t symbol_id) const;
+
+    // Symbols subscribed to one by one, and to every symbol
+    const boost::dynamic_bitset<>& subscriptions() const
+    {
+      return subscriptions_;
+    }
+    bool all_symbols() const { return all_symbols_; }
+
+    // Send a trade message, unless the queue is full
+    //   return false if dropped
+    bool send_trade(const WorkingBufferPtr& body, uint64_t encoded_time);
+
+    // Send an incremental update, if this client is up to date for the
+    //   symbol and keeping up
+    //   return false if it needs a full update instead
+    bool send_incr_update(uint32_t symbol_id,
+                          const WorkingBufferPtr& body,
+                          uint64_t encoded_time);
+
+    // Send a full update, if this client needs one for the symbol; while
+    //   the client is behind, keep it in the symbol's slot instead
+    void send_full_update(uint32_t symbol_id,
+                          const WorkingBufferPtr& body,
+                          uint64_t encoded_time);
+
+    // Send an encoded message body framed with the given sequence number;
+    //   its latency is not measured
+    void send(const WorkingBufferPtr& body, uint32_t seq_num);
+
+    // Close the session once every send has completed
+    void close_when_sent();
+
+    // Trades not sent because the client was behind
+    size_t dropped_trades() const { return dropped_trades_; }
 
-    // Send an incremental update - if this client has handled this symbol
-    //   return true if handled
-    bool send_incr_update(const std::string& symbol,
-                          QuickFAST::Messages::FieldSet& message);
-
-    // Send a full update - if the client has not yet received for this symbol
-    void send_full_update(const std::string& symbol,
-                          QuickFAST::Messages::FieldSet& message);
   private:       
     bool connected_;
+    bool closing_;
     uint32_t seq_num_;
+    size_t dropped_trades_;
 
     boost::asio::io_service& ios_;
     boost::asio::ip::tcp::socket socket_;
     DepthFeedConnection* connection_;
-    QuickFAST::Codecs::Encoder encoder_;
-
-    typedef std::set<std::string> StringSet;
-    StringSet sent_symbols_;
-
-    static QuickFAST::template_id_t TID_TRADE_MESSAGE;
-    static QuickFAST::template_id_t TID_DEPTH_MESSAGE;
-
-    void set_sequence_num(QuickFAST::Messages::FieldSet& message);
 
-    void on_send(WorkingBufferPtr wb,
-                 const boost::system::error_code& error,
-                 std::size_t bytes_transferred);
+    // By symbol id: subscribed to, and sent a full update
+    boost::dynamic_bitset<> subscriptions_;
+    bool all_symbols_;
+    boost::dynamic_bitset<> sent_symbols_;
+    boost::array<unsigned char, SubscriptionRequest::MAX_SIZE> request_;
+
+    // Frames to write, the first in_flight_ of them being written.  Room
+    // for a full queue is reserved up front; it only grows when a
+    // snapshot or a flush of conflated symbols goes beyond that.
+    typedef boost::circular_buffer<Frame> Frames;
+    Frames queue_;
+    size_t in_flight_;
+
+    // Headers and buffer list of the write in flight
+    boost::array<FrameHeader, MAX_GATHER> headers_;
+    boost::array<boost::asio::const_buffer, MAX_GATHER * 2> gather_;
+
+    // Latest full depth of each conflated symbol, as a frame yet to be
+    // numbered; its body is empty until the next full update after a
+    // change was held back
+    typedef std::map<uint32_t, Frame> Slots;
+    Slots conflated_;
+
+    // Sends come from the feed thread, completions from the IO thread
+    boost::mutex mutex_;
+
+    bool backed_up() const { return queue_.size() >= QUEUE_LIMIT; }
+    void enqueue(const WorkingBufferPtr& body, uint32_t seq_num,
+                 uint64_t encoded_time);
+    void write_next();
+    void flush_conflated();
+    void close();
+
+    void on_write(const boost::system::error_code& error,
+                  std::size_t bytes_transferred);
   };
 
   typedef boost::shared_ptr<DepthFeedSession> SessionPtr;
@@ -92,6 +244,37 @@ namespace liquibook { namespace examples {
     // Accept connection from subscriber
     void accept();
 
+    // Is the incremental feed multicast?  Then TCP connections to the
+    // publisher are snapshot requests, answered with the state of every
+    // symbol and closed.
+    bool multicast() const { return group_ != NULL; }
+
+    // Open the multicast group for sending
+    void open_multicast();
+
+    // Join the multicast group to receive
+    void join();
+
+    // Connect to the snapshot service of a multicast publisher; each
+    // message received goes to the snapshot message handler, then the
+    // snapshot done handler is called
+    void request_snapshot();
+
+    // End a snapshot with a frame that has an empty body, numbered with
+    //   the sequence number the snapshot is as of.  It is sent even when
+    //   there are no symbols, so the subscriber always learns where the
+    //   feed stands.
+    void send_snapshot_end(DepthFeedSession& session, uint32_t seq_num);
+
+    // Send a message once to the multicast group
+    //   return the sequence number it was sent with
+    uint32_t send_multicast(QuickFAST::template_id_t tid,
+                            QuickFAST::Messages::FieldSet& message);
+
+    // Encode a message once, for any number of sends
+    WorkingBufferPtr encode(QuickFAST::template_id_t tid,
+                            QuickFAST::Messages::FieldSet& message);
+
     // Let the IO service run
     void run();
 
@@ -101,22 +284,46 @@ namespace liquibook { namespace examples {
     // Set a callback to handle a reset connection
     void set_reset_handler(ResetHandler reset_handler);
 
+    // Set a callback to answer a snapshot request
+    void set_snapshot_handler(SnapshotHandler snapshot_handler);
+
+    // Set callbacks to handle the messages of a snapshot, and its end
+    void set_snapshot_message_handler(MessageHandler msg_handler);
+    void set_snapshot_done_handler(ResetHandler done_handler);
+
     // Reserve a buffer for receiving a message
     BufferPtr reserve_recv_buffer();
 
-    // Reserve a buffer for sending a message
+    // Reserve a buffer for an encoded message body from the pool, taking
+    // the next one no session still holds
     WorkingBufferPtr reserve_send_buffer();
 
-    // Send a trade messsage to all clients
-    void send_trade(QuickFAST::Messages::FieldSet& message);
+    // Bodies allocated because every pooled buffer was still being sent
+    size_t send_pool_misses() const { return send_pool_misses_; }
+
+    // Id of a symbol, given on first sight; ids are small and dense, to
+    //   index routing tables
+    uint32_t symbol_id(const std::string& symbol);
+
+    // Is any client subscribed to the symbol?  If not, there is no need
+    //   to build its messages
+    bool has_subscribers(uint32_t symbol_id);
 
-    // Send an incremental update
-    //   return true if all sessions could handle an incremental update
-    bool send_incr_update(const std::string& symbol, 
+    // Subscribe to symbols, given as a comma separated list, or to every
+    //   symbol if NULL; the requests are written on each connect
+    void set_subscriptions(const char* symbols);
+
+    // Send a trade messsage to clients subscribed to the symbol
+    void send_trade(uint32_t symbol_id,
+                    QuickFAST::Messages::FieldSet& message);
+
+    // Send an incremental update to clients subscribed to the symbol
+    //   return true if all of them could handle an incremental update
+    bool send_incr_update(uint32_t symbol_id,
                           QuickFAST::Messages::FieldSet& message);
 
     // Send a full update to those which have not yet received for this symbol
-    void send_full_update(const std::string& symbol, 
+    void send_full_update(uint32_t symbol_id,
                           QuickFAST::Messages::FieldSet& message);
 
     // Handle a connection
@@ -126,37 +333,108 @@ namespace liquibook { namespace examples {
     void on_accept(SessionPtr session,
                    const boost::system::error_code& error);
 
-    // Handle a received message
+    // Handle a received message header, then its body
+    void on_receive_header(BufferPtr bp,
+                           const boost::system::error_code& error,
+                           std::size_t bytes_transferred);
     void on_receive(BufferPtr bp,
                     const boost::system::error_code& error,
                     std::size_t bytes_transferred);
-    // Handle a sent message
-    void on_send(WorkingBufferPtr wb,
-                 const boost::system::error_code& error,
-                 std::size_t bytes_transferred);
 
+    static QuickFAST::template_id_t TID_TRADE_MESSAGE;
+    static QuickFAST::template_id_t TID_DEPTH_MESSAGE;
+    // Encoded bodies held in the send pool
+    static const size_t SEND_POOL_SIZE = 1024;
   private:
     typedef std::deque<BufferPtr> Buffers;
     typedef std::vector<SessionPtr> Sessions;
     const char* template_filename_;
     const char* host_;
     int port_;
+    const char* group_;
+    int mcast_port_;
     MessageHandler msg_handler_;
     ResetHandler reset_handler_;
+    SnapshotHandler snapshot_handler_;
+    MessageHandler snapshot_msg_handler_;
+    ResetHandler snapshot_done_handler_;
     QuickFAST::Codecs::TemplateRegistryPtr templates_;
+    // Shared by every session; reset before each message so an encoded
+    // body does not depend on what any session was sent before
+    QuickFAST::Codecs::Encoder encoder_;
+    // Reused for every message, cleared before each one
+    QuickFAST::Codecs::DataDestination destination_;
+    // Messages are encoded from the feed and the IO threads; guards the
+    // encoder and the destination
+    boost::mutex encode_mutex_;
+    // Body of the frame that ends a snapshot, always empty
+    WorkingBufferPtr snapshot_end_;
 
     Buffers        unused_recv_buffers_;
-    WorkingBuffers unused_send_buffers_;
+    // Pre-allocated encoded bodies, reused in turn; sends finish roughly
+    // in order, so the one after the last reserved is usually free
+    std::vector<WorkingBufferPtr> send_pool_;
+    size_t send_pool_next_;
+    size_t send_pool_misses_;
     Sessions sessions_;
+    // Routing: ids of symbols, and by id how many sessions are subscribed
+    // to it alone, besides those subscribed to every symbol
+    typedef std::map<std::string, uint32_t> SymbolIds;
+    SymbolIds symbol_ids_;
+    std::vector<size_t> subscriber_counts_;
+    size_t all_symbols_subscribers_;
+    // Sessions are added and subscribed by the IO thread and fed by the
+    // feed thread
+    boost::mutex sessions_mutex_;
+    // Subscription requests written on connecting
+    std::vector<unsigned char> subscriptions_;
     boost::shared_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
     boost::asio::io_service ios_;
     boost::asio::ip::tcp::socket socket_;
+    boost::asio::ip::udp::socket mcast_socket_;
+    boost::asio::ip::udp::endpoint mcast_endpoint_;
+    uint32_t feed_seq_;
     boost::shared_ptr<boost::asio::io_service::work> work_ptr_;
 
     void issue_read();
+    void issue_mcast_read();
+    void issue_request_read(SessionPtr session);
+
+    void on_request_header(SessionPtr session,
+                           const boost::system::error_code& error,
+                           std::size_t bytes_transferred);
+    void on_request(SessionPtr session,
+                    const boost::system::error_code& error,
+                    std::size_t bytes_transferred);
+    void on_subscriptions_sent(const boost::system::error_code& error,
+                               std::size_t bytes_transferred);
+    // Apply a request, with the sessions lock held
+    void subscribe(DepthFeedSession& session,
+                   SubscriptionRequest::Action action,
+                   const std::string& symbol);
+    bool any_subscriber(uint32_t symbol_id) const;
+    uint32_t intern(const std::string& symbol);
+    // Forget a disconnected session and its subscriptions
+    Sessions::iterator remove_session(Sessions::iterator session);
+    void issue_snapshot_read();
+
+    void on_mcast_receive(BufferPtr bp,
+                          const boost::system::error_code& error,
+                          std::size_t bytes_transferred);
+    void on_snapshot_connect(const boost::system::error_code& error);
+    void on_snapshot_header(BufferPtr bp,
+                            const boost::system::error_code& error,
+                            std::size_t bytes_transferred);
+    void on_snapshot_body(BufferPtr bp,
+                          const boost::system::error_code& error,
+                          std::size_t bytes_transferred);
+    void retry_snapshot();
   public:
     static const char* template_file_from_args(int argc, const char* argv[]);
     static const char* host_from_args(int argc, const char* argv[]);
     static int port_from_args(int argc, const char* argv[]);
+    static const char* group_from_args(int argc, const char* argv[]);
+    static int mcast_port_from_args(int argc, const char* argv[]);
+    static const char* symbols_from_args(int argc, const char* argv[]);
   };
 } } // End namespace
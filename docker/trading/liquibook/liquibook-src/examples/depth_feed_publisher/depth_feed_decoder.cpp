@@ -0,0 +1,248 @@
+#include "depth_feed_decoder.h"
+#include "depth_feed_connection.h"
+#include <algorithm>
+
+namespace liquibook { namespace examples {
+
+namespace {
+  // Each byte holds 7 bits of a field; the last byte of a field has the
+  // stop bit set
+  const unsigned char STOP_BIT = 0x80;
+  const unsigned char DATA_BITS = 0x7F;
+}
+
+const uint32_t DepthFeedDecoder::NO_SYMBOL(0xFFFFFFFF);
+
+DepthFeedDecoder::DepthFeedDecoder()
+: pos_(NULL),
+  end_(NULL),
+  pmap_(0),
+  pmap_bits_(0),
+  msg_type_(msg_none),
+  symbol_id_(NO_SYMBOL),
+  symbol_slots_(INITIAL_SYMBOLS * 2, NO_SYMBOL)
+{
+  symbols_.reserve(INITIAL_SYMBOLS);
+  depths_.reserve(INITIAL_SYMBOLS);
+  for (int i = 0; i < FIELD_COUNT; ++i) {
+    values_[i] = 0;
+    defined_[i] = false;
+  }
+}
+
+bool
+DepthFeedDecoder::decode(const unsigned char* body, size_t length)
+{
+  pos_ = body;
+  end_ = body + length;
+  msg_type_ = msg_none;
+  // The publisher resets its encoder before every message
+  for (int i = 0; i < FIELD_COUNT; ++i) {
+    defined_[i] = false;
+  }
+
+  // The template id is always present after a reset
+  uint64_t tid;
+  if (!read_pmap() || !next_pmap_bit() || !read_uint(tid)) {
+    return false;
+  }
+  // MessageType is a constant, so never sent
+  if (!read_copy(f_timestamp) ||
+      !read_copy(f_received_time) ||
+      !read_copy(f_matched_time) ||
+      !read_copy(f_published_time) ||
+      !read_symbol()) {
+    return false;
+  }
+  if (tid == DepthFeedConnection::TID_TRADE_MESSAGE) {
+    if (!read_copy(f_qty) || !read_copy(f_cost)) {
+      return false;
+    }
+    msg_type_ = msg_trade;
+  } else if (tid == DepthFeedConnection::TID_DEPTH_MESSAGE) {
+    // Only changed levels are sent, so start from the current ones
+    SymbolDepth& symbol_depth = depths_[symbol_id_];
+    std::copy(symbol_depth.bids(), symbol_depth.bids() + DEPTH_LEVELS, bids_);
+    std::copy(symbol_depth.asks(), symbol_depth.asks() + DEPTH_LEVELS, asks_);
+    if (!read_levels(bids_) || !read_levels(asks_) || pos_ != end_) {
+      return false;
+    }
+    std::copy(bids_, bids_ + DEPTH_LEVELS, symbol_depth.bids());
+    std::copy(asks_, asks_ + DEPTH_LEVELS, symbol_depth.asks());
+    msg_type_ = msg_depth;
+    return true;
+  } else {
+    return false;
+  }
+  return pos_ == end_;
+}
+
+bool
+DepthFeedDecoder::read_levels(book::DepthLevel* levels)
+{
+  // Sequence length has no operator, so no presence map bit
+  uint64_t entries;
+  if (!read_uint(entries) || entries > uint64_t(DEPTH_LEVELS)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < entries; ++i) {
+    // Each entry has a presence map of its own
+    if (!read_pmap() ||
+        !read_copy(f_level_num) ||
+        !read_copy(f_order_count) ||
+        !read_copy(f_price) ||
+        !read_copy(f_aggregate_qty)) {
+      return false;
+    }
+    uint64_t level_num = values_[f_level_num];
+    if (level_num >= uint64_t(DEPTH_LEVELS)) {
+      return false;
+    }
+    levels[level_num].set(book::Price(values_[f_price]),
+                          book::Quantity(values_[f_aggregate_qty]),
+                          uint32_t(values_[f_order_count]));
+  }
+  return true;
+}
+
+bool
+DepthFeedDecoder::read_pmap()
+{
+  pmap_ = 0;
+  pmap_bits_ = 0;
+  while (pos_ != end_) {
+    unsigned char byte = *pos_++;
+    // 63 bits are more than any template here needs
+    if (pmap_bits_ == 63) {
+      return false;
+    }
+    pmap_ = (pmap_ << 7) | (byte & DATA_BITS);
+    pmap_bits_ += 7;
+    if (byte & STOP_BIT) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+DepthFeedDecoder::next_pmap_bit()
+{
+  // Bits past the end of the map are zero
+  if (pmap_bits_ == 0) {
+    return false;
+  }
+  --pmap_bits_;
+  return ((pmap_ >> pmap_bits_) & 1) != 0;
+}
+
+bool
+DepthFeedDecoder::read_uint(uint64_t& value)
+{
+  uint64_t result = 0;
+  while (pos_ != end_) {
+    // Another 7 bits would overflow
+    if (result >> 57) {
+      return false;
+    }
+    unsigned char byte = *pos_++;
+    result = (result << 7) | (byte & DATA_BITS);
+    if (byte & STOP_BIT) {
+      value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+DepthFeedDecoder::read_copy(Field field)
+{
+  if (next_pmap_bit()) {
+    if (!read_uint(values_[field])) {
+      return false;
+    }
+    defined_[field] = true;
+    return true;
+  }
+  // Absent: the previous value, which must exist
+  return defined_[field];
+}
+
+bool
+DepthFeedDecoder::read_symbol()
+{
+  // Always present after a reset
+  if (!next_pmap_bit()) {
+    return false;
+  }
+  char symbol[MAX_SYMBOL_LENGTH];
+  size_t length = 0;
+  while (pos_ != end_) {
+    unsigned char byte = *pos_++;
+    if (length == MAX_SYMBOL_LENGTH) {
+      return false;
+    }
+    symbol[length++] = char(byte & DATA_BITS);
+    if (byte & STOP_BIT) {
+      // A lone stop bit is the empty string
+      if (length == 1 && symbol[0] == 0) {
+        length = 0;
+      }
+      symbol_id_ = intern(symbol, length);
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t
+DepthFeedDecoder::intern(const char* symbol, size_t length)
+{
+  size_t mask = symbol_slots_.size() - 1;
+  size_t slot = hash(symbol, length) & mask;
+  while (symbol_slots_[slot] != NO_SYMBOL) {
+    const std::string& known = symbols_[symbol_slots_[slot]];
+    if (known.size() == length && known.compare(0, length, symbol, length) == 0) {
+      return symbol_slots_[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  uint32_t id = uint32_t(symbols_.size());
+  symbols_.push_back(std::string(symbol, length));
+  depths_.push_back(SymbolDepth());
+  symbol_slots_[slot] = id;
+  // Keep the index at most half full
+  if (symbols_.size() * 2 > symbol_slots_.size()) {
+    grow_symbol_slots();
+  }
+  return id;
+}
+
+void
+DepthFeedDecoder::grow_symbol_slots()
+{
+  symbol_slots_.assign(symbol_slots_.size() * 2, NO_SYMBOL);
+  size_t mask = symbol_slots_.size() - 1;
+  for (uint32_t id = 0; id < symbols_.size(); ++id) {
+    size_t slot = hash(symbols_[id].data(), symbols_[id].size()) & mask;
+    while (symbol_slots_[slot] != NO_SYMBOL) {
+      slot = (slot + 1) & mask;
+    }
+    symbol_slots_[slot] = id;
+  }
+}
+
+uint32_t
+DepthFeedDecoder::hash(const char* symbol, size_t length)
+{
+  // FNV-1a
+  uint32_t result = 2166136261u;
+  for (size_t i = 0; i < length; ++i) {
+    result = (result ^ (unsigned char)symbol[i]) * 16777619u;
+  }
+  return result;
+}
+
+} } // End namespace
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+#include "book/depth.h"
+
+namespace liquibook { namespace examples {
+
+  // Decodes the Trade and Depth templates of templates/depth.xml straight
+  // from the FAST encoded body, without building a generic message.  Each
+  // symbol is interned to a small id on first sight; depth messages are
+  // applied to that symbol's depth once the whole body has been read.
+  //
+  // Only what the publisher sends is handled: every body is encoded from
+  // an empty dictionary, fields are mandatory and use the copy operator,
+  // and the dictionary is keyed by field name.
+  class DepthFeedDecoder {
+  public:
+    static const int DEPTH_LEVELS = 5;
+    typedef book::Depth<DEPTH_LEVELS> SymbolDepth;
+
+    enum MessageType {
+      msg_none,
+      msg_trade,
+      msg_depth
+    };
+
+    DepthFeedDecoder();
+
+    // Decode one message body
+    //   return false if it is malformed or of an unknown template
+    bool decode(const unsigned char* body, size_t length);
+
+    // Fields of the last message decoded
+    MessageType msg_type() const { return msg_type_; }
+    uint32_t symbol_id() const { return symbol_id_; }
+    uint32_t timestamp() const { return uint32_t(values_[f_timestamp]); }
+    uint32_t trade_qty() const { return uint32_t(values_[f_qty]); }
+    uint32_t trade_cost() const { return uint32_t(values_[f_cost]); }
+
+    // Latency of the command the message follows from, in nanoseconds
+    // since the epoch; 0 if not measured
+    uint64_t received_time() const { return values_[f_received_time]; }
+    uint64_t matched_time() const { return values_[f_matched_time]; }
+    uint64_t published_time() const { return values_[f_published_time]; }
+
+    // Symbols seen so far, by id
+    size_t symbol_count() const { return symbols_.size(); }
+    const std::string& symbol(uint32_t id) const { return symbols_[id]; }
+    SymbolDepth& depth(uint32_t id) { return depths_[id]; }
+
+  private:
+    // Copy operator dictionary entries
+    enum Field {
+      f_timestamp,
+      f_received_time,
+      f_matched_time,
+      f_published_time,
+      f_qty,
+      f_cost,
+      f_level_num,
+      f_order_count,
+      f_price,
+      f_aggregate_qty,
+      FIELD_COUNT
+    };
+
+    // Room reserved up front, so the first symbols do not reallocate
+    static const size_t INITIAL_SYMBOLS = 1024;
+    static const size_t MAX_SYMBOL_LENGTH = 64;
+    static const uint32_t NO_SYMBOL;
+
+    // Position in the body being decoded and its presence map
+    const unsigned char* pos_;
+    const unsigned char* end_;
+    uint64_t pmap_;
+    size_t pmap_bits_;
+
+    MessageType msg_type_;
+    uint32_t symbol_id_;
+    uint64_t values_[FIELD_COUNT];
+    bool defined_[FIELD_COUNT];
+
+    // Levels of the depth message being decoded, kept apart from the
+    // symbol's depth until the body checks out
+    book::DepthLevel bids_[DEPTH_LEVELS];
+    book::DepthLevel asks_[DEPTH_LEVELS];
+
+    std::vector<std::string> symbols_;
+    std::vector<SymbolDepth> depths_;
+    // Open addressed index of symbols_, a power of two in size
+    std::vector<uint32_t> symbol_slots_;
+
+    bool read_pmap();
+    bool next_pmap_bit();
+    bool read_uint(uint64_t& value);
+    bool read_copy(Field field);
+    bool read_symbol();
+    bool read_levels(book::DepthLevel* levels);
+
+    uint32_t intern(const char* symbol, size_t length);
+    void grow_symbol_slots();
+    static uint32_t hash(const char* symbol, size_t length);
+  };
+} }
@@ -1,6 +1,7 @@
 #include <iomanip>
 #include <fstream>
 #include "depth_feed_publisher.h"
+#include "latency.h"
 #include <Codecs/DataDestination.h>
 #include <Codecs/XMLTemplateParser.h>
 #include <Messages/FieldIdentity.h>
@@ -9,6 +10,7 @@
 #include <Messages/FieldString.h>
 #include <Messages/FieldUInt8.h>
 #include <Messages/FieldUInt32.h>
+#include <Messages/FieldUInt64.h>
 #include <Messages/Sequence.h>
 
 namespace liquibook { namespace examples { 
@@ -16,7 +18,8 @@ namespace liquibook { namespace examples {
 using namespace QuickFAST::Messages;
 
 DepthFeedPublisher::DepthFeedPublisher()
-: connection_(NULL)
+: connection_(NULL),
+  last_seq_num_(0)
 {
 }
 
@@ -33,14 +36,27 @@ DepthFeedPublisher::on_trade(
     book::Cost cost)
 {
   // Publish trade
-  QuickFAST::Messages::FieldSet message(20);
+  uint64_t published_time = wall_clock_ns();
   const ExampleOrderBook* exob = 
           dynamic_cast<const ExampleOrderBook*>(order_book);
+  uint32_t symbol_id = connection_->symbol_id(exob->symbol());
+  if (!wanted(symbol_id)) {
+    return;
+  }
+  QuickFAST::Messages::FieldSet message(20);
   std::cout << "Got trade for " << exob->symbol() 
             << " qty " << qty
             << " cost " << cost << std::endl;
   build_trade_message(message, exob->symbol(), qty, cost);
-  connection_->send_trade(message);
+  add_latency_fields(message, exob->received_time(), exob->matched_time(),
+                     published_time);
+  if (connection_->multicast()) {
+    boost::mutex::scoped_lock lock(snapshot_mutex_);
+    last_seq_num_ = connection_->send_multicast(
+        DepthFeedConnection::TID_TRADE_MESSAGE, message);
+  } else {
+    connection_->send_trade(symbol_id, message);
+  }
 }
 
 void
@@ -49,18 +65,75 @@ DepthFeedPublisher::on_depth_change(
     const book::DepthOrderBook<OrderPtr>::DepthTracker* tracker)
 {
   // Publish changed levels of order book
-  QuickFAST::Messages::FieldSet message(20);
+  uint64_t published_time = wall_clock_ns();
   const ExampleOrderBook* exob = 
           dynamic_cast<const ExampleOrderBook*>(order_book);
+  uint32_t symbol_id = connection_->symbol_id(exob->symbol());
+  if (!wanted(symbol_id)) {
+    return;
+  }
+  QuickFAST::Messages::FieldSet message(20);
   build_depth_message(message, exob->symbol(), tracker, false);
-  if (!connection_->send_incr_update(exob->symbol(), message)) {
+  add_latency_fields(message, exob->received_time(), exob->matched_time(),
+                     published_time);
+  if (connection_->multicast()) {
+    // Send the change once, and keep the depth it leads to for snapshots
+    boost::mutex::scoped_lock lock(snapshot_mutex_);
+    last_seq_num_ = connection_->send_multicast(
+        DepthFeedConnection::TID_DEPTH_MESSAGE, message);
+    DepthLevels& levels = depths_[exob->symbol()];
+    std::copy(tracker->bids(), tracker->bids() + DEPTH_LEVELS, levels.begin());
+    std::copy(tracker->asks(), tracker->asks() + DEPTH_LEVELS,
+              levels.begin() + DEPTH_LEVELS);
+  } else if (!connection_->send_incr_update(symbol_id, message)) {
     // Publish all levels of order book
     QuickFAST::Messages::FieldSet full_message(20);
     build_depth_message(full_message, exob->symbol(), tracker, true);
-    connection_->send_full_update(exob->symbol(), full_message);
+    add_latency_fields(full_message, exob->received_time(),
+                       exob->matched_time(), published_time);
+    connection_->send_full_update(symbol_id, full_message);
+  }
+}
+
+bool
+DepthFeedPublisher::wanted(uint32_t symbol_id)
+{
+  // The multicast group, and snapshots, carry every symbol
+  return connection_->multicast() || connection_->has_subscribers(symbol_id);
+}
+
+void
+DepthFeedPublisher::send_snapshot(DepthFeedSession& session)
+{
+  boost::mutex::scoped_lock lock(snapshot_mutex_);
+  std::cout << "Sending snapshot of " << depths_.size()
+            << " symbols at " << last_seq_num_ << std::endl;
+  DepthMap::const_iterator depth;
+  for (depth = depths_.begin(); depth != depths_.end(); ++depth) {
+    QuickFAST::Messages::FieldSet message(20);
+    build_depth_message(message, depth->first, depth->second.data(),
+                        depth->second.data() + DEPTH_LEVELS, 0, true);
+    // Not a response to any one command
+    add_latency_fields(message, 0, 0, 0);
+    session.send(connection_->encode(DepthFeedConnection::TID_DEPTH_MESSAGE,
+                                     message),
+                 last_seq_num_);
   }
+  connection_->send_snapshot_end(session, last_seq_num_);
 }
- 
+
+void
+DepthFeedPublisher::add_latency_fields(
+    QuickFAST::Messages::FieldSet& message,
+    uint64_t received_time,
+    uint64_t matched_time,
+    uint64_t published_time)
+{
+  message.addField(id_received_time_, FieldUInt64::create(received_time));
+  message.addField(id_matched_time_, FieldUInt64::create(matched_time));
+  message.addField(id_published_time_, FieldUInt64::create(published_time));
+}
+
 void
 DepthFeedPublisher::build_trade_message(
     QuickFAST::Messages::FieldSet& message,
@@ -80,55 +153,51 @@ DepthFeedPublisher::build_depth_message(
     const std::string& symbol,
     const book::DepthOrderBook<OrderPtr>::DepthTracker* tracker,
     bool full_message)
+{
+  build_depth_message(message, symbol, tracker->bids(), tracker->asks(),
+                      tracker->last_published_change(), full_message);
+}
+
+void
+DepthFeedPublisher::build_depth_message(
+    QuickFAST::Messages::FieldSet& message,
+    const std::string& symbol,
+    const book::DepthLevel* bids,
+    const book::DepthLevel* asks,
+    book::ChangeId last_published_change,
+    bool full_message)
 {
   size_t bid_count(0), ask_count(0);
 
   message.addField(id_timestamp_, FieldUInt32::create(time_stamp()));
   message.addField(id_symbol_, FieldString::create(symbol));
 
-  // Build the changed levels
-  book::ChangeId last_published_change = tracker->last_published_change();
-  
   // Build changed bids
   {
-    SequencePtr bids(new Sequence(id_bids_length_, 1));
-    int index = 0;
-    const book::DepthLevel* bid = tracker->bids();
+    SequencePtr bid_seq(new Sequence(id_bids_length_, 1));
     // Create sequence of bids
-    while (true) {
+    for (int index = 0; index < DEPTH_LEVELS; ++index) {
+      const book::DepthLevel* bid = bids + index;
       if (full_message || bid->changed_since(last_published_change)) {
-        build_depth_level(bids, bid, index);
+        build_depth_level(bid_seq, bid, index);
         ++bid_count;
       }
-      ++index;
-      if (bid == tracker->last_bid_level()) {
-        break;
-      } else {
-        ++bid;
-      }
     }
-    message.addField(id_bids_, FieldSequence::create(bids));
+    message.addField(id_bids_, FieldSequence::create(bid_seq));
   }
 
   // Build changed asks
   {
-    SequencePtr asks(new Sequence(id_asks_length_, 1));
-    int index = 0;
-    const book::DepthLevel* ask = tracker->asks();
+    SequencePtr ask_seq(new Sequence(id_asks_length_, 1));
     // Create sequence of asks
-    while (true) {
+    for (int index = 0; index < DEPTH_LEVELS; ++index) {
+      const book::DepthLevel* ask = asks + index;
       if (full_message || ask->changed_since(last_published_change)) {
-        build_depth_level(asks, ask, index);
+        build_depth_level(ask_seq, ask, index);
         ++ask_count;
       }
-      ++index;
-      if (ask == tracker->last_ask_level()) {
-        break;
-      } else {
-        ++ask;
-      }
     }
-    message.addField(id_asks_, FieldSequence::create(asks));
+    message.addField(id_asks_, FieldSequence::create(ask_seq));
   }
   std::cout << "Encoding " << (full_message ? "full" : "incr")
             << " depth message for symbol " << symbol 
@@ -6,7 +6,9 @@
 #include <boost/operators.hpp>
 #include <boost/scoped_array.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <cstring>
+#include <map>
 #include <sstream>
 #include <vector>
 
@@ -34,9 +36,34 @@ public:
   virtual void on_depth_change(
       const book::DepthOrderBook<OrderPtr>* order_book,
       const book::DepthOrderBook<OrderPtr>::DepthTracker* tracker);
+
+  // Answer a snapshot request with the depth of every symbol, each
+  // tagged with the sequence number of the last multicast message
+  void send_snapshot(DepthFeedSession& session);
 private:
+  static const int DEPTH_LEVELS = 5;
+  // Bid levels, then ask levels
+  typedef boost::array<book::DepthLevel, DEPTH_LEVELS * 2> DepthLevels;
+  typedef std::map<std::string, DepthLevels> DepthMap;
+
   DepthFeedConnection* connection_;
 
+  // Multicast feed: depth as of the last message sent, for snapshots
+  boost::mutex snapshot_mutex_;
+  DepthMap depths_;
+  uint32_t last_seq_num_;
+
+  // Does anyone want messages for the symbol?  If not, they are neither
+  // built nor encoded
+  bool wanted(uint32_t symbol_id);
+
+  // Add the latency of the command a message follows from
+  void add_latency_fields(
+      QuickFAST::Messages::FieldSet& message,
+      uint64_t received_time,
+      uint64_t matched_time,
+      uint64_t published_time);
+
   // Build an trade message
   void build_trade_message(
       QuickFAST::Messages::FieldSet& message,
@@ -50,6 +77,14 @@ private:
       const std::string& symbol,
       const book::DepthOrderBook<OrderPtr>::DepthTracker* tracker,
       bool full_message);
+  // Build a depth message from DEPTH_LEVELS bid and ask levels
+  void build_depth_message(
+      QuickFAST::Messages::FieldSet& message,
+      const std::string& symbol,
+      const book::DepthLevel* bids,
+      const book::DepthLevel* asks,
+      book::ChangeId last_published_change,
+      bool full_message);
   void build_depth_level(
       QuickFAST::Messages::SequencePtr& level_seq,
       const book::DepthLevel* level,
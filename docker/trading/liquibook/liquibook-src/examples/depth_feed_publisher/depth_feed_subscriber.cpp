@@ -1,24 +1,26 @@
 
 #include "order.h"
-#include <boost/scoped_ptr.hpp>
 #include "depth_feed_subscriber.h"
-#include <Codecs/DataSourceBuffer.h>
-#include <Codecs/GenericMessageBuilder.h>
-#include <Codecs/SingleMessageConsumer.h>
-#include <Messages/MessageAccessor.h>
 
 namespace liquibook { namespace examples {
 
-const uint64_t DepthFeedSubscriber::MSG_TYPE_DEPTH(11);
-const uint64_t DepthFeedSubscriber::MSG_TYPE_TRADE(22);
+const size_t DepthFeedSubscriber::MAX_PENDING(10000);
+const size_t DepthFeedSubscriber::LATENCY_REPORT_INTERVAL(1000);
+const char* const DepthFeedSubscriber::STAGE_NAMES[STAGE_COUNT] = {
+  "match", "publish", "encode", "queue", "wire", "total" };
 
-using QuickFAST::ValueType;
+DepthFeedSubscriber::DepthFeedSubscriber()
+: expected_seq_(1),
+  synced_(false),
+  recovering_(false),
+  snapshot_seq_(0)
+{
+}
 
-DepthFeedSubscriber::DepthFeedSubscriber(
-        const QuickFAST::Codecs::TemplateRegistryPtr& templates)
-: decoder_(templates),
-  expected_seq_(1)
+void
+DepthFeedSubscriber::set_snapshot_requester(ResetHandler requester)
 {
+  request_snapshot_ = requester;
 }
 
 void
@@ -28,56 +30,194 @@ DepthFeedSubscriber::handle_reset()
 }
 
 bool
-DepthFeedSubscriber::handle_message(BufferPtr& bp, size_t bytes_transferred)
+DepthFeedSubscriber::handle_message(const BufferPtr& bp,
+                                    size_t bytes_transferred)
 {
-  // Decode the message
-  QuickFAST::Codecs::DataSourceBuffer source(bp->c_array(), bytes_transferred);
-  QuickFAST::Codecs::SingleMessageConsumer consumer;
-  QuickFAST::Codecs::GenericMessageBuilder builder(consumer);
-  decoder_.decodeMessage(source, builder);
-  QuickFAST::Messages::Message& msg(consumer.message());
-
-  // Examine message contents
-  uint64_t seq_num, msg_type, timestamp;
-  const QuickFAST::StringBuffer* string_buffer;
-  std::string symbol;
-  if (!msg.getUnsignedInteger(id_seq_num_, ValueType::UINT32, seq_num)) {
-    std::cout << "Could not get seq num from msg" << std::endl;
+  uint64_t arrival_time = wall_clock_ns();
+  uint32_t seq_num;
+  if (!read_header(bp, bytes_transferred, seq_num)) {
     return false;
   }
+  if (request_snapshot_) {
+    return handle_multicast_message(bp->data(), bytes_transferred, seq_num,
+                                    arrival_time);
+  }
   if (seq_num != expected_seq_) {
     std::cout << "ERROR: Got Seq num " << seq_num << ", expected " 
               << expected_seq_ << std::endl;
     return false;
   }
-  if (!msg.getUnsignedInteger(id_msg_type_, ValueType::UINT32, msg_type)) {
-    std::cout << "Could not get msg type from msg" << std::endl;
+  ++expected_seq_;
+  return apply_message(bp->data(), arrival_time);
+}
+
+bool
+DepthFeedSubscriber::handle_snapshot_message(const BufferPtr& bp,
+                                             size_t bytes_transferred)
+{
+  uint32_t seq_num;
+  if (!read_header(bp, bytes_transferred, seq_num)) {
+    return false;
+  }
+  // Every message of a snapshot carries the sequence number it is as of
+  snapshot_seq_ = seq_num;
+  // The frame that ends the snapshot has no body
+  if (bytes_transferred == FrameHeader::SIZE) {
+    return true;
+  }
+  return apply_message(bp->data(), 0);
+}
+
+void
+DepthFeedSubscriber::handle_snapshot_done()
+{
+  std::cout << "Snapshot as of " << snapshot_seq_ << ", replaying "
+            << pending_.size() << " buffered msgs" << std::endl;
+  recovering_ = false;
+  synced_ = true;
+  expected_seq_ = snapshot_seq_ + 1;
+  replay_pending();
+}
+
+bool
+DepthFeedSubscriber::handle_multicast_message(const unsigned char* frame,
+                                              size_t length,
+                                              uint32_t seq_num,
+                                              uint64_t arrival_time)
+{
+  if (synced_) {
+    if (seq_num < expected_seq_) {
+      // Already applied
+      return true;
+    } else if (seq_num == expected_seq_) {
+      ++expected_seq_;
+      return apply_message(frame, arrival_time);
+    }
+    std::cout << "Gap: got seq num " << seq_num << ", expected "
+              << expected_seq_ << std::endl;
+    synced_ = false;
+  }
+
+  // Keep the message until the snapshot it follows has been applied
+  pending_[seq_num].assign(frame, frame + length);
+  if (pending_.size() > MAX_PENDING) {
+    pending_.erase(pending_.begin());
+  }
+  if (!recovering_) {
+    recovering_ = true;
+    request_snapshot();
+  }
+  return true;
+}
+
+void
+DepthFeedSubscriber::request_snapshot()
+{
+  snapshot_seq_ = 0;
+  request_snapshot_();
+}
+
+void
+DepthFeedSubscriber::replay_pending()
+{
+  PendingMessages::iterator msg = pending_.begin();
+  while (msg != pending_.end()) {
+    // Older messages are covered by the snapshot
+    // Held back, so not counted as live
+    if (msg->first == expected_seq_) {
+      ++expected_seq_;
+      apply_message(&msg->second[0], 0);
+    } else if (msg->first > expected_seq_) {
+      break;
+    }
+    pending_.erase(msg++);
+  }
+
+  // Still a gap: try again from a later snapshot
+  if (!pending_.empty()) {
+    synced_ = false;
+    recovering_ = true;
+    request_snapshot();
+  }
+}
+
+bool
+DepthFeedSubscriber::read_header(const BufferPtr& bp,
+                                 size_t bytes_transferred,
+                                 uint32_t& seq_num)
+{
+  // The frame header carries the sequence number and body length
+  if (bytes_transferred < FrameHeader::SIZE) {
+    std::cout << "Could not get frame header from msg" << std::endl;
     return false;
   }
-  if (!msg.getString(id_symbol_, ValueType::ASCII, string_buffer)) {
-    std::cout << "Could not get symbol from msg" << std::endl;
+  seq_num = FrameHeader::seq_num(bp->data());
+  if (FrameHeader::body_length(bp->data()) >
+      bytes_transferred - FrameHeader::SIZE) {
+    std::cout << "Truncated msg " << seq_num << std::endl;
     return false;
   }
-  if (!msg.getUnsignedInteger(id_timestamp_, ValueType::UINT32, timestamp)) {
-    std::cout << "Could not get timestamp from msg" << std::endl;
+  return true;
+}
+
+bool
+DepthFeedSubscriber::apply_message(const unsigned char* frame,
+                                   uint64_t arrival_time)
+{
+  uint64_t seq_num = FrameHeader::seq_num(frame);
+  size_t body_length = FrameHeader::body_length(frame);
+
+  // Decode the message straight into the depth of its symbol
+  if (!decoder_.decode(frame + FrameHeader::SIZE, body_length)) {
+    std::cout << "ERROR: Could not decode msg " << seq_num << std::endl;
     return false;
   }
-  bool result = false;
-  symbol = (std::string)*string_buffer;
-  switch (msg_type) {
-  case MSG_TYPE_DEPTH:
-    result = handle_depth_message(symbol, seq_num, timestamp, msg);
+  switch (decoder_.msg_type()) {
+  case DepthFeedDecoder::msg_depth:
+    handle_depth_message(seq_num);
     break;
-  case MSG_TYPE_TRADE:
-    result = handle_trade_message(symbol, seq_num, timestamp, msg);
+  case DepthFeedDecoder::msg_trade:
+    handle_trade_message(seq_num);
     break;
   default:
-    std::cout << "ERROR: Unknown message type " << msg_type 
-              << " seq num " << seq_num << std::endl;
+    std::cout << "ERROR: Unknown message type, seq num " << seq_num
+              << std::endl;
     return false;
   }
-  ++expected_seq_;
-  return result;
+  if (arrival_time) {
+    record_latency(frame, arrival_time);
+  }
+  return true;
+}
+
+void
+DepthFeedSubscriber::record_latency(const unsigned char* frame,
+                                    uint64_t arrival_time)
+{
+  uint64_t received = decoder_.received_time();
+  // Not every message follows from an order, nor is every one stamped
+  if (!received) {
+    return;
+  }
+  uint64_t matched = decoder_.matched_time();
+  uint64_t published = decoder_.published_time();
+  uint64_t encoded = FrameHeader::encoded_time(frame);
+  uint64_t sent = FrameHeader::sent_time(frame);
+  latency_[stage_match].record(int64_t(matched - received));
+  latency_[stage_publish].record(int64_t(published - matched));
+  latency_[stage_encode].record(int64_t(encoded - published));
+  latency_[stage_queue].record(int64_t(sent - encoded));
+  latency_[stage_wire].record(int64_t(arrival_time - sent));
+  latency_[stage_total].record(int64_t(arrival_time - received));
+
+  if (latency_[stage_total].count() == LATENCY_REPORT_INTERVAL) {
+    std::cout << "Latency of the last " << LATENCY_REPORT_INTERVAL
+              << " msgs (us):" << std::endl;
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+      latency_[stage].print(STAGE_NAMES[stage]);
+      latency_[stage].reset();
+    }
+  }
 }
 
 void
@@ -119,125 +259,27 @@ DepthFeedSubscriber::log_depth(book::Depth<5>& depth)
   }
 }
 
-bool
-DepthFeedSubscriber::handle_depth_message(
-  const std::string& symbol,
-  uint64_t& seq_num,
-  uint64_t& timestamp,
-  QuickFAST::Messages::Message& msg)
+void
+DepthFeedSubscriber::handle_depth_message(uint64_t seq_num)
 {
-  size_t bids_length, asks_length;
-  std::cout << timestamp
+  uint32_t symbol_id = decoder_.symbol_id();
+  std::cout << decoder_.timestamp()
             << " Got depth msg " << seq_num 
-            << " for symbol " << symbol << std::endl;
-
-  // Create or find depth
-  std::pair<DepthMap::iterator, bool> results = depth_map_.insert(
-      std::make_pair(symbol, book::Depth<5>()));
-  book::Depth<5>& depth = results.first->second;
-
-  if (msg.getSequenceLength(id_bids_, bids_length)) {
-    for (size_t i = 0; i < bids_length; ++i) {
-      const QuickFAST::Messages::MessageAccessor* accessor;
-      if (msg.getSequenceEntry(id_bids_, i, accessor)) {
-        uint64_t level_num, price, order_count, aggregate_qty;
-        if (!accessor->getUnsignedInteger(id_level_num_, ValueType::UINT8,
-                                         level_num)) {
-          std::cout << "Could not get Bid level from depth msg" << std::endl;
-          return false;
-        }
-        if (!accessor->getUnsignedInteger(id_price_, ValueType::UINT32,
-                                         price)) {
-          std::cout << "Could not get Bid price from depth msg" << std::endl;
-          return false;
-        }
-        if (!accessor->getUnsignedInteger(id_order_count_, ValueType::UINT32,
-                                         order_count)) {
-          std::cout << "Could not get Bid count from depth msg" << std::endl;
-          return false;
-        }
-        if (!accessor->getUnsignedInteger(id_size_, ValueType::UINT32,
-                                         aggregate_qty)) {
-          std::cout << "Could not get Bid agg qty  from depth msg" << std::endl;
-          return false;
-        }
-
-        book::DepthLevel& level = depth.bids()[level_num];
-        level.set(book::Price(price), book::Quantity(aggregate_qty), uint32_t(order_count));
-
-      } else {
-        std::cout << "Failed to get bid " << i << std::endl;
-        return false;
-      }
-      msg.endSequenceEntry(id_bids_, i, accessor);
-    }
-  }
-  if (msg.getSequenceLength(id_asks_, asks_length)) {
-    for (size_t i = 0; i < asks_length; ++i) {
-      const QuickFAST::Messages::MessageAccessor* accessor;
-      if (msg.getSequenceEntry(id_asks_, i, accessor)) {
-        uint64_t level_num, price, order_count, aggregate_qty;
-        if (!accessor->getUnsignedInteger(id_level_num_, ValueType::UINT8,
-                                         level_num)) {
-          std::cout << "Could not get Ask level from depth msg " << std::endl;
-          return false;
-        }
-        if (!accessor->getUnsignedInteger(id_price_, ValueType::UINT32,
-                                         price)) {
-          std::cout << "Could not get Ask price  from depth msg" << std::endl;
-          return false;
-        }
-        if (!accessor->getUnsignedInteger(id_order_count_, ValueType::UINT32,
-                                         order_count)) {
-          std::cout << "Could not get Ask count from depth msg " << std::endl;
-          return false;
-        }
-        if (!accessor->getUnsignedInteger(id_size_, ValueType::UINT32,
-                                         aggregate_qty)) {
-          std::cout << "Could not get Ask agg qty from depth msg " << std::endl;
-          return false;
-        }
-
-        book::DepthLevel& level = depth.asks()[level_num];
-        level.set(book::Price(price), book::Quantity(aggregate_qty), uint32_t(order_count));
-
-      } else {
-        std::cout << "Failed to get ask " << i << std::endl;
-        return false;
-      }
-      msg.endSequenceEntry(id_asks_, i, accessor);
-    }
-  }
-  log_depth(depth);
-  return true;
+            << " for symbol " << decoder_.symbol(symbol_id) << std::endl;
+  log_depth(decoder_.depth(symbol_id));
 }
 
-bool
-DepthFeedSubscriber::handle_trade_message(
-  const std::string& symbol,
-  uint64_t& seq_num,
-  uint64_t& timestamp,
-  QuickFAST::Messages::Message& msg)
+void
+DepthFeedSubscriber::handle_trade_message(uint64_t seq_num)
 {
-  uint64_t qty, cost;
-  // Get trade fields
-  if (!msg.getUnsignedInteger(id_qty_, ValueType::UINT32, qty)) {
-    std::cout << "Could not qty from trade msg" << std::endl;
-    return false;
-  }
-  if (!msg.getUnsignedInteger(id_cost_, ValueType::UINT32, cost)) {
-    std::cout << "Could not get cost from trade msg" << std::endl;
-    return false;
-  }
-
+  uint64_t qty = decoder_.trade_qty();
+  uint64_t cost = decoder_.trade_cost();
   double price = (double) cost / (qty * Order::precision_);
-  std::cout << timestamp
+  std::cout << decoder_.timestamp()
             << " Got trade msg " << seq_num 
-            << " for symbol " << symbol 
+            << " for symbol " << decoder_.symbol(decoder_.symbol_id())
             << ": " << qty << "@" << price
             << std::endl;
-
-  return true;
 }
 
 } }
@@ -6,48 +6,84 @@
 #include <cstring>
 #include <sstream>
 #include <vector>
-#include <Application/QuickFAST.h>
-#include <Codecs/Decoder.h>
 
-#include "template_consumer.h"
 #include "depth_feed_connection.h"
-#include "book/depth.h"
-
-namespace QuickFAST { namespace Messages {
-  class Message;
-} }
+#include "depth_feed_decoder.h"
+#include "latency.h"
 
 namespace liquibook { namespace examples {
 
-  class DepthFeedSubscriber : public TemplateConsumer {
+  class DepthFeedSubscriber {
   public:
-    DepthFeedSubscriber(
-        const QuickFAST::Codecs::TemplateRegistryPtr& templates);
+    DepthFeedSubscriber();
 
     // Handle a reset of the connection
     void handle_reset();
 
+    // Recover from sequence gaps with snapshots, as on a multicast feed;
+    // requester asks the publisher for one
+    void set_snapshot_requester(ResetHandler requester);
+
     // Handle a message
     // return false if failure
-    bool handle_message(BufferPtr& bp, size_t bytes_transferred);
+    bool handle_message(const BufferPtr& bp, size_t bytes_transferred);
+
+    // Handle a message of a snapshot, including the empty frame that ends
+    // it, and the end of the snapshot
+    bool handle_snapshot_message(const BufferPtr& bp,
+                                 size_t bytes_transferred);
+    void handle_snapshot_done();
 
   private:
-    QuickFAST::Codecs::Decoder decoder_;
-    typedef std::map<std::string, book::Depth<5> > DepthMap;
-    DepthMap depth_map_;
+    // Holds the depth of every symbol
+    DepthFeedDecoder decoder_;
     uint64_t expected_seq_;
 
-    static const uint64_t MSG_TYPE_DEPTH;
-    static const uint64_t MSG_TYPE_TRADE;
+    // Snapshot recovery: messages received while out of sequence are kept,
+    // up to MAX_PENDING, and replayed over the snapshot
+    typedef std::map<uint32_t, std::vector<unsigned char> > PendingMessages;
+    static const size_t MAX_PENDING;
+    ResetHandler request_snapshot_;
+    bool synced_;
+    bool recovering_;
+    uint64_t snapshot_seq_;
+    PendingMessages pending_;
+
+    // Ask for a snapshot, forgetting where the last one stood
+    void request_snapshot();
+
+    // Latency of each stage a live message went through, from the order
+    // reaching the exchange to the message reaching this subscriber,
+    // reported every LATENCY_REPORT_INTERVAL messages
+    enum Stage {
+      stage_match,
+      stage_publish,
+      stage_encode,
+      stage_queue,
+      stage_wire,
+      stage_total,
+      STAGE_COUNT
+    };
+    static const char* const STAGE_NAMES[STAGE_COUNT];
+    static const size_t LATENCY_REPORT_INTERVAL;
+    LatencyHistogram latency_[STAGE_COUNT];
+
+    // Handle a multicast message, recovering from any gap
+    bool handle_multicast_message(const unsigned char* frame,
+                                  size_t length,
+                                  uint32_t seq_num,
+                                  uint64_t arrival_time);
+    // Decode a message and act on it; arrival_time is 0 for messages that
+    // were not live, such as a snapshot
+    bool apply_message(const unsigned char* frame, uint64_t arrival_time);
+    void record_latency(const unsigned char* frame, uint64_t arrival_time);
+    // Check the frame header of a message
+    bool read_header(const BufferPtr& bp, size_t bytes_transferred,
+                     uint32_t& seq_num);
+    void replay_pending();
 
     void log_depth(book::Depth<5>& depth);
-    bool handle_trade_message(const std::string& symbol,
-                              uint64_t& seq_num,
-                              uint64_t& timestamp,
-                              QuickFAST::Messages::Message& msg);
-    bool handle_depth_message(const std::string& symbol,
-                              uint64_t& seq_num,
-                              uint64_t& timestamp,
-                              QuickFAST::Messages::Message& msg);
+    void handle_trade_message(uint64_t seq_num);
+    void handle_depth_message(uint64_t seq_num);
   };
 } }
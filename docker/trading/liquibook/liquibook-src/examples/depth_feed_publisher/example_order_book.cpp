@@ -1,9 +1,12 @@
 #include "example_order_book.h"
+#include "latency.h"
 
 namespace liquibook { namespace examples {
 
 ExampleOrderBook::ExampleOrderBook(const std::string& symbol)
-: symbol_(symbol)
+: symbol_(symbol),
+  received_time_(0),
+  matched_time_(0)
 {
 }
 
@@ -13,5 +16,33 @@ ExampleOrderBook::symbol() const
   return symbol_;
 }
 
+void
+ExampleOrderBook::set_received_time(uint64_t received_time)
+{
+  received_time_ = received_time;
+  matched_time_ = 0;
+}
+
+uint64_t
+ExampleOrderBook::received_time() const
+{
+  return received_time_;
+}
+
+uint64_t
+ExampleOrderBook::matched_time() const
+{
+  return matched_time_;
+}
+
+void
+ExampleOrderBook::perform_callback(TypedCallback& cb)
+{
+  if (!matched_time_) {
+    matched_time_ = wall_clock_ns();
+  }
+  book::DepthOrderBook<OrderPtr>::perform_callback(cb);
+}
+
 } } // End namespace
 
@@ -14,8 +14,20 @@ public:
   ExampleOrderBook(const std::string& symbol);
   const std::string& symbol() const;
 
+  // Latency of the command being handled, in nanoseconds since the epoch:
+  // when it reached the exchange, and when matching finished
+  void set_received_time(uint64_t received_time);
+  uint64_t received_time() const;
+  uint64_t matched_time() const;
+
+protected:
+  // Matching is done once the first callback is performed
+  virtual void perform_callback(TypedCallback& cb);
+
 private:
   std::string symbol_;
+  uint64_t received_time_;
+  uint64_t matched_time_;
 };
 
 } } // End namespace
@@ -1,4 +1,5 @@
 #include "exchange.h"
+#include "latency.h"
 
 namespace liquibook { namespace examples {
 
@@ -23,6 +24,7 @@ Exchange::add_order(const std::string& symbol, OrderPtr& order)
 {
   OrderBookMap::iterator order_book = order_books_.find(symbol);
   if (order_book != order_books_.end()) {
+    order_book->second.set_received_time(wall_clock_ns());
     order_book->second.add(order);
     order_book->second.perform_callbacks();
   }
@@ -0,0 +1,196 @@
+// Publisher throughput against loopback subscribers.  Full depth
+// messages for a few symbols are sent through the feed as fast as it
+// will take them, to subscribers that only frame and count what they
+// read; subscribers that fall behind are conflated as usual.
+//
+//   depth_feed_bench [-p port] [-c subscribers] [-n messages]
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread.hpp>
+#include "bench_messages.h"
+#include "depth_feed_connection.h"
+#include <Messages/FieldSet.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace liquibook::examples;
+using namespace QuickFAST::Messages;
+using namespace boost::asio::ip;
+
+// Connects to the feed, subscribes to every symbol, and counts the frames
+// it reads
+class LoopbackSubscriber {
+public:
+  LoopbackSubscriber(int port)
+  : port_(port),
+    frames_(0),
+    bytes_(0),
+    reads_(0)
+  {
+  }
+
+  void run()
+  {
+    boost::asio::io_service ios;
+    tcp::socket socket(ios);
+    socket.connect(tcp::endpoint(address::from_string("127.0.0.1"), port_));
+    std::vector<unsigned char> request;
+    SubscriptionRequest::append(request, SubscriptionRequest::SUBSCRIBE,
+                                SubscriptionRequest::ALL_SYMBOLS);
+    boost::asio::write(socket, boost::asio::buffer(request));
+
+    std::vector<unsigned char> buffer(1 << 16);
+    size_t held = 0;
+    size_t frames = 0;
+    size_t bytes = 0;
+    size_t reads = 0;
+    while (true) {
+      boost::system::error_code ec;
+      size_t received = socket.read_some(
+          boost::asio::buffer(&buffer[held], buffer.size() - held), ec);
+      if (ec) {
+        break;
+      }
+      held += received;
+      // Count every whole frame, keep any partial one for the next read
+      size_t offset = 0;
+      while (held - offset >= FrameHeader::SIZE) {
+        size_t frame_length = FrameHeader::SIZE +
+                              FrameHeader::body_length(&buffer[offset]);
+        if (held - offset < frame_length) {
+          break;
+        }
+        offset += frame_length;
+        ++frames;
+      }
+      std::memmove(&buffer[0], &buffer[offset], held - offset);
+      held -= offset;
+      bytes += received;
+      ++reads;
+      frames_.store(frames, boost::memory_order_relaxed);
+      bytes_.store(bytes, boost::memory_order_relaxed);
+      reads_.store(reads, boost::memory_order_relaxed);
+    }
+  }
+
+  size_t frames() const { return frames_.load(boost::memory_order_relaxed); }
+  size_t bytes() const { return bytes_.load(boost::memory_order_relaxed); }
+  size_t reads() const { return reads_.load(boost::memory_order_relaxed); }
+
+private:
+  int port_;
+  // Counted on the subscriber thread, read by the main thread; each is
+  // only a tally, so nothing is ordered around them
+  boost::atomic<size_t> frames_;
+  boost::atomic<size_t> bytes_;
+  boost::atomic<size_t> reads_;
+};
+
+int count_from_args(int argc, const char* argv[], const char* flag,
+                    int default_count);
+
+int main(int argc, const char* argv[])
+{
+  try
+  {
+    const int num_subscribers = count_from_args(argc, argv, "-c", 4);
+    const int num_messages = count_from_args(argc, argv, "-n", 1000000);
+
+    DepthFeedConnection connection(argc, argv);
+    connection.accept();
+    boost::thread io_thread(
+        boost::bind(&DepthFeedConnection::run, &connection));
+
+    std::vector<boost::shared_ptr<LoopbackSubscriber> > subscribers;
+    boost::thread_group subscriber_threads;
+    for (int i = 0; i < num_subscribers; ++i) {
+      boost::shared_ptr<LoopbackSubscriber> subscriber(
+          new LoopbackSubscriber(
+              DepthFeedConnection::port_from_args(argc, argv)));
+      subscribers.push_back(subscriber);
+      subscriber_threads.create_thread(
+          boost::bind(&LoopbackSubscriber::run, subscriber.get()));
+    }
+    // Let every session be accepted before the clock starts
+    sleep(1);
+
+    // One message per symbol, encoded afresh on every send
+    static const char* symbols[] = {
+      "AAPL", "ADBE", "AMZN", "CSCO", "GOOG", "INTC", "MSFT", "ORCL" };
+    const size_t num_symbols = sizeof(symbols) / sizeof(symbols[0]);
+    std::vector<boost::shared_ptr<FieldSet> > messages;
+    std::vector<uint32_t> symbol_ids;
+    for (size_t i = 0; i < num_symbols; ++i) {
+      symbol_ids.push_back(connection.symbol_id(symbols[i]));
+      boost::shared_ptr<FieldSet> message(new FieldSet(20));
+      build_bench_depth_message(*message, symbols[i],
+                                uint32_t(1000 + i * 100));
+      messages.push_back(message);
+    }
+
+    boost::posix_time::ptime start =
+        boost::posix_time::microsec_clock::universal_time();
+    for (int i = 0; i < num_messages; ++i) {
+      uint32_t symbol_id = symbol_ids[i % num_symbols];
+      FieldSet& message = *messages[i % num_symbols];
+      if (!connection.send_incr_update(symbol_id, message)) {
+        connection.send_full_update(symbol_id, message);
+      }
+    }
+    boost::posix_time::ptime sent =
+        boost::posix_time::microsec_clock::universal_time();
+
+    // Drained once no subscriber has read anything for a while
+    size_t last_frames = size_t(-1);
+    size_t frames = 0;
+    while (frames != last_frames) {
+      last_frames = frames;
+      boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+      frames = 0;
+      for (size_t i = 0; i < subscribers.size(); ++i) {
+        frames += subscribers[i]->frames();
+      }
+    }
+
+    double send_secs = (sent - start).total_microseconds() / 1e6;
+    std::cout << num_messages << " messages to " << num_subscribers
+              << " subscribers in " << send_secs << " s, "
+              << size_t(num_messages / send_secs) << " messages/s" << std::endl;
+    for (size_t i = 0; i < subscribers.size(); ++i) {
+      const LoopbackSubscriber& subscriber = *subscribers[i];
+      std::cout << "  subscriber " << i << ": "
+                << subscriber.frames() << " frames, "
+                << subscriber.bytes() << " bytes in "
+                << subscriber.reads() << " reads" << std::endl;
+    }
+    std::cout << "  send pool misses: " << connection.send_pool_misses()
+              << std::endl;
+    // The feed has no shutdown; leave the threads behind
+    std::exit(0);
+  }
+  catch (const std::exception & ex)
+  {
+    std::cerr << "Exception caught at main level: " << ex.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+int
+count_from_args(int argc, const char* argv[], const char* flag,
+                int default_count)
+{
+  bool next_is_count = false;
+  for (int i = 0; i < argc; ++i) {
+    if (next_is_count) {
+      return atoi(argv[i]);
+    } else if (strcmp(argv[i], flag) == 0) {
+      next_is_count = true;
+    }
+  }
+  return default_count;
+}
@@ -0,0 +1,109 @@
+#include "latency.h"
+#include <cstdio>
+#ifdef _WIN32
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#else
+#include <time.h>
+#endif
+
+namespace liquibook { namespace examples {
+
+uint64_t
+wall_clock_ns()
+{
+#ifdef _WIN32
+  static const boost::posix_time::ptime epoch(
+      boost::gregorian::date(1970, 1, 1));
+  return uint64_t((boost::posix_time::microsec_clock::universal_time() -
+                   epoch).total_microseconds()) * 1000;
+#else
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return uint64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+#endif
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+void
+LatencyHistogram::record(int64_t ns)
+{
+  uint64_t value = ns < 0 ? 0 : uint64_t(ns);
+  ++buckets_[bucket_of(value)];
+  ++count_;
+  if (value > max_) {
+    max_ = value;
+  }
+}
+
+uint64_t
+LatencyHistogram::percentile(double percent) const
+{
+  // Rank of the latency wanted, from 1
+  size_t rank = size_t(count_ * percent / 100);
+  if (rank < 1) {
+    rank = 1;
+  }
+  size_t seen = 0;
+  for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank && bucket < BUCKETS - 1) {
+      uint64_t limit = bucket_limit(bucket);
+      return limit < max_ ? limit : max_;
+    }
+  }
+  return max_;
+}
+
+void
+LatencyHistogram::print(const std::string& name) const
+{
+  printf("%-10s %8lu  p50 %10.1f  p99 %10.1f  p99.9 %10.1f  max %10.1f us\n",
+         name.c_str(), (unsigned long)count_,
+         percentile(50) / 1000.0, percentile(99) / 1000.0,
+         percentile(99.9) / 1000.0, max_ / 1000.0);
+}
+
+void
+LatencyHistogram::reset()
+{
+  buckets_.assign(0);
+  count_ = 0;
+  max_ = 0;
+}
+
+int
+LatencyHistogram::bucket_of(uint64_t ns)
+{
+  // Below SUB_BUCKETS, one bucket per nanosecond
+  if (ns < uint64_t(SUB_BUCKETS)) {
+    return int(ns);
+  }
+  int power = 63;
+  while (!(ns >> power)) {
+    --power;
+  }
+  if (power >= MAX_POWER) {
+    return BUCKETS - 1;
+  }
+  // Top SUB_BUCKET_BITS bits below the leading one pick the sub-bucket
+  int sub_bucket = int(ns >> (power - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return (power - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t
+LatencyHistogram::bucket_limit(int bucket)
+{
+  if (bucket < SUB_BUCKETS) {
+    return uint64_t(bucket);
+  }
+  int power = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  uint64_t sub_bucket = bucket % SUB_BUCKETS;
+  // Largest value that falls in the bucket
+  return ((uint64_t(SUB_BUCKETS) + sub_bucket + 1) << (power - SUB_BUCKET_BITS)) - 1;
+}
+
+} } // End namespace
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <boost/array.hpp>
+#include <boost/cstdint.hpp>
+#include <string>
+
+namespace liquibook { namespace examples {
+
+  // Nanoseconds since the epoch, comparable between the publisher and
+  // subscribers on one host
+  uint64_t wall_clock_ns();
+
+  // Counts of latencies in log-linear buckets: SUB_BUCKETS buckets for each
+  // power of two nanoseconds, so a percentile is within 1/SUB_BUCKETS of
+  // the true value.  Recording is a few shifts and an increment.
+  class LatencyHistogram {
+  public:
+    LatencyHistogram();
+
+    // Record one latency; a negative one, from clocks out of step, counts
+    // as zero
+    void record(int64_t ns);
+
+    size_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+
+    // Upper bound of the bucket holding the given percentile
+    uint64_t percentile(double percent) const;
+
+    // Print count, median, 99th, 99.9th percentiles and max, in
+    // microseconds
+    void print(const std::string& name) const;
+
+    void reset();
+
+  private:
+    static const int SUB_BUCKET_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    // Up to 2^40 ns, some 18 minutes
+    static const int MAX_POWER = 40;
+    static const int BUCKETS = (MAX_POWER - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    boost::array<size_t, BUCKETS> buckets_;
+    size_t count_;
+    uint64_t max_;
+
+    static int bucket_of(uint64_t ns);
+    static uint64_t bucket_limit(int bucket);
+  };
+} }
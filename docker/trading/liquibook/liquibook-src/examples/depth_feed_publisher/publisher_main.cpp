@@ -1,4 +1,5 @@
 
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include "exchange.h"
 #include "depth_feed_publisher.h"
@@ -35,15 +36,22 @@ int main(int argc, const char* argv[])
     // Feed connection
     examples::DepthFeedConnection connection(argc, argv);
 
+    // Create feed publisher
+    examples::DepthFeedPublisher feed;
+    feed.set_connection(&connection);
+
+    // With a multicast group, connections are snapshot requests
+    if (connection.multicast()) {
+      connection.open_multicast();
+      connection.set_snapshot_handler(
+          boost::bind(&examples::DepthFeedPublisher::send_snapshot, &feed, _1));
+    }
+
     // Open connection in background thread
     connection.accept();
     boost::function<void ()> acceptor(
         boost::bind(&examples::DepthFeedConnection::run, &connection));
     boost::thread acceptor_thread(acceptor);
-  
-    // Create feed publisher
-    examples::DepthFeedPublisher feed;
-    feed.set_connection(&connection);
 
     // Create exchange
     examples::Exchange exchange(&feed, &feed);
@@ -11,7 +11,7 @@ int main(int argc, const char* argv[])
     liquibook::examples::DepthFeedConnection connection(argc, argv);
 
     // Create feed subscriber
-    liquibook::examples::DepthFeedSubscriber feed(connection.get_templates());
+    liquibook::examples::DepthFeedSubscriber feed;
 
     // Set up handlers
     liquibook::examples::MessageHandler msg_handler =
@@ -23,8 +23,22 @@ int main(int argc, const char* argv[])
     connection.set_message_handler(msg_handler);
     connection.set_reset_handler(reset_handler);
 
-    // Connect to server
-    connection.connect();
+    if (connection.multicast()) {
+      // Incremental messages from the group, recovery from snapshots
+      connection.set_snapshot_message_handler(
+          boost::bind(&liquibook::examples::DepthFeedSubscriber::handle_snapshot_message,
+                      &feed, _1, _2));
+      connection.set_snapshot_done_handler(
+          boost::bind(&liquibook::examples::DepthFeedSubscriber::handle_snapshot_done,
+                      &feed));
+      feed.set_snapshot_requester(
+          boost::bind(&liquibook::examples::DepthFeedConnection::request_snapshot,
+                      &connection));
+      connection.join();
+    } else {
+      // Connect to server
+      connection.connect();
+    }
     connection.run();
   }
   catch (const std::exception & ex)
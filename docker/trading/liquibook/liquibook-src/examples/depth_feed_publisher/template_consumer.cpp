@@ -8,14 +8,18 @@ namespace liquibook { namespace examples {
 
 using namespace QuickFAST::Messages;
 
-const FieldIdentity TemplateConsumer::id_seq_num_("SequenceNumber");
-
 const FieldIdentity TemplateConsumer::id_msg_type_("MessageType");
 
 const FieldIdentity TemplateConsumer::id_timestamp_("Timestamp");
 
 const FieldIdentity TemplateConsumer::id_symbol_("Symbol");
 
+const FieldIdentity TemplateConsumer::id_received_time_("ReceivedTime");
+
+const FieldIdentity TemplateConsumer::id_matched_time_("MatchedTime");
+
+const FieldIdentity TemplateConsumer::id_published_time_("PublishedTime");
+
 const FieldIdentity TemplateConsumer::id_bids_("Bids");
 
 const FieldIdentity TemplateConsumer::id_bids_length_("BidsLength");
@@ -16,11 +16,15 @@ public:
   static const QuickFAST::Messages::FieldIdentity id_cost_;
 
   // Common field identities
-  static const QuickFAST::Messages::FieldIdentity id_seq_num_;
   static const QuickFAST::Messages::FieldIdentity id_msg_type_;
   static const QuickFAST::Messages::FieldIdentity id_timestamp_;
   static const QuickFAST::Messages::FieldIdentity id_symbol_;
 
+  // Latency field identities, nanoseconds since the epoch
+  static const QuickFAST::Messages::FieldIdentity id_received_time_;
+  static const QuickFAST::Messages::FieldIdentity id_matched_time_;
+  static const QuickFAST::Messages::FieldIdentity id_published_time_;
+
   // Depth field identities
   static const QuickFAST::Messages::FieldIdentity id_bids_length_;
   static const QuickFAST::Messages::FieldIdentity id_bids_;
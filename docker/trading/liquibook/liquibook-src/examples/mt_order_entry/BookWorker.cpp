@@ -0,0 +1,173 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#include "BookWorker.h"
+
+namespace
+{
+    thread_local std::ostream * workerLog = nullptr;
+}
+
+namespace orderentry
+{
+
+LogQueue::LogQueue(std::ostream & out)
+: out_(out)
+, pushed_(0)
+, written_(0)
+, stopping_(false)
+, thread_(&LogQueue::run, this)
+{
+}
+
+LogQueue::~LogQueue()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+void
+LogQueue::push(std::string text)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        queue_.push_back(std::move(text));
+        ++pushed_;
+    }
+    changed_.notify_all();
+}
+
+void
+LogQueue::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = pushed_;
+    changed_.wait(lock, [this, target]{ return written_ >= target; });
+}
+
+void
+LogQueue::run()
+{
+    std::vector<std::string> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true)
+    {
+        changed_.wait(lock, [this]{ return !queue_.empty() || stopping_; });
+        if(queue_.empty())
+        {
+            break;
+        }
+        // Write outside the lock, so pushing never waits on the stream
+        batch.swap(queue_);
+        lock.unlock();
+        for(auto text = batch.begin(); text != batch.end(); ++text)
+        {
+            out_ << *text;
+        }
+        out_.flush();
+        lock.lock();
+        written_ += batch.size();
+        batch.clear();
+        changed_.notify_all();
+    }
+}
+
+QueuedLog::QueuedLog(LogQueue & queue)
+: std::ostream(nullptr)
+, buffer_(queue)
+{
+    rdbuf(&buffer_);
+}
+
+QueuedLog::Buffer::Buffer(LogQueue & queue)
+: queue_(queue)
+{
+}
+
+int
+QueuedLog::Buffer::sync()
+{
+    if(pptr() != pbase())
+    {
+        queue_.push(str());
+        str(std::string());
+    }
+    return 0;
+}
+
+BookWorker::BookWorker(LogQueue & logQueue)
+: log_(logQueue)
+, busy_(false)
+, stopping_(false)
+, thread_(&BookWorker::run, this)
+{
+}
+
+BookWorker::~BookWorker()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+void
+BookWorker::post(Command command)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        queue_.push_back(std::move(command));
+    }
+    changed_.notify_all();
+}
+
+void
+BookWorker::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this]{ return queue_.empty() && !busy_; });
+}
+
+std::ostream *
+BookWorker::currentLog()
+{
+    return workerLog;
+}
+
+void
+BookWorker::run()
+{
+    workerLog = &log_;
+    std::vector<Command> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true)
+    {
+        changed_.wait(lock, [this]{ return !queue_.empty() || stopping_; });
+        if(queue_.empty())
+        {
+            break;
+        }
+        // Take every command queued so far, so the dispatching thread
+        // contends for the lock once per batch rather than per command
+        batch.swap(queue_);
+        busy_ = true;
+        lock.unlock();
+        for(auto command = batch.begin(); command != batch.end(); ++command)
+        {
+            (*command)();
+        }
+        batch.clear();
+        log_.flush();
+        lock.lock();
+        busy_ = false;
+        changed_.notify_all();
+    }
+}
+
+} // namespace orderentry
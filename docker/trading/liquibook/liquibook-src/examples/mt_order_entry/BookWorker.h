@@ -0,0 +1,105 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+/// @brief Threads for a Market that runs its books in parallel: a worker
+/// thread applies requests to each book, and one output thread writes
+/// what all of them log.
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace orderentry
+{
+
+/// @brief Write text queued from any thread to one stream, on a thread of
+/// its own.
+class LogQueue
+{
+public:
+    LogQueue(std::ostream & out);
+
+    /// @brief Write whatever is still queued, then stop.
+    ~LogQueue();
+
+    void push(std::string text);
+
+    /// @brief Wait until everything pushed so far has been written.
+    void flush();
+
+private:
+    void run();
+
+    std::ostream & out_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<std::string> queue_;
+    uint64_t pushed_;
+    uint64_t written_;
+    bool stopping_;
+    std::thread thread_;
+};
+
+/// @brief A stream that pushes its text to a LogQueue each time it is
+/// flushed, as by std::endl, so lines from different threads never mix.
+class QueuedLog : public std::ostream
+{
+public:
+    QueuedLog(LogQueue & queue);
+
+private:
+    class Buffer : public std::stringbuf
+    {
+    public:
+        Buffer(LogQueue & queue);
+    protected:
+        virtual int sync();
+    private:
+        LogQueue & queue_;
+    };
+
+    Buffer buffer_;
+};
+
+/// @brief A thread that runs the commands posted to it in order.
+///
+/// Each book is served by exactly one worker, so a book and its orders are
+/// only ever touched by that worker's thread once the book is created.
+class BookWorker
+{
+public:
+    typedef std::function<void()> Command;
+
+    BookWorker(LogQueue & logQueue);
+
+    /// @brief Run whatever is still queued, then stop.
+    ~BookWorker();
+
+    void post(Command command);
+
+    /// @brief Wait until every command posted so far has run.
+    void drain();
+
+    /// @brief The log of the worker running on this thread, or nullptr.
+    static std::ostream * currentLog();
+
+private:
+    void run();
+
+    QueuedLog log_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<Command> queue_;
+    bool busy_;
+    bool stopping_;
+    std::thread thread_;
+};
+
+} // namespace orderentry
@@ -0,0 +1,536 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#include "CommandFile.h"
+#include "Market.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace orderentry
+{
+const char CommandFileHeader::MAGIC[8] = {'L', 'B', 'O', 'E', 'C', 'M', 'D', '\0'};
+
+namespace
+{
+    size_t padded(size_t length)
+    {
+        return (length + CommandRecord::ALIGNMENT - 1) & ~(CommandRecord::ALIGNMENT - 1);
+    }
+}
+
+CommandFileWriter::CommandFileWriter(std::ostream & out, std::ostream & errors)
+: out_(out)
+, errors_(errors)
+, lineNumber_(0)
+, commandCount_(0)
+, lastOrderId_(0)
+{
+    CommandFileHeader header;
+    memcpy(header.magic_, CommandFileHeader::MAGIC, sizeof(header.magic_));
+    header.byteOrder_ = CommandFileHeader::BYTE_ORDER_MARK;
+    header.version_ = CommandFileHeader::VERSION;
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+uint64_t
+CommandFileWriter::commandCount() const
+{
+    return commandCount_;
+}
+
+bool
+CommandFileWriter::convert(std::istream & script)
+{
+    std::string line;
+    while(std::getline(script, line))
+    {
+        ++lineNumber_;
+        std::transform(line.begin(), line.end(), line.begin(), toupper);
+        // QUIT ends the script
+        if(trimmed(line) == "QUIT")
+        {
+            break;
+        }
+        if(!convertLine(line))
+        {
+            return false;
+        }
+    }
+    return out_.good();
+}
+
+bool
+CommandFileWriter::convertLine(std::string line)
+{
+    // Split as mt_order_entry does: a trailing ';' is a token of its own
+    if(line.length() > 1 && line.back() == ';')
+    {
+        line.pop_back();
+        if(line.back() == ' ')
+        {
+            line.pop_back();
+        }
+        line.append(" ;");
+    }
+    std::vector<std::string> tokens;
+    split(line, " \t\v\n\r", tokens);
+    if(tokens.empty())
+    {
+        return true;
+    }
+
+    const std::string & command = tokens[0];
+    if(command[0] == '#' || command == "?" || command == "HELP")
+    {
+        return true;
+    }
+    if(command == "BUY" || command == "B")
+    {
+        return convertAdd(true, tokens, 1);
+    }
+    if(command == "SELL" || command == "S")
+    {
+        return convertAdd(false, tokens, 1);
+    }
+    if(command == "CANCEL" || command == "C")
+    {
+        return convertCancel(tokens, 1);
+    }
+    if(command == "MODIFY" || command == "M")
+    {
+        return convertModify(tokens, 1);
+    }
+    if(command == "F" || command == "FILE")
+    {
+        return fail("FILE can't be converted; convert that script instead");
+    }
+    if((command == "DISPLAY" || command == "D")
+        && (tokens.size() < 2 || (tokens[1] == "+" && tokens.size() < 3)))
+    {
+        return fail("DISPLAY needs an order, a symbol, or ALL");
+    }
+    // DISPLAY, and anything mt_order_entry would reject, is kept as text
+    CommandRecord record = CommandRecord();
+    record.type_ = CommandRecord::TextCommand;
+    write(record, line);
+    return true;
+}
+
+bool
+CommandFileWriter::convertAdd(bool buy, const std::vector<std::string> & tokens, size_t pos)
+{
+    CommandRecord record = CommandRecord();
+    record.type_ = CommandRecord::AddCommand;
+    record.flags_ = buy ? CommandRecord::Buy : 0;
+
+    uint32_t quantity = toUint32(nextToken(tokens, pos));
+    if(quantity == 0 || quantity > 1000000000)
+    {
+        return fail("Expecting quantity");
+    }
+    record.quantity_ = quantity;
+
+    SymbolId symbolId;
+    if(!readSymbol(nextToken(tokens, pos), symbolId))
+    {
+        return false;
+    }
+    record.id_ = symbolId;
+
+    liquibook::book::Price price = stringToPrice(nextToken(tokens, pos));
+    if(price > 10000000)
+    {
+        return fail("Expecting price or MARKET");
+    }
+    record.price_ = uint32_t(price);
+
+    bool go = false;
+    while(!go)
+    {
+        std::string option = nextToken(tokens, pos);
+        if(option == ";" || option == "E" || option == "END")
+        {
+            go = true;
+        }
+        else if(option == "A" || option == "AON")
+        {
+            record.flags_ |= CommandRecord::AllOrNone;
+        }
+        else if(option == "I" || option == "IOC")
+        {
+            record.flags_ |= CommandRecord::ImmediateOrCancel;
+        }
+        else if(option == "S" || option == "STOP")
+        {
+            liquibook::book::Price stopPrice = stringToPrice(nextToken(tokens, pos));
+            if(stopPrice > 10000000)
+            {
+                return fail("Expecting stop price");
+            }
+            record.stopPrice_ = uint32_t(stopPrice);
+        }
+        else
+        {
+            return fail("Expecting AON IOC STOP or END, not '" + option + "'");
+        }
+    }
+    write(record);
+    ++lastOrderId_;
+    return true;
+}
+
+bool
+CommandFileWriter::convertCancel(const std::vector<std::string> & tokens, size_t pos)
+{
+    CommandRecord record = CommandRecord();
+    record.type_ = CommandRecord::CancelCommand;
+    if(!readOrderId(tokens, pos, record.id_))
+    {
+        return false;
+    }
+    write(record);
+    return true;
+}
+
+bool
+CommandFileWriter::convertModify(const std::vector<std::string> & tokens, size_t pos)
+{
+    CommandRecord record = CommandRecord();
+    record.type_ = CommandRecord::ModifyCommand;
+    if(!readOrderId(tokens, pos, record.id_))
+    {
+        return false;
+    }
+
+    bool go = false;
+    while(!go)
+    {
+        std::string option = nextToken(tokens, pos);
+        if(option == ";" || option == "E" || option == "END")
+        {
+            go = true;
+        }
+        else if(option == "P" || option == "PRICE")
+        {
+            uint32_t price = toUint32(nextToken(tokens, pos));
+            if(price == 0 || price == INVALID_UINT32)
+            {
+                return fail("Invalid price");
+            }
+            record.flags_ |= CommandRecord::PriceChanged;
+            record.price_ = price;
+        }
+        else if(option == "Q" || option == "QUANTITY")
+        {
+            int32_t change = int32_t(toInt32(nextToken(tokens, pos)));
+            if(change == INVALID_INT32)
+            {
+                return fail("Invalid quantity change");
+            }
+            record.flags_ |= CommandRecord::QuantityChanged;
+            record.quantity_ = uint32_t(change);
+        }
+        else
+        {
+            return fail("Expecting PRICE <price>, or QUANTITY <change>, or END, not '" + option + "'");
+        }
+    }
+    write(record);
+    return true;
+}
+
+bool
+CommandFileWriter::readOrderId(const std::vector<std::string> & tokens, size_t & pos, OrderId & orderId)
+{
+    std::string text = nextToken(tokens, pos);
+    if(!text.empty() && text[0] == '#')
+    {
+        text = text.substr(1);
+    }
+    if(text.empty())
+    {
+        return fail("Expecting #orderID");
+    }
+    if(text[0] == '-')
+    {
+        // Relative to the next id, as Market resolves it
+        int32_t offset = int32_t(toInt32(text));
+        if(offset == INVALID_INT32)
+        {
+            return fail("Expecting orderID or offset");
+        }
+        orderId = lastOrderId_ + 1 + offset;
+        return true;
+    }
+    orderId = toUint32(text);
+    if(orderId == INVALID_UINT32)
+    {
+        return fail("Expecting orderID or offset");
+    }
+    return true;
+}
+
+bool
+CommandFileWriter::readSymbol(std::string symbol, SymbolId & symbolId)
+{
+    bool define = !symbol.empty() && (symbol[0] == '+' || symbol[0] == '!');
+    bool useDepthBook = define && symbol[0] == '!';
+    auto known = std::find(symbols_.begin(), symbols_.end(), symbol);
+    if(known == symbols_.end() && define)
+    {
+        symbol = symbol.substr(1);
+        known = std::find(symbols_.begin(), symbols_.end(), symbol);
+    }
+    if(known != symbols_.end())
+    {
+        symbolId = SymbolId(known - symbols_.begin());
+        return true;
+    }
+    if(!define)
+    {
+        // mt_order_entry would ask which kind of book to create
+        return fail("Symbol '" + symbol + "' must be defined with + or ! first");
+    }
+    symbolId = SymbolId(symbols_.size());
+    symbols_.push_back(symbol);
+
+    CommandRecord record = CommandRecord();
+    record.type_ = CommandRecord::SymbolCommand;
+    record.flags_ = useDepthBook ? CommandRecord::DepthBook : 0;
+    record.id_ = symbolId;
+    write(record, symbol);
+    return true;
+}
+
+void
+CommandFileWriter::write(CommandRecord & record, const std::string & text)
+{
+    static const char padding[CommandRecord::ALIGNMENT] = {0};
+    record.textLength_ = uint16_t(text.size());
+    out_.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    out_.write(text.data(), text.size());
+    out_.write(padding, padded(text.size()) - text.size());
+    // A symbol defined on the way is not a request of its own
+    if(record.type_ != CommandRecord::SymbolCommand)
+    {
+        ++commandCount_;
+    }
+}
+
+bool
+CommandFileWriter::fail(const std::string & reason)
+{
+    errors_ << "Line " << lineNumber_ << ": " << reason << std::endl;
+    return false;
+}
+
+CommandFileReader::CommandFileReader()
+: data_(nullptr)
+, size_(0)
+{
+}
+
+CommandFileReader::~CommandFileReader()
+{
+    close();
+}
+
+const std::string &
+CommandFileReader::error() const
+{
+    return error_;
+}
+
+bool
+CommandFileReader::isCommandFile(const std::string & filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(CommandFileHeader::MAGIC)];
+    return file.read(magic, sizeof(magic)).good()
+        && memcmp(magic, CommandFileHeader::MAGIC, sizeof(magic)) == 0;
+}
+
+bool
+CommandFileReader::open(const std::string & filename)
+{
+    close();
+#ifdef _WIN32
+    std::ifstream file(filename, std::ios::binary);
+    if(!file.good())
+    {
+        error_ = "Can't open " + filename;
+        return false;
+    }
+    contents_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data_ = contents_.data();
+    size_ = contents_.size();
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        error_ = "Can't open " + filename;
+        return false;
+    }
+    struct stat status;
+    if(fstat(fd, &status) != 0)
+    {
+        ::close(fd);
+        error_ = "Can't read " + filename;
+        return false;
+    }
+    size_ = size_t(status.st_size);
+    if(size_ > 0)
+    {
+        void * mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED)
+        {
+            ::close(fd);
+            size_ = 0;
+            error_ = "Can't map " + filename;
+            return false;
+        }
+        madvise(mapped, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const unsigned char *>(mapped);
+    }
+    ::close(fd);
+#endif
+
+    CommandFileHeader header;
+    if(size_ < sizeof(header))
+    {
+        close();
+        error_ = filename + " is not a command file";
+        return false;
+    }
+    memcpy(&header, data_, sizeof(header));
+    if(memcmp(header.magic_, CommandFileHeader::MAGIC, sizeof(header.magic_)) != 0)
+    {
+        close();
+        error_ = filename + " is not a command file";
+        return false;
+    }
+    if(header.byteOrder_ != CommandFileHeader::BYTE_ORDER_MARK)
+    {
+        close();
+        error_ = filename + " was written on a host of different byte order";
+        return false;
+    }
+    if(header.version_ != CommandFileHeader::VERSION)
+    {
+        close();
+        error_ = filename + " is of an unknown version";
+        return false;
+    }
+    return true;
+}
+
+void
+CommandFileReader::close()
+{
+#ifndef _WIN32
+    if(data_ != nullptr)
+    {
+        munmap(const_cast<unsigned char *>(data_), size_);
+    }
+#endif
+    contents_.clear();
+    data_ = nullptr;
+    size_ = 0;
+}
+
+uint64_t
+CommandFileReader::apply(Market & market)
+{
+    uint64_t applied = 0;
+    // Symbol ids in the file, to the market's
+    std::vector<SymbolId> symbolIds;
+    std::vector<std::string> tokens;
+    size_t pos = sizeof(CommandFileHeader);
+    while(pos < size_)
+    {
+        if(size_ - pos < sizeof(CommandRecord))
+        {
+            error_ = "Truncated record";
+            return applied;
+        }
+        // Records are aligned, but the mapping need not be aligned for them
+        CommandRecord record;
+        memcpy(&record, data_ + pos, sizeof(record));
+        pos += sizeof(record);
+        const char * text = reinterpret_cast<const char *>(data_ + pos);
+        size_t textSize = padded(record.textLength_);
+        if(size_ - pos < textSize)
+        {
+            error_ = "Truncated record";
+            return applied;
+        }
+        pos += textSize;
+
+        switch(record.type_)
+        {
+        case CommandRecord::SymbolCommand:
+            if(record.id_ != symbolIds.size())
+            {
+                error_ = "Symbol defined out of order";
+                return applied;
+            }
+            symbolIds.push_back(market.addSymbol(
+                std::string(text, record.textLength_),
+                (record.flags_ & CommandRecord::DepthBook) != 0));
+            // Defines a symbol for the requests that follow
+            continue;
+        case CommandRecord::AddCommand:
+            if(record.id_ >= symbolIds.size())
+            {
+                error_ = "Order for an undefined symbol";
+                return applied;
+            }
+            market.addOrder((record.flags_ & CommandRecord::Buy) != 0,
+                record.quantity_,
+                symbolIds[record.id_],
+                record.price_,
+                record.stopPrice_,
+                (record.flags_ & CommandRecord::AllOrNone) != 0,
+                (record.flags_ & CommandRecord::ImmediateOrCancel) != 0);
+            break;
+        case CommandRecord::CancelCommand:
+            market.cancelOrder(record.id_);
+            break;
+        case CommandRecord::ModifyCommand:
+            market.modifyOrder(record.id_,
+                (record.flags_ & CommandRecord::QuantityChanged)
+                    ? int64_t(int32_t(record.quantity_))
+                    : liquibook::book::SIZE_UNCHANGED,
+                (record.flags_ & CommandRecord::PriceChanged)
+                    ? liquibook::book::Price(record.price_)
+                    : liquibook::book::PRICE_UNCHANGED);
+            break;
+        case CommandRecord::TextCommand:
+            tokens.clear();
+            split(std::string(text, record.textLength_), " \t\v\n\r", tokens);
+            if(!tokens.empty())
+            {
+                market.apply(tokens);
+            }
+            break;
+        default:
+            error_ = "Unknown record type";
+            return applied;
+        }
+        ++applied;
+    }
+    return applied;
+}
+
+} // namespace orderentry
@@ -0,0 +1,146 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+/// @brief Binary command files: the requests of a text script, parsed once,
+/// so a large script can be applied to a Market without tokenizing.
+#pragma once
+
+#include "Order.h"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace orderentry
+{
+class Market;
+
+/// @brief The file starts with this header.
+struct CommandFileHeader
+{
+    char magic_[8];
+    /// BYTE_ORDER_MARK as written; records are in the byte order of the host
+    /// that converted the script
+    uint32_t byteOrder_;
+    uint32_t version_;
+
+    static const char MAGIC[8];
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static const uint32_t VERSION = 1;
+};
+
+/// @brief Then one record per request.  The text of a SymbolCommand or
+/// TextCommand follows its record, padded to a multiple of 4 bytes.
+struct CommandRecord
+{
+    enum Type
+    {
+        /// Define symbol id_ as the text, with a depth book if DepthBook
+        SymbolCommand,
+        /// Add an order for symbol id_
+        AddCommand,
+        /// Cancel order id_
+        CancelCommand,
+        /// Modify order id_: quantity_ is the change, if QuantityChanged
+        ModifyCommand,
+        /// Any other request, as text to be tokenized
+        TextCommand
+    };
+
+    enum Flags
+    {
+        Buy = 1,
+        AllOrNone = 2,
+        ImmediateOrCancel = 4,
+        DepthBook = 8,
+        QuantityChanged = 16,
+        PriceChanged = 32
+    };
+
+    uint8_t type_;
+    uint8_t flags_;
+    uint16_t textLength_;
+    /// Symbol id as numbered in this file, or order id
+    uint32_t id_;
+    /// Quantity, or a modify's change to it as an int32_t
+    uint32_t quantity_;
+    /// Prices the text syntax accepts fit in 32 bits
+    uint32_t price_;
+    uint32_t stopPrice_;
+
+    static const size_t ALIGNMENT = 4;
+};
+
+/// @brief Convert a text script to a binary command file.
+///
+/// Order ids, including relative ones, are resolved as the script is
+/// read, so every BUY and SELL must be complete and valid; the first
+/// request that would have prompted the user, or been rejected before
+/// reaching a book, stops the conversion.
+class CommandFileWriter
+{
+public:
+    CommandFileWriter(std::ostream & out, std::ostream & errors = std::cerr);
+
+    /// @brief Convert every request in the script.
+    /// @returns false if a request could not be converted.
+    bool convert(std::istream & script);
+
+    /// @brief Requests written so far.
+    uint64_t commandCount() const;
+
+private:
+    bool convertLine(std::string line);
+    bool convertAdd(bool buy, const std::vector<std::string> & tokens, size_t pos);
+    bool convertCancel(const std::vector<std::string> & tokens, size_t pos);
+    bool convertModify(const std::vector<std::string> & tokens, size_t pos);
+    bool readOrderId(const std::vector<std::string> & tokens, size_t & pos, OrderId & orderId);
+    bool readSymbol(std::string symbol, SymbolId & symbolId);
+
+    void write(CommandRecord & record, const std::string & text = "");
+    bool fail(const std::string & reason);
+
+    std::ostream & out_;
+    std::ostream & errors_;
+    uint32_t lineNumber_;
+    uint64_t commandCount_;
+    /// Ids of the orders and symbols the converted requests will create
+    OrderId lastOrderId_;
+    std::vector<std::string> symbols_;
+};
+
+/// @brief Map a binary command file into memory and apply its requests.
+class CommandFileReader
+{
+public:
+    CommandFileReader();
+    ~CommandFileReader();
+
+    /// @brief Map the file.
+    /// @returns false, with the reason in error(), if it can't be read or
+    /// is not a command file from a host of the same byte order.
+    bool open(const std::string & filename);
+
+    const std::string & error() const;
+
+    /// @brief Does the file start as a command file does?
+    static bool isCommandFile(const std::string & filename);
+
+    /// @brief Apply each request to the market in turn.
+    /// @returns the number of requests applied; fewer than the file holds
+    /// only if a record is malformed, with the reason in error().
+    uint64_t apply(Market & market);
+
+private:
+    void close();
+
+    const unsigned char * data_;
+    size_t size_;
+    /// Read into memory where the file can't be mapped
+    std::vector<unsigned char> contents_;
+    std::string error_;
+};
+
+} // namespace orderentry
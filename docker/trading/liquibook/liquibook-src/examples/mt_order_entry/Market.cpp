@@ -71,15 +71,95 @@ namespace {
 namespace orderentry
 {
 
-uint32_t Market::orderIdSeed_ = 0;
+Market::Market(std::ostream * out, unsigned workerThreads, uint32_t historyDepth)
+: orderIdSeed_(0)
+, logFile_(out)
+, logEvents_(true)
+, history_(historyDepth)
+{
+    if(workerThreads > 0)
+    {
+        logQueue_.reset(new LogQueue(*logFile_));
+        mainLog_.reset(new QueuedLog(*logQueue_));
+        for(unsigned i = 0; i < workerThreads; ++i)
+        {
+            workers_.emplace_back(new BookWorker(*logQueue_));
+        }
+    }
+}
+
+void
+Market::logEvents(bool logEvents)
+{
+    logEvents_ = logEvents;
+}
 
-Market::Market(std::ostream * out)
-: logFile_(out)
+SymbolId
+Market::addSymbol(const std::string & symbol, bool useDepthBook)
 {
+    SymbolId symbolId;
+    if(!findSymbol(symbol, symbolId))
+    {
+        addBook(symbol, useDepthBook);
+        symbolId = SymbolId(books_.size() - 1);
+    }
+    return symbolId;
 }
 
 Market::~Market()
 {
+    // Workers finish what they were given before the books go away
+    workers_.clear();
+    if(mainLog_)
+    {
+        mainLog_->flush();
+    }
+    logQueue_.reset();
+}
+
+void
+Market::drain()
+{
+    drainWorkers();
+    if(logQueue_)
+    {
+        mainLog_->flush();
+        logQueue_->flush();
+    }
+}
+
+std::ostream &
+Market::log()
+{
+    return out();
+}
+
+void
+Market::drainWorkers()
+{
+    for(auto worker = workers_.begin(); worker != workers_.end(); ++worker)
+    {
+        (*worker)->drain();
+    }
+}
+
+std::ostream &
+Market::out()
+{
+    // On a worker, what the books report goes to that worker's log
+    std::ostream * workerLog = BookWorker::currentLog();
+    if(workerLog != nullptr)
+    {
+        return *workerLog;
+    }
+    if(mainLog_)
+    {
+        // Let the books finish reporting earlier requests first, so the
+        // log reads in request order
+        drainWorkers();
+        return *mainLog_;
+    }
+    return *logFile_;
 }
 
 const char * 
@@ -291,9 +371,34 @@ Market::doAdd(const  std::string & side, const std::vector<std::string> & tokens
         }
     }
 
-    std::string orderId = std::to_string(++orderIdSeed_);
+    SymbolId symbolId;
+    if(!findSymbol(symbol, symbolId))
+    {
+        out() << "--No order book for symbol" << symbol << std::endl;
+        return false;
+    }
+    return addOrder(side == "BUY", quantity, symbolId, price, stopPrice, aon, ioc);
+}
+
+bool
+Market::addOrder(bool buy,
+    liquibook::book::Quantity quantity,
+    SymbolId symbolId,
+    liquibook::book::Price price,
+    liquibook::book::Price stopPrice,
+    bool aon,
+    bool ioc)
+{
+    if(symbolId >= books_.size())
+    {
+        out() << "--No order book for symbol #" << symbolId << std::endl;
+        return false;
+    }
+    OrderBookPtr book = books_[symbolId];
 
-    OrderPtr order = std::make_shared<Order>(orderId, side == "BUY", quantity, symbol, price, stopPrice, aon, ioc);
+    OrderId orderId = ++orderIdSeed_;
+
+    OrderPtr order = std::make_shared<Order>(orderId, buy, quantity, symbolId, symbols_[symbolId], price, stopPrice, aon, ioc, history_);
 
     const liquibook::book::OrderConditions AON(liquibook::book::oc_all_or_none);
     const liquibook::book::OrderConditions IOC(liquibook::book::oc_immediate_or_cancel);
@@ -302,19 +407,16 @@ Market::doAdd(const  std::string & side, const std::vector<std::string> & tokens
     const liquibook::book::OrderConditions conditions = 
         (aon ? AON : NOC) | (ioc ? IOC : NOC);
 
-
-    auto book = findBook(symbol);
-    if(!book)
+    orders_.push_back(order);
+    dispatch(symbolId, [this, book, order, conditions]()
     {
-        out() << "--No order book for symbol" << symbol << std::endl;
-        return false;
-    }
-
-    order->onSubmitted();
-    out() << "ADDING order:  " << *order << std::endl;
-
-    orders_[orderId] = order;
-    book->add(order, conditions);
+        order->onSubmitted();
+        if(logEvents_)
+        {
+            out() << "ADDING order:  " << *order << std::endl;
+        }
+        book->add(order, conditions);
+    });
     return true;
 }
 
@@ -322,15 +424,32 @@ Market::doAdd(const  std::string & side, const std::vector<std::string> & tokens
 // CANCEL
 bool
 Market::doCancel(const std::vector<std::string> & tokens, size_t position)
+{
+    OrderId orderId;
+    if(!readOrderId(tokens, position, orderId))
+    {
+        return false;
+    }
+    return cancelOrder(orderId);
+}
+
+bool
+Market::cancelOrder(OrderId orderId)
 {
     OrderPtr order;
     OrderBookPtr book;
-    if(!findExistingOrder(tokens, position, order, book))
+    if(!findExistingOrder(orderId, order, book))
     {
         return false;
     }
-    out() << "Requesting Cancel: " << *order << std::endl;
-    book->cancel(order);
+    dispatch(order->symbolId(), [this, book, order]()
+    {
+        if(logEvents_)
+        {
+            out() << "Requesting Cancel: " << *order << std::endl;
+        }
+        book->cancel(order);
+    });
     return true;
 }
 
@@ -339,9 +458,8 @@ Market::doCancel(const std::vector<std::string> & tokens, size_t position)
 bool
 Market::doModify(const std::vector<std::string> & tokens, size_t position)
 {
-    OrderPtr order;
-    OrderBookPtr book;
-    if(!findExistingOrder(tokens, position, order, book))
+    OrderId orderId;
+    if(!readOrderId(tokens, position, orderId))
     {
         return false;
     }
@@ -427,17 +545,37 @@ Market::doModify(const std::vector<std::string> & tokens, size_t position)
         }
     }
 
-    book->replace(order, quantityChange, price);
-    out() << "Requested Modify" ;
-    if(quantityChange != liquibook::book::SIZE_UNCHANGED)
+    return modifyOrder(orderId, quantityChange, price);
+}
+
+bool
+Market::modifyOrder(OrderId orderId,
+    int64_t quantityChange,
+    liquibook::book::Price price)
+{
+    OrderPtr order;
+    OrderBookPtr book;
+    if(!findExistingOrder(orderId, order, book))
     {
-        out() << " QUANTITY  += " << quantityChange;
+        return false;
     }
-    if(price != liquibook::book::PRICE_UNCHANGED)
+    dispatch(order->symbolId(), [this, book, order, quantityChange, price]()
     {
-        out() << " PRICE " << price;
-    }
-    out() << std::endl;
+        book->replace(order, quantityChange, price);
+        if(logEvents_)
+        {
+            out() << "Requested Modify" ;
+            if(quantityChange != liquibook::book::SIZE_UNCHANGED)
+            {
+                out() << " QUANTITY  += " << quantityChange;
+            }
+            if(price != liquibook::book::PRICE_UNCHANGED)
+            {
+                out() << " PRICE " << price;
+            }
+            out() << std::endl;
+        }
+    });
     return true;
 }
 
@@ -446,6 +584,8 @@ Market::doModify(const std::vector<std::string> & tokens, size_t position)
 bool
 Market::doDisplay(const std::vector<std::string> & tokens, size_t pos)
 {
+    // Orders and books are only quiet once the workers are idle
+    drainWorkers();
     bool verbose = false;
     // see if first token could be an order id.
     // todo: handle prompted imput!
@@ -481,9 +621,10 @@ Market::doDisplay(const std::vector<std::string> & tokens, size_t pos)
     }
     if(parameter[0] == '#' || parameter[0] == '-' || isdigit(parameter[0]))
     {
+        OrderId orderId;
         OrderPtr order;
         OrderBookPtr book;
-        if(findExistingOrder(parameter, order, book))
+        if(parseOrderId(parameter, orderId) && findExistingOrder(orderId, order, book))
         {
             out() << *order << std::endl;
             return true;
@@ -492,41 +633,34 @@ Market::doDisplay(const std::vector<std::string> & tokens, size_t pos)
 
     // Not an order id.  Try for a symbol:
     std::string symbol = parameter;
-    if(symbolIsDefined(symbol))
+    SymbolId symbolId;
+    if(findSymbol(symbol, symbolId))
     {
         for(auto pOrder = orders_.begin(); pOrder != orders_.end(); ++pOrder)
         {
-            const OrderPtr & order = pOrder->second;
-            if(order->symbol() == symbol)
+            const OrderPtr & order = *pOrder;
+            if(order->symbolId() == symbolId)
             {
                 out() << order->verbose(verbose) << std::endl;
                 order->verbose(false);
             }
         }
-        auto book = findBook(symbol);
-        if(!book)
-        {
-            out() << "--No order book for symbol" << symbol << std::endl;
-        }
-        else
-        {
-            book->log(out());
-        }
+        books_[symbolId]->log(out());
         return true;
     }
     else if( symbol == "ALL")
     {
         for(auto pOrder = orders_.begin(); pOrder != orders_.end(); ++pOrder)
         {
-            const OrderPtr & order = pOrder->second;
+            const OrderPtr & order = *pOrder;
             out() << order->verbose(verbose) << std::endl;
             order->verbose(false);
         }
 
-        for(auto pBook = books_.begin(); pBook != books_.end(); ++pBook)
+        for(SymbolId id = 0; id < books_.size(); ++id)
         {
-            out() << "Order book for " << pBook->first << std::endl;
-            pBook->second->log(out());
+            out() << "Order book for " << symbols_[id] << std::endl;
+            books_[id]->log(out());
         }
         return true;
     }
@@ -543,8 +677,19 @@ Market::doDisplay(const std::vector<std::string> & tokens, size_t pos)
 bool
 Market::symbolIsDefined(const std::string & symbol)
 {
-    auto book = books_.find(symbol);
-    return book != books_.end();
+    return symbolIds_.find(symbol) != symbolIds_.end();
+}
+
+bool
+Market::findSymbol(const std::string & symbol, SymbolId & symbolId)
+{
+    auto entry = symbolIds_.find(symbol);
+    if(entry == symbolIds_.end())
+    {
+        return false;
+    }
+    symbolId = entry->second;
+    return true;
 }
 
 OrderBookPtr
@@ -567,7 +712,9 @@ Market::addBook(const std::string & symbol, bool useDepthBook)
     result->set_order_listener(this);
     result->set_trade_listener(this);
     result->set_order_book_listener(this);
-    books_[symbol] = result;
+    symbolIds_[symbol] = SymbolId(books_.size());
+    symbols_.push_back(symbol);
+    books_.push_back(result);
     return result;
 }
 
@@ -575,68 +722,73 @@ OrderBookPtr
 Market::findBook(const std::string & symbol)
 {
     OrderBookPtr result;
-    auto entry = books_.find(symbol);
-    if(entry != books_.end())
+    SymbolId symbolId;
+    if(findSymbol(symbol, symbolId))
     {
-        result = entry->second;
+        result = books_[symbolId];
     }
     return result;
 }
 
-bool Market::findExistingOrder(const std::vector<std::string> & tokens, size_t & position, OrderPtr & order, OrderBookPtr & book)
+bool Market::readOrderId(const std::vector<std::string> & tokens, size_t & position, OrderId & orderId)
 {
     ////////////////
     // Order ID
-    std::string orderId = nextToken(tokens, position);
-    trim(orderId);
-    if(orderId.empty())
+    std::string orderIdStr = nextToken(tokens, position);
+    trim(orderIdStr);
+    if(orderIdStr.empty())
     {
-        orderId = promptForString("Order Id#");
-        trim(orderId);
+        orderIdStr = promptForString("Order Id#");
     }
+    return parseOrderId(orderIdStr, orderId);
+}
+
+bool Market::parseOrderId(std::string text, OrderId & orderId)
+{
+    trim(text);
     // discard leading # if any
-    if(orderId[0] == '#')
+    if(!text.empty() && text[0] == '#')
     {
-        orderId = orderId.substr(1);
-        trim(orderId);
-        if(orderId.empty())
-        {
-            out() << "--Expecting #orderID" << std::endl;
-            return false;
-        }
+        text = text.substr(1);
+        trim(text);
+    }
+    if(text.empty())
+    {
+        out() << "--Expecting #orderID" << std::endl;
+        return false;
     }
 
-    if(orderId[0] == '-') // relative addressing
+    if(text[0] == '-') // relative addressing
     {
-        int32_t orderOffset = toInt32(orderId);
+        int32_t orderOffset = toInt32(text);
         if(orderOffset == INVALID_INT32)
         {
             out() << "--Expecting orderID or offset" << std::endl;
             return false;
         }
-        uint32_t orderNumber = orderIdSeed_  + 1 + orderOffset;
-        orderId = std::to_string(orderNumber);
+        orderId = orderIdSeed_  + 1 + orderOffset;
+        return true;
+    }
+    orderId = toUint32(text);
+    if(orderId == INVALID_UINT32)
+    {
+        out() << "--Expecting orderID or offset" << std::endl;
+        return false;
     }
-    return findExistingOrder(orderId, order, book);
+    return true;
 }
 
-bool Market::findExistingOrder(const std::string & orderId, OrderPtr & order, OrderBookPtr & book)
+bool Market::findExistingOrder(OrderId orderId, OrderPtr & order, OrderBookPtr & book)
 {
-    auto orderPosition = orders_.find(orderId);
-    if(orderPosition == orders_.end())
+    // Ids are assigned in sequence from 1
+    if(orderId == 0 || orderId > orders_.size())
     {
         out() << "--Can't find OrderID #" << orderId << std::endl;
         return false;
     }
 
-    order = orderPosition->second;
-    std::string symbol = order->symbol();
-    book = findBook(symbol);
-    if(!book)
-    {
-        out() << "--No order book for symbol" << symbol << std::endl;
-        return false;
-    }
+    order = orders_[orderId - 1];
+    book = books_[order->symbolId()];
     return true;
 }
 
@@ -647,14 +799,20 @@ void
 Market::on_accept(const OrderPtr& order)
 {
     order->onAccepted();
-    out() << "\tAccepted: " <<*order<< std::endl;
+    if(logEvents_)
+    {
+        out() << "\tAccepted: " <<*order<< std::endl;
+    }
 }
 
 void 
 Market::on_reject(const OrderPtr& order, const char* reason)
 {
     order->onRejected(reason);
-    out() << "\tRejected: " <<*order<< ' ' << reason << std::endl;
+    if(logEvents_)
+    {
+        out() << "\tRejected: " <<*order<< ' ' << reason << std::endl;
+    }
 
 }
 
@@ -666,23 +824,32 @@ Market::on_fill(const OrderPtr& order,
 {
     order->onFilled(fill_qty, fill_cost);
     matched_order->onFilled(fill_qty, fill_cost);
-    out() << (order->is_buy() ? "\tBought: " : "\tSold: ") 
-        << fill_qty << " Shares for " << fill_cost << ' ' <<*order<< std::endl;
-    out() << (matched_order->is_buy() ? "\tBought: " : "\tSold: ") 
-        << fill_qty << " Shares for " << fill_cost << ' ' << *matched_order << std::endl;
+    if(logEvents_)
+    {
+        out() << (order->is_buy() ? "\tBought: " : "\tSold: ") 
+            << fill_qty << " Shares for " << fill_cost << ' ' <<*order<< std::endl;
+        out() << (matched_order->is_buy() ? "\tBought: " : "\tSold: ") 
+            << fill_qty << " Shares for " << fill_cost << ' ' << *matched_order << std::endl;
+    }
 }
 
 void 
 Market::on_cancel(const OrderPtr& order)
 {
     order->onCancelled();
-    out() << "\tCanceled: " << *order<< std::endl;
+    if(logEvents_)
+    {
+        out() << "\tCanceled: " << *order<< std::endl;
+    }
 }
 
 void Market::on_cancel_reject(const OrderPtr& order, const char* reason)
 {
     order->onCancelRejected(reason);
-    out() << "\tCancel Reject: " <<*order<< ' ' << reason << std::endl;
+    if(logEvents_)
+    {
+        out() << "\tCancel Reject: " <<*order<< ' ' << reason << std::endl;
+    }
 }
 
 void Market::on_replace(const OrderPtr& order, 
@@ -690,23 +857,29 @@ void Market::on_replace(const OrderPtr& order,
     liquibook::book::Price new_price)
 {
     order->onReplaced(size_delta, new_price);
-    out() << "\tModify " ;
-    if(size_delta != liquibook::book::SIZE_UNCHANGED)
+    if(logEvents_)
     {
-        out() << " QUANTITY  += " << size_delta;
-    }
-    if(new_price != liquibook::book::PRICE_UNCHANGED)
-    {
-        out() << " PRICE " << new_price;
+        out() << "\tModify " ;
+        if(size_delta != liquibook::book::SIZE_UNCHANGED)
+        {
+            out() << " QUANTITY  += " << size_delta;
+        }
+        if(new_price != liquibook::book::PRICE_UNCHANGED)
+        {
+            out() << " PRICE " << new_price;
+        }
+        out() <<*order<< std::endl;
     }
-    out() <<*order<< std::endl;
 }
 
 void 
 Market::on_replace_reject(const OrderPtr& order, const char* reason)
 {
     order->onReplaceRejected(reason);
-    out() << "\tReplace Reject: " <<*order<< ' ' << reason << std::endl;
+    if(logEvents_)
+    {
+        out() << "\tReplace Reject: " <<*order<< ' ' << reason << std::endl;
+    }
 }
 
 ////////////////////////////////////
@@ -717,7 +890,10 @@ Market::on_trade(const OrderBook* book,
     liquibook::book::Quantity qty, 
     liquibook::book::Cost cost)
 {
-    out() << "\tTrade: " << qty <<  ' ' << book->symbol() << " Cost "  << cost  << std::endl;
+    if(logEvents_)
+    {
+        out() << "\tTrade: " << qty <<  ' ' << book->symbol() << " Cost "  << cost  << std::endl;
+    }
 }
 
 /////////////////////////////////////////
@@ -726,7 +902,10 @@ Market::on_trade(const OrderBook* book,
 void 
 Market::on_order_book_change(const OrderBook* book)
 {
-    out() << "\tBook Change: " << ' ' << book->symbol() << std::endl;
+    if(logEvents_)
+    {
+        out() << "\tBook Change: " << ' ' << book->symbol() << std::endl;
+    }
 }
 
 
@@ -736,11 +915,14 @@ Market::on_order_book_change(const OrderBook* book)
 void 
 Market::on_bbo_change(const DepthOrderBook * book, const BookDepth * depth)
 {
-    out() << "\tBBO Change: " << ' ' << book->symbol() 
-        << (depth->changed() ? " Changed" : " Unchanged")
-        << " Change Id: " << depth->last_change()
-        << " Published: " << depth->last_published_change()
-        << std::endl;
+    if(logEvents_)
+    {
+        out() << "\tBBO Change: " << ' ' << book->symbol() 
+            << (depth->changed() ? " Changed" : " Unchanged")
+            << " Change Id: " << depth->last_change()
+            << " Published: " << depth->last_published_change()
+            << std::endl;
+    }
 
 }
 
@@ -749,12 +931,15 @@ Market::on_bbo_change(const DepthOrderBook * book, const BookDepth * depth)
 void 
 Market::on_depth_change(const DepthOrderBook * book, const BookDepth * depth)
 {
-    out() << "\tDepth Change: " << ' ' << book->symbol();
-    out() << (depth->changed() ? " Changed" : " Unchanged")
-        << " Change Id: " << depth->last_change()
-        << " Published: " << depth->last_published_change();
-    publishDepth(out(), *depth);
-    out() << std::endl;
+    if(logEvents_)
+    {
+        out() << "\tDepth Change: " << ' ' << book->symbol();
+        out() << (depth->changed() ? " Changed" : " Unchanged")
+            << " Change Id: " << depth->last_change()
+            << " Published: " << depth->last_published_change();
+        publishDepth(out(), *depth);
+        out() << std::endl;
+    }
 }
 
 }  // namespace orderentry
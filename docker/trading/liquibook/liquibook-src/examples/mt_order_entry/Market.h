@@ -6,12 +6,14 @@
 #include <book/depth_order_book.h>
 
 #include "Order.h"
+#include "BookWorker.h"
 
 #include <string>
 #include <vector>
+#include <deque>
 #include <iostream>
 #include <algorithm>
-#include <map>
+#include <unordered_map>
 #include <memory>
 
 namespace orderentry
@@ -29,10 +31,20 @@ class Market
     , public liquibook::book::BboListener<DepthOrderBook>
     , public liquibook::book::DepthListener<DepthOrderBook>
 {
-    typedef std::map<std::string, OrderPtr> OrderMap;
-    typedef std::map<std::string, OrderBookPtr> SymbolToBookMap;
+    /// Orders by id - 1; ids are assigned in sequence
+    typedef std::vector<OrderPtr> OrderVector;
+    /// Books by symbol id
+    typedef std::vector<OrderBookPtr> BookVector;
+    typedef std::unordered_map<std::string, SymbolId> SymbolIdMap;
 public:
-    Market(std::ostream * logFile = &std::cout);
+    /// @param workerThreads 0 to apply each request to its book as it is
+    ///        made; otherwise the number of threads the books are spread
+    ///        across, with the log written by a thread of its own.
+    /// @param historyDepth how many of each order's most recent events to
+    ///        keep for DISPLAY
+    Market(std::ostream * logFile = &std::cout,
+        unsigned workerThreads = 0,
+        uint32_t historyDepth = OrderHistory::DEFAULT_DEPTH);
     ~Market();
 
     /// @brief What to display to user when requesting input
@@ -44,6 +56,45 @@ public:
     /// @brief Apply a user command that has been parsed into tokens.
     bool apply(const std::vector<std::string> & tokens);
 
+    /////////////////////////////////////
+    // Commands already parsed, as from a
+    // binary command file.
+
+    /// @brief Define a symbol, with a new book unless it already has one.
+    /// @returns the symbol's id.
+    SymbolId addSymbol(const std::string & symbol, bool useDepthBook);
+
+    /// @brief Add a new order.  Its id is the next in sequence.
+    /// @param price the limit price, or 0 for a market order
+    /// @param stopPrice the stop price, or 0 if not a stop order
+    bool addOrder(bool buy,
+        liquibook::book::Quantity quantity,
+        SymbolId symbolId,
+        liquibook::book::Price price,
+        liquibook::book::Price stopPrice,
+        bool aon,
+        bool ioc);
+
+    /// @brief Request cancel of an existing order.
+    bool cancelOrder(OrderId orderId);
+
+    /// @brief Request modify of an existing order.
+    /// @param quantityChange change to the quantity, or SIZE_UNCHANGED
+    /// @param price the new price, or PRICE_UNCHANGED
+    bool modifyOrder(OrderId orderId,
+        int64_t quantityChange,
+        liquibook::book::Price price);
+
+    /// @brief Log each request and event (the default), or only errors and
+    /// what DISPLAY asks for.
+    void logEvents(bool logEvents);
+
+    /// @brief Wait until every request so far has been applied and logged.
+    void drain();
+
+    /// @brief The log, for text to appear in line with the requests'.
+    std::ostream & log();
+
 public:
     /////////////////////////////////////
     // Implement OrderListener interface
@@ -118,22 +169,51 @@ private:
     ////////////////////////
     // Order book interactions
     bool symbolIsDefined(const std::string & symbol);
+    bool findSymbol(const std::string & symbol, SymbolId & symbolId);
     OrderBookPtr findBook(const std::string & symbol);
     OrderBookPtr addBook(const std::string & symbol, bool useDepthBook);
-    bool findExistingOrder(const std::vector<std::string> & tokens, size_t & position, OrderPtr & order, OrderBookPtr & book);
-    bool findExistingOrder(const std::string & orderId, OrderPtr & order, OrderBookPtr & book);
-
-    std::ostream & out() 
+    bool readOrderId(const std::vector<std::string> & tokens, size_t & position, OrderId & orderId);
+    bool findExistingOrder(OrderId orderId, OrderPtr & order, OrderBookPtr & book);
+    /// @brief Parse an order id: a number, #number, or -offset from the next id
+    bool parseOrderId(std::string text, OrderId & orderId);
+
+    /// @brief Run a command against a symbol's book: on the book's worker,
+    /// if there are workers.
+    template <typename COMMAND>
+    void dispatch(SymbolId symbolId, COMMAND command)
     {
-        return *logFile_;
+        if(workers_.empty())
+        {
+            command();
+        }
+        else
+        {
+            workers_[symbolId % workers_.size()]->post(std::move(command));
+        }
     }
+    void drainWorkers();
+
+    std::ostream & out();
 private:
-    static uint32_t orderIdSeed_;
+    OrderId orderIdSeed_;
 
     std::ostream * logFile_;
-
-    OrderMap orders_;
-    SymbolToBookMap books_;
+    bool logEvents_;
+
+    /// Declared before the orders and books, which refer to it
+    OrderHistory history_;
+
+    /// With worker threads, everything logged goes through logQueue_;
+    /// this thread's text through mainLog_
+    std::unique_ptr<LogQueue> logQueue_;
+    std::unique_ptr<QueuedLog> mainLog_;
+    std::vector<std::unique_ptr<BookWorker>> workers_;
+
+    OrderVector orders_;
+    BookVector books_;
+    SymbolIdMap symbolIds_;
+    /// Symbol names by id; a deque so orders can refer to them
+    std::deque<std::string> symbols_;
 
 };
 
@@ -2,22 +2,27 @@
 // All rights reserved.
 // See the file license.txt for licensing information.
 #include "Order.h"
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <ostream>
 
 namespace orderentry
 {
 
-Order::Order(const std::string & id,
+Order::Order(OrderId id,
     bool buy_side,
     liquibook::book::Quantity quantity,
-    std::string symbol,
+    SymbolId symbolId,
+    const std::string & symbol,
     liquibook::book::Price price,
     liquibook::book::Price stopPrice,
     bool aon,
-    bool ioc)
+    bool ioc,
+    OrderHistory & history)
     : id_(id)
     , buy_side_(buy_side)
-    , symbol_(symbol)
+    , symbolId_(symbolId)
+    , symbol_(&symbol)
     , quantity_(quantity)
     , price_(price)
     , stopPrice_(stopPrice)
@@ -26,12 +31,15 @@ Order::Order(const std::string & id,
     , quantityFilled_(0)
     , quantityOnMarket_(0)
     , fillCost_(0)
+    , history_(history)
+    , events_(history.allocate())
+    , eventCount_(0)
     , verbose_(false)
 
 {
 }
 
-std::string 
+OrderId 
 Order::order_id() const
 {
     return id_;
@@ -61,10 +69,16 @@ Order::immediate_or_cancel() const
     return ioc_;
 }
 
-std::string 
+const std::string & 
 Order::symbol() const
 {
-   return symbol_;
+   return *symbol_;
+}
+
+SymbolId 
+Order::symbolId() const
+{
+   return symbolId_;
 }
 
 liquibook::book::Price 
@@ -105,16 +119,47 @@ Order::fillCost() const
 }
 
 
-const Order::History & 
-Order::history() const
+uint32_t
+Order::eventCount() const
+{
+    return eventCount_;
+}
+
+uint32_t
+Order::eventsKept() const
 {
-    return history_;
+    return std::min(eventCount_, history_.depth());
 }
 
-const Order::StateChange & 
+const OrderEvent &
+Order::event(uint32_t index) const
+{
+    uint32_t sequence = eventCount_ - eventsKept() + index;
+    return events_[sequence % history_.depth()];
+}
+
+const OrderEvent & 
 Order::currentState() const
 {
-    return history_.back();
+    static const OrderEvent unknown = {0, 0, 0, OrderEvent::NO_REASON, Unknown, {0}};
+    if(eventCount_ == 0)
+    {
+        return unknown;
+    }
+    return event(eventsKept() - 1);
+}
+
+void
+Order::record(State state, int64_t quantity, uint64_t price, const char * reason)
+{
+    OrderEvent & event = events_[eventCount_ % history_.depth()];
+    event.timestamp_ = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    event.price_ = price;
+    event.quantity_ = quantity;
+    event.reason_ = reason == nullptr ? OrderEvent::NO_REASON : history_.addReason(reason);
+    event.state_ = uint8_t(state);
+    ++eventCount_;
 }
 
 
@@ -134,30 +179,20 @@ Order::isVerbose() const
 void 
 Order::onSubmitted()
 {
-    std::stringstream msg;
-    msg << (is_buy() ? "BUY " : "SELL ") << quantity_ << ' ' << symbol_ << " @";
-    if( price_ == 0)
-    {
-        msg << "MKT";
-    }
-    else
-    {
-        msg << price_;
-    }
-    history_.emplace_back(Submitted, msg.str());
+    record(Submitted, quantity_, price_);
 }
 
 void 
 Order::onAccepted()
 {
     quantityOnMarket_ = quantity_;
-    history_.emplace_back(Accepted);
+    record(Accepted);
 }
 
 void 
 Order::onRejected(const char * reason)
 {
-    history_.emplace_back(Rejected, reason);
+    record(Rejected, 0, 0, reason);
 }
 
 void 
@@ -167,29 +202,26 @@ Order::onFilled(
 {
     quantityOnMarket_ -= fill_qty;
     fillCost_ += fill_cost;
-
-    std::stringstream msg;
-    msg << fill_qty << " for " << fill_cost;
-    history_.emplace_back(Filled, msg.str());
+    record(Filled, fill_qty, fill_cost);
 }
 
 void 
 Order::onCancelRequested()
 {
-    history_.emplace_back(CancelRequested);
+    record(CancelRequested);
 }
 
 void 
 Order::onCancelled()
 {
     quantityOnMarket_ = 0;
-    history_.emplace_back(Cancelled);
+    record(Cancelled);
 }
 
 void 
 Order::onCancelRejected(const char * reason)
 {
-    history_.emplace_back(CancelRejected, reason);
+    record(CancelRejected, 0, 0, reason);
 }
 
 void 
@@ -197,44 +229,33 @@ Order::onReplaceRequested(
     const int32_t& size_delta, 
     liquibook::book::Price new_price)
 {
-    std::stringstream msg;
-    if(size_delta != liquibook::book::SIZE_UNCHANGED)
-    {
-        msg << "Quantity change: " << size_delta << ' ';
-    }
-    if(new_price != liquibook::book::PRICE_UNCHANGED)
-    {
-        msg << "New Price " << new_price;
-    }
-    history_.emplace_back(ModifyRequested, msg.str());
+    record(ModifyRequested, size_delta, new_price);
 }
 
 void 
 Order::onReplaced(const int32_t& size_delta, 
     liquibook::book::Price new_price)
 {
-    std::stringstream msg;
     if(size_delta != liquibook::book::SIZE_UNCHANGED)
     {
         quantity_ += size_delta;
         quantityOnMarket_ += size_delta;
-        msg << "Quantity change: " << size_delta << ' ';
     }
     if(new_price != liquibook::book::PRICE_UNCHANGED)
     {
         price_ = new_price;
-        msg << "New Price " << new_price;
     }
-    history_.emplace_back(Modified, msg.str());
+    record(Modified, size_delta, new_price);
 }
 
 void 
 Order::onReplaceRejected(const char * reason)
 {
-    history_.emplace_back(ModifyRejected, reason);
+    record(ModifyRejected, 0, 0, reason);
 }
 
-std::ostream & operator << (std::ostream & out, const Order::StateChange & event)
+void
+Order::displayEvent(std::ostream & out, const OrderEvent & event) const
 {
     out << "{";
     switch(event.state_)
@@ -276,9 +297,43 @@ std::ostream & operator << (std::ostream & out, const Order::StateChange & event
         out << "Unknown ";
         break;
     }
-    out << event.description_;
+
+    // The description, formatted now rather than when the event happened
+    switch(event.state_)
+    {
+    case Order::Submitted:
+        out << (is_buy() ? "BUY " : "SELL ") << event.quantity_ << ' ' << symbol() << " @";
+        if(event.price_ == 0)
+        {
+            out << "MKT";
+        }
+        else
+        {
+            out << event.price_;
+        }
+        break;
+    case Order::Filled:
+        out << event.quantity_ << " for " << event.price_;
+        break;
+    case Order::ModifyRequested:
+    case Order::Modified:
+        if(event.quantity_ != liquibook::book::SIZE_UNCHANGED)
+        {
+            out << "Quantity change: " << event.quantity_ << ' ';
+        }
+        if(event.price_ != liquibook::book::PRICE_UNCHANGED)
+        {
+            out << "New Price " << event.price_;
+        }
+        break;
+    default:
+        if(event.reason_ != OrderEvent::NO_REASON)
+        {
+            out << history_.reason(event.reason_);
+        }
+        break;
+    }
     out << "}";
-    return out;
 }
 
 std::ostream & operator << (std::ostream & out, const Order & order)
@@ -324,15 +379,21 @@ std::ostream & operator << (std::ostream & out, const Order & order)
 
     if(order.isVerbose())
     {
-        const Order::History & history = order.history();
-        for(auto event = history.begin(); event != history.end(); ++event)
+        uint32_t dropped = order.eventCount() - order.eventsKept();
+        if(dropped != 0)
+        {
+            out << "\n\t... " << dropped << " earlier events";
+        }
+        for(uint32_t event = 0; event < order.eventsKept(); ++event)
         {
-            out << "\n\t" << *event;
+            out << "\n\t";
+            order.displayEvent(out, order.event(event));
         } 
     }
     else
     {
-        out << " Last Event:" << order.currentState();
+        out << " Last Event:";
+        order.displayEvent(out, order.currentState());
     }
 
    out << ']';
@@ -4,13 +4,18 @@
 #pragma once
 
 #include "OrderFwd.h"
+#include "OrderHistory.h"
 #include <book/types.h>
 
+#include <iosfwd>
 #include <string>
-#include <vector>
 
 namespace orderentry
 {
+/// @brief Order ids are assigned by the Market in sequence, starting at 1
+typedef uint32_t OrderId;
+/// @brief Symbols are interned by the Market; ids are dense, starting at 0
+typedef uint32_t SymbolId;
 
 class Order
 {
@@ -30,29 +35,20 @@ public:
         Unknown
     };
 
-    struct StateChange
-    {
-        State state_;
-        std::string description_;
-        StateChange()
-          : state_(Unknown)
-          {}
-
-        StateChange(State state, const std::string & description = "")
-            : state_(state)
-            , description_(description)
-        {}
-    };    
-    typedef std::vector<StateChange> History;
 public:
-    Order(const std::string & id,
+    /// @param symbol the interned symbol, which must outlive the order
+    /// @param history where the order's events are kept, which must outlive
+    ///        the order
+    Order(OrderId id,
         bool buy_side,
         liquibook::book::Quantity quantity,
-        std::string symbol,
+        SymbolId symbolId,
+        const std::string & symbol,
         liquibook::book::Price price,
         liquibook::book::Price stopPrice,
         bool aon,
-        bool ioc);
+        bool ioc,
+        OrderHistory & history);
 
     //////////////////////////
     // Implement the 
@@ -84,9 +80,11 @@ public:
     /// orders already on the market, cancel any remaining quantity.
     virtual bool immediate_or_cancel() const;
 
-    std::string symbol() const;
+    const std::string & symbol() const;
 
-    std::string order_id() const;
+    SymbolId symbolId() const;
+
+    OrderId order_id() const;
 
     uint32_t quantityFilled() const;
 
@@ -96,8 +94,17 @@ public:
 
     Order & verbose(bool verbose = true);
     bool isVerbose()const;
-    const History & history() const;
-    const StateChange & currentState() const;
+
+    /// @brief Events recorded, including any no longer kept.
+    uint32_t eventCount() const;
+    /// @brief The most recent events, oldest first: at most the history
+    /// depth of the market.
+    uint32_t eventsKept() const;
+    const OrderEvent & event(uint32_t index) const;
+    const OrderEvent & currentState() const;
+
+    /// @brief Describe an event of this order, as {State description}
+    void displayEvent(std::ostream & out, const OrderEvent & event) const;
 
     ///////////////////////////
     // Order life cycle events
@@ -123,9 +130,15 @@ public:
     void onReplaceRejected(const char * reaseon);
 
 private:
-    std::string id_;
+    void record(State state,
+        int64_t quantity = 0,
+        uint64_t price = 0,
+        const char * reason = nullptr);
+
+    OrderId id_;
     bool buy_side_;
-    std::string symbol_;
+    SymbolId symbolId_;
+    const std::string * symbol_;
     liquibook::book::Quantity quantity_;
     liquibook::book::Price price_;
     liquibook::book::Price stopPrice_;
@@ -137,11 +150,13 @@ private:
     int32_t quantityOnMarket_;
     uint32_t fillCost_;
     
-    std::vector<StateChange> history_;
+    OrderHistory & history_;
+    /// Room for history_.depth() events, used as a ring
+    OrderEvent * events_;
+    uint32_t eventCount_;
     bool verbose_;
 };
 
 std::ostream & operator << (std::ostream & out, const Order & order);
-std::ostream & operator << (std::ostream & out, const Order::StateChange & event);
 
 }
@@ -0,0 +1,69 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#include "OrderHistory.h"
+
+#include <algorithm>
+
+namespace orderentry
+{
+
+OrderHistory::OrderHistory(uint32_t depth)
+: depth_(std::max<uint32_t>(depth, 1))
+, chunkSize_(std::max<size_t>(CHUNK_EVENTS, depth_))
+, chunkUsed_(chunkSize_)
+{
+}
+
+uint32_t
+OrderHistory::depth() const
+{
+    return depth_;
+}
+
+OrderEvent *
+OrderHistory::allocate()
+{
+    if(chunkSize_ - chunkUsed_ < depth_)
+    {
+        chunks_.emplace_back(new OrderEvent[chunkSize_]);
+        chunkUsed_ = 0;
+    }
+    OrderEvent * events = chunks_.back().get() + chunkUsed_;
+    chunkUsed_ += depth_;
+    return events;
+}
+
+uint16_t
+OrderHistory::addReason(const char * reason)
+{
+    std::lock_guard<std::mutex> guard(reasonMutex_);
+    auto known = reasonIds_.find(reason);
+    if(known != reasonIds_.end())
+    {
+        return known->second;
+    }
+    // The book rejects for a handful of reasons; should there ever be more
+    // than fit, later ones are not kept
+    if(reasons_.size() >= OrderEvent::NO_REASON)
+    {
+        return OrderEvent::NO_REASON;
+    }
+    uint16_t reasonId = uint16_t(reasons_.size());
+    reasons_.push_back(reason);
+    reasonIds_[reason] = reasonId;
+    return reasonId;
+}
+
+std::string
+OrderHistory::reason(uint16_t reasonId) const
+{
+    std::lock_guard<std::mutex> guard(reasonMutex_);
+    if(reasonId >= reasons_.size())
+    {
+        return std::string();
+    }
+    return reasons_[reasonId];
+}
+
+} // namespace orderentry
@@ -0,0 +1,78 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+/// @brief Order life cycle events, kept as fixed size records.
+#pragma once
+
+#include <book/types.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace orderentry
+{
+
+/// @brief One event in the life of an order.  What the fields hold depends
+/// on the state; the text is only formatted when the order is displayed.
+struct OrderEvent
+{
+    /// Nanoseconds, by the steady clock
+    uint64_t timestamp_;
+    /// Limit price, fill cost, or new price
+    uint64_t price_;
+    /// Quantity, fill quantity, or change to the quantity
+    int64_t quantity_;
+    /// OrderHistory::reason() of a reject, or NO_REASON
+    uint16_t reason_;
+    /// An Order::State
+    uint8_t state_;
+    uint8_t reserved_[5];
+
+    static const uint16_t NO_REASON = 0xFFFF;
+};
+
+/// @brief Where a market's orders keep their events.
+///
+/// Each order is given room for its most recent depth() events when it is
+/// created.  That room comes from large chunks that are only ever added
+/// to, so recording an event never allocates.
+class OrderHistory
+{
+public:
+    static const uint32_t DEFAULT_DEPTH = 4;
+
+    OrderHistory(uint32_t depth = DEFAULT_DEPTH);
+
+    /// @brief Events kept per order.
+    uint32_t depth() const;
+
+    /// @brief Room for one order's events.  Not thread safe: orders are
+    /// created by one thread.
+    OrderEvent * allocate();
+
+    /// @brief An id for reject text.  Thread safe.
+    uint16_t addReason(const char * reason);
+
+    /// @brief Reject text by id.  Thread safe.
+    std::string reason(uint16_t reasonId) const;
+
+private:
+    /// Events per chunk, unless depth() is larger
+    static const size_t CHUNK_EVENTS = 65536;
+
+    uint32_t depth_;
+    std::vector<std::unique_ptr<OrderEvent[]>> chunks_;
+    size_t chunkSize_;
+    size_t chunkUsed_;
+
+    mutable std::mutex reasonMutex_;
+    std::deque<std::string> reasons_;
+    std::unordered_map<std::string, uint16_t> reasonIds_;
+};
+
+} // namespace orderentry
@@ -0,0 +1,167 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+/// Market::apply throughput.  A scripted mix of adds, modifies and cancels
+/// over a number of depth books is tokenized as mt_order_entry would, then
+/// applied with per-event logging off, so what is timed is looking up orders
+/// and books, and the books themselves.  With -w the books are spread
+/// across that many worker threads.
+///
+///   mt_order_entry_bench [-n commands] [-s symbols] [-w threads]
+#include "Market.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace orderentry;
+
+namespace
+{
+    typedef std::vector<std::string> Tokens;
+
+    /// Commands are generated, then applied, this many at a time
+    const size_t BATCH_SIZE = 100000;
+    /// Modifies and cancels pick one of this many most recent orders
+    const uint32_t RECENT_ORDERS = 1000;
+    const uint32_t MID_PRICE = 1000;
+
+    uint32_t countFromArgs(int argc, const char * argv[], const char * flag, uint32_t defaultCount)
+    {
+        for(int i = 1; i + 1 < argc; ++i)
+        {
+            if(strcmp(argv[i], flag) == 0)
+            {
+                return uint32_t(atoi(argv[i + 1]));
+            }
+        }
+        return defaultCount;
+    }
+
+    /// @brief Generates the command script.
+    class ScriptGenerator
+    {
+    public:
+        ScriptGenerator(uint32_t symbolCount)
+        : symbolCount_(symbolCount)
+        , ordersAdded_(0)
+        , random_(12345)
+        {
+        }
+
+        /// @brief The next command, as tokens
+        void next(Tokens & tokens)
+        {
+            tokens.clear();
+            // Each symbol's first order creates its depth book
+            if(ordersAdded_ < symbolCount_)
+            {
+                add(tokens, "!SYM" + std::to_string(ordersAdded_));
+                return;
+            }
+            uint32_t choice = random_() % 4;
+            if(choice < 2)
+            {
+                add(tokens, "SYM" + std::to_string(random_() % symbolCount_));
+            }
+            else if(choice == 2)
+            {
+                tokens.push_back("MODIFY");
+                tokens.push_back(recentOrder());
+                if(random_() % 2)
+                {
+                    tokens.push_back("PRICE");
+                    tokens.push_back(std::to_string(MID_PRICE - 20 + random_() % 41));
+                }
+                else
+                {
+                    tokens.push_back("QUANTITY");
+                    tokens.push_back(std::to_string(int32_t(random_() % 5) * 100 - 200));
+                }
+                tokens.push_back(";");
+            }
+            else
+            {
+                tokens.push_back("CANCEL");
+                tokens.push_back(recentOrder());
+                tokens.push_back(";");
+            }
+        }
+
+    private:
+        void add(Tokens & tokens, const std::string & symbol)
+        {
+            bool buy = random_() % 2 != 0;
+            // Mostly resting orders; one in ten crosses the spread
+            uint32_t offset = 1 + random_() % 20;
+            bool cross = random_() % 10 == 0;
+            uint32_t price = (buy != cross) ? MID_PRICE - offset : MID_PRICE + offset;
+            tokens.push_back(buy ? "BUY" : "SELL");
+            tokens.push_back(std::to_string(100 * (1 + random_() % 10)));
+            tokens.push_back(symbol);
+            tokens.push_back(std::to_string(price));
+            tokens.push_back(";");
+            ++ordersAdded_;
+        }
+
+        std::string recentOrder()
+        {
+            uint32_t recent = std::min(ordersAdded_, RECENT_ORDERS);
+            return std::to_string(ordersAdded_ - random_() % recent);
+        }
+
+        uint32_t symbolCount_;
+        uint32_t ordersAdded_;
+        std::minstd_rand random_;
+    };
+}
+
+int main(int argc, const char * argv[])
+{
+    const uint32_t commandCount = countFromArgs(argc, argv, "-n", 1000000);
+    const uint32_t symbolCount = countFromArgs(argc, argv, "-s", 100);
+    const uint32_t workerThreads = countFromArgs(argc, argv, "-w", 0);
+    if(symbolCount == 0)
+    {
+        std::cerr << "At least one symbol is needed" << std::endl;
+        return -1;
+    }
+
+    // Errors, if any, go to a stream that discards them
+    std::ostream discard(nullptr);
+    Market market(&discard, workerThreads);
+    market.logEvents(false);
+    ScriptGenerator generator(symbolCount);
+
+    std::vector<Tokens> batch(BATCH_SIZE);
+    std::chrono::steady_clock::duration elapsed(0);
+    uint32_t failed = 0;
+    for(uint32_t done = 0; done < commandCount; )
+    {
+        size_t batchSize = std::min<size_t>(BATCH_SIZE, commandCount - done);
+        for(size_t i = 0; i < batchSize; ++i)
+        {
+            generator.next(batch[i]);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < batchSize; ++i)
+        {
+            if(!market.apply(batch[i]))
+            {
+                ++failed;
+            }
+        }
+        market.drain();
+        elapsed += std::chrono::steady_clock::now() - start;
+        done += uint32_t(batchSize);
+    }
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << commandCount << " commands over " << symbolCount << " symbols, "
+        << workerThreads << " worker threads, in " << seconds << " s, " << uint64_t(commandCount / seconds) << " commands/s"
+        << std::endl;
+    std::cout << "  " << failed << " commands failed" << std::endl;
+    return 0;
+}
@@ -2,11 +2,14 @@
 // All rights reserved.
 // See the file license.txt for licensing information.
 #include "Market.h"
+#include "CommandFile.h"
 #include "Util.h"
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <string>
 #include <locale>
+#include <cstdlib>
 #include <cstring>
 #include <algorithm> 
 #include <vector>
@@ -14,20 +17,108 @@
 
 using namespace orderentry;
 
+namespace
+{
+    void usage()
+    {
+        std::cerr << "Usage: mt_order_entry [-t] [-w threads] [-e events] [commandFile|- [logFile]]\n"
+            << "       mt_order_entry -c scriptFile binaryFile\n"
+            << "  -t  throughput: log only errors and DISPLAY, and report requests/s\n"
+            << "  -w  spread the books across this many worker threads\n"
+            << "  -e  keep this many of each order's most recent events for DISPLAY\n"
+            << "  -c  convert a script to a binary command file" << std::endl;
+    }
+
+    int convertScript(const char * scriptName, const char * binaryName)
+    {
+        std::ifstream script(scriptName);
+        if(!script.good())
+        {
+            std::cerr << "Can't open command file " << scriptName << ". Exiting." << std::endl;
+            return -1;
+        }
+        std::ofstream binary(binaryName, std::ios::binary);
+        if(!binary.good())
+        {
+            std::cerr << "Can't create " << binaryName << ". Exiting." << std::endl;
+            return -1;
+        }
+        CommandFileWriter writer(binary);
+        if(!writer.convert(script))
+        {
+            std::cerr << "Can't convert " << scriptName << ". Exiting." << std::endl;
+            return -1;
+        }
+        std::cout << "Converted " << writer.commandCount() << " requests" << std::endl;
+        return 0;
+    }
+
+    void reportThroughput(uint64_t requests, std::chrono::steady_clock::duration elapsed)
+    {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << requests << " requests in " << seconds << " s, "
+            << uint64_t(seconds > 0 ? requests / seconds : 0) << " requests/s" << std::endl;
+    }
+}
+
 int main(int argc, const char * argv[])
 {
     bool done = false;
     bool prompt = true;
     bool interactive = true;
     bool fileActive = false;
+    bool throughput = false;
+    unsigned workerThreads = 0;
+    uint32_t historyDepth = OrderHistory::DEFAULT_DEPTH;
     std::ostream * log = &std::cout;
     std::ifstream commandFile;
     std::ofstream logFile;
 
+    // Options come first; a lone "-" is the command file argument
+    int arg = 1;
+    while(arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0')
+    {
+        std::string option = argv[arg++];
+        if(option == "-c" && arg + 1 < argc)
+        {
+            return convertScript(argv[arg], argv[arg + 1]);
+        }
+        else if(option == "-t")
+        {
+            throughput = true;
+        }
+        else if(option == "-w" && arg < argc)
+        {
+            workerThreads = unsigned(atoi(argv[arg++]));
+        }
+        else if(option == "-e" && arg < argc)
+        {
+            historyDepth = uint32_t(atoi(argv[arg++]));
+        }
+        else
+        {
+            usage();
+            return -1;
+        }
+    }
+    argc -= arg - 1;
+    argv += arg - 1;
+
+    CommandFileReader binaryFile;
+    bool binary = false;
     if(argc > 1)
     {
         std::string filename = argv[1];
-        if(filename != "-")
+        if(filename != "-" && CommandFileReader::isCommandFile(filename))
+        {
+            if(!binaryFile.open(filename))
+            {
+                std::cerr << binaryFile.error() << ". Exiting." << std::endl;
+                return -1;
+            }
+            binary = true;
+        }
+        else if(filename != "-")
         {
             commandFile.open(filename);
             if(!commandFile.good())
@@ -51,7 +142,27 @@ int main(int argc, const char * argv[])
         log = & logFile;
     }
 
-    Market market(log);
+    Market market(log, workerThreads, historyDepth);
+    market.logEvents(!throughput);
+    if(binary)
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t requests = binaryFile.apply(market);
+        market.drain();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if(!binaryFile.error().empty())
+        {
+            std::cerr << binaryFile.error() << " after " << requests << " requests." << std::endl;
+        }
+        if(throughput)
+        {
+            reportThroughput(requests, elapsed);
+        }
+        return 0;
+    }
+
+    uint64_t requests = 0;
+    auto start = std::chrono::steady_clock::now();
     while( !done)
     {
         std::string input;
@@ -72,9 +183,9 @@ int main(int argc, const char * argv[])
                 }
             }
             // if it came from a file, echo it to the log
-            if(input.substr(0,2) != "##") // don't log ## comments.
+            if(!throughput && input.substr(0,2) != "##") // don't log ## comments.
             {
-                *log << input << std::endl;
+                market.log() << input << std::endl;
             }
         }
         else
@@ -94,7 +205,7 @@ int main(int argc, const char * argv[])
         {
             if(input.substr(0,2) != "##") // don't log ## comments.
             {
-                *log << input << std::endl;
+                market.log() << input << std::endl;
             }
         }
 
@@ -150,23 +261,37 @@ int main(int argc, const char * argv[])
             else if(command == "?" || command == "HELP")
             {
                 market.help();
-                *log << "(F)ile  Open or Close a command input file\n"
+                market.log() << "(F)ile  Open or Close a command input file\n"
                     << "\tArguments\n"
                     << "\t\t<FileName>  Required if no file is open. Must not appear if file is open.\n";
-                *log << "QUIT  Exit from this program.\n";
+                market.log() << "QUIT  Exit from this program.\n";
                 bool prompt = true;
             }
-            else if(!market.apply(words))
+            else
             {
-                std::cerr << "Cannot process command";
-                for(auto word = words.begin(); word != words.end(); ++ word)
+                ++requests;
+                if(!market.apply(words))
                 {
-                    std::cerr << ' ' << *word;
+                    std::cerr << "Cannot process command";
+                    for(auto word = words.begin(); word != words.end(); ++ word)
+                    {
+                        std::cerr << ' ' << *word;
+                    }
+                    std::cerr << std::endl;
+                    bool prompt = true;
+                }
+                // Show the console user the results before the next prompt
+                if(!fileActive)
+                {
+                    market.drain();
                 }
-                std::cerr << std::endl;
-                bool prompt = true;
             }
         }
     }
+    market.drain();
+    if(throughput)
+    {
+        reportThroughput(requests, std::chrono::steady_clock::now() - start);
+    }
     return 0;
 }
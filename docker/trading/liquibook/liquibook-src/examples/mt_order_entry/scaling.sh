@@ -0,0 +1,18 @@
+#!/bin/sh
+# Copyright (c) 2017 Object Computing, Inc.
+# All rights reserved.
+# See the file license.txt for licensing information.
+
+# Throughput of mt_order_entry_bench as the books are spread across more
+# worker threads: first applied inline, then on 1, 2, 4 ... threads up to
+# the number of cores.  Arguments are passed to the bench, for example
+#   ./scaling.sh -n 2000000 -s 200
+BENCH=${BENCH:-$LIQUIBOOK_ROOT/bin/mt_order_entry_bench}
+CORES=`getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1`
+
+"$BENCH" "$@" -w 0 | head -1
+THREADS=1
+while test $THREADS -le $CORES; do
+  "$BENCH" "$@" -w $THREADS | head -1
+  THREADS=`expr $THREADS \* 2`
+done
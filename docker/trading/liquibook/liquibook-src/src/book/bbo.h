@@ -0,0 +1,459 @@
+// Copyright (c) 2012 - 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#pragma once
+
+#include "depth_constants.h"
+#include "depth_level.h"
+#include <stdexcept>
+#include <cmath>
+
+namespace liquibook { namespace book {
+/// @brief top of book tracker.  Aggregates the best limit price of each
+///    side, and the last few levels displaced from the best; events at any
+///    other price are ignored.  When a best level empties, the side is
+///    marked for restoration.  The next best level is then the most recently
+///    displaced level if it is still next in the order book, or is rebuilt
+///    from the orders at the first price of the book's own sorted
+///    containers.
+///
+///    Presents the same level accessors as Depth<1>, so BBO listeners may
+///    use either.
+class Bbo {
+public:
+  /// @brief construct
+  Bbo();
+
+  /// @brief get the best bid level (const)
+  const DepthLevel* bids() const;
+  /// @brief get the last bid level (const) - the same as the best bid
+  const DepthLevel* last_bid_level() const;
+  /// @brief get the best ask level (const)
+  const DepthLevel* asks() const;
+  /// @brief get the last ask level (const) - the same as the best ask
+  const DepthLevel* last_ask_level() const;
+  /// @brief get one past the last ask level (const)
+  const DepthLevel* end() const;
+
+  /// @brief add an order
+  /// @param price the price level of the order
+  /// @param qty the open quantity of the order
+  /// @param is_bid indicator of bid or ask
+  void add_order(Price price, Quantity qty, bool is_bid);
+
+  /// @brief ignore future fill quantity on a side, due to a match at
+  ///        accept time for an order
+  /// @param qty the open quantity to ignore
+  /// @param is_bid indicator of bid or ask
+  void ignore_fill_qty(Quantity qty, bool is_bid);
+
+  /// @brief handle an order fill
+  /// @param price the price level of the order
+  /// @param fill_qty the quantity of this fill
+  /// @param filled was this order completely filled?
+  /// @param is_bid indicator of bid or ask
+  void fill_order(Price price,
+                  Quantity fill_qty,
+                  bool filled,
+                  bool is_bid);
+
+  /// @brief cancel or fill an order
+  /// @param price the price level of the order
+  /// @param open_qty the open quantity of the order
+  /// @param is_bid indicator of bid or ask
+  /// @return true if the close emptied the best level
+  bool close_order(Price price, Quantity open_qty, bool is_bid);
+
+  /// @brief change quantity of an order
+  /// @param price the price level of the order
+  /// @param qty_delta the change in open quantity of the order (+ or -)
+  /// @param is_bid indicator of bid or ask
+  void change_qty_order(Price price, int64_t qty_delta, bool is_bid);
+
+  /// @brief replace a order
+  /// @param current_price the current price level of the order
+  /// @param new_price the new price level of the order
+  /// @param current_qty the current open quantity of the order
+  /// @param new_qty the new open quantity of the order
+  /// @param is_bid indicator of bid or ask
+  /// @return true if the close emptied the best level
+  bool replace_order(Price current_price,
+                     Price new_price,
+                     Quantity current_qty,
+                     Quantity new_qty,
+                     bool is_bid);
+
+  /// @brief has the best bid emptied, so it must be read from the book?
+  bool needs_bid_restoration() const;
+
+  /// @brief has the best ask emptied, so it must be read from the book?
+  bool needs_ask_restoration() const;
+
+  /// @brief rebuild the best bid from the orders at the first limit
+  ///        price of the book's bids
+  /// @param bids the order book's sorted bid container
+  template <class TrackerMap>
+  void restore_bids(const TrackerMap& bids);
+
+  /// @brief rebuild the best ask from the orders at the first limit
+  ///        price of the book's asks
+  /// @param asks the order book's sorted ask container
+  template <class TrackerMap>
+  void restore_asks(const TrackerMap& asks);
+
+  /// @brief has the bbo changed since the last publish
+  bool changed() const;
+
+  /// @brief what was the ID of the last change?
+  ChangeId last_change() const;
+
+  /// @brief what was the ID of the last published change?
+  ChangeId last_published_change() const;
+
+  /// @brief note the ID of last published change
+  void published();
+
+private:
+  // Published best bid, best ask
+  DepthLevel levels_[2];
+  // Working best bid, best ask
+  DepthLevel best_[2];
+  bool has_best_[2];
+  // Levels displaced from the best and still aggregated, worst first
+  static const int DISPLACED = 4;
+  DepthLevel displaced_[2][DISPLACED];
+  int displaced_count_[2];
+  ChangeId last_change_;
+  ChangeId last_published_change_;
+  Quantity ignore_bid_fill_qty_;
+  Quantity ignore_ask_fill_qty_;
+  bool needs_restoration_[2];
+
+  /// @brief find the best level, if it is at the price
+  /// @param price the price to find
+  /// @param side 0 for bids, 1 for asks
+  /// @return the level, or nullptr if the price is not the best
+  DepthLevel* find_level(Price price, int side);
+
+  /// @brief find a displaced level, if there is one at the price
+  DepthLevel* find_displaced(Price price, int side);
+
+  /// @brief keep aggregating a level displaced from the best
+  void push_displaced(const DepthLevel& level, int side);
+
+  /// @brief stop aggregating a displaced level
+  void erase_displaced(DepthLevel* level, int side);
+
+  /// @brief copy the best level of a side to the published levels
+  void publish_best(int side);
+
+  /// @brief rebuild a best level from the orders at the first limit price
+  ///        in a container
+  template <class TrackerMap>
+  void restore(const TrackerMap& orders, bool is_bid);
+};
+
+inline
+Bbo::Bbo()
+: last_change_(0),
+  last_published_change_(0),
+  ignore_bid_fill_qty_(0),
+  ignore_ask_fill_qty_(0)
+{
+  for (int side = 0; side < 2; ++side) {
+    levels_[side].init(INVALID_LEVEL_PRICE, false);
+    levels_[side].last_change(0);
+    has_best_[side] = false;
+    displaced_count_[side] = 0;
+    needs_restoration_[side] = false;
+  }
+}
+
+inline const DepthLevel*
+Bbo::bids() const
+{
+  return levels_;
+}
+
+inline const DepthLevel*
+Bbo::last_bid_level() const
+{
+  return levels_;
+}
+
+inline const DepthLevel*
+Bbo::asks() const
+{
+  return levels_ + 1;
+}
+
+inline const DepthLevel*
+Bbo::last_ask_level() const
+{
+  return levels_ + 1;
+}
+
+inline const DepthLevel*
+Bbo::end() const
+{
+  return levels_ + 2;
+}
+
+inline DepthLevel*
+Bbo::find_level(Price price, int side)
+{
+  // While restoration is pending, the book will determine the best
+  if (has_best_[side] && !needs_restoration_[side] &&
+      best_[side].price() == price) {
+    return &best_[side];
+  }
+  return nullptr;
+}
+
+inline DepthLevel*
+Bbo::find_displaced(Price price, int side)
+{
+  DepthLevel* levels = displaced_[side];
+  for (int index = displaced_count_[side] - 1; index >= 0; --index) {
+    if (levels[index].price() == price) {
+      return levels + index;
+    }
+  }
+  return nullptr;
+}
+
+inline void
+Bbo::push_displaced(const DepthLevel& level, int side)
+{
+  DepthLevel* levels = displaced_[side];
+  // Forget the worst, if there is no room
+  if (displaced_count_[side] == DISPLACED) {
+    erase_displaced(levels, side);
+  }
+  levels[displaced_count_[side]++] = level;
+}
+
+inline void
+Bbo::erase_displaced(DepthLevel* level, int side)
+{
+  DepthLevel* end = displaced_[side] + --displaced_count_[side];
+  for (; level != end; ++level) {
+    *level = *(level + 1);
+  }
+}
+
+inline void
+Bbo::publish_best(int side)
+{
+  if (has_best_[side]) {
+    levels_[side] = best_[side];
+  } else {
+    levels_[side].init(INVALID_LEVEL_PRICE, false);
+  }
+  levels_[side].last_change(++last_change_);
+}
+
+inline void
+Bbo::add_order(Price price, Quantity qty, bool is_bid)
+{
+  int side = is_bid ? 0 : 1;
+  DepthLevel* level = find_level(price, side);
+  if (level) {
+    level->add_order(qty);
+    publish_best(side);
+  // While restoration is pending, the book will determine the best
+  } else if (needs_restoration_[side]) {
+    if ((level = find_displaced(price, side))) {
+      level->add_order(qty);
+    }
+  // Else if the order betters the best price, or the side was empty
+  } else if (!has_best_[side] ||
+             (is_bid ? price > best_[side].price()
+                     : price < best_[side].price())) {
+    if (has_best_[side]) {
+      push_displaced(best_[side], side);
+    }
+    best_[side].init(price, false);
+    best_[side].add_order(qty);
+    has_best_[side] = true;
+    publish_best(side);
+  } else if ((level = find_displaced(price, side))) {
+    level->add_order(qty);
+  }
+}
+
+inline void
+Bbo::ignore_fill_qty(Quantity qty, bool is_bid)
+{
+  if (is_bid) {
+    if (ignore_bid_fill_qty_) {
+      throw std::runtime_error("Unexpected ignore_bid_fill_qty_");
+    }
+    ignore_bid_fill_qty_ = qty;
+  } else {
+    if (ignore_ask_fill_qty_) {
+      throw std::runtime_error("Unexpected ignore_ask_fill_qty_");
+    }
+    ignore_ask_fill_qty_ = qty;
+  }
+}
+
+inline void
+Bbo::fill_order(
+  Price price,
+  Quantity fill_qty,
+  bool filled,
+  bool is_bid)
+{
+  if (is_bid && ignore_bid_fill_qty_) {
+    ignore_bid_fill_qty_ -= fill_qty;
+  } else if ((!is_bid) && ignore_ask_fill_qty_) {
+    ignore_ask_fill_qty_ -= fill_qty;
+  } else if (filled) {
+    close_order(price, fill_qty, is_bid);
+  } else {
+    change_qty_order(price, -(int64_t)fill_qty, is_bid);
+  }
+}
+
+inline bool
+Bbo::close_order(Price price, Quantity open_qty, bool is_bid)
+{
+  int side = is_bid ? 0 : 1;
+  DepthLevel* level = find_level(price, side);
+  if (level) {
+    // If this is the last order on the level
+    if (level->close_order(open_qty)) {
+      has_best_[side] = false;
+      // The next best level must come from the book
+      needs_restoration_[side] = true;
+      publish_best(side);
+      return true;
+    }
+    publish_best(side);
+  } else if ((level = find_displaced(price, side))) {
+    if (level->close_order(open_qty)) {
+      erase_displaced(level, side);
+    }
+  }
+  return false;
+}
+
+inline void
+Bbo::change_qty_order(Price price, int64_t qty_delta, bool is_bid)
+{
+  int side = is_bid ? 0 : 1;
+  DepthLevel* level = find_level(price, side);
+  bool is_best = (level != nullptr);
+  if (!level) {
+    level = find_displaced(price, side);
+  }
+  if (level && qty_delta) {
+    if (qty_delta > 0) {
+      level->increase_qty(Quantity(qty_delta));
+    } else {
+      level->decrease_qty(Quantity(std::abs(qty_delta)));
+    }
+    if (is_best) {
+      publish_best(side);
+    }
+  }
+}
+
+inline bool
+Bbo::replace_order(
+  Price current_price,
+  Price new_price,
+  Quantity current_qty,
+  Quantity new_qty,
+  bool is_bid)
+{
+  bool erased = false;
+  // If the price is unchanged, modify this level only
+  if (current_price == new_price) {
+    int64_t qty_delta = ((int64_t)new_qty) - current_qty;
+    change_qty_order(current_price, qty_delta, is_bid);
+  // Else this is a price change
+  } else {
+    add_order(new_price, new_qty, is_bid);
+    erased = close_order(current_price, current_qty, is_bid);
+  }
+  return erased;
+}
+
+inline bool
+Bbo::needs_bid_restoration() const
+{
+  return needs_restoration_[0];
+}
+
+inline bool
+Bbo::needs_ask_restoration() const
+{
+  return needs_restoration_[1];
+}
+
+template <class TrackerMap>
+inline void
+Bbo::restore_bids(const TrackerMap& bids)
+{
+  restore(bids, true);
+}
+
+template <class TrackerMap>
+inline void
+Bbo::restore_asks(const TrackerMap& asks)
+{
+  restore(asks, false);
+}
+
+template <class TrackerMap>
+void
+Bbo::restore(const TrackerMap& orders, bool is_bid)
+{
+  int side = is_bid ? 0 : 1;
+  // Market orders sort first and are not part of depth, so the best
+  // limit price is the first key after them
+  typename TrackerMap::const_iterator pos = orders.upper_bound(
+      typename TrackerMap::key_type(is_bid, MARKET_ORDER_PRICE));
+  has_best_[side] = (pos != orders.end());
+  int& displaced = displaced_count_[side];
+  if (has_best_[side] && displaced &&
+      displaced_[side][displaced - 1].price() == pos->first.price()) {
+    best_[side] = displaced_[side][--displaced];
+  } else if (has_best_[side]) {
+    best_[side].init(pos->first.price(), false);
+    typename TrackerMap::const_iterator end = orders.upper_bound(pos->first);
+    for (; pos != end; ++pos) {
+      best_[side].add_order(pos->second.open_qty());
+    }
+  }
+  needs_restoration_[side] = false;
+  publish_best(side);
+}
+
+inline bool
+Bbo::changed() const
+{
+  return last_change_ > last_published_change_;
+}
+
+inline ChangeId
+Bbo::last_change() const
+{
+  return last_change_;
+}
+
+inline ChangeId
+Bbo::last_published_change() const
+{
+  return last_published_change_;
+}
+
+inline void
+Bbo::published()
+{
+  last_published_change_ = last_change_;
+}
+
+} }
@@ -0,0 +1,208 @@
+// Copyright (c) 2012 - 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#pragma once
+
+#include "order_book.h"
+#include "bbo.h"
+#include "bbo_listener.h"
+
+namespace liquibook { namespace book {
+
+/// @brief Implementation of order book child class, that incorporates
+///        top of book tracking only.  Cheaper than DepthOrderBook<1>: only
+///        the best level of each side is kept, and the next best level is
+///        rebuilt from the book when the best level empties.
+template <typename OrderPtr>
+class BboOrderBook : public OrderBook<OrderPtr> {
+public:
+  typedef Bbo DepthTracker;
+  typedef BboListener<BboOrderBook >TypedBboListener;
+
+  /// @brief construct
+  BboOrderBook(const std::string & symbol = "unknown");
+
+  /// @brief set the BBO listener
+  void set_bbo_listener(TypedBboListener* bbo_listener);
+
+  // @brief access the top of book tracker
+  DepthTracker& depth();
+
+  // @brief access the top of book tracker
+  const DepthTracker& depth() const;
+
+  protected:
+  //////////////////////////////////
+  // Implement virtual callback methods
+  // needed to maintain the top of book.
+  virtual void on_accept(const OrderPtr& order, Quantity quantity);
+  virtual void on_trigger_stop(const OrderPtr& order);
+
+  virtual void on_fill(const OrderPtr& order,
+    const OrderPtr& matched_order,
+    Quantity fill_qty,
+    Price fill_price,
+    bool inbound_order_filled,
+    bool matched_order_filled);
+
+  virtual void on_cancel(const OrderPtr& order, Quantity quantity);
+
+  virtual void on_replace(const OrderPtr& order,
+    Quantity current_qty,
+    Quantity new_qty,
+    Price new_price);
+
+  virtual void on_reserve(const OrderPtr& order,
+    int64_t reserve_delta,
+    Price price);
+
+  virtual void on_order_book_change();
+
+private:
+  DepthTracker bbo_;
+  TypedBboListener* bbo_listener_;
+};
+
+template <class OrderPtr>
+BboOrderBook<OrderPtr>::BboOrderBook(const std::string & symbol)
+: OrderBook<OrderPtr>(symbol),
+  bbo_listener_(nullptr)
+{
+}
+
+template <class OrderPtr>
+void
+BboOrderBook<OrderPtr>::set_bbo_listener(TypedBboListener* listener)
+{
+  bbo_listener_ = listener;
+}
+
+template <class OrderPtr>
+void
+BboOrderBook<OrderPtr>::on_accept(const OrderPtr& order, Quantity quantity)
+{
+  // If the order is a limit order
+  if (order->is_limit())
+  {
+    // If the order is completely filled on acceptance, ignore its fills
+    if (quantity == order->order_qty())
+    {
+      bbo_.ignore_fill_qty(quantity, order->is_buy());
+    }
+    else
+    {
+      bbo_.add_order(order->price(), order->order_qty(), order->is_buy());
+    }
+  }
+}
+
+template <class OrderPtr>
+void
+BboOrderBook<OrderPtr>::on_trigger_stop(const OrderPtr& order)
+{
+  bbo_.add_order(order->price(), order->order_qty(), order->is_buy());
+}
+
+template <class OrderPtr>
+void
+BboOrderBook<OrderPtr>::on_fill(const OrderPtr& order,
+  const OrderPtr& matched_order,
+  Quantity quantity,
+  Price fill_price,
+  bool inbound_order_filled,
+  bool matched_order_filled)
+{
+  // If the matched order is a limit order
+  if (matched_order->is_limit()) {
+    bbo_.fill_order(matched_order->price(),
+      quantity,
+      matched_order_filled,
+      matched_order->is_buy());
+  }
+  // If the inbound order is a limit order
+  if (order->is_limit()) {
+    bbo_.fill_order(order->price(),
+      quantity,
+      inbound_order_filled,
+      order->is_buy());
+  }
+}
+
+template <class OrderPtr>
+void
+BboOrderBook<OrderPtr>::on_cancel(const OrderPtr& order, Quantity quantity)
+{
+  // If the order is a limit order
+  if (order->is_limit()) {
+    bbo_.close_order(order->price(), quantity, order->is_buy());
+  }
+}
+
+template <class OrderPtr>
+void
+BboOrderBook<OrderPtr>::on_replace(const OrderPtr& order,
+  Quantity current_qty,
+  Quantity new_qty,
+  Price new_price)
+{
+  bbo_.replace_order(order->price(), new_price,
+    current_qty, new_qty, order->is_buy());
+}
+
+template <class OrderPtr>
+void
+BboOrderBook<OrderPtr>::on_reserve(const OrderPtr& order,
+  int64_t reserve_delta,
+  Price price)
+{
+  // Only the displayed slice of an iceberg order is shown
+  if (order->is_limit()) {
+    bbo_.change_qty_order(price, -reserve_delta, order->is_buy());
+  }
+}
+
+template <class OrderPtr>
+void
+BboOrderBook<OrderPtr>::on_order_book_change()
+{
+  // An emptied best level is read from the book only once every queued
+  // callback has been applied, so the book and the tracker agree
+  if (bbo_.needs_bid_restoration() || bbo_.needs_ask_restoration()) {
+    if (this->callbacks_pending()) {
+      return;
+    }
+  }
+  if (bbo_.needs_bid_restoration()) {
+    bbo_.restore_bids(this->bids());
+  }
+  if (bbo_.needs_ask_restoration()) {
+    bbo_.restore_asks(this->asks());
+  }
+  if (bbo_.changed()) {
+    if (bbo_listener_) {
+      ChangeId last_change = bbo_.last_published_change();
+      if ((bbo_.bids()->changed_since(last_change)) ||
+        (bbo_.asks()->changed_since(last_change))) {
+        bbo_listener_->on_bbo_change(this, &bbo_);
+      }
+    }
+    // Start tracking changes again...
+    bbo_.published();
+  }
+}
+
+template <class OrderPtr>
+inline typename BboOrderBook<OrderPtr>::DepthTracker&
+BboOrderBook<OrderPtr>::depth()
+{
+  return bbo_;
+}
+
+template <class OrderPtr>
+inline const typename BboOrderBook<OrderPtr>::DepthTracker&
+BboOrderBook<OrderPtr>::depth() const
+{
+  return bbo_;
+}
+
+} }
@@ -34,6 +34,8 @@ class OrderBook;
 //     - depth/bbo ?
 //   Order replace reject
 //     - order replace reject
+//   Iceberg order slice shown or hidden
+//     - order reserve
 
 /// @brief notification from OrderBook of an event
 template <typename OrderPtr>
@@ -53,6 +55,7 @@ public:
     cb_order_cancel_reject,
     cb_order_replace,
     cb_order_replace_reject,
+    cb_order_reserve,
     cb_book_update
   };
 
@@ -96,6 +99,11 @@ public:
   /// @brief create a new replace reject callback
   static Callback<OrderPtr> replace_reject(const OrderPtr& order,
                                            const char* reason);
+  /// @brief create a new reserve callback, for quantity of an iceberg order
+  ///        moving into (positive) or out of (negative) its hidden reserve
+  static Callback<OrderPtr> reserve(const OrderPtr& order,
+                                    const int64_t& reserve_delta,
+                                    const Price& price);
 
   static Callback<OrderPtr> book_update(const TypedOrderBook* book = nullptr);
   CbType type;
@@ -245,6 +253,20 @@ Callback<OrderPtr> Callback<OrderPtr>::replace_reject(
   return result;
 }
 
+template <class OrderPtr>
+Callback<OrderPtr> Callback<OrderPtr>::reserve(
+  const OrderPtr& order,
+  const int64_t& reserve_delta,
+  const Price& price)
+{
+  Callback<OrderPtr> result;
+  result.type = cb_order_reserve;
+  result.order = order;
+  result.delta = reserve_delta;
+  result.price = price;
+  return result;
+}
+
 template <class OrderPtr>
 Callback<OrderPtr>
 Callback<OrderPtr>::book_update(const OrderBook<OrderPtr>* book)
@@ -0,0 +1,43 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#pragma once
+
+#include "types.h"
+
+#include <chrono>
+
+namespace liquibook { namespace book {
+/// @brief Interface to let the application decide what time it is.
+///        Order expiry times are compared with this clock.
+class Clock
+{
+public:
+  virtual ~Clock() {}
+  virtual Timestamp now() const = 0;
+};
+
+/// @brief Wall clock time, in nanoseconds since the epoch
+class SystemClock : public Clock
+{
+public:
+  virtual Timestamp now() const
+  {
+    return Timestamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+  }
+};
+
+/// @brief A clock that only moves when told to, for tests and replays
+class ManualClock : public Clock
+{
+public:
+  ManualClock(Timestamp now = 0) : now_(now) {}
+  virtual Timestamp now() const { return now_; }
+  void set(Timestamp now) { now_ = now; }
+  void advance(Timestamp delta) { now_ += delta; }
+private:
+  Timestamp now_;
+};
+
+}}
@@ -101,6 +101,10 @@ public:
   /// @return true if restoration is needed (previously was full)
   bool needs_ask_restoration(Price& restoration_price);
 
+  /// @brief aggregate quantity of the visible levels on a side
+  /// @param is_bid indicator of bid or ask
+  Quantity visible_qty(bool is_bid) const;
+
   /// @brief has the depth changed since the last publish
   bool changed() const;
 
@@ -119,6 +123,8 @@ private:
   ChangeId last_published_change_;
   Quantity ignore_bid_fill_qty_;
   Quantity ignore_ask_fill_qty_;
+  Quantity visible_bid_qty_;
+  Quantity visible_ask_qty_;
 
   typedef std::map<Price, DepthLevel, std::greater<Price> > BidLevelMap;
   typedef std::map<Price, DepthLevel, std::less<Price> > AskLevelMap;
@@ -144,6 +150,12 @@ private:
   /// @param level the level to erase
   /// @param is_bid indicator of bid or ask
   void erase_level(DepthLevel* level, bool is_bid);
+
+  /// @brief account for a quantity change on a visible level
+  /// @param before the level quantity before the change
+  /// @param after the level quantity after the change
+  /// @param is_bid indicator of bid or ask
+  void visible_qty_changed(Quantity before, Quantity after, bool is_bid);
 };
 
 template <int SIZE> 
@@ -151,7 +163,9 @@ Depth<SIZE>::Depth()
 : last_change_(0),
   last_published_change_(0),
   ignore_bid_fill_qty_(0),
-  ignore_ask_fill_qty_(0)
+  ignore_ask_fill_qty_(0),
+  visible_bid_qty_(0),
+  visible_ask_qty_(0)
 {
   memset(levels_, 0, sizeof(DepthLevel) * SIZE * 2);
 }
@@ -232,6 +246,7 @@ Depth<SIZE>::add_order(Price price, Quantity qty, bool is_bid)
       // The depth changed
       last_change_ = last_change_copy + 1; // Ensure incremented
       level->last_change(last_change_copy + 1);
+      visible_qty_changed(0, qty, is_bid);
     }
     // The level is not marked as changed if it is not visible
   }
@@ -279,13 +294,20 @@ Depth<SIZE>::close_order(Price price, Quantity open_qty, bool is_bid)
 {
   DepthLevel* level = find_level(price, is_bid, false);
   if (level) {
+    Quantity before = level->aggregate_qty();
     // If this is the last order on the level
     if (level->close_order(open_qty)) {
+      if (!level->is_excess()) {
+        visible_qty_changed(before, 0, is_bid);
+      }
       erase_level(level, is_bid);
       return true;
     // Else, mark the level as changed
     } else {
       level->last_change(++last_change_);
+      if (!level->is_excess()) {
+        visible_qty_changed(before, level->aggregate_qty(), is_bid);
+      }
     }
   }
   return false;
@@ -297,12 +319,16 @@ Depth<SIZE>::change_qty_order(Price price, int64_t qty_delta, bool is_bid)
 {
   DepthLevel* level = find_level(price, is_bid, false);
   if (level && qty_delta) {
+    Quantity before = level->aggregate_qty();
     if (qty_delta > 0) {
       level->increase_qty(Quantity(qty_delta));
     } else {
       level->decrease_qty(Quantity(std::abs(qty_delta)));
     }
     level->last_change(++last_change_);
+    if (!level->is_excess()) {
+      visible_qty_changed(before, level->aggregate_qty(), is_bid);
+    }
   }
   // Ignore if not found - may be beyond our depth size
 }
@@ -449,6 +475,8 @@ Depth<SIZE>::insert_level_before(DepthLevel* level,
 
   // If the last level has valid data
   if (last_side_level->price() != INVALID_LEVEL_PRICE) {
+    // It is pushed out of the visible levels
+    visible_qty_changed(last_side_level->aggregate_qty(), 0, is_bid);
     DepthLevel excess_level;
     excess_level.init(0, true);  // Will assign over price
     excess_level = *last_side_level;
@@ -520,6 +548,7 @@ Depth<SIZE>::erase_level(DepthLevel* level, bool is_bid)
         BidLevelMap::iterator best_bid = excess_bid_levels_.begin();
         if (best_bid != excess_bid_levels_.end()) {
           *last_side_level = best_bid->second;
+          visible_qty_changed(0, last_side_level->aggregate_qty(), is_bid);
           excess_bid_levels_.erase(best_bid);
         } else {
           // Nothing to restore, last level is blank
@@ -530,6 +559,7 @@ Depth<SIZE>::erase_level(DepthLevel* level, bool is_bid)
         AskLevelMap::iterator best_ask = excess_ask_levels_.begin();
         if (best_ask != excess_ask_levels_.end()) {
           *last_side_level = best_ask->second;
+          visible_qty_changed(0, last_side_level->aggregate_qty(), is_bid);
           excess_ask_levels_.erase(best_ask);
         } else {
           // Nothing to restore, last level is blank
@@ -542,6 +572,21 @@ Depth<SIZE>::erase_level(DepthLevel* level, bool is_bid)
   }
 }
 
+template <int SIZE> 
+inline void
+Depth<SIZE>::visible_qty_changed(Quantity before, Quantity after, bool is_bid)
+{
+  Quantity& visible_qty = is_bid ? visible_bid_qty_ : visible_ask_qty_;
+  visible_qty = visible_qty - before + after;
+}
+
+template <int SIZE> 
+Quantity
+Depth<SIZE>::visible_qty(bool is_bid) const
+{
+  return is_bid ? visible_bid_qty_ : visible_ask_qty_;
+}
+
 template <int SIZE> 
 bool
 Depth<SIZE>::changed() const
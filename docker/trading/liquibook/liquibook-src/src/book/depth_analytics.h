@@ -0,0 +1,181 @@
+// Copyright (c) 2012 - 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#pragma once
+
+#include "depth_constants.h"
+#include "depth_level.h"
+
+namespace liquibook { namespace book {
+/// @brief microstructure measures of a depth tracker's visible levels.
+///    The inputs are captured after each depth event, at the cost of a few
+///    loads, and every measure is computed from them in constant time.
+class DepthAnalytics {
+public:
+  /// @brief construct
+  DepthAnalytics();
+
+  /// @brief capture the inputs from a depth tracker
+  /// @param depth the tracker; must provide bids(), asks() and
+  ///        visible_qty(is_bid)
+  template <class DepthTracker>
+  void update(const DepthTracker& depth);
+
+  /// @brief is there a visible bid?
+  bool has_bid() const;
+  /// @brief is there a visible ask?
+  bool has_ask() const;
+  /// @brief are both sides present, so spread and mid are defined?
+  bool two_sided() const;
+
+  /// @brief best bid price, or INVALID_LEVEL_PRICE
+  Price best_bid() const;
+  /// @brief best ask price, or INVALID_LEVEL_PRICE
+  Price best_ask() const;
+  /// @brief quantity at the best bid
+  Quantity best_bid_qty() const;
+  /// @brief quantity at the best ask
+  Quantity best_ask_qty() const;
+
+  /// @brief cumulative quantity of the visible bid levels
+  Quantity bid_depth_qty() const;
+  /// @brief cumulative quantity of the visible ask levels
+  Quantity ask_depth_qty() const;
+
+  /// @brief best ask less best bid, 0 unless two sided
+  Price spread() const;
+  /// @brief average of best bid and best ask, 0 unless two sided
+  double mid() const;
+  /// @brief mid weighted toward the side with less quantity at the top,
+  ///        0 unless two sided
+  double microprice() const;
+  /// @brief (bid qty - ask qty) / (bid qty + ask qty) over the visible
+  ///        levels, in [-1, 1]; 0 if both sides are empty
+  double imbalance() const;
+
+private:
+  Price best_bid_;
+  Price best_ask_;
+  Quantity best_bid_qty_;
+  Quantity best_ask_qty_;
+  Quantity bid_depth_qty_;
+  Quantity ask_depth_qty_;
+};
+
+inline
+DepthAnalytics::DepthAnalytics()
+: best_bid_(INVALID_LEVEL_PRICE),
+  best_ask_(INVALID_LEVEL_PRICE),
+  best_bid_qty_(0),
+  best_ask_qty_(0),
+  bid_depth_qty_(0),
+  ask_depth_qty_(0)
+{
+}
+
+template <class DepthTracker>
+inline void
+DepthAnalytics::update(const DepthTracker& depth)
+{
+  const DepthLevel* bid = depth.bids();
+  const DepthLevel* ask = depth.asks();
+  best_bid_ = bid->price();
+  best_ask_ = ask->price();
+  best_bid_qty_ = bid->aggregate_qty();
+  best_ask_qty_ = ask->aggregate_qty();
+  bid_depth_qty_ = depth.visible_qty(true);
+  ask_depth_qty_ = depth.visible_qty(false);
+}
+
+inline bool
+DepthAnalytics::has_bid() const
+{
+  return best_bid_ != INVALID_LEVEL_PRICE;
+}
+
+inline bool
+DepthAnalytics::has_ask() const
+{
+  return best_ask_ != INVALID_LEVEL_PRICE;
+}
+
+inline bool
+DepthAnalytics::two_sided() const
+{
+  return has_bid() && has_ask();
+}
+
+inline Price
+DepthAnalytics::best_bid() const
+{
+  return best_bid_;
+}
+
+inline Price
+DepthAnalytics::best_ask() const
+{
+  return best_ask_;
+}
+
+inline Quantity
+DepthAnalytics::best_bid_qty() const
+{
+  return best_bid_qty_;
+}
+
+inline Quantity
+DepthAnalytics::best_ask_qty() const
+{
+  return best_ask_qty_;
+}
+
+inline Quantity
+DepthAnalytics::bid_depth_qty() const
+{
+  return bid_depth_qty_;
+}
+
+inline Quantity
+DepthAnalytics::ask_depth_qty() const
+{
+  return ask_depth_qty_;
+}
+
+inline Price
+DepthAnalytics::spread() const
+{
+  return two_sided() ? best_ask_ - best_bid_ : 0;
+}
+
+inline double
+DepthAnalytics::mid() const
+{
+  if (!two_sided()) {
+    return 0.0;
+  }
+  return (double(best_bid_) + double(best_ask_)) / 2.0;
+}
+
+inline double
+DepthAnalytics::microprice() const
+{
+  Quantity total = best_bid_qty_ + best_ask_qty_;
+  if (!two_sided() || total == 0) {
+    return 0.0;
+  }
+  // Each price is weighted by the quantity on the opposite side
+  return (double(best_bid_) * best_ask_qty_ +
+          double(best_ask_) * best_bid_qty_) / total;
+}
+
+inline double
+DepthAnalytics::imbalance() const
+{
+  Quantity total = bid_depth_qty_ + ask_depth_qty_;
+  if (total == 0) {
+    return 0.0;
+  }
+  return (double(bid_depth_qty_) - double(ask_depth_qty_)) / total;
+}
+
+} }
@@ -5,6 +5,7 @@
 
 #include "order_book.h"
 #include "depth.h"
+#include "depth_analytics.h"
 #include "bbo_listener.h"
 #include "depth_listener.h"
 
@@ -34,6 +35,11 @@ public:
   // @brief access the depth tracker
   const DepthTracker& depth() const;
 
+  /// @brief access the spread, mid, microprice, imbalance and cumulative
+  ///        quantities of the visible depth.  Kept current as each callback
+  ///        updates the depth, so reading is constant time.
+  const DepthAnalytics& analytics() const;
+
   protected:
   //////////////////////////////////
   // Implement virtual callback methods
@@ -57,10 +63,15 @@ public:
     Quantity new_qty,
     Price new_price);
 
+  virtual void on_reserve(const OrderPtr& order,
+    int64_t reserve_delta,
+    Price price);
+
   virtual void on_order_book_change();
 
 private:
   DepthTracker depth_;
+  DepthAnalytics analytics_;
   TypedBboListener* bbo_listener_;
   TypedDepthListener* depth_listener_;
 };
@@ -108,6 +119,7 @@ DepthOrderBook<OrderPtr, SIZE>::on_accept(const OrderPtr& order, Quantity quanti
       depth_.add_order(order->price(), 
         order->order_qty(), 
         order->is_buy());
+      analytics_.update(depth_);
     }
   }
 }
@@ -124,6 +136,7 @@ DepthOrderBook<OrderPtr, SIZE>::on_trigger_stop(const OrderPtr& order)
 {
   // Add to depth
   depth_.add_order(order->price(), order->order_qty(), order->is_buy());
+  analytics_.update(depth_);
 }
 
 template <class OrderPtr, int SIZE> 
@@ -151,6 +164,7 @@ DepthOrderBook<OrderPtr, SIZE>::on_fill(const OrderPtr& order,
       inbound_order_filled,
       order->is_buy());
   }
+  analytics_.update(depth_);
 }
 
 template <class OrderPtr, int SIZE> 
@@ -163,6 +177,7 @@ DepthOrderBook<OrderPtr, SIZE>::on_cancel(const OrderPtr& order, Quantity quanti
     depth_.close_order(order->price(), 
       quantity, 
       order->is_buy());
+    analytics_.update(depth_);
   }
 }
 
@@ -183,6 +198,20 @@ DepthOrderBook<OrderPtr, SIZE>::on_replace(const OrderPtr& order,
   // Notify the depth
   depth_.replace_order(order->price(), new_price, 
     current_qty, new_qty, order->is_buy());
+  analytics_.update(depth_);
+}
+
+template <class OrderPtr, int SIZE> 
+void 
+DepthOrderBook<OrderPtr, SIZE>::on_reserve(const OrderPtr& order,
+  int64_t reserve_delta,
+  Price price)
+{
+  // Only the displayed slice of an iceberg order is shown
+  if (order->is_limit()) {
+    depth_.change_qty_order(price, -reserve_delta, order->is_buy());
+    analytics_.update(depth_);
+  }
 }
 
 template <class OrderPtr, int SIZE> 
@@ -221,4 +250,11 @@ DepthOrderBook<OrderPtr, SIZE>::depth() const
   return depth_;
 }
 
+template <class OrderPtr, int SIZE>
+inline const DepthAnalytics&
+DepthOrderBook<OrderPtr, SIZE>::analytics() const
+{
+  return analytics_;
+}
+
 } }
@@ -11,14 +11,18 @@
 #include "trade_listener.h"
 #include "comparable_price.h"
 #include "logger.h"
+#include "timer_wheel.h"
+#include "clock.h"
 
 #include <sstream>
 #include <map>
+#include <memory>
 #include <vector>
 #include <stdexcept>
 #include <cmath>
 #include <list>
 #include <functional>
+#include <iterator>
 #include <algorithm>
 
 #ifdef LIQUIBOOK_IGNORES_DEPRECATED_CALLS
@@ -92,9 +96,60 @@ public:
   /// @return true if the add resulted in a fill
   virtual bool add(const OrderPtr& order, OrderConditions conditions = 0);
 
+  /// @brief add an iceberg order to book.  Only display_qty of the order
+  ///        is shown in depth; as each displayed slice fills, the next one
+  ///        comes out of the hidden reserve at the back of the queue.
+  /// @param order the order to add
+  /// @param display_qty the quantity to show at once
+  /// @param conditions special conditions on the order
+  /// @return true if the add resulted in a fill
+  virtual bool add_iceberg(const OrderPtr& order,
+                           Quantity display_qty,
+                           OrderConditions conditions = 0);
+
+  /// @brief add a pegged order to book.  Its price follows the best bid
+  ///        and ask of the orders that are not pegged, and never goes past
+  ///        the price the order is added with.  The order is told each new
+  ///        price by a replace callback.  A pegged order can trade when it
+  ///        is added against resting all or none interest, but it is never
+  ///        repriced into a cross.
+  /// @param order the order to add
+  /// @param peg_type what the order's price follows
+  /// @param offset how far behind the followed price the order rests
+  /// @param conditions special conditions on the order
+  /// @return true if the add resulted in a fill
+  virtual bool add_pegged(const OrderPtr& order,
+                          PegType peg_type,
+                          Price offset = 0,
+                          OrderConditions conditions = 0);
+
+  /// @brief add a good till time order to book.  If any of it is still
+  ///        on the book when the book's clock reaches expiry, the next
+  ///        call to expire_orders cancels it.
+  /// @param order the order to add
+  /// @param expiry when the order expires, by the book's clock
+  /// @param conditions special conditions on the order
+  /// @return true if the add resulted in a fill
+  virtual bool add_good_till(const OrderPtr& order,
+                             Timestamp expiry,
+                             OrderConditions conditions = 0);
+
   /// @brief cancel an order in the book
   virtual void cancel(const OrderPtr& order);
 
+  /// @brief cancel every good till time order that has expired by the
+  ///        book's clock.  However many orders expire, their cancels are
+  ///        delivered together, followed by a single book update.
+  virtual void expire_orders();
+
+  /// @brief set the clock that order expiry times are compared with.
+  ///        The book does not take ownership.  Without one, the book uses
+  ///        a SystemClock.
+  void set_clock(const Clock* clock);
+
+  /// @brief what time it is by the book's clock
+  Timestamp now() const;
+
   /// @brief replace an order in the book
   /// @param order the order to replace
   /// @param size_delta the change in size for the order (positive or negative)
@@ -147,6 +202,11 @@ protected:
   /// issue new requests. 
   void callback_now();
 
+  /// @brief are there callbacks queued behind the one being performed?
+  /// Lets derived classes defer work that must see the book and the
+  /// callback stream in agreement.
+  bool callbacks_pending() const;
+
   /// @brief perform an individual callback
   virtual void perform_callback(TypedCallback& cb);
 
@@ -197,6 +257,15 @@ protected:
                     Tracker& current_tracker,
                     Quantity max_quantity = QUANTITY_MAX);
 
+  /// @brief show the next slice of an iceberg order whose displayed
+  ///        quantity has traded away.
+  /// @param entry the iceberg order
+  /// @param current_orders the container of the order
+  /// @return where the order is now: behind the rest of its price level
+  typename TrackerMap::iterator replenish(
+    typename TrackerMap::iterator entry,
+    TrackerMap& current_orders);
+
   /// @brief find an order in a container
   /// @param order is the the order we are looking for
   /// @param[OUT] result will point to the entry in the container if we find a match
@@ -224,6 +293,13 @@ protected:
   /// @brief accept pending (formerly stop) orders.
   void submit_pending_orders();
 
+  /// @brief move the pegged orders whose reference prices have changed.
+  ///        Each group of orders sharing a peg moves as a whole, to the
+  ///        back of its new price level.  Pegged orders are not references,
+  ///        so moving them never calls for another pass.
+  /// @return true if any pegged order moved
+  bool reprice_pegs();
+
   ///////////////////////////////
   // Callback interfaces as
   // virtual methods to simplify
@@ -271,6 +347,16 @@ protected:
   /// @brief callback for an order replace rejection
   virtual void on_replace_reject(const OrderPtr& order, const char* reason){}
 
+  /// @brief callback for quantity of an iceberg order being hidden or shown.
+  ///        Not passed on to the order listener: the order itself is
+  ///        unchanged.
+  /// @param order the iceberg order
+  /// @param reserve_delta the change to its hidden quantity
+  /// @param price the price level of the order
+  virtual void on_reserve(const OrderPtr& order,
+    int64_t reserve_delta,
+    Price price){}
+
   // End of OrderListener Interface
   ///////////////////////////////
   // TradeListener Interface
@@ -292,8 +378,85 @@ protected:
 
 
 private:
+    bool add_tracker(Tracker & inbound);
     bool submit_order(Tracker & inbound);
     bool add_order(Tracker& order_tracker, Price order_price);
+
+  /// @brief Pegged orders with the same side, peg, offset and limit always
+  ///        rest at the same price, so they are repriced as one group.
+  struct PegKey {
+    PegKey(bool buy, PegType type, Price peg_offset, Price peg_limit)
+    : is_buy(buy), peg_type(type), offset(peg_offset), limit(peg_limit)
+    {
+    }
+
+    bool operator<(const PegKey& rhs) const
+    {
+      if (is_buy != rhs.is_buy) {
+        return is_buy < rhs.is_buy;
+      }
+      if (peg_type != rhs.peg_type) {
+        return peg_type < rhs.peg_type;
+      }
+      if (offset != rhs.offset) {
+        return offset < rhs.offset;
+      }
+      return limit < rhs.limit;
+    }
+
+    bool matches(const Tracker& tracker) const
+    {
+      return tracker.peg_type() == peg_type &&
+             tracker.peg_offset() == offset &&
+             tracker.peg_limit() == limit;
+    }
+
+    bool is_buy;
+    PegType peg_type;
+    Price offset;
+    Price limit;
+  };
+  /// Each peg group, and the price its orders rest at
+  typedef std::map<PegKey, Price> PegGroups;
+
+  /// Orders that are not pegged, counted by price, best first
+  typedef std::map<ComparablePrice, size_t> ReferenceLevels;
+
+  /// @brief the best price of the orders on one side that are not pegged
+  Price reference_price(const ReferenceLevels& levels) const;
+
+  /// @brief start counting the orders pegs follow, once the book has a
+  ///        pegged order; books without pegs never pay for it
+  void keep_references();
+
+  /// @brief where an order on a side is counted as one pegs follow, or
+  ///        nullptr if it is not
+  ReferenceLevels* references(const TrackerMap& side,
+                              const ComparablePrice& key,
+                              const Tracker& tracker);
+
+  /// @brief where a peg group belongs, given the current references
+  /// @return the price, or MARKET_ORDER_PRICE if there is nothing to follow
+  Price peg_price(const PegKey& key) const;
+
+  /// @brief move the orders of a peg group to the back of another level
+  /// @return false if the group has no orders left
+  bool move_peg_group(const PegKey& key, Price from, Price to);
+
+  /// @brief put an order on one side of the market.  A good till time
+  ///        order's timer is started, or pointed at its new place.
+  /// @return where the order is now
+  typename TrackerMap::iterator insert_tracker(TrackerMap& side,
+    const ComparablePrice& key,
+    Tracker&& tracker);
+
+  /// @brief take an order off one side of the market for good, stopping
+  ///        its expiry timer
+  void erase_tracker(TrackerMap& side, typename TrackerMap::iterator entry);
+
+  /// @brief take an order off one side of the market, leaving its expiry
+  ///        timer to the copy that takes its place
+  void remove_tracker(TrackerMap& side, typename TrackerMap::iterator entry);
 private:
 
   std::string symbol_;
@@ -306,23 +469,43 @@ private:
 
   Callbacks callbacks_;
   Callbacks workingCallbacks_;
+  size_t remaining_callbacks_;
   bool handling_callbacks_;
   TypedOrderListener* order_listener_;
   TypedTradeListener* trade_listener_;
   TypedOrderBookListener* order_book_listener_;
   Logger * logger_;
   Price marketPrice_;
+
+  PegGroups pegs_;
+  Price peg_bid_reference_;
+  Price peg_ask_reference_;
+  bool references_kept_;
+  ReferenceLevels bid_references_;
+  ReferenceLevels ask_references_;
+  std::vector<typename TrackerMap::iterator> peg_members_;
+
+  const Clock* clock_;
+  /// Expiry times of good till time orders.  The wheel is large, so it is
+  /// only created with the first such order.
+  typedef TimerWheel<typename TrackerMap::iterator> Timers;
+  std::unique_ptr<Timers> timers_;
 };
 
 template <class OrderPtr>
 OrderBook<OrderPtr>::OrderBook(const std::string & symbol)
 : symbol_(symbol),
+  remaining_callbacks_(0),
   handling_callbacks_(false),
   order_listener_(nullptr),
   trade_listener_(nullptr),
   order_book_listener_(nullptr),
   logger_(nullptr),
-  marketPrice_(MARKET_ORDER_PRICE)
+  marketPrice_(MARKET_ORDER_PRICE),
+  peg_bid_reference_(MARKET_ORDER_PRICE),
+  peg_ask_reference_(MARKET_ORDER_PRICE),
+  references_kept_(false),
+  clock_(nullptr)
 {
   callbacks_.reserve(16);  // Why 16?  Why not?  
   workingCallbacks_.reserve(callbacks_.capacity());
@@ -403,8 +586,128 @@ OrderBook<OrderPtr>::set_order_book_listener(TypedOrderBookListener* listener)
 template <class OrderPtr>
 bool
 OrderBook<OrderPtr>::add(const OrderPtr& order, OrderConditions conditions)
+{
+  Tracker inbound(order, conditions);
+  return add_tracker(inbound);
+}
+
+template <class OrderPtr>
+bool
+OrderBook<OrderPtr>::add_iceberg(const OrderPtr& order,
+                                 Quantity display_qty,
+                                 OrderConditions conditions)
+{
+  Tracker inbound(order, conditions);
+  const char* reason = nullptr;
+  if (display_qty == 0) {
+    reason = "display size must be positive";
+  } else if (inbound.all_or_none()) {
+    reason = "iceberg order cannot be all or none";
+  } else if (order->stop_price() != 0) {
+    reason = "iceberg order cannot be a stop order";
+  }
+  if (reason) {
+    callbacks_.push_back(TypedCallback::reject(order, reason));
+    callback_now();
+    return false;
+  }
+  inbound.set_display_qty(display_qty);
+  return add_tracker(inbound);
+}
+
+template <class OrderPtr>
+bool
+OrderBook<OrderPtr>::add_pegged(const OrderPtr& order,
+                                PegType peg_type,
+                                Price offset,
+                                OrderConditions conditions)
+{
+  Tracker inbound(order, conditions);
+  const char* reason = nullptr;
+  bool matched = false;
+  if (order->order_qty() == 0) {
+    reason = "size must be positive";
+  } else if (peg_type != peg_primary && peg_type != peg_midpoint) {
+    reason = "unknown peg type";
+  } else if (!order->is_limit()) {
+    reason = "pegged order must have a limit price";
+  } else if (order->stop_price() != 0) {
+    reason = "pegged order cannot be a stop order";
+  } else if (inbound.immediate_or_cancel()) {
+    reason = "pegged order cannot be immediate or cancel";
+  } else {
+    // Bring the pegs already on the book up to date first, so the new
+    // order joins its group at the group's price
+    keep_references();
+    reprice_pegs();
+    PegKey key(order->is_buy(), peg_type, offset, order->price());
+    Price price = peg_price(key);
+    if (price == MARKET_ORDER_PRICE) {
+      reason = "no price to peg to";
+    } else {
+      pegs_.insert(std::make_pair(key, price));
+      inbound.set_peg(peg_type, offset, order->price());
+      size_t accept_cb_index = callbacks_.size();
+      callbacks_.push_back(TypedCallback::accept(order));
+      if (price != order->price()) {
+        callbacks_.push_back(
+          TypedCallback::replace(order, order->order_qty(), 0, price));
+      }
+      matched = add_order(inbound, price);
+      // Note the filled qty in the accept callback.  An order filled on
+      // entry never rests, so there is no new price to tell depth about
+      callbacks_[accept_cb_index].quantity = inbound.filled_qty();
+      if (inbound.filled() && price != order->price()) {
+        callbacks_.erase(callbacks_.begin() + accept_cb_index + 1);
+      }
+      // If adding this order triggered any stops
+      // handle those stops now
+      while(!pendingOrders_.empty())
+      {
+        submit_pending_orders();
+      }
+      callbacks_.push_back(TypedCallback::book_update(this));
+    }
+  }
+  if (reason) {
+    callbacks_.push_back(TypedCallback::reject(order, reason));
+  }
+  callback_now();
+  return matched;
+}
+
+template <class OrderPtr>
+bool
+OrderBook<OrderPtr>::add_good_till(const OrderPtr& order,
+                                   Timestamp expiry,
+                                   OrderConditions conditions)
+{
+  Tracker inbound(order, conditions);
+  const char* reason = nullptr;
+  if (order->stop_price() != 0) {
+    reason = "good till time order cannot be a stop order";
+  } else if (expiry <= now() || (timers_ && expiry <= timers_->now())) {
+    reason = "order has already expired";
+  }
+  if (reason) {
+    callbacks_.push_back(TypedCallback::reject(order, reason));
+    callback_now();
+    return false;
+  }
+  if (!timers_) {
+    timers_.reset(new Timers(now()));
+  }
+  inbound.set_expiry(expiry);
+  return add_tracker(inbound);
+}
+
+template <class OrderPtr>
+bool
+OrderBook<OrderPtr>::add_tracker(Tracker & inbound)
 {
   bool matched = false;
+  // A stop order's tracker is moved into the stops
+  OrderPtr order = inbound.ptr();
 
   // If the order is invalid, ignore it
   if (order->order_qty() == 0) {
@@ -412,7 +715,6 @@ OrderBook<OrderPtr>::add(const OrderPtr& order, OrderConditions conditions)
   }
   else 
   {
-    Tracker inbound(order, conditions);
     if(inbound.ptr()->stop_price() != 0 && add_stop_order(inbound))
     {
       // The order has been added to stops
@@ -459,7 +761,7 @@ OrderBook<OrderPtr>::cancel(const OrderPtr& order)
     if (bid != bids_.end()) {
       open_qty = bid->second.open_qty();
       // Remove from container for cancel
-      bids_.erase(bid);
+      erase_tracker(bids_, bid);
       found = true;
     }
     else if (order->stop_price()) {
@@ -476,7 +778,7 @@ OrderBook<OrderPtr>::cancel(const OrderPtr& order)
     if (ask != asks_.end()) {
       open_qty = ask->second.open_qty();
       // Remove from container for cancel
-      asks_.erase(ask);
+      erase_tracker(asks_, ask);
       found = true;
     }
     else if (order->stop_price()) {
@@ -502,6 +804,43 @@ OrderBook<OrderPtr>::cancel(const OrderPtr& order)
   callback_now();
 }
 
+template <class OrderPtr>
+void
+OrderBook<OrderPtr>::expire_orders()
+{
+  bool expired = false;
+  if (timers_) {
+    timers_->advance(now(),
+                     [this, &expired](typename TrackerMap::iterator entry)
+    {
+      // The timer has already stopped
+      Tracker & tracker = entry->second;
+      callbacks_.push_back(TypedCallback::cancel(tracker.ptr(),
+                                                 tracker.open_qty()));
+      remove_tracker(tracker.ptr()->is_buy() ? bids_ : asks_, entry);
+      expired = true;
+    });
+  }
+  if (expired) {
+    callbacks_.push_back(TypedCallback::book_update(this));
+  }
+  callback_now();
+}
+
+template <class OrderPtr>
+void
+OrderBook<OrderPtr>::set_clock(const Clock* clock)
+{
+  clock_ = clock;
+}
+
+template <class OrderPtr>
+Timestamp
+OrderBook<OrderPtr>::now() const
+{
+  return clock_ ? clock_->now() : SystemClock().now();
+}
+
 template <class OrderPtr>
 bool
 OrderBook<OrderPtr>::replace(
@@ -520,7 +859,24 @@ OrderBook<OrderPtr>::replace(
   if(find_on_market(order, pos))
   {
     // If this is a valid replace
-    const Tracker& tracker = pos->second;
+    Tracker& tracker = pos->second;
+    // The book sets the price of a pegged order
+    if (price_change && tracker.peg_type() != peg_none)
+    {
+      callbacks_.push_back(TypedCallback::replace_reject(order,
+        "cannot change the price of a pegged order"));
+      callback_now();
+      return false;
+    }
+    // An iceberg order is replaced as a whole.  Its reserve is hidden
+    // again once the order is back on the book.
+    Quantity hidden = tracker.reserved_qty();
+    if (hidden)
+    {
+      tracker.reserve(-int64_t(hidden));
+      callbacks_.push_back(TypedCallback::reserve(order, -int64_t(hidden),
+                                                  pos->first.price()));
+    }
     // If there is not enough open quantity for the size reduction
     if (size_delta < 0 && ((int)tracker.open_qty() < -size_delta)) 
     {
@@ -547,14 +903,15 @@ OrderBook<OrderPtr>::replace(
     {
       // Cancel with NO open qty (should be zero after replace)
       callbacks_.push_back(TypedCallback::cancel(order, 0));
-      market.erase(pos); // Remove order
+      erase_tracker(market, pos); // Remove order
     } 
     else 
     {
       // Else rematch the new order - there could be a price change
       // or size change - that could cause all or none match
+      // The copy keeps any expiry timer running
       auto order = pos->second;
-      market.erase(pos); // Remove old order order
+      remove_tracker(market, pos); // Remove old order order
       matched = add_order(order, price); // Add order
     }
     // If replace any order this order triggered any trades
@@ -638,6 +995,143 @@ OrderBook<OrderPtr>::submit_order(Tracker & inbound)
   return add_order(inbound, order_price);
 }
 
+template <class OrderPtr>
+bool
+OrderBook<OrderPtr>::reprice_pegs()
+{
+  Price bid = reference_price(bid_references_);
+  Price ask = reference_price(ask_references_);
+  if (bid == peg_bid_reference_ && ask == peg_ask_reference_) {
+    return false;
+  }
+  peg_bid_reference_ = bid;
+  peg_ask_reference_ = ask;
+
+  bool moved = false;
+  auto group = pegs_.begin();
+  while (group != pegs_.end()) {
+    Price price = peg_price(group->first);
+    // With nothing to follow, a group stays where it is
+    if (price == MARKET_ORDER_PRICE || price == group->second) {
+      ++group;
+    } else if (move_peg_group(group->first, group->second, price)) {
+      group->second = price;
+      moved = true;
+      ++group;
+    } else {
+      group = pegs_.erase(group);
+    }
+  }
+  if (moved) {
+    callbacks_.push_back(TypedCallback::book_update(this));
+  }
+  return moved;
+}
+
+template <class OrderPtr>
+Price
+OrderBook<OrderPtr>::reference_price(const ReferenceLevels& levels) const
+{
+  if (levels.empty()) {
+    return MARKET_ORDER_PRICE;
+  }
+  return levels.begin()->first.price();
+}
+
+template <class OrderPtr>
+void
+OrderBook<OrderPtr>::keep_references()
+{
+  if (references_kept_) {
+    return;
+  }
+  references_kept_ = true;
+  for (auto pos = bids_.begin(); pos != bids_.end(); ++pos) {
+    if (ReferenceLevels* levels = references(bids_, pos->first, pos->second)) {
+      ++(*levels)[pos->first];
+    }
+  }
+  for (auto pos = asks_.begin(); pos != asks_.end(); ++pos) {
+    if (ReferenceLevels* levels = references(asks_, pos->first, pos->second)) {
+      ++(*levels)[pos->first];
+    }
+  }
+}
+
+template <class OrderPtr>
+typename OrderBook<OrderPtr>::ReferenceLevels*
+OrderBook<OrderPtr>::references(const TrackerMap& side,
+                                const ComparablePrice& key,
+                                const Tracker& tracker)
+{
+  // Stop orders are not on the market, and market orders set no price
+  if (!references_kept_ || tracker.peg_type() != peg_none ||
+      key.price() == MARKET_ORDER_PRICE) {
+    return nullptr;
+  }
+  if (&side == &bids_) {
+    return &bid_references_;
+  }
+  if (&side == &asks_) {
+    return &ask_references_;
+  }
+  return nullptr;
+}
+
+template <class OrderPtr>
+Price
+OrderBook<OrderPtr>::peg_price(const PegKey& key) const
+{
+  Price price = MARKET_ORDER_PRICE;
+  Price follow = MARKET_ORDER_PRICE;
+  if (key.peg_type == peg_primary) {
+    follow = key.is_buy ? peg_bid_reference_ : peg_ask_reference_;
+  } else if (peg_bid_reference_ != MARKET_ORDER_PRICE &&
+             peg_ask_reference_ != MARKET_ORDER_PRICE) {
+    // Sells rest above buys, so midpoint pegs never lock each other
+    follow = (peg_bid_reference_ + peg_ask_reference_) / 2;
+    if (!key.is_buy) {
+      ++follow;
+    }
+  }
+  if (follow == MARKET_ORDER_PRICE) {
+    return MARKET_ORDER_PRICE;
+  }
+  if (key.is_buy) {
+    if (follow > key.offset) {
+      price = (std::min)(follow - key.offset, key.limit);
+    }
+  } else {
+    price = (std::max)(follow + key.offset, key.limit);
+  }
+  return price;
+}
+
+template <class OrderPtr>
+bool
+OrderBook<OrderPtr>::move_peg_group(const PegKey& key, Price from, Price to)
+{
+  TrackerMap & side = key.is_buy ? bids_ : asks_;
+  auto level = side.equal_range(ComparablePrice(key.is_buy, from));
+  peg_members_.clear();
+  for (auto pos = level.first; pos != level.second; ++pos) {
+    if (key.matches(pos->second)) {
+      peg_members_.push_back(pos);
+    }
+  }
+  const ComparablePrice to_key(key.is_buy, to);
+  for (auto member = peg_members_.begin(); member != peg_members_.end();
+       ++member) {
+    Tracker & tracker = (*member)->second;
+    callbacks_.push_back(TypedCallback::replace(tracker.ptr(),
+      tracker.open_qty(), 0, to));
+    // In their order of arrival, behind what is already there
+    insert_tracker(side, to_key, std::move(tracker));
+    remove_tracker(side, *member);
+  }
+  return !peg_members_.empty();
+}
+
 template <class OrderPtr>
 bool
 OrderBook<OrderPtr>::find_on_market(
@@ -707,11 +1201,17 @@ OrderBook<OrderPtr>::add_order(Tracker& inbound, Price order_price)
 
   // If order has remaining open quantity and is not immediate or cancel
   if (inbound.open_qty() && !inbound.immediate_or_cancel()) {
+    // An iceberg order rests with one slice displayed
+    Quantity hidden = inbound.hide_reserve();
+    if (hidden) {
+      callbacks_.push_back(TypedCallback::reserve(order, hidden, order_price));
+    }
     // If this is a buy order
     if (order->is_buy()) 
     {
       // Insert into bids
-      bids_.insert(std::make_pair(ComparablePrice(true, order_price), inbound));
+      insert_tracker(bids_, ComparablePrice(true, order_price),
+                     Tracker(inbound));
       // and see if that satisfies any ask orders
       if(check_deferred_aons(deferred_aons, asks_, bids_))
       {
@@ -722,13 +1222,18 @@ OrderBook<OrderPtr>::add_order(Tracker& inbound, Price order_price)
     {
       // Else this is a sell order
       // Insert into asks
-      asks_.insert(std::make_pair(ComparablePrice(false, order_price), inbound));
+      insert_tracker(asks_, ComparablePrice(false, order_price),
+                     Tracker(inbound));
       if(check_deferred_aons(deferred_aons, bids_, asks_))
       {
         matched = true;
       }
     }
   }
+  // A replaced order that no longer rests has nothing left to expire
+  else if (inbound.timer() != NO_TIMER) {
+    timers_->remove(inbound.timer());
+  }
   return matched;
 }
 
@@ -751,7 +1256,7 @@ OrderBook<OrderPtr>::check_deferred_aons(DeferredMatches & aons,
     result |= matched;
     if(tracker.filled())
     {
-      deferredTrackers.erase(entry);
+      erase_tracker(deferredTrackers, entry);
     }
   }
   return result;
@@ -818,7 +1323,7 @@ OrderBook<OrderPtr>::match_regular_order(Tracker& inbound,
         {
           matched = true;
           // assert traded == current_quantity
-          current_orders.erase(entry);
+          erase_tracker(current_orders, entry);
           inbound_qty -= traded;
         }
       }
@@ -838,7 +1343,16 @@ OrderBook<OrderPtr>::match_regular_order(Tracker& inbound,
         matched = true;
         if(current_order.filled())
         {
-          current_orders.erase(entry);
+          erase_tracker(current_orders, entry);
+        }
+        else if(!current_order.open_qty())
+        {
+          auto refilled = replenish(entry, current_orders);
+          // The new slice is still at this price, ahead of the next level
+          if(std::next(refilled) == pos)
+          {
+            pos = refilled;
+          }
         }
         inbound_qty -= traded;
       }
@@ -905,7 +1419,7 @@ OrderBook<OrderPtr>::match_aon_order(Tracker& inbound,
               // assert traded == current_quantity
               inbound_qty -= traded;
               matched = true;
-              current_orders.erase(entry);
+              erase_tracker(current_orders, entry);
             }
           }
         }
@@ -946,7 +1460,11 @@ OrderBook<OrderPtr>::match_aon_order(Tracker& inbound,
           }
           if(current_order.filled())
           {
-            current_orders.erase(entry);
+            erase_tracker(current_orders, entry);
+          }
+          else if(!current_order.open_qty())
+          {
+            replenish(entry, current_orders);
           }
         }
       }
@@ -1017,7 +1535,11 @@ OrderBook<OrderPtr>::try_create_deferred_trades(
       traded += create_trade(inbound, tracker, fills[index]);
       if(tracker.filled())
       {
-        current_orders.erase(entry);
+        erase_tracker(current_orders, entry);
+      }
+      else if(!tracker.open_qty())
+      {
+        replenish(entry, current_orders);
       }
     }
   }
@@ -1056,11 +1578,11 @@ OrderBook<OrderPtr>::create_trade(Tracker& inbound_tracker,
 
     typename TypedCallback::FillFlags fill_flags = 
                                 TypedCallback::ff_neither_filled;
-    if (!inbound_tracker.open_qty()) {
+    if (inbound_tracker.filled()) {
       fill_flags = (typename TypedCallback::FillFlags)(
                        fill_flags | TypedCallback::ff_inbound_filled);
     }
-    if (!current_tracker.open_qty()) {
+    if (current_tracker.filled()) {
       fill_flags = (typename TypedCallback::FillFlags)(
                        fill_flags | TypedCallback::ff_matched_filled);
     }
@@ -1074,6 +1596,70 @@ OrderBook<OrderPtr>::create_trade(Tracker& inbound_tracker,
   return fill_qty;
 }
 
+template <class OrderPtr>
+typename OrderBook<OrderPtr>::TrackerMap::iterator
+OrderBook<OrderPtr>::replenish(
+  typename TrackerMap::iterator entry,
+  TrackerMap& current_orders)
+{
+  Quantity slice = entry->second.refill();
+  callbacks_.push_back(TypedCallback::reserve(entry->second.ptr(),
+                                              -int64_t(slice),
+                                              entry->first.price()));
+  // Equal keys insert after those already present: the back of the queue
+  auto refilled = insert_tracker(current_orders, entry->first,
+                                 std::move(entry->second));
+  remove_tracker(current_orders, entry);
+  return refilled;
+}
+
+template <class OrderPtr>
+typename OrderBook<OrderPtr>::TrackerMap::iterator
+OrderBook<OrderPtr>::insert_tracker(
+  TrackerMap& side,
+  const ComparablePrice& key,
+  Tracker&& tracker)
+{
+  auto entry = side.insert(std::make_pair(key, std::move(tracker)));
+  Tracker& placed = entry->second;
+  if (ReferenceLevels* levels = references(side, key, placed)) {
+    ++(*levels)[key];
+  }
+  if (placed.timer() != NO_TIMER) {
+    timers_->update(placed.timer(), entry);
+  } else if (placed.expiry()) {
+    placed.set_timer(timers_->insert(placed.expiry(), entry));
+  }
+  return entry;
+}
+
+template <class OrderPtr>
+void
+OrderBook<OrderPtr>::erase_tracker(
+  TrackerMap& side,
+  typename TrackerMap::iterator entry)
+{
+  if (entry->second.timer() != NO_TIMER) {
+    timers_->remove(entry->second.timer());
+  }
+  remove_tracker(side, entry);
+}
+
+template <class OrderPtr>
+void
+OrderBook<OrderPtr>::remove_tracker(
+  TrackerMap& side,
+  typename TrackerMap::iterator entry)
+{
+  if (ReferenceLevels* levels = references(side, entry->first, entry->second)) {
+    auto level = levels->find(entry->first);
+    if (--level->second == 0) {
+      levels->erase(level);
+    }
+  }
+  side.erase(entry);
+}
+
 template <class OrderPtr>
 void
 OrderBook<OrderPtr>::move_callbacks(Callbacks& target)
@@ -1109,6 +1695,7 @@ OrderBook<OrderPtr>::callback_now()
       workingCallbacks_.reserve(callbacks_.capacity());
       workingCallbacks_.swap(callbacks_);
       for (auto cb = workingCallbacks_.begin(); cb != workingCallbacks_.end(); ++cb) {
+        remaining_callbacks_ = workingCallbacks_.end() - cb - 1;
         try
         {
           perform_callback(*cb);
@@ -1138,10 +1725,18 @@ OrderBook<OrderPtr>::callback_now()
       }
       workingCallbacks_.clear();
     }
+    remaining_callbacks_ = 0;
     handling_callbacks_ = false;
   }
 }
 
+template <class OrderPtr>
+bool
+OrderBook<OrderPtr>::callbacks_pending() const
+{
+  return remaining_callbacks_ != 0 || !callbacks_.empty();
+}
+
 template <class OrderPtr>
 void
 OrderBook<OrderPtr>::perform_callback(TypedCallback& cb)
@@ -1218,9 +1813,11 @@ OrderBook<OrderPtr>::perform_callback(TypedCallback& cb)
       }
       break;
     case TypedCallback::cb_order_replace:
+      // Depth tracks open quantity, which is less than the order
+      // quantity once the order has partially filled
       on_replace(cb.order, 
-        cb.order->order_qty(), 
-        cb.order->order_qty() + cb.delta,
+        cb.quantity, 
+        cb.quantity + cb.delta,
         cb.price);
       if(order_listener_)
       {
@@ -1236,7 +1833,16 @@ OrderBook<OrderPtr>::perform_callback(TypedCallback& cb)
         order_listener_->on_replace_reject(cb.order, cb.reject_reason);
       }
       break;
+    case TypedCallback::cb_order_reserve:
+      on_reserve(cb.order, cb.delta, cb.price);
+      break;
     case TypedCallback::cb_book_update:
+      // Pegged orders follow the book.  When they move, the book update
+      // queued behind them covers this change as well.
+      if (!pegs_.empty() && reprice_pegs())
+      {
+        break;
+      }
       on_order_book_change();
       if(order_book_listener_)
       {
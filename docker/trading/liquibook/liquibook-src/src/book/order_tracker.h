@@ -5,6 +5,8 @@
 
 #include "types.h"
 
+#include <algorithm>
+
 namespace liquibook { namespace book {
 
 /// @brief Tracker of an order's state, to keep inside the OrderBook.  
@@ -43,12 +45,65 @@ public:
   /// @ brief is this order marked immediate or cancel?
   bool immediate_or_cancel() const;
 
+  /// @brief hold back part of the open quantity from matching
+  /// @param reserved the change to the quantity held back
+  /// @return the open quantity still available
   Quantity reserve(int64_t reserved);
 
+  /// @brief get the quantity held back from matching
+  Quantity reserved_qty() const;
+
+  /// @brief make this an iceberg order, showing at most display_qty at once
+  void set_display_qty(Quantity display_qty);
+
+  /// @brief get the displayed size of an iceberg order, or zero
+  Quantity display_qty() const;
+
+  /// @brief hold back all but one displayed slice of an iceberg order
+  /// @return the quantity now held back
+  Quantity hide_reserve();
+
+  /// @brief move the next displayed slice of an iceberg order out of reserve
+  /// @return the quantity moved
+  Quantity refill();
+
+  /// @brief make this a pegged order
+  /// @param peg_type what the order's price follows
+  /// @param offset how far behind the followed price the order rests
+  /// @param limit the price the order never goes past
+  void set_peg(PegType peg_type, Price offset, Price limit);
+
+  /// @brief what the price of this order follows, or peg_none
+  PegType peg_type() const;
+
+  /// @brief get the offset of a pegged order
+  Price peg_offset() const;
+
+  /// @brief get the limit of a pegged order
+  Price peg_limit() const;
+
+  /// @brief make this a good till time order, expiring at expiry
+  void set_expiry(Timestamp expiry);
+
+  /// @brief when a good till time order expires, or zero
+  Timestamp expiry() const;
+
+  /// @brief remember the book's timer for the order's expiry
+  void set_timer(TimerId timer);
+
+  /// @brief get the book's timer for the order's expiry, or NO_TIMER
+  TimerId timer() const;
+
 private:
   OrderPtr order_;
   Quantity open_qty_;
   int64_t reserved_;
+  Quantity display_qty_;
+  PegType peg_type_;
+  Price peg_offset_;
+  Price peg_limit_;
+  Timestamp expiry_;
+  TimerId timer_;
   OrderConditions conditions_;
 };
 
@@ -59,6 +114,12 @@ OrderTracker<OrderPtr>::OrderTracker(
 : order_(order),
   open_qty_(order->order_qty()),
   reserved_(0),
+  display_qty_(0),
+  peg_type_(peg_none),
+  peg_offset_(0),
+  peg_limit_(0),
+  expiry_(0),
+  timer_(NO_TIMER),
   conditions_(conditions)
 {
 #if defined(LIQUIBOOK_ORDER_KNOWS_CONDITIONS)
@@ -81,6 +142,104 @@ OrderTracker<OrderPtr>::reserve(int64_t reserved)
   return open_qty_  - reserved_;
 }
 
+template <class OrderPtr>
+Quantity
+OrderTracker<OrderPtr>::reserved_qty() const
+{
+  return Quantity(reserved_);
+}
+
+template <class OrderPtr>
+void
+OrderTracker<OrderPtr>::set_display_qty(Quantity display_qty)
+{
+  display_qty_ = display_qty;
+}
+
+template <class OrderPtr>
+Quantity
+OrderTracker<OrderPtr>::display_qty() const
+{
+  return display_qty_;
+}
+
+template <class OrderPtr>
+Quantity
+OrderTracker<OrderPtr>::hide_reserve()
+{
+  if (display_qty_ && open_qty_ > display_qty_) {
+    reserved_ = int64_t(open_qty_ - display_qty_);
+  }
+  return Quantity(reserved_);
+}
+
+template <class OrderPtr>
+Quantity
+OrderTracker<OrderPtr>::refill()
+{
+  Quantity slice = (std::min)(display_qty_, Quantity(reserved_));
+  reserved_ -= slice;
+  return slice;
+}
+
+template <class OrderPtr>
+void
+OrderTracker<OrderPtr>::set_peg(PegType peg_type, Price offset, Price limit)
+{
+  peg_type_ = peg_type;
+  peg_offset_ = offset;
+  peg_limit_ = limit;
+}
+
+template <class OrderPtr>
+PegType
+OrderTracker<OrderPtr>::peg_type() const
+{
+  return peg_type_;
+}
+
+template <class OrderPtr>
+Price
+OrderTracker<OrderPtr>::peg_offset() const
+{
+  return peg_offset_;
+}
+
+template <class OrderPtr>
+Price
+OrderTracker<OrderPtr>::peg_limit() const
+{
+  return peg_limit_;
+}
+
+template <class OrderPtr>
+void
+OrderTracker<OrderPtr>::set_expiry(Timestamp expiry)
+{
+  expiry_ = expiry;
+}
+
+template <class OrderPtr>
+Timestamp
+OrderTracker<OrderPtr>::expiry() const
+{
+  return expiry_;
+}
+
+template <class OrderPtr>
+void
+OrderTracker<OrderPtr>::set_timer(TimerId timer)
+{
+  timer_ = timer;
+}
+
+template <class OrderPtr>
+TimerId
+OrderTracker<OrderPtr>::timer() const
+{
+  return timer_;
+}
+
 template <class OrderPtr>
 void
 OrderTracker<OrderPtr>::change_qty(int64_t delta)
@@ -114,7 +273,7 @@ template <class OrderPtr>
 Quantity
 OrderTracker<OrderPtr>::filled_qty() const
 {
-  return order_->order_qty() - open_qty();
+  return order_->order_qty() - open_qty_;
 }
 
 // TODO: Rename this to be available and change the rest of the
@@ -0,0 +1,364 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#pragma once
+
+#include "types.h"
+
+#include <vector>
+#include <stdexcept>
+
+namespace liquibook { namespace book {
+
+/// @brief Hierarchical timing wheel.  Each level has 256 slots, each slot
+///        covering 256 times the span of a slot on the level below, so
+///        eight levels cover every Timestamp without an overflow list.
+///        A timer waits on the level of the highest byte in which its
+///        expiry differs from the current time, and moves down a level
+///        each time the current time reaches its slot.
+///
+///        Inserting and removing a timer take constant time.  Advancing
+///        skips straight to the next occupied slot, so a long quiet gap
+///        costs no more than a short one.
+template <typename Value>
+class TimerWheel {
+public:
+  /// @brief construct
+  /// @param now the time to start from
+  TimerWheel(Timestamp now = 0);
+
+  /// @brief the time the wheel has been advanced to
+  Timestamp now() const;
+
+  /// @brief the number of timers waiting
+  size_t size() const;
+
+  /// @brief are there no timers waiting?
+  bool empty() const;
+
+  /// @brief start a timer
+  /// @param expiry when the timer expires; must be later than now()
+  /// @param value passed back when the timer expires
+  /// @return the id used to update or remove the timer
+  TimerId insert(Timestamp expiry, const Value& value);
+
+  /// @brief change the value of a waiting timer
+  void update(TimerId timer, const Value& value);
+
+  /// @brief stop a waiting timer
+  void remove(TimerId timer);
+
+  /// @brief get the value of a waiting timer
+  const Value& value(TimerId timer) const;
+
+  /// @brief get the expiry of a waiting timer
+  Timestamp expiry(TimerId timer) const;
+
+  /// @brief move the current time forward, expiring the timers that are
+  ///        due by then in order of expiry, and those due at the same time
+  ///        in order of insertion.  Each timer is removed before it is
+  ///        passed to expire, so expire may insert and remove others.
+  /// @param to the new current time
+  /// @param expire called with the value of each expired timer
+  template <typename Expire>
+  void advance(Timestamp to, Expire expire);
+
+private:
+  static const unsigned SLOT_BITS = 8;
+  static const unsigned SLOTS = 1u << SLOT_BITS;
+  static const Timestamp SLOT_MASK = SLOTS - 1;
+  static const unsigned LEVELS = 64 / SLOT_BITS;
+  static const unsigned WORDS = SLOTS / 64;
+
+  struct Node {
+    Value value;
+    Timestamp expiry;
+    TimerId prev;
+    TimerId next;
+    // level * SLOTS + slot, or SLOTS * LEVELS when the node is free
+    unsigned bucket;
+  };
+
+  struct Slot {
+    TimerId head;
+    TimerId tail;
+  };
+
+  /// @brief which bucket a timer belongs in, given the current time
+  unsigned bucket_for(Timestamp expiry) const;
+  /// @brief put a node at the back of its bucket
+  void link(TimerId timer);
+  /// @brief take a node out of its bucket
+  void unlink(TimerId timer);
+  /// @brief the first occupied slot of a level at or after a slot
+  /// @return SLOTS if there is none
+  unsigned next_occupied(unsigned level, unsigned slot) const;
+  /// @brief the start of the next occupied slot after now_
+  /// @return false if no timers are waiting
+  bool next_event(Timestamp& when) const;
+  /// @brief move the timers of a slot down to the levels below
+  void cascade(unsigned level, unsigned slot);
+  /// @brief check that a timer is waiting
+  const Node& waiting(TimerId timer) const;
+
+  std::vector<Node> nodes_;
+  TimerId free_;
+  Slot slots_[LEVELS][SLOTS];
+  uint64_t occupied_[LEVELS][WORDS];
+  Timestamp now_;
+  size_t size_;
+};
+
+template <typename Value>
+TimerWheel<Value>::TimerWheel(Timestamp now)
+: free_(NO_TIMER),
+  now_(now),
+  size_(0)
+{
+  for (unsigned level = 0; level < LEVELS; ++level) {
+    for (unsigned slot = 0; slot < SLOTS; ++slot) {
+      slots_[level][slot].head = NO_TIMER;
+      slots_[level][slot].tail = NO_TIMER;
+    }
+    for (unsigned word = 0; word < WORDS; ++word) {
+      occupied_[level][word] = 0;
+    }
+  }
+}
+
+template <typename Value>
+Timestamp
+TimerWheel<Value>::now() const
+{
+  return now_;
+}
+
+template <typename Value>
+size_t
+TimerWheel<Value>::size() const
+{
+  return size_;
+}
+
+template <typename Value>
+bool
+TimerWheel<Value>::empty() const
+{
+  return size_ == 0;
+}
+
+template <typename Value>
+TimerId
+TimerWheel<Value>::insert(Timestamp expiry, const Value& value)
+{
+  if (expiry <= now_) {
+    throw std::runtime_error("Timer expiry is not in the future");
+  }
+  TimerId timer = free_;
+  if (timer == NO_TIMER) {
+    timer = TimerId(nodes_.size());
+    nodes_.push_back(Node());
+  } else {
+    free_ = nodes_[timer].next;
+  }
+  Node& node = nodes_[timer];
+  node.value = value;
+  node.expiry = expiry;
+  link(timer);
+  ++size_;
+  return timer;
+}
+
+template <typename Value>
+void
+TimerWheel<Value>::update(TimerId timer, const Value& value)
+{
+  waiting(timer);
+  nodes_[timer].value = value;
+}
+
+template <typename Value>
+void
+TimerWheel<Value>::remove(TimerId timer)
+{
+  waiting(timer);
+  unlink(timer);
+  nodes_[timer].bucket = SLOTS * LEVELS;
+  nodes_[timer].next = free_;
+  free_ = timer;
+  --size_;
+}
+
+template <typename Value>
+const Value&
+TimerWheel<Value>::value(TimerId timer) const
+{
+  return waiting(timer).value;
+}
+
+template <typename Value>
+Timestamp
+TimerWheel<Value>::expiry(TimerId timer) const
+{
+  return waiting(timer).expiry;
+}
+
+template <typename Value>
+template <typename Expire>
+void
+TimerWheel<Value>::advance(Timestamp to, Expire expire)
+{
+  Timestamp when;
+  while (now_ < to && next_event(when) && when <= to) {
+    now_ = when;
+    // Every level whose slot starts now hands its timers down, the
+    // highest first so the lower slots see what it hands them
+    unsigned top = 0;
+    while (top + 1 < LEVELS &&
+           (now_ & ((Timestamp(1) << (SLOT_BITS * (top + 1))) - 1)) == 0) {
+      ++top;
+    }
+    for (unsigned level = top; level > 0; --level) {
+      cascade(level, unsigned((now_ >> (SLOT_BITS * level)) & SLOT_MASK));
+    }
+    Slot& due = slots_[0][now_ & SLOT_MASK];
+    while (due.head != NO_TIMER) {
+      TimerId timer = due.head;
+      Value value = nodes_[timer].value;
+      remove(timer);
+      expire(value);
+    }
+  }
+  if (now_ < to) {
+    now_ = to;
+  }
+}
+
+template <typename Value>
+unsigned
+TimerWheel<Value>::bucket_for(Timestamp expiry) const
+{
+  Timestamp differ = (expiry ^ now_) >> SLOT_BITS;
+  unsigned level = 0;
+  while (differ) {
+    differ >>= SLOT_BITS;
+    ++level;
+  }
+  return level * SLOTS +
+    unsigned((expiry >> (SLOT_BITS * level)) & SLOT_MASK);
+}
+
+template <typename Value>
+void
+TimerWheel<Value>::link(TimerId timer)
+{
+  Node& node = nodes_[timer];
+  node.bucket = bucket_for(node.expiry);
+  const unsigned level = node.bucket / SLOTS;
+  const unsigned slot = node.bucket % SLOTS;
+  Slot& bucket = slots_[level][slot];
+  node.prev = bucket.tail;
+  node.next = NO_TIMER;
+  if (bucket.tail == NO_TIMER) {
+    bucket.head = timer;
+    occupied_[level][slot / 64] |= uint64_t(1) << (slot % 64);
+  } else {
+    nodes_[bucket.tail].next = timer;
+  }
+  bucket.tail = timer;
+}
+
+template <typename Value>
+void
+TimerWheel<Value>::unlink(TimerId timer)
+{
+  Node& node = nodes_[timer];
+  const unsigned level = node.bucket / SLOTS;
+  const unsigned slot = node.bucket % SLOTS;
+  Slot& bucket = slots_[level][slot];
+  if (node.prev == NO_TIMER) {
+    bucket.head = node.next;
+  } else {
+    nodes_[node.prev].next = node.next;
+  }
+  if (node.next == NO_TIMER) {
+    bucket.tail = node.prev;
+  } else {
+    nodes_[node.next].prev = node.prev;
+  }
+  if (bucket.head == NO_TIMER) {
+    occupied_[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+  }
+}
+
+template <typename Value>
+unsigned
+TimerWheel<Value>::next_occupied(unsigned level, unsigned slot) const
+{
+  for (unsigned word = slot / 64; word < WORDS; ++word) {
+    uint64_t bits = occupied_[level][word];
+    if (word == slot / 64) {
+      bits &= ~uint64_t(0) << (slot % 64);
+    }
+    if (bits) {
+      unsigned bit = 0;
+      while (!(bits & 1)) {
+        bits >>= 1;
+        ++bit;
+      }
+      return word * 64 + bit;
+    }
+  }
+  return SLOTS;
+}
+
+template <typename Value>
+bool
+TimerWheel<Value>::next_event(Timestamp& when) const
+{
+  if (size_ == 0) {
+    return false;
+  }
+  // Timers on a level all come before the next slot of the level above
+  for (unsigned level = 0; level < LEVELS; ++level) {
+    const unsigned shift = SLOT_BITS * level;
+    const unsigned current = unsigned((now_ >> shift) & SLOT_MASK);
+    const unsigned slot = next_occupied(level, current + 1);
+    if (slot < SLOTS) {
+      Timestamp above = 0;
+      if (shift + SLOT_BITS < 64) {
+        above = (now_ >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+      }
+      when = above | (Timestamp(slot) << shift);
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Value>
+void
+TimerWheel<Value>::cascade(unsigned level, unsigned slot)
+{
+  TimerId timer = slots_[level][slot].head;
+  slots_[level][slot].head = NO_TIMER;
+  slots_[level][slot].tail = NO_TIMER;
+  occupied_[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+  while (timer != NO_TIMER) {
+    TimerId next = nodes_[timer].next;
+    link(timer);
+    timer = next;
+  }
+}
+
+template <typename Value>
+const typename TimerWheel<Value>::Node&
+TimerWheel<Value>::waiting(TimerId timer) const
+{
+  if (timer >= nodes_.size() || nodes_[timer].bucket >= SLOTS * LEVELS) {
+    throw std::runtime_error("Timer is not waiting");
+  }
+  return nodes_[timer];
+}
+
+} }
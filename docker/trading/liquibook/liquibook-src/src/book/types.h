@@ -15,6 +15,8 @@ namespace liquibook { namespace book {
   typedef uint32_t FillId;
   typedef uint32_t ChangeId;
   typedef uint32_t OrderConditions;
+  typedef uint64_t Timestamp;
+  typedef uint32_t TimerId;
 
   enum OrderCondition {
     oc_no_conditions = 0,
@@ -24,12 +26,22 @@ namespace liquibook { namespace book {
     oc_stop = oc_immediate_or_cancel << 1
   };
 
+  // What the price of a pegged order follows
+  enum PegType {
+    peg_none = 0,
+    // the best price on the order's own side
+    peg_primary,
+    // the midpoint between the best bid and the best ask
+    peg_midpoint
+  };
+
   namespace {
   // Constants used in liquibook API
   const Price MARKET_ORDER_PRICE(0);
   const Price PRICE_UNCHANGED(0);
   const Quantity QUANTITY_MAX(UINT64_MAX);
   const int64_t SIZE_UNCHANGED(0);
+  const TimerId NO_TIMER(UINT32_MAX);
   }
 
 } } // namespace
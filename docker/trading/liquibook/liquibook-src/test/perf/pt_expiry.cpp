@@ -0,0 +1,105 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#include <simple/simple_order_book.h>
+#include <book/clock.h>
+#include <book/types.h>
+
+#include <deque>
+#include <iostream>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace liquibook;
+using namespace liquibook::book;
+
+typedef simple::SimpleOrderBook<5> FullDepthOrderBook;
+
+namespace {
+  const Price MID_PRICE = 10000;
+  const Price LEVELS = 1000;
+  const Timestamp NANOS_PER_SECOND = 1000000000;
+  // A six and a half hour session, in nanoseconds
+  const Timestamp SESSION_END = 23400 * NANOS_PER_SECOND;
+}
+
+// Resting orders on both sides, none crossing.  Most are good for the day;
+// the rest expire at some time in the session's last hour.
+void fill_book(FullDepthOrderBook& order_book,
+               std::deque<simple::SimpleOrder>& orders,
+               uint32_t count,
+               bool good_till)
+{
+  for (uint32_t i = 0; i < count; ++i) {
+    bool is_buy = (i % 2) == 0;
+    Price offset = 1 + rand() % LEVELS;
+    Price price = is_buy ? MID_PRICE - offset : MID_PRICE + offset;
+    orders.emplace_back(is_buy, price, (rand() % 10 + 1) * 100);
+    Timestamp expiry = SESSION_END;
+    if (rand() % 4 == 0) {
+      expiry -= (rand() % 3600) * NANOS_PER_SECOND;
+    }
+    if (good_till) {
+      order_book.add_good_till(&orders.back(), expiry);
+    } else {
+      order_book.add(&orders.back());
+    }
+  }
+}
+
+// The book expires every order itself
+double run_native(uint32_t count) {
+  FullDepthOrderBook order_book;
+  ManualClock session_clock;
+  order_book.set_clock(&session_clock);
+  std::deque<simple::SimpleOrder> orders;
+  fill_book(order_book, orders, count, true);
+
+  session_clock.set(SESSION_END);
+  clock_t start = clock();
+  order_book.expire_orders();
+  double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+  if (!order_book.bids().empty() || !order_book.asks().empty()) {
+    std::cout << "orders left on the book after expiry" << std::endl;
+  }
+  return seconds;
+}
+
+// The client sweeps its own orders at the close, one cancel at a time
+double run_sweep(uint32_t count) {
+  FullDepthOrderBook order_book;
+  std::deque<simple::SimpleOrder> orders;
+  fill_book(order_book, orders, count, false);
+
+  clock_t start = clock();
+  for (auto order = orders.begin(); order != orders.end(); ++order) {
+    order_book.cancel(&*order);
+  }
+  return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+void report(const char* name, uint32_t count, double seconds) {
+  std::cout << name << ": " << count << " orders expired in "
+            << seconds << " seconds";
+  if (seconds > 0) {
+    std::cout << ", or " << uint64_t(count / seconds) << " per sec";
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, const char* argv[])
+{
+  uint32_t count = 1000000;
+  if (argc > 1) {
+    count = atoi(argv[1]);
+    if (!count) {
+      count = 1000000;
+    }
+  }
+  std::cout << "good till time orders: expiry at the close against "
+            << "a cancel sweep" << std::endl;
+  srand(count);
+  report("native", count, run_native(count));
+  srand(count);
+  report("sweep", count, run_sweep(count));
+}
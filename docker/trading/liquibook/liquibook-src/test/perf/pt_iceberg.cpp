@@ -0,0 +1,119 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+#include <simple/simple_order_book.h>
+#include <book/types.h>
+
+#include <deque>
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace liquibook;
+using namespace liquibook::book;
+
+typedef simple::SimpleOrderBook<5> FullDepthOrderBook;
+
+namespace {
+  const uint32_t ICEBERGS = 5;
+  const Price FIRST_PRICE = 1250;
+  const Quantity DISPLAY_QTY = 100;
+  // Enough that no iceberg runs out during a run
+  const Quantity ICEBERG_QTY = 1000000000;
+}
+
+// Aggressive IOC buys of one to five slices each, all at a price that
+// reaches every iceberg
+std::vector<simple::SimpleOrder*> make_aggressors(uint32_t count) {
+  std::vector<simple::SimpleOrder*> orders;
+  orders.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    Quantity qty = ((rand() % 5) + 1) * DISPLAY_QTY;
+    orders.push_back(new simple::SimpleOrder(
+      true, FIRST_PRICE + ICEBERGS, qty));
+  }
+  return orders;
+}
+
+// The book refills each iceberg itself
+double run_native(const std::vector<simple::SimpleOrder*>& aggressors) {
+  FullDepthOrderBook order_book;
+  std::deque<simple::SimpleOrder> icebergs;
+  for (uint32_t i = 0; i < ICEBERGS; ++i) {
+    icebergs.emplace_back(false, FIRST_PRICE + i, ICEBERG_QTY);
+    order_book.add_iceberg(&icebergs.back(), DISPLAY_QTY);
+  }
+
+  clock_t start = clock();
+  for (auto order = aggressors.begin(); order != aggressors.end(); ++order) {
+    order_book.add(*order, oc_immediate_or_cancel);
+  }
+  return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// The client keeps one visible order per iceberg on the book, and sends
+// the next slice as a new order once the previous one has filled
+double run_emulated(const std::vector<simple::SimpleOrder*>& aggressors) {
+  FullDepthOrderBook order_book;
+  std::deque<simple::SimpleOrder> slices;
+  std::vector<simple::SimpleOrder*> visible(ICEBERGS);
+  std::vector<Quantity> reserve(ICEBERGS, ICEBERG_QTY - DISPLAY_QTY);
+  for (uint32_t i = 0; i < ICEBERGS; ++i) {
+    slices.emplace_back(false, FIRST_PRICE + i, DISPLAY_QTY);
+    visible[i] = &slices.back();
+    order_book.add(visible[i]);
+  }
+
+  clock_t start = clock();
+  for (auto order = aggressors.begin(); order != aggressors.end(); ++order) {
+    order_book.add(*order, oc_immediate_or_cancel);
+    for (uint32_t i = 0; i < ICEBERGS; ++i) {
+      if (visible[i]->open_qty() == 0 && reserve[i] != 0) {
+        Quantity qty = (std::min)(DISPLAY_QTY, reserve[i]);
+        reserve[i] -= qty;
+        slices.emplace_back(false, FIRST_PRICE + i, qty);
+        visible[i] = &slices.back();
+        order_book.add(visible[i]);
+      }
+    }
+  }
+  return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+void report(const char* name, uint32_t count, double seconds) {
+  std::cout << name << ": " << count << " aggressive orders in "
+            << seconds << " seconds";
+  if (seconds > 0) {
+    std::cout << ", or " << uint64_t(count / seconds) << " per sec";
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, const char* argv[])
+{
+  uint32_t count = 1000000;
+  if (argc > 1) {
+    count = atoi(argv[1]);
+    if (!count) {
+      count = 1000000;
+    }
+  }
+  std::cout << "iceberg orders: native reserve against client emulation"
+            << std::endl;
+  srand(count);
+
+  // Emulated slices are only sent between aggressive orders, so an
+  // aggressor there trades through fewer slices at the best price
+  std::vector<simple::SimpleOrder*> aggressors = make_aggressors(count);
+  report("native", count, run_native(aggressors));
+  for (auto order = aggressors.begin(); order != aggressors.end(); ++order) {
+    delete *order;
+  }
+  srand(count);
+  aggressors = make_aggressors(count);
+  report("emulated", count, run_emulated(aggressors));
+  for (auto order = aggressors.begin(); order != aggressors.end(); ++order) {
+    delete *order;
+  }
+}
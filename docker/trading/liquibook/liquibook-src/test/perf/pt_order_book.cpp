@@ -2,6 +2,7 @@
 // All rights reserved.
 // See the file license.txt for licensing information.
 #include <simple/simple_order_book.h>
+#include <simple/simple_bbo_order_book.h>
 #include <book/types.h>
 
 #include <iostream>
@@ -13,7 +14,8 @@ using namespace liquibook;
 using namespace liquibook::book;
 
 typedef simple::SimpleOrderBook<5> FullDepthOrderBook;
-typedef simple::SimpleOrderBook<1> BboOrderBook;
+typedef simple::SimpleOrderBook<1> BboDepthOrderBook;
+typedef simple::SimpleBboOrderBook BboTrackerOrderBook;
 typedef book::OrderBook<simple::SimpleOrder*> NoDepthOrderBook;
 
 template <class TypedOrderBook, class TypedOrder>
@@ -122,7 +124,19 @@ int main(int argc, const char* argv[])
     std::cout << "testing order book with bbo" << std::endl;
     uint32_t num_to_try = dur_sec * 125000;
     while (true) {
-      if (build_and_run_test<BboOrderBook>(dur_sec, num_to_try)) {
+      if (build_and_run_test<BboDepthOrderBook>(dur_sec, num_to_try)) {
+        break;
+      } else {
+        num_to_try *= 2;
+      }
+    }
+  }
+
+  {
+    std::cout << "testing order book with bbo tracker" << std::endl;
+    uint32_t num_to_try = dur_sec * 125000;
+    while (true) {
+      if (build_and_run_test<BboTrackerOrderBook>(dur_sec, num_to_try)) {
         break;
       } else {
         num_to_try *= 2;
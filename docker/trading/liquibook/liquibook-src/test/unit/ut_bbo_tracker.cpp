@@ -0,0 +1,239 @@
+// Copyright (c) 2012 - 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+#define BOOST_TEST_NO_MAIN LiquibookTest
+#include <boost/test/unit_test.hpp>
+
+#include <book/bbo_order_book.h>
+#include <simple/simple_order.h>
+#include <simple/simple_bbo_order_book.h>
+#include "depth_check.h"
+#include "ut_utils.h"
+
+#include <memory>
+#include <vector>
+
+namespace liquibook {
+
+using simple::SimpleOrder;
+using simple::SimpleBboOrderBook;
+
+typedef FillCheck<SimpleOrder*> SimpleFillCheck;
+typedef DepthCheck<SimpleBboOrderBook> BboCheck;
+
+class BboCounter : public BboListener<book::BboOrderBook<SimpleOrder*> >
+{
+public:
+  BboCounter() : changes_(0) {}
+  virtual void on_bbo_change(const book::BboOrderBook<SimpleOrder*>* ,
+                             const Bbo* )
+  {
+    ++changes_;
+  }
+  int changes_;
+};
+
+BOOST_AUTO_TEST_CASE(TestBboTrackerAddBetterAndWorse)
+{
+  SimpleBboOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1249, 200);
+  SimpleOrder bid2(true,  1251, 300);
+  SimpleOrder ask0(false, 1255, 100);
+  SimpleOrder ask1(false, 1253, 400);
+  SimpleOrder ask2(false, 1253, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+
+  BboCheck dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1250, 1, 100));
+  BOOST_CHECK(dc.verify_ask(1255, 1, 100));
+
+  // Better prices replace the best level, equal prices aggregate
+  BOOST_CHECK(add_and_verify(order_book, &bid2, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask2, false));
+  dc.reset();
+  BOOST_CHECK(dc.verify_bid(1251, 1, 300));
+  BOOST_CHECK(dc.verify_ask(1253, 2, 500));
+}
+
+BOOST_AUTO_TEST_CASE(TestBboTrackerRestoreFromBookOnCancel)
+{
+  SimpleBboOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1249, 200);
+  SimpleOrder bid2(true,  1249, 300);
+  SimpleOrder ask0(false, 1255, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid2, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+
+  BOOST_CHECK(cancel_and_verify(order_book, &bid0, simple::os_cancelled));
+  BOOST_CHECK(!order_book.depth().needs_bid_restoration());
+  BboCheck dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1249, 2, 500));
+  BOOST_CHECK(dc.verify_ask(1255, 1, 100));
+
+  BOOST_CHECK(cancel_and_verify(order_book, &bid1, simple::os_cancelled));
+  BOOST_CHECK(cancel_and_verify(order_book, &bid2, simple::os_cancelled));
+  BOOST_CHECK(cancel_and_verify(order_book, &ask0, simple::os_cancelled));
+  dc.reset();
+  BOOST_CHECK(dc.verify_bid(0, 0, 0));
+  BOOST_CHECK(dc.verify_ask(0, 0, 0));
+}
+
+BOOST_AUTO_TEST_CASE(TestBboTrackerSweepPartialNextLevel)
+{
+  // The next level is partially filled by the same inbound order that
+  // emptied the best level.  Restoring from the book mid-stream would
+  // count that fill twice.
+  SimpleBboOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1249, 100);
+  SimpleOrder bid2(true,  1248, 100);
+  SimpleOrder ask0(false, 1249, 150);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid2, false));
+  {
+    SimpleFillCheck fc0(&ask0, 150, 1250 * 100 + 1249 * 50);
+    SimpleFillCheck fc1(&bid0, 100, 1250 * 100);
+    SimpleFillCheck fc2(&bid1,  50, 1249 *  50);
+    BOOST_CHECK(add_and_verify(order_book, &ask0, true, true));
+  }
+  BboCheck dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1249, 1, 50));
+  BOOST_CHECK(dc.verify_ask(0, 0, 0));
+}
+
+BOOST_AUTO_TEST_CASE(TestBboTrackerInboundRestsAfterSweep)
+{
+  SimpleBboOrderBook order_book;
+  SimpleOrder ask0(false, 1251, 100);
+  SimpleOrder ask1(false, 1252, 100);
+  SimpleOrder ask2(false, 1254, 100);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1252, 500);
+
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask2, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, true));
+
+  BboCheck dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1252, 1, 300));
+  BOOST_CHECK(dc.verify_ask(1254, 1, 100));
+}
+
+BOOST_AUTO_TEST_CASE(TestBboTrackerReplace)
+{
+  SimpleBboOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1249, 200);
+  SimpleOrder ask0(false, 1255, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+
+  // Size change at the best level
+  BOOST_CHECK(replace_and_verify(order_book, &bid0, 50));
+  BboCheck dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1250, 1, 150));
+
+  // Move the best bid behind the next level
+  BOOST_CHECK(replace_and_verify(order_book, &bid0, 0, 1248));
+  dc.reset();
+  BOOST_CHECK(dc.verify_bid(1249, 1, 200));
+
+  // Move it ahead again
+  BOOST_CHECK(replace_and_verify(order_book, &bid0, 0, 1251));
+  dc.reset();
+  BOOST_CHECK(dc.verify_bid(1251, 1, 150));
+  BOOST_CHECK(dc.verify_ask(1255, 1, 100));
+}
+
+BOOST_AUTO_TEST_CASE(TestBboTrackerListener)
+{
+  SimpleBboOrderBook order_book;
+  BboCounter listener;
+  order_book.set_bbo_listener(&listener);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1249, 200);
+  SimpleOrder bid2(true,  1248, 200);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK_EQUAL(1, listener.changes_);
+  // Behind the best, no change
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid2, false));
+  BOOST_CHECK_EQUAL(1, listener.changes_);
+  BOOST_CHECK(cancel_and_verify(order_book, &bid2, simple::os_cancelled));
+  BOOST_CHECK_EQUAL(1, listener.changes_);
+  // Best empties, restored from the book
+  BOOST_CHECK(cancel_and_verify(order_book, &bid0, simple::os_cancelled));
+  BOOST_CHECK_EQUAL(2, listener.changes_);
+}
+
+BOOST_AUTO_TEST_CASE(TestBboTrackerMatchesDepth)
+{
+  // Drive the same random flow through a depth book and a BBO book,
+  // and verify the tops agree after every command
+  SimpleOrderBook depth_book;
+  SimpleBboOrderBook bbo_book;
+  std::vector<std::unique_ptr<SimpleOrder> > depth_orders;
+  std::vector<std::unique_ptr<SimpleOrder> > bbo_orders;
+  srand(2017);
+
+  for (int i = 0; i < 20000; ++i) {
+    int action = rand() % 10;
+    if (action < 6 || depth_orders.empty()) {
+      bool is_buy = (rand() % 2) == 0;
+      Price price = (rand() % 10) + (is_buy ? 1880 : 1884);
+      Quantity qty = ((rand() % 10) + 1) * 100;
+      OrderConditions conditions = (rand() % 8 == 0) ? oc_all_or_none : 0;
+      depth_orders.emplace_back(
+        new SimpleOrder(is_buy, price, qty, 0, conditions));
+      bbo_orders.emplace_back(
+        new SimpleOrder(is_buy, price, qty, 0, conditions));
+      depth_book.add(depth_orders.back().get(), conditions);
+      bbo_book.add(bbo_orders.back().get(), conditions);
+    } else {
+      size_t index = rand() % depth_orders.size();
+      SimpleOrder* depth_order = depth_orders[index].get();
+      SimpleOrder* bbo_order = bbo_orders[index].get();
+      if (depth_order->state() != simple::os_accepted) {
+        continue;
+      }
+      if (action < 8) {
+        depth_book.cancel(depth_order);
+        bbo_book.cancel(bbo_order);
+      } else {
+        int64_t delta = ((rand() % 5) - 2) * 100;
+        Price price = depth_order->price() + (rand() % 3) - 1;
+        depth_book.replace(depth_order, delta, price);
+        bbo_book.replace(bbo_order, delta, price);
+      }
+    }
+    const DepthLevel* depth_bid = depth_book.depth().bids();
+    const DepthLevel* depth_ask = depth_book.depth().asks();
+    const DepthLevel* bbo_bid = bbo_book.depth().bids();
+    const DepthLevel* bbo_ask = bbo_book.depth().asks();
+    BOOST_REQUIRE_EQUAL(depth_bid->price(), bbo_bid->price());
+    BOOST_REQUIRE_EQUAL(depth_bid->order_count(), bbo_bid->order_count());
+    BOOST_REQUIRE_EQUAL(depth_bid->aggregate_qty(), bbo_bid->aggregate_qty());
+    BOOST_REQUIRE_EQUAL(depth_ask->price(), bbo_ask->price());
+    BOOST_REQUIRE_EQUAL(depth_ask->order_count(), bbo_ask->order_count());
+    BOOST_REQUIRE_EQUAL(depth_ask->aggregate_qty(), bbo_ask->aggregate_qty());
+  }
+}
+
+} // namespace
@@ -1067,4 +1067,41 @@ BOOST_AUTO_TEST_CASE(TestReplaceAsk)
   cc.reset();
 }
 
+BOOST_AUTO_TEST_CASE(TestVisibleQtyThroughExcess)
+{
+  SizedDepth depth;
+  depth.add_order(1236, 100, true);
+  depth.add_order(1235, 200, true);
+  depth.add_order(1234, 300, true);
+  depth.add_order(1233, 400, true);
+  depth.add_order(1232, 500, true);
+  BOOST_CHECK_EQUAL(1500, depth.visible_qty(true));
+  BOOST_CHECK_EQUAL(0, depth.visible_qty(false));
+
+  // Excess level, not visible
+  depth.add_order(1231, 600, true);
+  BOOST_CHECK_EQUAL(1500, depth.visible_qty(true));
+
+  // Better level pushes 1232 into excess
+  depth.add_order(1237, 700, true);
+  BOOST_CHECK_EQUAL(1700, depth.visible_qty(true));
+
+  // Partial fill and quantity change on visible levels
+  depth.fill_order(1237, 50, false, true);
+  depth.change_qty_order(1236, 25, true);
+  BOOST_CHECK_EQUAL(1675, depth.visible_qty(true));
+
+  // Changes to excess levels are not visible
+  depth.change_qty_order(1231, -100, true);
+  BOOST_CHECK_EQUAL(1675, depth.visible_qty(true));
+
+  // Erasing a visible level restores 1232 from excess
+  depth.close_order(1237, 650, true);
+  BOOST_CHECK_EQUAL(1525, depth.visible_qty(true));
+
+  // Moving a visible order into excess restores 1231 from excess
+  depth.replace_order(1236, 1230, 125, 125, true);
+  BOOST_CHECK_EQUAL(1900, depth.visible_qty(true));
+}
+
 } // namespace
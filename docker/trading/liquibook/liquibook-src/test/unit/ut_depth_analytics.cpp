@@ -0,0 +1,138 @@
+// Copyright (c) 2012 - 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+#define BOOST_TEST_NO_MAIN LiquibookTest
+#include <boost/test/unit_test.hpp>
+
+#include <book/depth_analytics.h>
+#include <simple/simple_order.h>
+#include <simple/simple_order_book.h>
+#include "ut_utils.h"
+
+#include <memory>
+#include <vector>
+
+namespace liquibook {
+
+using simple::SimpleOrder;
+using book::DepthAnalytics;
+
+typedef FillCheck<SimpleOrder*> SimpleFillCheck;
+
+BOOST_AUTO_TEST_CASE(TestAnalyticsEmptyAndOneSided)
+{
+  SimpleOrderBook order_book;
+  const DepthAnalytics& analytics = order_book.analytics();
+  BOOST_CHECK(!analytics.has_bid());
+  BOOST_CHECK(!analytics.has_ask());
+  BOOST_CHECK_EQUAL(0, analytics.spread());
+  BOOST_CHECK_EQUAL(0.0, analytics.imbalance());
+
+  SimpleOrder bid0(true, 1250, 100);
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(analytics.has_bid());
+  BOOST_CHECK(!analytics.two_sided());
+  BOOST_CHECK_EQUAL(0, analytics.spread());
+  BOOST_CHECK_EQUAL(0.0, analytics.mid());
+  BOOST_CHECK_EQUAL(0.0, analytics.microprice());
+  BOOST_CHECK_EQUAL(1.0, analytics.imbalance());
+  BOOST_CHECK_EQUAL(100, analytics.bid_depth_qty());
+}
+
+BOOST_AUTO_TEST_CASE(TestAnalyticsTwoSided)
+{
+  SimpleOrderBook order_book;
+  const DepthAnalytics& analytics = order_book.analytics();
+  SimpleOrder bid0(true,  1250, 300);
+  SimpleOrder bid1(true,  1249, 200);
+  SimpleOrder ask0(false, 1254, 100);
+  SimpleOrder ask1(false, 1255, 400);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+
+  BOOST_CHECK(analytics.two_sided());
+  BOOST_CHECK_EQUAL(1250, analytics.best_bid());
+  BOOST_CHECK_EQUAL(1254, analytics.best_ask());
+  BOOST_CHECK_EQUAL(4, analytics.spread());
+  BOOST_CHECK_EQUAL(1252.0, analytics.mid());
+  // (1250 * 100 + 1254 * 300) / 400
+  BOOST_CHECK_EQUAL(1253.0, analytics.microprice());
+  BOOST_CHECK_EQUAL(500, analytics.bid_depth_qty());
+  BOOST_CHECK_EQUAL(500, analytics.ask_depth_qty());
+  BOOST_CHECK_EQUAL(0.0, analytics.imbalance());
+
+  // Fill the best ask, the spread widens
+  SimpleOrder bid2(true, 1254, 100);
+  {
+    SimpleFillCheck fc0(&bid2, 100, 1254 * 100);
+    SimpleFillCheck fc1(&ask0, 100, 1254 * 100);
+    BOOST_CHECK(add_and_verify(order_book, &bid2, true, true));
+  }
+  BOOST_CHECK_EQUAL(1255, analytics.best_ask());
+  BOOST_CHECK_EQUAL(5, analytics.spread());
+  BOOST_CHECK_EQUAL(400, analytics.ask_depth_qty());
+
+  // Cancel and replace update the cumulative quantities
+  BOOST_CHECK(cancel_and_verify(order_book, &bid1, simple::os_cancelled));
+  BOOST_CHECK(replace_and_verify(order_book, &ask1, -100));
+  BOOST_CHECK_EQUAL(300, analytics.bid_depth_qty());
+  BOOST_CHECK_EQUAL(300, analytics.ask_depth_qty());
+  BOOST_CHECK_EQUAL(0.0, analytics.imbalance());
+}
+
+BOOST_AUTO_TEST_CASE(TestAnalyticsMatchRecomputed)
+{
+  // Recompute every measure from the visible levels after each command
+  SimpleOrderBook order_book;
+  std::vector<std::unique_ptr<SimpleOrder> > orders;
+  srand(2017);
+
+  for (int i = 0; i < 20000; ++i) {
+    int action = rand() % 10;
+    if (action < 6 || orders.empty()) {
+      bool is_buy = (rand() % 2) == 0;
+      Price price = (rand() % 12) + (is_buy ? 1880 : 1886);
+      Quantity qty = ((rand() % 10) + 1) * 100;
+      orders.emplace_back(new SimpleOrder(is_buy, price, qty));
+      order_book.add(orders.back().get());
+    } else {
+      SimpleOrder* order = orders[rand() % orders.size()].get();
+      if (order->state() != simple::os_accepted) {
+        continue;
+      }
+      if (action < 8) {
+        order_book.cancel(order);
+      } else {
+        int64_t delta = ((rand() % 5) - 2) * 100;
+        Price price = order->price() + (rand() % 5) - 2;
+        order_book.replace(order, delta, price);
+      }
+    }
+    const SimpleOrderBook::DepthTracker& depth = order_book.depth();
+    Quantity bid_qty = 0;
+    Quantity ask_qty = 0;
+    for (const DepthLevel* level = depth.bids(); level != depth.asks();
+         ++level) {
+      bid_qty += level->aggregate_qty();
+    }
+    for (const DepthLevel* level = depth.asks(); level != depth.end();
+         ++level) {
+      ask_qty += level->aggregate_qty();
+    }
+    const DepthAnalytics& analytics = order_book.analytics();
+    BOOST_REQUIRE_EQUAL(bid_qty, analytics.bid_depth_qty());
+    BOOST_REQUIRE_EQUAL(ask_qty, analytics.ask_depth_qty());
+    BOOST_REQUIRE_EQUAL(depth.bids()->price(), analytics.best_bid());
+    BOOST_REQUIRE_EQUAL(depth.asks()->price(), analytics.best_ask());
+    BOOST_REQUIRE_EQUAL(depth.bids()->aggregate_qty(),
+                        analytics.best_bid_qty());
+    BOOST_REQUIRE_EQUAL(depth.asks()->aggregate_qty(),
+                        analytics.best_ask_qty());
+  }
+}
+
+} // namespace
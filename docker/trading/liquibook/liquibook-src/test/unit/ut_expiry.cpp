@@ -0,0 +1,179 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+#define BOOST_TEST_NO_MAIN LiquibookTest
+#include <boost/test/unit_test.hpp>
+
+#include "ut_utils.h"
+
+namespace liquibook {
+
+using simple::SimpleOrder;
+typedef FillCheck<SimpleOrder*> SimpleFillCheck;
+
+BOOST_AUTO_TEST_CASE(TestGoodTillExpiresOnTime)
+{
+  SimpleOrderBook order_book;
+  ManualClock clock(1000);
+  order_book.set_clock(&clock);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1250, 200);
+
+  BOOST_CHECK(add_good_till_and_verify(order_book, &bid0, 2000, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+
+  // Nothing is due yet
+  clock.set(1999);
+  order_book.expire_orders();
+  BOOST_CHECK_EQUAL(simple::os_accepted, bid0.state());
+  BOOST_CHECK_EQUAL(2, order_book.bids().size());
+
+  clock.set(2000);
+  order_book.expire_orders();
+  BOOST_CHECK_EQUAL(simple::os_cancelled, bid0.state());
+  BOOST_CHECK_EQUAL(simple::os_accepted, bid1.state());
+  BOOST_CHECK_EQUAL(1, order_book.bids().size());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1250, 1, 200));
+}
+
+BOOST_AUTO_TEST_CASE(TestGoodTillBulkExpiryPublishesOnce)
+{
+  SimpleOrderBook order_book;
+  DepthChangeCounter counter;
+  order_book.set_depth_listener(&counter);
+  ManualClock clock(1000);
+  order_book.set_clock(&clock);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1249, 100);
+  SimpleOrder ask0(false, 1252, 100);
+  SimpleOrder ask1(false, 1253, 100);
+  SimpleOrder ask2(false, 1253, 100);
+
+  BOOST_CHECK(add_good_till_and_verify(order_book, &bid0, 5000, false));
+  BOOST_CHECK(add_good_till_and_verify(order_book, &bid1, 3000, false));
+  BOOST_CHECK(add_good_till_and_verify(order_book, &ask0, 4000, false));
+  BOOST_CHECK(add_good_till_and_verify(order_book, &ask1, 100000, false));
+  BOOST_CHECK(add_good_till_and_verify(order_book, &ask2, 6000, false));
+
+  // Everything due by the close goes at once
+  counter.changes_ = 0;
+  clock.set(10000);
+  order_book.expire_orders();
+  BOOST_CHECK_EQUAL(1, counter.changes_);
+  BOOST_CHECK_EQUAL(simple::os_cancelled, bid0.state());
+  BOOST_CHECK_EQUAL(simple::os_cancelled, bid1.state());
+  BOOST_CHECK_EQUAL(simple::os_cancelled, ask0.state());
+  BOOST_CHECK_EQUAL(simple::os_accepted, ask1.state());
+  BOOST_CHECK_EQUAL(simple::os_cancelled, ask2.state());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(0, 0, 0));
+  BOOST_CHECK(dc.verify_ask(1253, 1, 100));
+
+  // With nothing due, nothing is published
+  clock.set(20000);
+  order_book.expire_orders();
+  BOOST_CHECK_EQUAL(1, counter.changes_);
+}
+
+BOOST_AUTO_TEST_CASE(TestGoodTillPartialFillExpires)
+{
+  SimpleOrderBook order_book;
+  ManualClock clock(1000);
+  order_book.set_clock(&clock);
+  SimpleOrder ask0(false, 1250, 300);
+  SimpleOrder ask1(false, 1250, 100);
+  SimpleOrder bid0(true,  1250, 200);
+  SimpleOrder bid1(true,  1250, 200);
+
+  BOOST_CHECK(add_good_till_and_verify(order_book, &ask0, 2000, false));
+  BOOST_CHECK(add_good_till_and_verify(order_book, &ask1, 2000, false));
+  {
+    SimpleFillCheck fc0(&ask0, 200, 200 * 1250);
+    SimpleFillCheck fc1(&bid0, 200, 200 * 1250);
+    BOOST_CHECK(add_and_verify(order_book, &bid0, true, true));
+  }
+  {
+    SimpleFillCheck fc0(&ask0, 100, 100 * 1250);
+    SimpleFillCheck fc1(&ask1, 100, 100 * 1250);
+    BOOST_CHECK(add_and_verify(order_book, &bid1, true, true));
+  }
+  BOOST_CHECK_EQUAL(simple::os_complete, ask0.state());
+  BOOST_CHECK_EQUAL(simple::os_complete, ask1.state());
+
+  // Filled orders have nothing left to expire
+  clock.set(3000);
+  order_book.expire_orders();
+  BOOST_CHECK_EQUAL(simple::os_complete, ask0.state());
+  BOOST_CHECK_EQUAL(simple::os_complete, ask1.state());
+  BOOST_CHECK_EQUAL(0, order_book.asks().size());
+}
+
+BOOST_AUTO_TEST_CASE(TestGoodTillCancelAndReplace)
+{
+  SimpleOrderBook order_book;
+  ManualClock clock(1000);
+  order_book.set_clock(&clock);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1250, 100);
+  SimpleOrder ask0(false, 1253, 100);
+
+  BOOST_CHECK(add_good_till_and_verify(order_book, &bid0, 2000, false));
+  BOOST_CHECK(add_good_till_and_verify(order_book, &bid1, 2000, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+  BOOST_CHECK(cancel_and_verify(order_book, &bid0, simple::os_cancelled));
+
+  // A replaced order keeps its expiry
+  BOOST_CHECK(replace_and_verify(order_book, &bid1, 50, 1251));
+  BOOST_CHECK(replace_and_verify(order_book, &bid1, -25));
+
+  clock.set(2000);
+  order_book.expire_orders();
+  BOOST_CHECK_EQUAL(simple::os_cancelled, bid1.state());
+  BOOST_CHECK_EQUAL(0, order_book.bids().size());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(0, 0, 0));
+  BOOST_CHECK(dc.verify_ask(1253, 1, 100));
+}
+
+BOOST_AUTO_TEST_CASE(TestGoodTillReplaceThatFills)
+{
+  SimpleOrderBook order_book;
+  ManualClock clock(1000);
+  order_book.set_clock(&clock);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder ask0(false, 1251, 100);
+
+  BOOST_CHECK(add_good_till_and_verify(order_book, &bid0, 2000, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+  {
+    SimpleFillCheck fc0(&bid0, 100, 100 * 1251);
+    SimpleFillCheck fc1(&ask0, 100, 100 * 1251);
+    BOOST_CHECK(replace_and_verify(order_book, &bid0, 0, 1251,
+                                   simple::os_complete, 100));
+  }
+
+  clock.set(2000);
+  order_book.expire_orders();
+  BOOST_CHECK_EQUAL(simple::os_complete, bid0.state());
+}
+
+BOOST_AUTO_TEST_CASE(TestGoodTillRejects)
+{
+  SimpleOrderBook order_book;
+  ManualClock clock(1000);
+  order_book.set_clock(&clock);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1250, 100, 1240);
+
+  // Rejected orders never leave the new state
+  BOOST_CHECK(!order_book.add_good_till(&bid0, 1000));
+  BOOST_CHECK_EQUAL(simple::os_new, bid0.state());
+  BOOST_CHECK(!order_book.add_good_till(&bid1, 2000));
+  BOOST_CHECK_EQUAL(simple::os_new, bid1.state());
+  BOOST_CHECK_EQUAL(0, order_book.bids().size());
+  BOOST_CHECK_EQUAL(0, order_book.stopBids().size());
+}
+
+} // namespace liquibook
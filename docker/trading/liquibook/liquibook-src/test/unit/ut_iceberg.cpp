@@ -0,0 +1,233 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+#define BOOST_TEST_NO_MAIN LiquibookTest
+#include <boost/test/unit_test.hpp>
+
+#include <simple/simple_bbo_order_book.h>
+#include "ut_utils.h"
+
+namespace liquibook {
+
+using simple::SimpleOrder;
+using simple::SimpleBboOrderBook;
+typedef FillCheck<SimpleOrder*> SimpleFillCheck;
+
+// Remember the largest ask quantity ever published at one price
+class PublishedAskCheck : public DepthListener<DepthBook>
+{
+public:
+  PublishedAskCheck(Price price) : price_(price), max_qty_(0), changes_(0) {}
+  virtual void on_depth_change(const DepthBook* ,
+                               const DepthBook::DepthTracker* depth)
+  {
+    ++changes_;
+    const DepthLevel* ask = depth->asks();
+    for (int level = 0; level < 5; ++level, ++ask) {
+      if (ask->price() == price_) {
+        max_qty_ = (std::max)(max_qty_, ask->aggregate_qty());
+      }
+    }
+  }
+  Price price_;
+  Quantity max_qty_;
+  int changes_;
+};
+
+BOOST_AUTO_TEST_CASE(TestIcebergShowsDisplayQty)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder ask0(false, 1251, 1000);
+  SimpleOrder ask1(false, 1251, 100);
+  SimpleOrder bid0(true,  1250, 100);
+
+  BOOST_CHECK(add_iceberg_and_verify(order_book, &ask0, 200, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+
+  // Book keeps the whole order, depth shows one slice of it
+  BOOST_CHECK_EQUAL(2, order_book.asks().size());
+  BOOST_CHECK_EQUAL(1000, ask0.open_qty());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_ask(1251, 2, 300));
+  BOOST_CHECK(dc.verify_bid(1250, 1, 100));
+}
+
+BOOST_AUTO_TEST_CASE(TestIcebergRefillsAtBackOfQueue)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder ask0(false, 1250, 300);
+  SimpleOrder ask1(false, 1250, 100);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1250, 100);
+
+  BOOST_CHECK(add_iceberg_and_verify(order_book, &ask0, 100, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+
+  // Displayed slice trades, the next slice goes behind ask1
+  {
+    SimpleFillCheck fc0(&ask0, 100, 125000);
+    SimpleFillCheck fc1(&ask1, 0, 0);
+    SimpleFillCheck fc2(&bid0, 100, 125000);
+    BOOST_CHECK(add_and_verify(order_book, &bid0, true, true));
+  }
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_ask(1250, 2, 200));
+
+  // So ask1 trades next
+  {
+    SimpleFillCheck fc0(&ask0, 0, 0);
+    SimpleFillCheck fc1(&ask1, 100, 125000);
+    SimpleFillCheck fc2(&bid1, 100, 125000);
+    BOOST_CHECK(add_and_verify(order_book, &bid1, true, true));
+  }
+  dc.reset();
+  BOOST_CHECK(dc.verify_ask(1250, 1, 100));
+  BOOST_CHECK_EQUAL(1, order_book.asks().size());
+  BOOST_CHECK_EQUAL(200, ask0.open_qty());
+}
+
+BOOST_AUTO_TEST_CASE(TestIcebergSweptThroughRefills)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder ask0(false, 1250, 300);
+  SimpleOrder ask1(false, 1251, 100);
+  SimpleOrder bid0(true,  1251, 350);
+
+  BOOST_CHECK(add_iceberg_and_verify(order_book, &ask0, 100, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+
+  // Every slice at the better price trades before the next level
+  {
+    SimpleFillCheck fc0(&ask0, 300, 300 * 1250);
+    SimpleFillCheck fc1(&ask1, 50, 50 * 1251);
+    SimpleFillCheck fc2(&bid0, 350, 300 * 1250 + 50 * 1251);
+    BOOST_CHECK(add_and_verify(order_book, &bid0, true, true));
+  }
+  BOOST_CHECK_EQUAL(1, order_book.asks().size());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_ask(1251, 1, 50));
+}
+
+BOOST_AUTO_TEST_CASE(TestIcebergInboundTradesWholeQty)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 500);
+  SimpleOrder ask0(false, 1250, 1000);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+
+  // The reserve is only hidden once the order rests
+  {
+    SimpleFillCheck fc0(&bid0, 500, 500 * 1250);
+    SimpleFillCheck fc1(&ask0, 500, 500 * 1250);
+    BOOST_CHECK(add_iceberg_and_verify(order_book, &ask0, 100, true));
+  }
+  BOOST_CHECK_EQUAL(0, order_book.bids().size());
+  BOOST_CHECK_EQUAL(1, order_book.asks().size());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_ask(1250, 1, 100));
+  BOOST_CHECK(dc.verify_bid(0, 0, 0));
+}
+
+BOOST_AUTO_TEST_CASE(TestIcebergDepthNeverShowsReserve)
+{
+  SimpleOrderBook order_book;
+  PublishedAskCheck published(1250);
+  order_book.set_depth_listener(&published);
+  SimpleOrder bid0(true,  1250, 150);
+  SimpleOrder ask0(false, 1250, 1000);
+  SimpleOrder bid1(true,  1250, 250);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_iceberg_and_verify(order_book, &ask0, 100, true));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, true, true));
+  BOOST_CHECK(replace_and_verify(order_book, &ask0, 400, 1251));
+  BOOST_CHECK(replace_and_verify(order_book, &ask0, 0, 1250));
+  BOOST_CHECK_EQUAL(1000, ask0.open_qty());
+
+  BOOST_CHECK(published.changes_ > 0);
+  BOOST_CHECK_EQUAL(100, published.max_qty_);
+}
+
+BOOST_AUTO_TEST_CASE(TestIcebergReplace)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder ask0(false, 1252, 500);
+  SimpleOrder ask1(false, 1252, 100);
+
+  BOOST_CHECK(add_iceberg_and_verify(order_book, &ask0, 100, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+
+  // Size changes come out of the reserve
+  BOOST_CHECK(replace_and_verify(order_book, &ask0, 500));
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_ask(1252, 2, 200));
+
+  BOOST_CHECK(replace_and_verify(order_book, &ask0, -950));
+  dc.reset();
+  BOOST_CHECK(dc.verify_ask(1252, 2, 150));
+
+  BOOST_CHECK(replace_and_verify(order_book, &ask0, 0, 1253));
+  dc.reset();
+  BOOST_CHECK(dc.verify_ask(1252, 1, 100));
+  BOOST_CHECK(dc.verify_ask(1253, 1, 50));
+
+  // Removing the whole order cancels it
+  BOOST_CHECK(replace_and_verify(order_book, &ask0, -50, PRICE_UNCHANGED,
+                                 simple::os_cancelled));
+  dc.reset();
+  BOOST_CHECK(dc.verify_ask(1252, 1, 100));
+  BOOST_CHECK(dc.verify_ask(0, 0, 0));
+}
+
+BOOST_AUTO_TEST_CASE(TestIcebergCancel)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder ask0(false, 1252, 500);
+
+  BOOST_CHECK(add_iceberg_and_verify(order_book, &ask0, 100, false));
+  BOOST_CHECK(cancel_and_verify(order_book, &ask0, simple::os_cancelled));
+  BOOST_CHECK_EQUAL(0, order_book.asks().size());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_ask(0, 0, 0));
+}
+
+BOOST_AUTO_TEST_CASE(TestIcebergRejects)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder ask0(false, 1252, 500);
+  SimpleOrder ask1(false, 1252, 500);
+  SimpleOrder ask2(false, 1252, 500, 1253);
+
+  // Rejected orders never leave the new state
+  BOOST_CHECK(!order_book.add_iceberg(&ask0, 0));
+  BOOST_CHECK_EQUAL(simple::os_new, ask0.state());
+  BOOST_CHECK(!order_book.add_iceberg(&ask1, 100, oc_all_or_none));
+  BOOST_CHECK_EQUAL(simple::os_new, ask1.state());
+  BOOST_CHECK(!order_book.add_iceberg(&ask2, 100));
+  BOOST_CHECK_EQUAL(simple::os_new, ask2.state());
+  BOOST_CHECK_EQUAL(0, order_book.asks().size());
+}
+
+BOOST_AUTO_TEST_CASE(TestIcebergBbo)
+{
+  SimpleBboOrderBook order_book;
+  SimpleOrder ask0(false, 1250, 300);
+  SimpleOrder bid0(true,  1250, 150);
+
+  BOOST_CHECK(add_iceberg_and_verify(order_book, &ask0, 100, false));
+  DepthCheck<SimpleBboOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_ask(1250, 1, 100));
+
+  {
+    SimpleFillCheck fc0(&ask0, 150, 150 * 1250);
+    SimpleFillCheck fc1(&bid0, 150, 150 * 1250);
+    BOOST_CHECK(add_and_verify(order_book, &bid0, true, true));
+  }
+  dc.reset();
+  BOOST_CHECK(dc.verify_ask(1250, 1, 50));
+}
+
+} // namespace liquibook
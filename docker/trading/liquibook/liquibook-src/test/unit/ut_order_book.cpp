@@ -2562,6 +2562,37 @@ BOOST_AUTO_TEST_CASE(TestReplaceBidMatch)
   BOOST_CHECK(cc.verify_ask_changed(true, false, false, false, false));
 }
 
+BOOST_AUTO_TEST_CASE(TestReplacePartiallyFilledBidMatch)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder ask1(false, 1253, 100);
+  SimpleOrder ask0(false, 1250, 100);
+  SimpleOrder bid0(true,  1250, 300);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+  // Partially fill the bid
+  {
+    SimpleFillCheck fc0(&bid0, 100, 100 * 1250);
+    SimpleFillCheck fc1(&ask0, 100, 100 * 1250);
+    BOOST_CHECK(add_and_verify(order_book, &ask0, true, true));
+  }
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1250, 1, 200));
+
+  // Depth must move the open quantity, not the order quantity
+  {
+    SimpleFillCheck fc0(&bid0, 100, 100 * 1253);
+    SimpleFillCheck fc1(&ask1, 100, 100 * 1253);
+    BOOST_CHECK(replace_and_verify(order_book, &bid0, SIZE_UNCHANGED, 1253,
+                  simple::os_accepted, 100));
+  }
+  dc.reset();
+  BOOST_CHECK(dc.verify_bid(1253, 1, 100));
+  BOOST_CHECK(dc.verify_bid(   0, 0,   0));
+  BOOST_CHECK(dc.verify_ask(   0, 0,   0));
+}
+
 BOOST_AUTO_TEST_CASE(TestReplaceAskMatch)
 {
   SimpleOrderBook order_book;
@@ -0,0 +1,297 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+#define BOOST_TEST_NO_MAIN LiquibookTest
+#include <boost/test/unit_test.hpp>
+
+#include "ut_utils.h"
+
+namespace liquibook {
+
+using simple::SimpleOrder;
+typedef FillCheck<SimpleOrder*> SimpleFillCheck;
+
+BOOST_AUTO_TEST_CASE(TestPrimaryPegFollowsBestPrice)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1252, 100);
+  SimpleOrder ask0(false, 1256, 100);
+  SimpleOrder ask1(false, 1255, 100);
+  SimpleOrder peg0(true,  1260, 200);
+  SimpleOrder peg1(false, 1240, 300);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg0, peg_primary, 0, 1250));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg1, peg_primary, 1, 1257));
+
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1250, 2, 300));
+  BOOST_CHECK(dc.verify_ask(1256, 1, 100));
+  BOOST_CHECK(dc.verify_ask(1257, 1, 300));
+
+  // Better prices move the pegs
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+  BOOST_CHECK_EQUAL(1252, peg0.price());
+  BOOST_CHECK_EQUAL(1256, peg1.price());
+  dc.reset();
+  BOOST_CHECK(dc.verify_bid(1252, 2, 300));
+  BOOST_CHECK(dc.verify_bid(1250, 1, 100));
+  BOOST_CHECK(dc.verify_ask(1255, 1, 100));
+  BOOST_CHECK(dc.verify_ask(1256, 2, 400));
+
+  // And so do worse ones
+  BOOST_CHECK(cancel_and_verify(order_book, &bid1, simple::os_cancelled));
+  BOOST_CHECK_EQUAL(1250, peg0.price());
+  dc.reset();
+  BOOST_CHECK(dc.verify_bid(1250, 2, 300));
+}
+
+BOOST_AUTO_TEST_CASE(TestMidpointPeg)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder ask0(false, 1256, 100);
+  SimpleOrder ask1(false, 1254, 100);
+  SimpleOrder peg0(true,  1260, 100);
+  SimpleOrder peg1(false, 1240, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg0, peg_midpoint, 0, 1253));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg1, peg_midpoint, 0, 1254));
+
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+  BOOST_CHECK_EQUAL(1252, peg0.price());
+  BOOST_CHECK_EQUAL(1253, peg1.price());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1252, 1, 100));
+  BOOST_CHECK(dc.verify_bid(1250, 1, 100));
+  BOOST_CHECK(dc.verify_ask(1253, 1, 100));
+  BOOST_CHECK(dc.verify_ask(1254, 1, 100));
+  BOOST_CHECK(dc.verify_ask(1256, 1, 100));
+}
+
+BOOST_AUTO_TEST_CASE(TestPegGroupMovesToBackOfLevel)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1251, 100);
+  SimpleOrder peg0(true,  1260, 100);
+  SimpleOrder peg1(true,  1260, 100);
+  SimpleOrder ask0(false, 1251, 150);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg0, peg_primary, 0, 1250));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg1, peg_primary, 0, 1250));
+
+  // The group moves behind bid1, in its own order
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK_EQUAL(1251, peg0.price());
+  BOOST_CHECK_EQUAL(1251, peg1.price());
+  {
+    SimpleFillCheck fc0(&bid1, 100, 1251 * 100);
+    SimpleFillCheck fc1(&peg0, 50, 1251 * 50);
+    SimpleFillCheck fc2(&peg1, 0, 0);
+    SimpleFillCheck fc3(&ask0, 150, 1251 * 150);
+    BOOST_CHECK(add_and_verify(order_book, &ask0, true, true));
+  }
+
+  // bid1 traded away, so the pegs follow bid0 back down
+  BOOST_CHECK_EQUAL(1250, peg0.price());
+  BOOST_CHECK_EQUAL(1250, peg1.price());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1250, 3, 250));
+}
+
+BOOST_AUTO_TEST_CASE(TestPegOffsetAndLimit)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1254, 100);
+  SimpleOrder peg0(true,  1251, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg0, peg_primary, 2, 1248));
+
+  // Never past the order's own price
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK_EQUAL(1251, peg0.price());
+}
+
+BOOST_AUTO_TEST_CASE(TestPegRepricingPublishesOnce)
+{
+  SimpleOrderBook order_book;
+  DepthChangeCounter counter;
+  order_book.set_depth_listener(&counter);
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1252, 100);
+  SimpleOrder ask0(false, 1256, 100);
+  SimpleOrder peg0(true,  1260, 100);
+  SimpleOrder peg1(true,  1260, 100);
+  SimpleOrder peg2(false, 1240, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg0, peg_primary, 0, 1250));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg1, peg_midpoint, 0, 1253));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg2, peg_midpoint, 0, 1254));
+
+  // Every peg moves, and the change is published once
+  counter.changes_ = 0;
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK_EQUAL(1, counter.changes_);
+  BOOST_CHECK_EQUAL(1252, peg0.price());
+  BOOST_CHECK_EQUAL(1254, peg1.price());
+  BOOST_CHECK_EQUAL(1255, peg2.price());
+}
+
+BOOST_AUTO_TEST_CASE(TestPegKeepsPriceWithoutReference)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1248, 100);
+  SimpleOrder peg0(true,  1260, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg0, peg_primary, 0, 1250));
+  BOOST_CHECK(cancel_and_verify(order_book, &bid0, simple::os_cancelled));
+  BOOST_CHECK_EQUAL(1250, peg0.price());
+
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK_EQUAL(1248, peg0.price());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1248, 2, 200));
+}
+
+BOOST_AUTO_TEST_CASE(TestPegReplaceAndCancel)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1251, 100);
+  SimpleOrder peg0(true,  1260, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg0, peg_primary, 0, 1250));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+
+  // Size may change, price may not
+  BOOST_CHECK(replace_and_verify(order_book, &peg0, 50));
+  order_book.replace(&peg0, 0, 1249);
+  BOOST_CHECK_EQUAL(1251, peg0.price());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1251, 2, 250));
+
+  BOOST_CHECK(cancel_and_verify(order_book, &peg0, simple::os_cancelled));
+  dc.reset();
+  BOOST_CHECK(dc.verify_bid(1251, 1, 100));
+  BOOST_CHECK(dc.verify_bid(1250, 1, 100));
+}
+
+BOOST_AUTO_TEST_CASE(TestPegFollowsReplacedOrders)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder bid1(true,  1252, 100);
+  SimpleOrder peg0(true,  1260, 100);
+
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  BOOST_CHECK(add_and_verify(order_book, &bid1, false));
+  BOOST_CHECK(add_pegged_and_verify(order_book, &peg0, peg_primary, 0, 1252));
+
+  // The best bid moves away, and the peg goes with it
+  BOOST_CHECK(replace_and_verify(order_book, &bid1, 0, 1249));
+  BOOST_CHECK_EQUAL(1250, peg0.price());
+  BOOST_CHECK(replace_and_verify(order_book, &bid0, 50));
+  BOOST_CHECK_EQUAL(1250, peg0.price());
+  BOOST_CHECK(replace_and_verify(order_book, &bid1, 0, 1251));
+  BOOST_CHECK_EQUAL(1251, peg0.price());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bid(1251, 2, 200));
+  BOOST_CHECK(dc.verify_bid(1250, 1, 150));
+}
+
+BOOST_AUTO_TEST_CASE(TestPegReportsFill)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1252, 300);
+  SimpleOrder ask0(false, 1251, 100);
+  SimpleOrder peg0(false, 1240, 300);
+
+  // An all or none bid rests across a smaller ask
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false, false, oc_all_or_none));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+
+  // Following that ask, the pegged order fills the bid as it is added
+  {
+    SimpleFillCheck fc0(&bid0, 300, 300 * 1252);
+    SimpleFillCheck fc1(&peg0, 300, 300 * 1252);
+    BOOST_CHECK(order_book.add_pegged(&peg0, peg_primary));
+  }
+  BOOST_CHECK_EQUAL(simple::os_complete, peg0.state());
+  BOOST_CHECK_EQUAL(simple::os_complete, bid0.state());
+  BOOST_CHECK_EQUAL(0, order_book.bids().size());
+  DepthCheck<SimpleOrderBook> dc(order_book.depth());
+  BOOST_CHECK(dc.verify_bids_done());
+  BOOST_CHECK(dc.verify_ask(1251, 1, 100));
+}
+
+BOOST_AUTO_TEST_CASE(TestPegTriggersStop)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1252, 300);
+  SimpleOrder ask0(false, 1251, 100);
+  SimpleOrder ask1(false, 1260, 100);
+  SimpleOrder stop0(true, 0, 50, 1252);
+  SimpleOrder peg0(false, 1240, 300);
+  order_book.set_market_price(1245);
+
+  // A resting buy stop waits above the market
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false, false, oc_all_or_none));
+  BOOST_CHECK(add_and_verify(order_book, &ask0, false));
+  BOOST_CHECK(add_and_verify(order_book, &ask1, false));
+  BOOST_CHECK(!order_book.add(&stop0));
+  BOOST_CHECK_EQUAL(1, order_book.stopBids().size());
+
+  // The pegged order's fill trades at the stop price and sets it off
+  {
+    SimpleFillCheck fc0(&bid0, 300, 300 * 1252);
+    SimpleFillCheck fc1(&peg0, 300, 300 * 1252);
+    SimpleFillCheck fc2(&stop0, 50, 50 * 1251);
+    SimpleFillCheck fc3(&ask0, 50, 50 * 1251);
+    BOOST_CHECK(order_book.add_pegged(&peg0, peg_primary));
+  }
+  BOOST_CHECK_EQUAL(0, order_book.stopBids().size());
+  BOOST_CHECK_EQUAL(simple::os_complete, peg0.state());
+  BOOST_CHECK_EQUAL(simple::os_complete, stop0.state());
+  BOOST_CHECK_EQUAL(2, order_book.asks().size());
+}
+
+BOOST_AUTO_TEST_CASE(TestPegRejects)
+{
+  SimpleOrderBook order_book;
+  SimpleOrder bid0(true,  1250, 100);
+  SimpleOrder peg0(true,  1260, 100);
+  SimpleOrder peg1(true,  1260, 100);
+  SimpleOrder peg2(true,  1260, 100, 1255);
+  SimpleOrder peg3(true,  0, 100);
+
+  // Rejected orders never leave the new state
+  order_book.add_pegged(&peg0, peg_primary);
+  BOOST_CHECK_EQUAL(simple::os_new, peg0.state());
+  BOOST_CHECK(add_and_verify(order_book, &bid0, false));
+  order_book.add_pegged(&peg0, peg_midpoint);
+  BOOST_CHECK_EQUAL(simple::os_new, peg0.state());
+  order_book.add_pegged(&peg1, peg_primary, 0, oc_immediate_or_cancel);
+  BOOST_CHECK_EQUAL(simple::os_new, peg1.state());
+  order_book.add_pegged(&peg2, peg_primary);
+  BOOST_CHECK_EQUAL(simple::os_new, peg2.state());
+  order_book.add_pegged(&peg3, peg_primary);
+  BOOST_CHECK_EQUAL(simple::os_new, peg3.state());
+  BOOST_CHECK_EQUAL(1, order_book.bids().size());
+}
+
+} // namespace liquibook
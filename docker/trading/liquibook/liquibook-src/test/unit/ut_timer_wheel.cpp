@@ -0,0 +1,160 @@
+// Copyright (c) 2017 Object Computing, Inc.
+// All rights reserved.
+// See the file license.txt for licensing information.
+
+#define BOOST_TEST_NO_MAIN LiquibookTest
+#include <boost/test/unit_test.hpp>
+
+#include <book/timer_wheel.h>
+
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace liquibook {
+
+using book::Timestamp;
+using book::TimerId;
+typedef book::TimerWheel<int> IntWheel;
+
+// Record what expires, and when
+class ExpiryLog
+{
+public:
+  ExpiryLog(const IntWheel& wheel) : wheel_(wheel) {}
+  void operator()(int value)
+  {
+    values_.push_back(value);
+    times_.push_back(wheel_.now());
+  }
+  const IntWheel& wheel_;
+  std::vector<int> values_;
+  std::vector<Timestamp> times_;
+};
+
+BOOST_AUTO_TEST_CASE(TestTimerWheelExpiresInOrder)
+{
+  IntWheel wheel(1000);
+  wheel.insert(1005, 2);
+  wheel.insert(1001, 0);
+  wheel.insert(1003, 1);
+  wheel.insert(1005, 3);
+  BOOST_CHECK_EQUAL(4, wheel.size());
+
+  ExpiryLog log(wheel);
+  wheel.advance(1004, std::ref(log));
+  BOOST_CHECK_EQUAL(2, log.values_.size());
+  BOOST_CHECK_EQUAL(1004, wheel.now());
+
+  // Timers due at the same time expire in order of insertion
+  wheel.advance(1005, std::ref(log));
+  BOOST_REQUIRE_EQUAL(4, log.values_.size());
+  for (int value = 0; value < 4; ++value) {
+    BOOST_CHECK_EQUAL(value, log.values_[value]);
+  }
+  BOOST_CHECK_EQUAL(1001, log.times_[0]);
+  BOOST_CHECK_EQUAL(1003, log.times_[1]);
+  BOOST_CHECK_EQUAL(1005, log.times_[3]);
+  BOOST_CHECK(wheel.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestTimerWheelCascadesFromHigherLevels)
+{
+  IntWheel wheel;
+  const Timestamp expiries[] = {
+    255, 256, 257, 65535, 65536, 70000, Timestamp(1) << 40,
+    (Timestamp(1) << 40) + 1, UINT64_MAX };
+  const int count = sizeof(expiries) / sizeof(expiries[0]);
+  for (int value = count - 1; value >= 0; --value) {
+    wheel.insert(expiries[value], value);
+  }
+
+  ExpiryLog log(wheel);
+  wheel.advance(UINT64_MAX, std::ref(log));
+  BOOST_REQUIRE_EQUAL(count, log.values_.size());
+  for (int value = 0; value < count; ++value) {
+    BOOST_CHECK_EQUAL(value, log.values_[value]);
+    BOOST_CHECK_EQUAL(expiries[value], log.times_[value]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestTimerWheelRemove)
+{
+  IntWheel wheel;
+  TimerId timer0 = wheel.insert(10, 0);
+  TimerId timer1 = wheel.insert(70000, 1);
+  TimerId timer2 = wheel.insert(70000, 2);
+  wheel.update(timer2, 20);
+  BOOST_CHECK_EQUAL(20, wheel.value(timer2));
+  BOOST_CHECK_EQUAL(70000, wheel.expiry(timer1));
+
+  wheel.remove(timer0);
+  wheel.remove(timer1);
+  BOOST_CHECK_EQUAL(1, wheel.size());
+  BOOST_CHECK_THROW(wheel.remove(timer1), std::runtime_error);
+
+  // Removed timers are reused
+  TimerId timer3 = wheel.insert(300, 3);
+  BOOST_CHECK(timer3 == timer0 || timer3 == timer1);
+
+  ExpiryLog log(wheel);
+  wheel.advance(100000, std::ref(log));
+  BOOST_REQUIRE_EQUAL(2, log.values_.size());
+  BOOST_CHECK_EQUAL(3, log.values_[0]);
+  BOOST_CHECK_EQUAL(20, log.values_[1]);
+  BOOST_CHECK_EQUAL(100000, wheel.now());
+}
+
+BOOST_AUTO_TEST_CASE(TestTimerWheelRejectsPast)
+{
+  IntWheel wheel(500);
+  BOOST_CHECK_THROW(wheel.insert(500, 0), std::runtime_error);
+  BOOST_CHECK_THROW(wheel.insert(499, 0), std::runtime_error);
+  BOOST_CHECK(wheel.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestTimerWheelMatchesSortedOrder)
+{
+  IntWheel wheel(12345);
+  std::multimap<Timestamp, int> expected;
+  std::vector<TimerId> timers;
+  uint64_t seed = 88172645463325252ull;
+  for (int value = 0; value < 20000; ++value) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    // Spread the expiries over several levels
+    Timestamp expiry = 12346 + seed % (Timestamp(1) << (8 + value % 24));
+    timers.push_back(wheel.insert(expiry, value));
+    expected.insert(std::make_pair(expiry, value));
+  }
+  // Take every third one out again
+  for (size_t index = 0; index < timers.size(); index += 3) {
+    Timestamp expiry = wheel.expiry(timers[index]);
+    auto range = expected.equal_range(expiry);
+    for (auto pos = range.first; pos != range.second; ++pos) {
+      if (pos->second == int(index)) {
+        expected.erase(pos);
+        break;
+      }
+    }
+    wheel.remove(timers[index]);
+  }
+  BOOST_CHECK_EQUAL(expected.size(), wheel.size());
+
+  // Advance in uneven steps
+  ExpiryLog log(wheel);
+  Timestamp to = 12345;
+  while (!wheel.empty()) {
+    to += 1 + to % 9973;
+    wheel.advance(to, std::ref(log));
+  }
+  BOOST_REQUIRE_EQUAL(expected.size(), log.values_.size());
+  size_t index = 0;
+  for (auto pos = expected.begin(); pos != expected.end(); ++pos, ++index) {
+    BOOST_CHECK_EQUAL(pos->first, log.times_[index]);
+    BOOST_CHECK_EQUAL(pos->second, log.values_[index]);
+  }
+}
+
+} // namespace liquibook
@@ -15,15 +15,30 @@ namespace liquibook {
 
 typedef simple::SimpleOrderBook<5> SimpleOrderBook;
 typedef simple::SimpleOrderBook<5>::DepthTracker SimpleDepth;
+typedef book::DepthOrderBook<simple::SimpleOrder*, 5> DepthBook;
 
-template <class OrderBook, class OrderPtr>
-bool add_and_verify(OrderBook& order_book,
-                    const OrderPtr& order,
-                    const bool match_expected,
-                    const bool complete_expected = false,
-                    OrderConditions conditions = 0)
+// Count the depth changes a book publishes
+class DepthChangeCounter : public DepthListener<DepthBook>
+{
+public:
+  DepthChangeCounter() : changes_(0) {}
+  virtual void on_depth_change(const DepthBook* ,
+                               const DepthBook::DepthTracker* )
+  {
+    ++changes_;
+  }
+  int changes_;
+};
+
+// Whether an add matched as expected, and left the order in the
+// expected state
+template <class OrderPtr>
+bool verify_add(const OrderPtr& order,
+                const bool matched,
+                const bool match_expected,
+                const bool complete_expected = false,
+                OrderConditions conditions = 0)
 {
-  const bool matched = order_book.add(order, conditions);
   if (matched == match_expected) {
     if (complete_expected) {
       // State should be complete
@@ -40,6 +55,61 @@ bool add_and_verify(OrderBook& order_book,
   }
 }
 
+template <class OrderBook, class OrderPtr>
+bool add_and_verify(OrderBook& order_book,
+                    const OrderPtr& order,
+                    const bool match_expected,
+                    const bool complete_expected = false,
+                    OrderConditions conditions = 0)
+{
+  const bool matched = order_book.add(order, conditions);
+  return verify_add(order, matched, match_expected, complete_expected,
+                    conditions);
+}
+
+template <class OrderBook, class OrderPtr>
+bool add_iceberg_and_verify(OrderBook& order_book,
+                            const OrderPtr& order,
+                            Quantity display_qty,
+                            const bool match_expected,
+                            const bool complete_expected = false)
+{
+  const bool matched = order_book.add_iceberg(order, display_qty);
+  return verify_add(order, matched, match_expected, complete_expected);
+}
+
+template <class OrderBook, class OrderPtr>
+bool add_good_till_and_verify(OrderBook& order_book,
+                              const OrderPtr& order,
+                              Timestamp expiry,
+                              const bool match_expected,
+                              const bool complete_expected = false)
+{
+  const bool matched = order_book.add_good_till(order, expiry);
+  return verify_add(order, matched, match_expected, complete_expected);
+}
+
+// A pegged order can trade on entry against resting all or none interest,
+// but is never repriced into a cross; here one is expected to rest at
+// expected_price
+template <class OrderBook, class OrderPtr>
+bool add_pegged_and_verify(OrderBook& order_book,
+                           const OrderPtr& order,
+                           PegType peg_type,
+                           Price offset,
+                           Price expected_price)
+{
+  const bool matched = order_book.add_pegged(order, peg_type, offset);
+  if (!verify_add(order, matched, false)) {
+    std::cout << "State " << order->state() << std::endl;
+    return false;
+  }
+  if (order->price() != expected_price) {
+    std::cout << "Price " << order->price() << std::endl;
+    return false;
+  }
+  return true;
+}
 
 template <class OrderBook, class OrderPtr>
 bool cancel_and_verify(OrderBook& order_book,
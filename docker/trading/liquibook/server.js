@@ -1,9 +1,15 @@
 const express = require('express');
 const cors = require('cors');
-const { OrderBook } = require('./index');
+const { OrderBook, AsyncOrderBook, Engine, Events } = require('./index');
 
 const app = express();
 const port = process.env.PORT || 8080;
+// Match on native threads so a long sweep does not stall other requests
+const asyncMatching = process.env.LIQUIBOOK_ASYNC === '1' && AsyncOrderBook;
+// Otherwise one native engine owns every book; batches spread over this
+// many worker threads
+const engine = !asyncMatching && Engine ?
+  new Engine(parseInt(process.env.LIQUIBOOK_ENGINE_THREADS || '0', 10)) : null;
 
 // Middleware
 app.use(cors());
@@ -12,14 +18,46 @@ app.use(express.json());
 // Store multiple order books by symbol
 const orderBooks = new Map();
 
+// Execution event streams and the recent trades drained from them
+const eventStreams = new Map();
+const RECENT_TRADES = 100;
+
 // Helper function to get or create order book
 function getOrderBook(symbol = 'default') {
   if (!orderBooks.has(symbol)) {
-    orderBooks.set(symbol, new OrderBook(symbol));
+    const orderBook = engine ? engine.book(symbol) :
+      asyncMatching ? new AsyncOrderBook(symbol) : new OrderBook(symbol);
+    if (typeof orderBook.attachEvents === 'function') {
+      eventStreams.set(symbol, { stream: orderBook.attachEvents(), trades: [], gaps: 0 });
+    }
+    orderBooks.set(symbol, orderBook);
   }
   return orderBooks.get(symbol);
 }
 
+// Move pending execution events into the recent trades of a symbol
+function drainEvents(symbol) {
+  const entry = eventStreams.get(symbol);
+  if (!entry) {
+    return null;
+  }
+  entry.stream.drain((records, i) => {
+    if (records[i + 1] === Events.FILL) {
+      entry.trades.push({
+        seq: records[i],
+        orderId: records[i + 2],
+        matchedOrderId: records[i + 3],
+        quantity: records[i + 4],
+        price: records[i + 5]
+      });
+    }
+  }, Infinity, () => ++entry.gaps);
+  if (entry.trades.length > RECENT_TRADES) {
+    entry.trades.splice(0, entry.trades.length - RECENT_TRADES);
+  }
+  return entry;
+}
+
 // Health check endpoint
 app.get('/health', (req, res) => {
   res.json({ 
@@ -27,7 +65,7 @@ app.get('/health', (req, res) => {
     service: 'liquibook-orderbook',
     version: '1.0.0',
     timestamp: new Date().toISOString(),
-    activeOrderBooks: Array.from(orderBooks.keys())
+    activeOrderBooks: engine ? engine.symbols() : Array.from(orderBooks.keys())
   });
 });
 
@@ -36,6 +74,10 @@ app.get('/orderbook/:symbol?', (req, res) => {
   try {
     const symbol = req.params.symbol || 'default';
     const orderBook = getOrderBook(symbol);
+    // Serialized natively when the book can, skipping JS objects entirely
+    if (orderBook.getDepthJson) {
+      return res.type('json').send(orderBook.getDepthJson(new Date().toISOString()));
+    }
     const depth = orderBook.getDepth();
     
     res.json({
@@ -52,11 +94,17 @@ app.get('/orderbook/:symbol?', (req, res) => {
 });
 
 // Get full order book
-app.get('/orderbook/:symbol/full', (req, res) => {
+app.get('/orderbook/:symbol/full', async (req, res) => {
   try {
     const symbol = req.params.symbol;
     const orderBook = getOrderBook(symbol);
-    const fullBook = orderBook.getOrderBook();
+    if (orderBook.getOrderBookJson) {
+      return res.type('json').send(orderBook.getOrderBookJson(new Date().toISOString()));
+    }
+    if (!orderBook.getOrderBook) {
+      return res.status(501).json({ error: 'The full order book is not available for this order book' });
+    }
+    const fullBook = await orderBook.getOrderBook();
     
     res.json({
       symbol,
@@ -71,8 +119,105 @@ app.get('/orderbook/:symbol/full', (req, res) => {
   }
 });
 
+// Get aggregated price levels over the whole book: ?from=0&count=20
+app.get('/orderbook/:symbol/levels', (req, res) => {
+  try {
+    const symbol = req.params.symbol;
+    const from = parseInt(req.query.from || '0', 10);
+    const count = parseInt(req.query.count || '20', 10);
+    if (isNaN(from) || from < 0 || isNaN(count) || count < 0) {
+      return res.status(400).json({ error: 'from and count must be non-negative numbers' });
+    }
+
+    const orderBook = getOrderBook(symbol);
+    if (!orderBook.getLevelsJson) {
+      return res.status(501).json({ error: 'Price levels are not available for this order book' });
+    }
+    res.type('json').send(orderBook.getLevelsJson(from, count, new Date().toISOString()));
+  } catch (error) {
+    res.status(500).json({ 
+      error: 'Failed to get price levels', 
+      message: error.message 
+    });
+  }
+});
+
+// Get the depth levels changed since a version: ?since=<version>
+app.get('/orderbook/:symbol/changes', (req, res) => {
+  try {
+    const symbol = req.params.symbol;
+    const since = parseInt(req.query.since || '0', 10);
+    if (isNaN(since) || since < 0) {
+      return res.status(400).json({ error: 'since must be a non-negative number' });
+    }
+
+    const orderBook = getOrderBook(symbol);
+    if (!orderBook.getDepthSince) {
+      return res.status(501).json({ error: 'Depth changes are not available for this order book' });
+    }
+    res.json({
+      symbol,
+      timestamp: new Date().toISOString(),
+      changes: orderBook.getDepthSince(since)
+    });
+  } catch (error) {
+    res.status(500).json({ 
+      error: 'Failed to get depth changes', 
+      message: error.message 
+    });
+  }
+});
+
+// Get spread, mid, microprice and imbalance of the visible depth
+app.get('/orderbook/:symbol/analytics', async (req, res) => {
+  try {
+    const symbol = req.params.symbol;
+    const orderBook = getOrderBook(symbol);
+    if (!orderBook.getAnalytics) {
+      return res.status(501).json({ error: 'Analytics are not available for this order book' });
+    }
+    const analytics = await orderBook.getAnalytics();
+    
+    res.json({
+      symbol,
+      timestamp: new Date().toISOString(),
+      analytics
+    });
+  } catch (error) {
+    res.status(500).json({ 
+      error: 'Failed to get order book analytics', 
+      message: error.message 
+    });
+  }
+});
+
+// Get recent trades from the execution event stream
+app.get('/orderbook/:symbol/trades', (req, res) => {
+  try {
+    const symbol = req.params.symbol;
+    getOrderBook(symbol);
+    const entry = drainEvents(symbol);
+    if (!entry) {
+      return res.status(501).json({ error: 'Execution events are not available for this order book' });
+    }
+    
+    res.json({
+      symbol,
+      timestamp: new Date().toISOString(),
+      trades: entry.trades,
+      gaps: entry.gaps,
+      dropped: entry.stream.dropped()
+    });
+  } catch (error) {
+    res.status(500).json({ 
+      error: 'Failed to get trades', 
+      message: error.message 
+    });
+  }
+});
+
 // Add order
-app.post('/orderbook/:symbol/orders', (req, res) => {
+app.post('/orderbook/:symbol/orders', async (req, res) => {
   try {
     const symbol = req.params.symbol;
     const { 
@@ -96,11 +241,12 @@ app.post('/orderbook/:symbol/orders', (req, res) => {
     }
 
     const orderBook = getOrderBook(symbol);
-    const result = orderBook.addOrder(isBuy, price, quantity, stopPrice, allOrNone, immediateOrCancel);
+    const result = await orderBook.addOrder(isBuy, price, quantity, stopPrice, allOrNone, immediateOrCancel);
+    drainEvents(symbol);
     
     res.json({
       symbol,
-      orderId: result.orderId || result,
+      orderId: result.orderId,
       status: 'added',
       timestamp: new Date().toISOString(),
       order: {
@@ -121,7 +267,7 @@ app.post('/orderbook/:symbol/orders', (req, res) => {
 });
 
 // Cancel order
-app.delete('/orderbook/:symbol/orders/:orderId', (req, res) => {
+app.delete('/orderbook/:symbol/orders/:orderId', async (req, res) => {
   try {
     const symbol = req.params.symbol;
     const orderId = parseInt(req.params.orderId);
@@ -131,7 +277,11 @@ app.delete('/orderbook/:symbol/orders/:orderId', (req, res) => {
     }
 
     const orderBook = getOrderBook(symbol);
-    const result = orderBook.cancelOrder(orderId);
+    if (!orderBook.cancelOrder) {
+      return res.status(501).json({ error: 'Cancel is not available for this order book' });
+    }
+    const result = await orderBook.cancelOrder(orderId);
+    drainEvents(symbol);
     
     res.json({
       symbol,
@@ -149,7 +299,7 @@ app.delete('/orderbook/:symbol/orders/:orderId', (req, res) => {
 });
 
 // Replace order
-app.put('/orderbook/:symbol/orders/:orderId', (req, res) => {
+app.put('/orderbook/:symbol/orders/:orderId', async (req, res) => {
   try {
     const symbol = req.params.symbol;
     const orderId = parseInt(req.params.orderId);
@@ -166,7 +316,11 @@ app.put('/orderbook/:symbol/orders/:orderId', (req, res) => {
     }
 
     const orderBook = getOrderBook(symbol);
-    const result = orderBook.replaceOrder(orderId, sizeDelta, newPrice);
+    if (!orderBook.replaceOrder) {
+      return res.status(501).json({ error: 'Replace is not available for this order book' });
+    }
+    const result = await orderBook.replaceOrder(orderId, sizeDelta, newPrice);
+    drainEvents(symbol);
     
     res.json({
       symbol,
@@ -186,7 +340,7 @@ app.put('/orderbook/:symbol/orders/:orderId', (req, res) => {
 });
 
 // Set market price
-app.post('/orderbook/:symbol/market-price', (req, res) => {
+app.post('/orderbook/:symbol/market-price', async (req, res) => {
   try {
     const symbol = req.params.symbol;
     const { price } = req.body;
@@ -196,7 +350,8 @@ app.post('/orderbook/:symbol/market-price', (req, res) => {
     }
 
     const orderBook = getOrderBook(symbol);
-    orderBook.setMarketPrice(price);
+    await orderBook.setMarketPrice(price);
+    drainEvents(symbol);
     
     res.json({
       symbol,
@@ -212,12 +367,31 @@ app.post('/orderbook/:symbol/market-price', (req, res) => {
   }
 });
 
+// Totals and per-book stats for every book, in one native call
+app.get('/stats', (req, res) => {
+  if (!engine) {
+    return res.status(501).json({ error: 'Stats require the native engine' });
+  }
+  try {
+    res.json({
+      timestamp: new Date().toISOString(),
+      ...engine.getStats()
+    });
+  } catch (error) {
+    res.status(500).json({ 
+      error: 'Failed to get stats', 
+      message: error.message 
+    });
+  }
+});
+
 // List all active order books
 app.get('/orderbooks', (req, res) => {
   try {
-    const books = Array.from(orderBooks.keys()).map(symbol => ({
+    const symbols = engine ? engine.symbols() : Array.from(orderBooks.keys());
+    const books = symbols.map(symbol => ({
       symbol,
-      depth: orderBooks.get(symbol).getDepth()
+      depth: getOrderBook(symbol).getDepth()
     }));
     
     res.json({
@@ -256,6 +430,7 @@ app.listen(port, '0.0.0.0', () => {
   console.log(`🚀 Liquibook Order Book Service running on port ${port}`);
   console.log(`📊 Health check: http://localhost:${port}/health`);
   console.log(`📈 Order book API: http://localhost:${port}/orderbook/{symbol}`);
+  console.log(`🧵 Matching: ${asyncMatching ? 'native thread per book' : engine ? `engine, ${engine.getStats().threads} batch threads` : 'event loop'}`);
   console.log(`⚡ Service ready to handle order book operations`);
 });
 
@@ -1,9 +1,16 @@
 #include <napi.h>
+#include "addon_data.h"
 #include "order_book_wrapper.h"
+#include "async_order_book_wrapper.h"
+#include "engine_wrapper.h"
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
+  // Runs once per environment; nothing here may be static
+  env.SetInstanceData(new AddonData());
   OrderBookWrapper::Init(env, exports);
+  AsyncOrderBookWrapper::Init(env, exports);
+  EngineWrapper::Init(env, exports);
   return exports;
 }
 
-NODE_API_MODULE(liquibook, Init)
\ No newline at end of file
+NODE_API_MODULE(liquibook, Init)
@@ -0,0 +1,15 @@
+#ifndef ADDON_DATA_H
+#define ADDON_DATA_H
+
+#include <napi.h>
+
+// State of the addon for one Node environment, the main thread or a
+// worker.  Held as the environment's instance data so each worker that
+// loads the addon gets its own constructors, and freed with it.
+struct AddonData {
+  Napi::FunctionReference orderBookConstructor;
+  Napi::FunctionReference asyncOrderBookConstructor;
+  Napi::FunctionReference engineConstructor;
+};
+
+#endif // ADDON_DATA_H
@@ -0,0 +1,348 @@
+#include "async_order_book_wrapper.h"
+#include "addon_data.h"
+#include <cstring>
+
+Napi::Object AsyncOrderBookWrapper::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "AsyncOrderBook", {
+    InstanceMethod("addOrder", &AsyncOrderBookWrapper::AddOrder),
+    InstanceMethod("cancelOrder", &AsyncOrderBookWrapper::CancelOrder),
+    InstanceMethod("replaceOrder", &AsyncOrderBookWrapper::ReplaceOrder),
+    InstanceMethod("setMarketPrice", &AsyncOrderBookWrapper::SetMarketPrice),
+    InstanceMethod("getOrderBook", &AsyncOrderBookWrapper::GetOrderBook),
+    InstanceMethod("getAnalytics", &AsyncOrderBookWrapper::GetAnalytics),
+    InstanceMethod("getDepth", &AsyncOrderBookWrapper::GetDepth),
+    InstanceMethod("close", &AsyncOrderBookWrapper::Close)
+  });
+
+  env.GetInstanceData<AddonData>()->asyncOrderBookConstructor = Napi::Persistent(func);
+
+  exports.Set("AsyncOrderBook", func);
+  return exports;
+}
+
+AsyncOrderBookWrapper::AsyncOrderBookWrapper(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<AsyncOrderBookWrapper>(info),
+    stopping_(false),
+    nextSeq_(0),
+    closed_(false) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::string symbol = "default";
+  if (info.Length() > 0 && info[0].IsString()) {
+    symbol = info[0].As<Napi::String>().Utf8Value();
+  }
+
+  orderBook_ = std::make_unique<NodeOrderBook>(symbol);
+  std::memset(&snapshot_, 0, sizeof(snapshot_));
+
+  // Results are settled in C++, the JS function is never called
+  tsfn_ = Napi::ThreadSafeFunction::New(
+    env,
+    Napi::Function::New(env, [](const Napi::CallbackInfo&) {}),
+    "LiquibookMatching",
+    0,
+    1);
+  // Only keep the process alive while commands are outstanding
+  tsfn_.Unref(env);
+
+  thread_ = std::thread(&AsyncOrderBookWrapper::Run, this);
+}
+
+AsyncOrderBookWrapper::~AsyncOrderBookWrapper() {
+  Stop();
+}
+
+Napi::Value AsyncOrderBookWrapper::AddOrder(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 5) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  bool isBuy = info[0].As<Napi::Boolean>().Value();
+  uint64_t price = static_cast<uint64_t>(info[1].As<Napi::Number>().DoubleValue());
+  uint64_t quantity = static_cast<uint64_t>(info[2].As<Napi::Number>().DoubleValue());
+  uint64_t stopPrice = static_cast<uint64_t>(info[3].As<Napi::Number>().DoubleValue());
+  bool allOrNone = info[4].As<Napi::Boolean>().Value();
+  bool immediateOrCancel = info.Length() > 5 ? info[5].As<Napi::Boolean>().Value() : false;
+
+  Command command;
+  command.type = Command::add_order;
+  command.order = std::make_shared<NodeOrder>(isBuy, price, quantity, stopPrice, allOrNone, immediateOrCancel);
+  command.conditions = (allOrNone ? liquibook::book::oc_all_or_none : 0) |
+                       (immediateOrCancel ? liquibook::book::oc_immediate_or_cancel : 0);
+  command.price = price;
+  return Submit(env, command);
+}
+
+Napi::Value AsyncOrderBookWrapper::CancelOrder(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Command command;
+  command.type = Command::cancel_order;
+  command.conditions = 0;
+  if (!ReadOrderId(info[0], command.orderId)) {
+    Napi::TypeError::New(env, "Invalid order id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Submit(env, command);
+}
+
+Napi::Value AsyncOrderBookWrapper::ReplaceOrder(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Command command;
+  command.type = Command::replace_order;
+  command.conditions = 0;
+  if (!ReadOrderId(info[0], command.orderId)) {
+    Napi::TypeError::New(env, "Invalid order id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  command.sizeDelta = info[1].As<Napi::Number>().Int64Value();
+  command.price = static_cast<uint64_t>(info[2].As<Napi::Number>().DoubleValue());
+  return Submit(env, command);
+}
+
+Napi::Value AsyncOrderBookWrapper::SetMarketPrice(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Command command;
+  command.type = Command::set_market_price;
+  command.conditions = 0;
+  command.price = static_cast<uint64_t>(info[0].As<Napi::Number>().DoubleValue());
+  return Submit(env, command);
+}
+
+Napi::Value AsyncOrderBookWrapper::GetOrderBook(const Napi::CallbackInfo& info) {
+  Command command;
+  command.type = Command::get_order_book;
+  command.conditions = 0;
+  return Submit(info.Env(), command);
+}
+
+Napi::Value AsyncOrderBookWrapper::GetAnalytics(const Napi::CallbackInfo& info) {
+  Command command;
+  command.type = Command::get_analytics;
+  command.conditions = 0;
+  return Submit(info.Env(), command);
+}
+
+Napi::Value AsyncOrderBookWrapper::GetDepth(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  DepthSnapshot snapshot;
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    snapshot = snapshot_;
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  Napi::Array bids = Napi::Array::New(env);
+  Napi::Array asks = Napi::Array::New(env);
+
+  int bidIndex = 0;
+  int askIndex = 0;
+  for (int i = 0; i < DEPTH_SIZE; ++i) {
+    if (snapshot.bidPrices[i] != liquibook::book::INVALID_LEVEL_PRICE) {
+      Napi::Object bidLevel = Napi::Object::New(env);
+      bidLevel.Set("price", Napi::Number::New(env, snapshot.bidPrices[i]));
+      bidLevel.Set("quantity", Napi::Number::New(env, snapshot.bidQuantities[i]));
+      bids.Set(bidIndex++, bidLevel);
+    }
+    if (snapshot.askPrices[i] != liquibook::book::INVALID_LEVEL_PRICE) {
+      Napi::Object askLevel = Napi::Object::New(env);
+      askLevel.Set("price", Napi::Number::New(env, snapshot.askPrices[i]));
+      askLevel.Set("quantity", Napi::Number::New(env, snapshot.askQuantities[i]));
+      asks.Set(askIndex++, askLevel);
+    }
+  }
+
+  result.Set("bids", bids);
+  result.Set("asks", asks);
+  result.Set("version", Napi::Number::New(env, static_cast<double>(snapshot.version)));
+  return result;
+}
+
+Napi::Value AsyncOrderBookWrapper::Close(const Napi::CallbackInfo& info) {
+  closed_ = true;
+  // Commands already queued are still matched and their Promises settled
+  Stop();
+  return info.Env().Undefined();
+}
+
+Napi::Value AsyncOrderBookWrapper::Submit(Napi::Env env, Command& command) {
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+  if (closed_) {
+    deferred.Reject(Napi::Error::New(env, "Order book is closed").Value());
+    return deferred.Promise();
+  }
+
+  command.seq = nextSeq_++;
+  // Keep this object, and the process, alive until every result is in
+  if (pending_.empty()) {
+    Ref();
+    tsfn_.Ref(env);
+  }
+  pending_.emplace(command.seq, deferred);
+
+  {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    queue_.push_back(std::move(command));
+  }
+  queueReady_.notify_one();
+  return deferred.Promise();
+}
+
+void AsyncOrderBookWrapper::Run() {
+  std::vector<Command> batch;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(queueMutex_);
+      queueReady_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      // Stop once drained
+      if (queue_.empty()) {
+        break;
+      }
+      batch.swap(queue_);
+    }
+
+    std::vector<Result>* results = new std::vector<Result>();
+    results->reserve(batch.size());
+    for (Command& command : batch) {
+      Result result;
+      result.type = command.type;
+      result.seq = command.seq;
+      result.orderId = 0;
+      result.matched = false;
+      try {
+        Execute(command, result);
+      } catch (const std::exception& e) {
+        result.error = e.what();
+      } catch (...) {
+        result.error = "Unknown error";
+      }
+      results->push_back(std::move(result));
+    }
+    batch.clear();
+    Publish();
+
+    // One main thread callback settles the whole batch
+    napi_status status = tsfn_.BlockingCall(results,
+      [this](Napi::Env env, Napi::Function, std::vector<Result>* delivered) {
+        Deliver(env, delivered);
+      });
+    if (status != napi_ok) {
+      delete results;
+    }
+  }
+}
+
+void AsyncOrderBookWrapper::Execute(Command& command, Result& result) {
+  switch (command.type) {
+    case Command::add_order:
+      result.orderId = orderBook_->add_order(command.order, command.conditions, result.matched);
+      break;
+    case Command::cancel_order:
+      result.matched = orderBook_->cancel_order(command.orderId);
+      break;
+    case Command::replace_order:
+      result.matched = orderBook_->replace_order(command.orderId, command.sizeDelta, command.price);
+      break;
+    case Command::set_market_price:
+      orderBook_->set_market_price(command.price);
+      break;
+    case Command::get_order_book:
+      result.bids.reserve(orderBook_->bids().size());
+      for (auto it = orderBook_->bids().begin(); it != orderBook_->bids().end(); ++it) {
+        result.bids.emplace_back(it->first.price(), it->second.open_qty());
+      }
+      result.asks.reserve(orderBook_->asks().size());
+      for (auto it = orderBook_->asks().begin(); it != orderBook_->asks().end(); ++it) {
+        result.asks.emplace_back(it->first.price(), it->second.open_qty());
+      }
+      break;
+    case Command::get_analytics:
+      result.analytics = orderBook_->analytics();
+      break;
+  }
+}
+
+void AsyncOrderBookWrapper::Publish() {
+  const NodeOrderBook::DepthTracker& depth = orderBook_->depth();
+  std::lock_guard<std::mutex> lock(snapshotMutex_);
+  for (int i = 0; i < DEPTH_SIZE; ++i) {
+    snapshot_.bidPrices[i] = depth.bids()[i].price();
+    snapshot_.bidQuantities[i] = depth.bids()[i].aggregate_qty();
+    snapshot_.askPrices[i] = depth.asks()[i].price();
+    snapshot_.askQuantities[i] = depth.asks()[i].aggregate_qty();
+  }
+  snapshot_.version = depth.last_change();
+}
+
+void AsyncOrderBookWrapper::Deliver(Napi::Env env, std::vector<Result>* results) {
+  for (const Result& result : *results) {
+    auto it = pending_.find(result.seq);
+    if (it == pending_.end()) {
+      continue;
+    }
+    if (!result.error.empty()) {
+      it->second.Reject(Napi::Error::New(env, std::string("Error processing order: ") + result.error).Value());
+    } else if (result.type == Command::add_order) {
+      // Same shape as OrderBook.addOrder
+      Napi::Object added = Napi::Object::New(env);
+      added.Set("orderId", Napi::Number::New(env, static_cast<double>(result.orderId)));
+      added.Set("matched", Napi::Boolean::New(env, result.matched));
+      it->second.Resolve(added);
+    } else if (result.type == Command::cancel_order || result.type == Command::replace_order) {
+      it->second.Resolve(Napi::Boolean::New(env, result.matched));
+    } else if (result.type == Command::get_order_book) {
+      it->second.Resolve(OrderBookValue(env, result.bids, result.asks));
+    } else if (result.type == Command::get_analytics) {
+      it->second.Resolve(AnalyticsValue(env, result.analytics));
+    } else {
+      it->second.Resolve(env.Undefined());
+    }
+    pending_.erase(it);
+  }
+  delete results;
+
+  if (pending_.empty()) {
+    // Once closed, the released function no longer holds the loop open
+    if (!closed_) {
+      tsfn_.Unref(env);
+    }
+    Unref();
+  }
+}
+
+void AsyncOrderBookWrapper::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    stopping_ = true;
+  }
+  queueReady_.notify_one();
+  thread_.join();
+  tsfn_.Release();
+}
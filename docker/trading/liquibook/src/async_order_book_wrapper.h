@@ -0,0 +1,116 @@
+#ifndef ASYNC_ORDER_BOOK_WRAPPER_H
+#define ASYNC_ORDER_BOOK_WRAPPER_H
+
+#include <napi.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "book_values.h"
+#include "node_order_book.h"
+
+// Order book that matches on its own native thread.  Commands are queued
+// and answered with Promises, resolved in batches through a
+// ThreadSafeFunction, so a long sweep never blocks the event loop.  Orders
+// are registered by id as in OrderBook, so cancel, replace and reads of the
+// whole book are commands too, answered in order with the matching.  Depth
+// is read from a snapshot published after each batch.
+class AsyncOrderBookWrapper : public Napi::ObjectWrap<AsyncOrderBookWrapper> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  AsyncOrderBookWrapper(const Napi::CallbackInfo& info);
+  ~AsyncOrderBookWrapper();
+
+private:
+  static const int DEPTH_SIZE = 5;
+
+  struct Command {
+    enum Type {
+      add_order,
+      cancel_order,
+      replace_order,
+      set_market_price,
+      get_order_book,
+      get_analytics
+    };
+    Type type;
+    uint64_t seq;
+    std::shared_ptr<NodeOrder> order;
+    liquibook::book::OrderConditions conditions;
+    liquibook::book::Price price;
+    // Cancel and replace
+    uint64_t orderId;
+    int64_t sizeDelta;
+  };
+
+  struct Result {
+    Command::Type type;
+    uint64_t seq;
+    // Id of an added order
+    uint64_t orderId;
+    // Whether an add matched, or a cancel or replace was accepted
+    bool matched;
+    std::string error;
+    // Copied out for get_order_book and get_analytics
+    RestingOrders bids;
+    RestingOrders asks;
+    liquibook::book::DepthAnalytics analytics;
+  };
+
+  // Visible depth as of the last batch the matching thread completed
+  struct DepthSnapshot {
+    liquibook::book::Price bidPrices[DEPTH_SIZE];
+    liquibook::book::Quantity bidQuantities[DEPTH_SIZE];
+    liquibook::book::Price askPrices[DEPTH_SIZE];
+    liquibook::book::Quantity askQuantities[DEPTH_SIZE];
+    uint64_t version;
+  };
+
+  // Instance methods
+  Napi::Value AddOrder(const Napi::CallbackInfo& info);
+  Napi::Value CancelOrder(const Napi::CallbackInfo& info);
+  Napi::Value ReplaceOrder(const Napi::CallbackInfo& info);
+  Napi::Value SetMarketPrice(const Napi::CallbackInfo& info);
+  Napi::Value GetOrderBook(const Napi::CallbackInfo& info);
+  Napi::Value GetAnalytics(const Napi::CallbackInfo& info);
+  Napi::Value GetDepth(const Napi::CallbackInfo& info);
+  Napi::Value Close(const Napi::CallbackInfo& info);
+
+  // Queue a command and return the Promise for its result
+  Napi::Value Submit(Napi::Env env, Command& command);
+  // Matching thread body
+  void Run();
+  // Apply one command to the book; matching thread only
+  void Execute(Command& command, Result& result);
+  // Copy the depth into the snapshot; matching thread only
+  void Publish();
+  // Settle the Promises for a batch; main thread only
+  void Deliver(Napi::Env env, std::vector<Result>* results);
+  // Drain the queue, then stop the matching thread
+  void Stop();
+
+  // Touched only by the matching thread once started
+  std::unique_ptr<NodeOrderBook> orderBook_;
+
+  // Command queue shared with the matching thread
+  std::mutex queueMutex_;
+  std::condition_variable queueReady_;
+  std::vector<Command> queue_;
+  bool stopping_;
+
+  std::mutex snapshotMutex_;
+  DepthSnapshot snapshot_;
+
+  // Main thread only
+  std::unordered_map<uint64_t, Napi::Promise::Deferred> pending_;
+  uint64_t nextSeq_;
+  bool closed_;
+
+  Napi::ThreadSafeFunction tsfn_;
+  std::thread thread_;
+};
+
+#endif // ASYNC_ORDER_BOOK_WRAPPER_H
@@ -0,0 +1,107 @@
+#include "book_json.h"
+
+static void BeginResponse(JsonWriter& out, const std::string& symbol,
+                          const std::string& timestamp, const char* key) {
+  out.raw("{\"symbol\":");
+  out.string(symbol);
+  out.raw(",\"timestamp\":");
+  out.string(timestamp);
+  out.raw(",\"");
+  out.raw(key);
+  out.raw("\":{\"bids\":[");
+}
+
+static void Entry(JsonWriter& out, bool& first, uint64_t price, uint64_t quantity) {
+  if (!first) {
+    out.raw(',');
+  }
+  first = false;
+  out.raw("{\"price\":");
+  out.number(price);
+  out.raw(",\"quantity\":");
+  out.number(quantity);
+  out.raw('}');
+}
+
+static void Levels(JsonWriter& out, const liquibook::book::Price* prices,
+                   const liquibook::book::Quantity* quantities, size_t levels) {
+  bool first = true;
+  for (size_t i = 0; i < levels; ++i) {
+    if (prices[i] > 0 && prices[i] != liquibook::book::INVALID_LEVEL_PRICE) {
+      Entry(out, first, prices[i], quantities[i]);
+    }
+  }
+}
+
+void WriteDepthJson(JsonWriter& out, const std::string& symbol, const std::string& timestamp,
+                    const liquibook::book::Price* bidPrices,
+                    const liquibook::book::Quantity* bidQuantities,
+                    const liquibook::book::Price* askPrices,
+                    const liquibook::book::Quantity* askQuantities,
+                    size_t levels) {
+  BeginResponse(out, symbol, timestamp, "depth");
+  Levels(out, bidPrices, bidQuantities, levels);
+  out.raw("],\"asks\":[");
+  Levels(out, askPrices, askQuantities, levels);
+  out.raw("]}}");
+}
+
+void WriteDepthJson(JsonWriter& out, const std::string& timestamp, const NodeOrderBook& book) {
+  const size_t LEVELS = 5;
+  liquibook::book::Price bidPrices[LEVELS];
+  liquibook::book::Quantity bidQuantities[LEVELS];
+  liquibook::book::Price askPrices[LEVELS];
+  liquibook::book::Quantity askQuantities[LEVELS];
+  const NodeOrderBook::DepthTracker& depth = book.depth();
+  for (size_t i = 0; i < LEVELS; ++i) {
+    bidPrices[i] = depth.bids()[i].price();
+    bidQuantities[i] = depth.bids()[i].aggregate_qty();
+    askPrices[i] = depth.asks()[i].price();
+    askQuantities[i] = depth.asks()[i].aggregate_qty();
+  }
+  WriteDepthJson(out, book.symbol(), timestamp,
+                 bidPrices, bidQuantities, askPrices, askQuantities, LEVELS);
+}
+
+void WriteOrderBookJson(JsonWriter& out, const std::string& timestamp, const NodeOrderBook& book) {
+  BeginResponse(out, book.symbol(), timestamp, "orderBook");
+  bool first = true;
+  for (auto it = book.bids().begin(); it != book.bids().end(); ++it) {
+    Entry(out, first, it->first.price(), it->second.open_qty());
+  }
+  out.raw("],\"asks\":[");
+  first = true;
+  for (auto it = book.asks().begin(); it != book.asks().end(); ++it) {
+    Entry(out, first, it->first.price(), it->second.open_qty());
+  }
+  out.raw("]}}");
+}
+
+// Orders of one side are sorted best price first, so levels are runs of
+// equal price
+static void AggregatedLevels(JsonWriter& out, const NodeOrderBook::TrackerMap& side,
+                             size_t first, size_t count) {
+  bool firstEntry = true;
+  size_t level = 0;
+  auto it = side.begin();
+  while (it != side.end() && level < first + count) {
+    liquibook::book::Price price = it->first.price();
+    liquibook::book::Quantity quantity = 0;
+    for (; it != side.end() && it->first.price() == price; ++it) {
+      quantity += it->second.open_qty();
+    }
+    if (level >= first) {
+      Entry(out, firstEntry, price, quantity);
+    }
+    ++level;
+  }
+}
+
+void WriteLevelsJson(JsonWriter& out, const std::string& timestamp, const NodeOrderBook& book,
+                     size_t first, size_t count) {
+  BeginResponse(out, book.symbol(), timestamp, "levels");
+  AggregatedLevels(out, book.bids(), first, count);
+  out.raw("],\"asks\":[");
+  AggregatedLevels(out, book.asks(), first, count);
+  out.raw("]}}");
+}
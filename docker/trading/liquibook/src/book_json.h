@@ -0,0 +1,34 @@
+#ifndef BOOK_JSON_H
+#define BOOK_JSON_H
+
+#include <string>
+#include "json_writer.h"
+#include "node_order_book.h"
+
+// HTTP response documents written straight from a book, in the shape the
+// service's JSON endpoints return:
+//   {"symbol":...,"timestamp":...,"<key>":{"bids":[...],"asks":[...]}}
+// with {"price":p,"quantity":q} entries.  The timestamp is passed in as
+// text.
+
+// Visible depth from parallel level arrays; zero or invalid prices are
+// skipped
+void WriteDepthJson(JsonWriter& out, const std::string& symbol, const std::string& timestamp,
+                    const liquibook::book::Price* bidPrices,
+                    const liquibook::book::Quantity* bidQuantities,
+                    const liquibook::book::Price* askPrices,
+                    const liquibook::book::Quantity* askQuantities,
+                    size_t levels);
+
+// Visible depth of a book
+void WriteDepthJson(JsonWriter& out, const std::string& timestamp, const NodeOrderBook& book);
+
+// Every resting order, as "orderBook"
+void WriteOrderBookJson(JsonWriter& out, const std::string& timestamp, const NodeOrderBook& book);
+
+// Price levels aggregated over the whole book, count levels per side
+// starting at level first from the top, as "levels"
+void WriteLevelsJson(JsonWriter& out, const std::string& timestamp, const NodeOrderBook& book,
+                     size_t first, size_t count);
+
+#endif // BOOK_JSON_H
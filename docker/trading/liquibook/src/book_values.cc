@@ -0,0 +1,190 @@
+#include "book_values.h"
+#include <depth.h>
+#include <cmath>
+
+bool IsTypedArrayOf(const Napi::Value& value, napi_typedarray_type type) {
+  return value.IsTypedArray() && value.As<Napi::TypedArray>().TypedArrayType() == type;
+}
+
+bool ReadOrderId(const Napi::Value& value, uint64_t& id) {
+  if (value.IsBigInt()) {
+    bool lossless = false;
+    id = value.As<Napi::BigInt>().Uint64Value(&lossless);
+    return lossless;
+  }
+  if (value.IsNumber()) {
+    double number = value.As<Napi::Number>().DoubleValue();
+    // Ids are issued from 1 and stay exact in a double up to 2^53 - 1
+    if (!std::isfinite(number) || number != std::floor(number) ||
+        number < 1 || number > 9007199254740991.0) {
+      return false;
+    }
+    id = static_cast<uint64_t>(number);
+    return true;
+  }
+  return false;
+}
+
+Napi::Object DepthValue(Napi::Env env, const NodeOrderBook& book) {
+  Napi::Object result = Napi::Object::New(env);
+
+  // Get depth levels from the order book
+  auto& depth = book.depth();
+
+  Napi::Array bids = Napi::Array::New(env);
+  Napi::Array asks = Napi::Array::New(env);
+
+  // Add bid depth levels
+  int bidIndex = 0;
+  const liquibook::book::DepthLevel* bidLevels = depth.bids();
+  for (int i = 0; i < 5; ++i) {  // SIZE = 5
+    const liquibook::book::DepthLevel& level = bidLevels[i];
+    if (level.price() > 0 && level.price() != 0xFFFFFFFFFFFFFFFFULL) {  // Check for valid price
+      Napi::Object bidLevel = Napi::Object::New(env);
+      bidLevel.Set("price", Napi::Number::New(env, level.price()));
+      bidLevel.Set("quantity", Napi::Number::New(env, level.aggregate_qty()));
+      bids.Set(bidIndex++, bidLevel);
+    }
+  }
+
+  // Add ask depth levels
+  int askIndex = 0;
+  const liquibook::book::DepthLevel* askLevels = depth.asks();
+  for (int i = 0; i < 5; ++i) {  // SIZE = 5
+    const liquibook::book::DepthLevel& level = askLevels[i];
+    if (level.price() > 0 && level.price() != 0xFFFFFFFFFFFFFFFFULL) {  // Check for valid price
+      Napi::Object askLevel = Napi::Object::New(env);
+      askLevel.Set("price", Napi::Number::New(env, level.price()));
+      askLevel.Set("quantity", Napi::Number::New(env, level.aggregate_qty()));
+      asks.Set(askIndex++, askLevel);
+    }
+  }
+
+  result.Set("bids", bids);
+  result.Set("asks", asks);
+  result.Set("version", Napi::Number::New(env, static_cast<double>(depth.last_change())));
+  return result;
+}
+
+static void FreezeLevels(Napi::Array levels) {
+  for (uint32_t i = 0; i < levels.Length(); ++i) {
+    levels.Get(i).As<Napi::Object>().Freeze();
+  }
+  levels.Freeze();
+}
+
+void FreezeDepthValue(Napi::Object depth) {
+  FreezeLevels(depth.Get("bids").As<Napi::Array>());
+  FreezeLevels(depth.Get("asks").As<Napi::Array>());
+  depth.Freeze();
+}
+
+static Napi::Array ChangedLevels(Napi::Env env, const liquibook::book::DepthLevel* levels,
+                                 uint64_t since, bool reset) {
+  Napi::Array changes = Napi::Array::New(env);
+  uint32_t index = 0;
+  for (int i = 0; i < 5; ++i) {  // SIZE = 5
+    const liquibook::book::DepthLevel& level = levels[i];
+    if (!reset && !level.changed_since(since)) {
+      continue;
+    }
+    bool valid = level.price() != liquibook::book::INVALID_LEVEL_PRICE;
+    Napi::Object change = Napi::Object::New(env);
+    change.Set("level", Napi::Number::New(env, i));
+    change.Set("price", Napi::Number::New(env, valid ? level.price() : 0));
+    change.Set("quantity", Napi::Number::New(env, valid ? level.aggregate_qty() : 0));
+    changes.Set(index++, change);
+  }
+  return changes;
+}
+
+Napi::Object DepthChangesValue(Napi::Env env, const NodeOrderBook& book, uint64_t since) {
+  const NodeOrderBook::DepthTracker& depth = book.depth();
+  bool reset = since > depth.last_change();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("version", Napi::Number::New(env, static_cast<double>(depth.last_change())));
+  result.Set("since", Napi::Number::New(env, static_cast<double>(since)));
+  result.Set("reset", Napi::Boolean::New(env, reset));
+  result.Set("bids", ChangedLevels(env, depth.bids(), since, reset));
+  result.Set("asks", ChangedLevels(env, depth.asks(), since, reset));
+  return result;
+}
+
+Napi::Object OrderBookValue(Napi::Env env, const NodeOrderBook& book) {
+  Napi::Object result = Napi::Object::New(env);
+
+  // Get bids
+  Napi::Array bids = Napi::Array::New(env);
+  int bidIndex = 0;
+  for (auto it = book.bids().begin(); it != book.bids().end(); ++it) {
+    Napi::Object bid = Napi::Object::New(env);
+    bid.Set("price", Napi::Number::New(env, it->first.price()));
+    bid.Set("quantity", Napi::Number::New(env, it->second.open_qty()));
+    bids.Set(bidIndex++, bid);
+  }
+
+  // Get asks
+  Napi::Array asks = Napi::Array::New(env);
+  int askIndex = 0;
+  for (auto it = book.asks().begin(); it != book.asks().end(); ++it) {
+    Napi::Object ask = Napi::Object::New(env);
+    ask.Set("price", Napi::Number::New(env, it->first.price()));
+    ask.Set("quantity", Napi::Number::New(env, it->second.open_qty()));
+    asks.Set(askIndex++, ask);
+  }
+
+  result.Set("bids", bids);
+  result.Set("asks", asks);
+  return result;
+}
+
+static Napi::Array RestingOrdersValue(Napi::Env env, const RestingOrders& orders) {
+  Napi::Array result = Napi::Array::New(env, orders.size());
+  for (size_t i = 0; i < orders.size(); ++i) {
+    Napi::Object order = Napi::Object::New(env);
+    order.Set("price", Napi::Number::New(env, orders[i].first));
+    order.Set("quantity", Napi::Number::New(env, orders[i].second));
+    result.Set(i, order);
+  }
+  return result;
+}
+
+Napi::Object OrderBookValue(Napi::Env env, const RestingOrders& bids, const RestingOrders& asks) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("bids", RestingOrdersValue(env, bids));
+  result.Set("asks", RestingOrdersValue(env, asks));
+  return result;
+}
+
+Napi::Object AnalyticsValue(Napi::Env env, const NodeOrderBook& book) {
+  // Maintained by the order book as depth changes, nothing to recompute
+  return AnalyticsValue(env, book.analytics());
+}
+
+Napi::Object AnalyticsValue(Napi::Env env, const liquibook::book::DepthAnalytics& analytics) {
+  Napi::Object result = Napi::Object::New(env);
+  if (analytics.has_bid()) {
+    result.Set("bestBid", Napi::Number::New(env, analytics.best_bid()));
+  } else {
+    result.Set("bestBid", env.Null());
+  }
+  if (analytics.has_ask()) {
+    result.Set("bestAsk", Napi::Number::New(env, analytics.best_ask()));
+  } else {
+    result.Set("bestAsk", env.Null());
+  }
+  if (analytics.two_sided()) {
+    result.Set("spread", Napi::Number::New(env, analytics.spread()));
+    result.Set("mid", Napi::Number::New(env, analytics.mid()));
+    result.Set("microprice", Napi::Number::New(env, analytics.microprice()));
+  } else {
+    result.Set("spread", env.Null());
+    result.Set("mid", env.Null());
+    result.Set("microprice", env.Null());
+  }
+  result.Set("imbalance", Napi::Number::New(env, analytics.imbalance()));
+  result.Set("bidQuantity", Napi::Number::New(env, analytics.bid_depth_qty()));
+  result.Set("askQuantity", Napi::Number::New(env, analytics.ask_depth_qty()));
+  return result;
+}
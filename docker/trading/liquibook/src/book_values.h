@@ -0,0 +1,43 @@
+#ifndef BOOK_VALUES_H
+#define BOOK_VALUES_H
+
+#include <napi.h>
+#include <utility>
+#include <vector>
+#include "node_order_book.h"
+
+// Argument checks and JS object views of a book, shared by every wrapper
+// that exposes one
+
+bool IsTypedArrayOf(const Napi::Value& value, napi_typedarray_type type);
+
+// Order ids are issued as Numbers, and accepted as Numbers or BigInts
+bool ReadOrderId(const Napi::Value& value, uint64_t& id);
+
+// { bids: [{ price, quantity }], asks: [...], version } for the visible
+// depth levels
+Napi::Object DepthValue(Napi::Env env, const NodeOrderBook& book);
+
+// Freeze a depth value and everything in it, so one built value can be
+// handed to every caller until the depth changes
+void FreezeDepthValue(Napi::Object depth);
+
+// { version, since, reset, bids: [{ level, price, quantity }], asks: [...] }
+// for the visible levels changed after version since.  A cleared level has
+// price and quantity 0.  If since is ahead of the book, every level is
+// listed and reset is true.
+Napi::Object DepthChangesValue(Napi::Env env, const NodeOrderBook& book, uint64_t since);
+
+// Price and open quantity of resting orders, in book order
+typedef std::vector<std::pair<liquibook::book::Price, liquibook::book::Quantity>> RestingOrders;
+
+// { bids: [{ price, quantity }], asks: [...] } for every resting order
+Napi::Object OrderBookValue(Napi::Env env, const NodeOrderBook& book);
+// The same from orders copied out of a book on another thread
+Napi::Object OrderBookValue(Napi::Env env, const RestingOrders& bids, const RestingOrders& asks);
+
+// Best prices, spread, mid, microprice and imbalance of the visible depth
+Napi::Object AnalyticsValue(Napi::Env env, const NodeOrderBook& book);
+Napi::Object AnalyticsValue(Napi::Env env, const liquibook::book::DepthAnalytics& analytics);
+
+#endif // BOOK_VALUES_H
@@ -0,0 +1,328 @@
+#include "engine.h"
+#include <map>
+#include <stdexcept>
+
+Engine::Engine(size_t threads)
+  : bookCount_(0),
+    commands_(nullptr),
+    results_(nullptr),
+    generation_(0),
+    running_(0),
+    stopping_(false) {
+  if (threads > 1) {
+    shares_.resize(threads);
+    errors_.resize(threads);
+    for (size_t i = 0; i < threads; ++i) {
+      workers_.emplace_back(&Engine::work, this, i);
+    }
+  }
+}
+
+Engine::~Engine() {
+  {
+    std::lock_guard<std::mutex> lock(batchMutex_);
+    stopping_ = true;
+  }
+  batchReady_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::shared_ptr<Engine> Engine::shared(const std::string& name, size_t threads) {
+  // Process-wide on purpose: workers attach to the same engine by name
+  static std::mutex registryMutex;
+  static std::map<std::string, std::weak_ptr<Engine>> registry;
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  std::shared_ptr<Engine> engine = registry[name].lock();
+  if (!engine) {
+    engine = std::make_shared<Engine>(threads);
+    registry[name] = engine;
+  }
+  return engine;
+}
+
+uint32_t Engine::intern(const std::string& symbol) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  auto found = ids_.find(symbol);
+  if (found != ids_.end()) {
+    return found->second;
+  }
+  uint32_t id = static_cast<uint32_t>(books_.size());
+  books_.emplace_back(new NodeOrderBook(symbol));
+  symbols_.push_back(symbol);
+  ids_.emplace(symbol, id);
+  {
+    std::lock_guard<std::mutex> snapshotLock(snapshotMutex_);
+    snapshots_.emplace_back();
+  }
+  publish(id);
+  bookCount_.store(books_.size(), std::memory_order_release);
+  return id;
+}
+
+bool Engine::find(const std::string& symbol, uint32_t& id) const {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  auto found = ids_.find(symbol);
+  if (found == ids_.end()) {
+    return false;
+  }
+  id = found->second;
+  return true;
+}
+
+std::vector<std::string> Engine::symbols() const {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  return symbols_;
+}
+
+uint64_t Engine::add_order(uint32_t id, const std::shared_ptr<NodeOrder>& order,
+                           liquibook::book::OrderConditions conditions, bool& matched) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  uint64_t orderId = books_.at(id)->add_order(order, conditions, matched);
+  publish(id);
+  return orderId;
+}
+
+bool Engine::cancel_order(uint32_t id, uint64_t orderId) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  bool cancelled = books_.at(id)->cancel_order(orderId);
+  publish(id);
+  return cancelled;
+}
+
+bool Engine::replace_order(uint32_t id, uint64_t orderId, int64_t sizeDelta,
+                           liquibook::book::Price newPrice) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  bool replaced = books_.at(id)->replace_order(orderId, sizeDelta, newPrice);
+  publish(id);
+  return replaced;
+}
+
+void Engine::set_market_price(uint32_t id, liquibook::book::Price price) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  books_.at(id)->set_market_price(price);
+  publish(id);
+}
+
+void Engine::set_event_ring(uint32_t id, EventRing* events) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  books_.at(id)->set_event_ring(events);
+}
+
+void Engine::release_event_ring(uint32_t id, EventRing* events) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  if (books_.at(id)->event_ring() == events) {
+    books_[id]->set_event_ring(nullptr);
+  }
+}
+
+Engine::SnapshotPtr Engine::snapshot(uint32_t id) const {
+  std::lock_guard<std::mutex> lock(snapshotMutex_);
+  return id < snapshots_.size() ? snapshots_[id] : SnapshotPtr();
+}
+
+void Engine::submit(const double* commands, size_t count, double* results) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  // Republish every book the batch names, even if it failed part way
+  try {
+    run(commands, count, results);
+  } catch (...) {
+    publish(commands, count);
+    throw;
+  }
+  publish(commands, count);
+}
+
+void Engine::run(const double* commands, size_t count, double* results) {
+  if (workers_.empty()) {
+    for (size_t i = 0; i < count; ++i) {
+      execute(commands + i * COMMAND_FIELDS, results + i * RESULT_FIELDS);
+    }
+    return;
+  }
+
+  // Each book belongs to one worker, so its commands keep their order
+  for (std::vector<size_t>& share : shares_) {
+    share.clear();
+  }
+  for (size_t i = 0; i < count; ++i) {
+    // Unknown ids go to the first worker, where execute reports them
+    double symbolId = commands[i * COMMAND_FIELDS + 1];
+    size_t worker = symbolId >= 0 && symbolId < books_.size()
+        ? static_cast<size_t>(symbolId) % workers_.size() : 0;
+    shares_[worker].push_back(i);
+  }
+
+  std::unique_lock<std::mutex> batchLock(batchMutex_);
+  commands_ = commands;
+  results_ = results;
+  running_ = workers_.size();
+  ++generation_;
+  batchReady_.notify_all();
+  batchDone_.wait(batchLock, [this] { return running_ == 0; });
+
+  for (std::string& error : errors_) {
+    if (!error.empty()) {
+      std::string message;
+      message.swap(error);
+      for (std::string& other : errors_) {
+        other.clear();
+      }
+      throw std::runtime_error(message);
+    }
+  }
+}
+
+size_t Engine::write_stats(double* out, size_t capacity) const {
+  std::vector<SnapshotPtr> snapshots;
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    if (snapshots_.size() > capacity) {
+      return snapshots_.size();
+    }
+    snapshots = snapshots_;
+  }
+  for (const SnapshotPtr& snapshot : snapshots) {
+    // Invalid levels are published as 0
+    liquibook::book::Quantity bidQuantity = 0;
+    liquibook::book::Quantity askQuantity = 0;
+    for (int i = 0; i < DEPTH_LEVELS; ++i) {
+      bidQuantity += snapshot->bidQuantities[i];
+      askQuantity += snapshot->askQuantities[i];
+    }
+    out[0] = static_cast<double>(snapshot->openOrders);
+    out[1] = static_cast<double>(snapshot->bidPrices[0]);
+    out[2] = static_cast<double>(snapshot->askPrices[0]);
+    out[3] = static_cast<double>(bidQuantity);
+    out[4] = static_cast<double>(askQuantity);
+    out[5] = static_cast<double>(snapshot->version);
+    out += STATS_FIELDS;
+  }
+  return snapshots.size();
+}
+
+void Engine::publish(const double* commands, size_t count) {
+  std::vector<char> touched(books_.size());
+  for (size_t i = 0; i < count; ++i) {
+    double symbolId = commands[i * COMMAND_FIELDS + 1];
+    if (symbolId >= 0 && symbolId < touched.size() && !touched[static_cast<size_t>(symbolId)]) {
+      touched[static_cast<size_t>(symbolId)] = 1;
+      publish(static_cast<uint32_t>(symbolId));
+    }
+  }
+}
+
+void Engine::publish(uint32_t id) {
+  const NodeOrderBook& book = *books_[id];
+  const NodeOrderBook::DepthTracker& depth = book.depth();
+  // Only commands write snapshots, so the current one can be read here
+  const SnapshotPtr& current = snapshots_[id];
+  if (current && current->version == depth.last_change() &&
+      current->openOrders == book.open_orders()) {
+    return;
+  }
+  std::shared_ptr<BookSnapshot> snapshot = std::make_shared<BookSnapshot>();
+  snapshot->symbol = &book.symbol();
+  snapshot->version = depth.last_change();
+  snapshot->openOrders = book.open_orders();
+  for (int i = 0; i < DEPTH_LEVELS; ++i) {
+    const liquibook::book::DepthLevel& bid = depth.bids()[i];
+    const liquibook::book::DepthLevel& ask = depth.asks()[i];
+    bool bidValid = bid.price() != liquibook::book::INVALID_LEVEL_PRICE;
+    bool askValid = ask.price() != liquibook::book::INVALID_LEVEL_PRICE;
+    snapshot->bidPrices[i] = bidValid ? bid.price() : 0;
+    snapshot->bidQuantities[i] = bidValid ? bid.aggregate_qty() : 0;
+    snapshot->askPrices[i] = askValid ? ask.price() : 0;
+    snapshot->askQuantities[i] = askValid ? ask.aggregate_qty() : 0;
+    snapshot->bidChanges[i] = bid.last_change();
+    snapshot->askChanges[i] = ask.last_change();
+  }
+
+  std::lock_guard<std::mutex> lock(snapshotMutex_);
+  snapshots_[id] = snapshot;
+}
+
+void Engine::execute(const double* command, double* result) {
+  NodeOrderBook* target = command[1] >= 0 && command[1] < books_.size() ?
+    books_[static_cast<size_t>(command[1])].get() : nullptr;
+  result[0] = 0;
+  result[1] = 0;
+  result[2] = NodeOrder::status_rejected;
+  if (!target) {
+    return;
+  }
+
+  uint64_t orderId = static_cast<uint64_t>(command[7]);
+  switch (static_cast<int>(command[0])) {
+    case cmd_add: {
+      uint32_t conditions = static_cast<uint32_t>(command[6]);
+      auto order = std::make_shared<NodeOrder>(command[2] != 0,
+        static_cast<liquibook::book::Price>(command[3]),
+        static_cast<liquibook::book::Quantity>(command[4]),
+        static_cast<liquibook::book::Price>(command[5]),
+        (conditions & liquibook::book::oc_all_or_none) != 0,
+        (conditions & liquibook::book::oc_immediate_or_cancel) != 0);
+      bool matched = false;
+      result[0] = static_cast<double>(target->add_order(order, conditions, matched));
+      result[1] = static_cast<double>(order->filled_qty());
+      result[2] = order->status();
+      break;
+    }
+    case cmd_cancel: {
+      std::shared_ptr<NodeOrder> order = target->find_order(orderId);
+      result[0] = static_cast<double>(orderId);
+      if (order && target->cancel_order(orderId)) {
+        result[1] = static_cast<double>(order->filled_qty());
+        result[2] = order->status();
+      }
+      break;
+    }
+    case cmd_replace: {
+      std::shared_ptr<NodeOrder> order = target->find_order(orderId);
+      result[0] = static_cast<double>(orderId);
+      if (order && target->replace_order(orderId, static_cast<int64_t>(command[4]),
+                                         static_cast<liquibook::book::Price>(command[3]))) {
+        result[1] = static_cast<double>(order->filled_qty());
+        result[2] = order->status();
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void Engine::work(size_t worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    const double* commands;
+    double* results;
+    {
+      std::unique_lock<std::mutex> lock(batchMutex_);
+      batchReady_.wait(lock, [this, seen] { return stopping_ || generation_ != seen; });
+      if (stopping_) {
+        return;
+      }
+      seen = generation_;
+      commands = commands_;
+      results = results_;
+    }
+
+    try {
+      for (size_t i : shares_[worker]) {
+        execute(commands + i * COMMAND_FIELDS, results + i * RESULT_FIELDS);
+      }
+    } catch (const std::exception& e) {
+      errors_[worker] = e.what();
+    } catch (...) {
+      errors_[worker] = "Unknown error";
+    }
+
+    std::lock_guard<std::mutex> lock(batchMutex_);
+    if (--running_ == 0) {
+      batchDone_.notify_one();
+    }
+  }
+}
@@ -0,0 +1,151 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "node_order_book.h"
+
+// Owns one NodeOrderBook per symbol.  Symbols are interned to small ids in
+// the order they are first seen, so commands name books by index rather
+// than by string.  Batches of packed commands are routed to their books,
+// optionally spread over worker threads that each own a fixed share of
+// the books; commands for one book always run in batch order.
+//
+// Every public member is thread safe, so one engine can serve several
+// Node worker threads.  Commands are serialized; after each one the
+// depth of the books it touched is published as an immutable snapshot,
+// which readers take without waiting for commands.
+class Engine {
+public:
+  // Doubles per command:
+  //   command type, symbol id, is buy, price, quantity, stop price,
+  //   conditions, order id
+  // Replace carries the size delta in quantity and the new price in price.
+  static const size_t COMMAND_FIELDS = 8;
+  // Doubles per result: order id, filled quantity, status
+  static const size_t RESULT_FIELDS = 3;
+  // Doubles per book in write_stats: open orders, best bid, best ask,
+  // visible bid quantity, visible ask quantity, depth version
+  static const size_t STATS_FIELDS = 6;
+  static const int DEPTH_LEVELS = 5;
+
+  enum CommandType {
+    cmd_add = 0,
+    cmd_cancel = 1,
+    cmd_replace = 2
+  };
+
+  // Published state of one book; never changed once published
+  struct BookSnapshot {
+    // Books live as long as the engine, so their symbols do too
+    const std::string* symbol;
+    uint64_t version;
+    size_t openOrders;
+    liquibook::book::Price bidPrices[DEPTH_LEVELS];
+    liquibook::book::Quantity bidQuantities[DEPTH_LEVELS];
+    liquibook::book::Price askPrices[DEPTH_LEVELS];
+    liquibook::book::Quantity askQuantities[DEPTH_LEVELS];
+    // Depth version at which each level last changed
+    liquibook::book::ChangeId bidChanges[DEPTH_LEVELS];
+    liquibook::book::ChangeId askChanges[DEPTH_LEVELS];
+  };
+  typedef std::shared_ptr<const BookSnapshot> SnapshotPtr;
+
+  // threads of 0 or 1 runs every batch on the calling thread
+  explicit Engine(size_t threads = 0);
+  ~Engine();
+
+  // The process-wide engine of this name, created with threads on first
+  // use and shared by every caller until the last one lets it go
+  static std::shared_ptr<Engine> shared(const std::string& name, size_t threads);
+
+  // Id of a symbol, creating its book the first time
+  uint32_t intern(const std::string& symbol);
+  // Look up a symbol without creating it
+  bool find(const std::string& symbol, uint32_t& id) const;
+  // Symbols in id order
+  std::vector<std::string> symbols() const;
+
+  bool has_book(uint32_t id) const { return id < bookCount_.load(std::memory_order_acquire); }
+  size_t book_count() const { return bookCount_.load(std::memory_order_acquire); }
+  size_t threads() const { return workers_.size(); }
+
+  // Single commands on a book; the id must be known
+  uint64_t add_order(uint32_t id, const std::shared_ptr<NodeOrder>& order,
+                     liquibook::book::OrderConditions conditions, bool& matched);
+  bool cancel_order(uint32_t id, uint64_t orderId);
+  bool replace_order(uint32_t id, uint64_t orderId, int64_t sizeDelta,
+                     liquibook::book::Price newPrice);
+  void set_market_price(uint32_t id, liquibook::book::Price price);
+  void set_event_ring(uint32_t id, EventRing* events);
+  // Detach a ring unless another has replaced it since
+  void release_event_ring(uint32_t id, EventRing* events);
+
+  // Run count commands, writing RESULT_FIELDS doubles for each.  Commands
+  // naming an unknown book or order are reported as rejected.
+  void submit(const double* commands, size_t count, double* results);
+
+  // Call f with the book while no command runs, for reads that need more
+  // than the snapshot
+  template <typename Function>
+  void with_book(uint32_t id, Function f);
+
+  // Latest published state of a book, or nullptr if the id is unknown
+  SnapshotPtr snapshot(uint32_t id) const;
+
+  // Write STATS_FIELDS doubles per book, in id order, from the published
+  // snapshots; returns the books written, or the books required if
+  // capacity is too small
+  size_t write_stats(double* out, size_t capacity) const;
+
+private:
+  // Run a batch; commandMutex_ must be held
+  void run(const double* commands, size_t count, double* results);
+  void execute(const double* command, double* result);
+  void work(size_t worker);
+  // Snapshot a book, or every book named by a batch, for readers, unless
+  // its depth and open orders are as last published; commandMutex_ must
+  // be held
+  void publish(uint32_t id);
+  void publish(const double* commands, size_t count);
+
+  // Books, symbols and ids change only under commandMutex_
+  mutable std::mutex commandMutex_;
+  std::vector<std::unique_ptr<NodeOrderBook>> books_;
+  std::vector<std::string> symbols_;
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::atomic<size_t> bookCount_;
+
+  // Snapshots are swapped under their own short lock
+  mutable std::mutex snapshotMutex_;
+  std::vector<SnapshotPtr> snapshots_;
+
+  // Batch handed to the workers; each runs the commands in its share
+  std::vector<std::thread> workers_;
+  std::vector<std::vector<size_t>> shares_;
+  std::vector<std::string> errors_;
+  std::mutex batchMutex_;
+  std::condition_variable batchReady_;
+  std::condition_variable batchDone_;
+  const double* commands_;
+  double* results_;
+  uint64_t generation_;
+  size_t running_;
+  bool stopping_;
+};
+
+template <typename Function>
+void Engine::with_book(uint32_t id, Function f) {
+  std::lock_guard<std::mutex> lock(commandMutex_);
+  if (id < books_.size()) {
+    f(static_cast<const NodeOrderBook&>(*books_[id]));
+  }
+}
+
+#endif // ENGINE_H
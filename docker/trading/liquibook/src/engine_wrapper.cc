@@ -0,0 +1,590 @@
+#include "engine_wrapper.h"
+#include "addon_data.h"
+#include "book_json.h"
+#include "book_values.h"
+
+Napi::Object EngineWrapper::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "Engine", {
+    InstanceMethod("symbolId", &EngineWrapper::SymbolId),
+    InstanceMethod("symbols", &EngineWrapper::Symbols),
+    InstanceMethod("addOrder", &EngineWrapper::AddOrder),
+    InstanceMethod("cancelOrder", &EngineWrapper::CancelOrder),
+    InstanceMethod("replaceOrder", &EngineWrapper::ReplaceOrder),
+    InstanceMethod("submit", &EngineWrapper::Submit),
+    InstanceMethod("getDepth", &EngineWrapper::GetDepth),
+    InstanceMethod("getDepthSince", &EngineWrapper::GetDepthSince),
+    InstanceMethod("getOrderBook", &EngineWrapper::GetOrderBook),
+    InstanceMethod("getAnalytics", &EngineWrapper::GetAnalytics),
+    InstanceMethod("getDepthJson", &EngineWrapper::GetDepthJson),
+    InstanceMethod("getOrderBookJson", &EngineWrapper::GetOrderBookJson),
+    InstanceMethod("getLevelsJson", &EngineWrapper::GetLevelsJson),
+    InstanceMethod("setMarketPrice", &EngineWrapper::SetMarketPrice),
+    InstanceMethod("getStats", &EngineWrapper::GetStats),
+    InstanceMethod("getStatsInto", &EngineWrapper::GetStatsInto),
+    InstanceMethod("attachEvents", &EngineWrapper::AttachEvents)
+  });
+
+  // Layout of submit() commands, results and getStatsInto() records
+  func.Set("COMMAND_FIELDS", Napi::Number::New(env, Engine::COMMAND_FIELDS));
+  func.Set("RESULT_FIELDS", Napi::Number::New(env, Engine::RESULT_FIELDS));
+  func.Set("STATS_FIELDS", Napi::Number::New(env, Engine::STATS_FIELDS));
+  func.Set("ADD", Napi::Number::New(env, Engine::cmd_add));
+  func.Set("CANCEL", Napi::Number::New(env, Engine::cmd_cancel));
+  func.Set("REPLACE", Napi::Number::New(env, Engine::cmd_replace));
+
+  env.GetInstanceData<AddonData>()->engineConstructor = Napi::Persistent(func);
+
+  exports.Set("Engine", func);
+  return exports;
+}
+
+EngineWrapper::EngineWrapper(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<EngineWrapper>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  // Worker threads for batches; 0 runs them on the calling thread
+  size_t threads = 0;
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    threads = info[0].As<Napi::Number>().Uint32Value();
+  }
+
+  // A named engine is shared by every environment in the process
+  if (info.Length() > 1 && info[1].IsString()) {
+    engine_ = Engine::shared(info[1].As<Napi::String>().Utf8Value(), threads);
+  } else {
+    engine_ = std::make_shared<Engine>(threads);
+  }
+}
+
+EngineWrapper::~EngineWrapper() {
+  // The rings live in this environment's memory, which a shared engine
+  // may outlive
+  for (uint32_t id = 0; id < events_.size(); ++id) {
+    if (events_[id]) {
+      engine_->release_event_ring(id, events_[id].get());
+    }
+  }
+}
+
+bool EngineWrapper::ReadBookId(const Napi::CallbackInfo& info, size_t index, uint32_t& id) {
+  Napi::Env env = info.Env();
+  if (info.Length() <= index || !info[index].IsNumber()) {
+    Napi::TypeError::New(env, "Expected a symbol id").ThrowAsJavaScriptException();
+    return false;
+  }
+  id = info[index].As<Napi::Number>().Uint32Value();
+  if (!engine_->has_book(id)) {
+    Napi::RangeError::New(env, "Unknown symbol id").ThrowAsJavaScriptException();
+    return false;
+  }
+  return true;
+}
+
+// Depth as published after the last command on the book, in the shape of
+// DepthValue
+static Napi::Object SnapshotDepthValue(Napi::Env env, const Engine::BookSnapshot& snapshot) {
+  Napi::Array bids = Napi::Array::New(env);
+  Napi::Array asks = Napi::Array::New(env);
+  int bidIndex = 0;
+  int askIndex = 0;
+  for (int i = 0; i < Engine::DEPTH_LEVELS; ++i) {
+    if (snapshot.bidPrices[i]) {
+      Napi::Object bidLevel = Napi::Object::New(env);
+      bidLevel.Set("price", Napi::Number::New(env, snapshot.bidPrices[i]));
+      bidLevel.Set("quantity", Napi::Number::New(env, snapshot.bidQuantities[i]));
+      bids.Set(bidIndex++, bidLevel);
+    }
+    if (snapshot.askPrices[i]) {
+      Napi::Object askLevel = Napi::Object::New(env);
+      askLevel.Set("price", Napi::Number::New(env, snapshot.askPrices[i]));
+      askLevel.Set("quantity", Napi::Number::New(env, snapshot.askQuantities[i]));
+      asks.Set(askIndex++, askLevel);
+    }
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("bids", bids);
+  result.Set("asks", asks);
+  result.Set("version", Napi::Number::New(env, static_cast<double>(snapshot.version)));
+  return result;
+}
+
+static Napi::Array SnapshotChangedLevels(Napi::Env env, const liquibook::book::Price* prices,
+                                         const liquibook::book::Quantity* quantities,
+                                         const liquibook::book::ChangeId* changes,
+                                         uint64_t since, bool reset) {
+  Napi::Array levels = Napi::Array::New(env);
+  uint32_t index = 0;
+  for (int i = 0; i < Engine::DEPTH_LEVELS; ++i) {
+    if (reset || changes[i] > since) {
+      Napi::Object level = Napi::Object::New(env);
+      level.Set("level", Napi::Number::New(env, i));
+      level.Set("price", Napi::Number::New(env, prices[i]));
+      level.Set("quantity", Napi::Number::New(env, quantities[i]));
+      levels.Set(index++, level);
+    }
+  }
+  return levels;
+}
+
+static Napi::Object SnapshotDepthChangesValue(Napi::Env env, const Engine::BookSnapshot& snapshot,
+                                              uint64_t since) {
+  bool reset = since > snapshot.version;
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("version", Napi::Number::New(env, static_cast<double>(snapshot.version)));
+  result.Set("since", Napi::Number::New(env, static_cast<double>(since)));
+  result.Set("reset", Napi::Boolean::New(env, reset));
+  result.Set("bids", SnapshotChangedLevels(env, snapshot.bidPrices, snapshot.bidQuantities,
+                                           snapshot.bidChanges, since, reset));
+  result.Set("asks", SnapshotChangedLevels(env, snapshot.askPrices, snapshot.askQuantities,
+                                           snapshot.askChanges, since, reset));
+  return result;
+}
+
+Napi::Value EngineWrapper::SymbolId(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected a symbol").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Number::New(env, engine_->intern(info[0].As<Napi::String>().Utf8Value()));
+}
+
+Napi::Value EngineWrapper::Symbols(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  // Indexed by symbol id
+  std::vector<std::string> names = engine_->symbols();
+  Napi::Array symbols = Napi::Array::New(env, names.size());
+  for (uint32_t id = 0; id < names.size(); ++id) {
+    symbols.Set(id, Napi::String::New(env, names[id]));
+  }
+  return symbols;
+}
+
+Napi::Value EngineWrapper::AddOrder(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 6) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+
+  try {
+    bool isBuy = info[1].As<Napi::Boolean>().Value();
+    uint64_t price = static_cast<uint64_t>(info[2].As<Napi::Number>().DoubleValue());
+    uint64_t quantity = static_cast<uint64_t>(info[3].As<Napi::Number>().DoubleValue());
+    uint64_t stopPrice = static_cast<uint64_t>(info[4].As<Napi::Number>().DoubleValue());
+    bool allOrNone = info[5].As<Napi::Boolean>().Value();
+    bool immediateOrCancel = info.Length() > 6 ? info[6].As<Napi::Boolean>().Value() : false;
+
+    auto order = std::make_shared<NodeOrder>(isBuy, price, quantity, stopPrice, allOrNone, immediateOrCancel);
+    liquibook::book::OrderConditions conditions =
+      (allOrNone ? liquibook::book::oc_all_or_none : 0) |
+      (immediateOrCancel ? liquibook::book::oc_immediate_or_cancel : 0);
+
+    bool matched = false;
+    uint64_t orderId = engine_->add_order(id, order, conditions, matched);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("orderId", Napi::Number::New(env, static_cast<double>(orderId)));
+    result.Set("matched", Napi::Boolean::New(env, matched));
+    return result;
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error adding order: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error adding order").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::CancelOrder(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+  uint64_t orderId = 0;
+  if (!ReadOrderId(info[1], orderId)) {
+    Napi::TypeError::New(env, "Invalid order id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    return Napi::Boolean::New(env, engine_->cancel_order(id, orderId));
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error cancelling order: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error cancelling order").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::ReplaceOrder(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 4) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+  uint64_t orderId = 0;
+  if (!ReadOrderId(info[1], orderId)) {
+    Napi::TypeError::New(env, "Invalid order id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  int64_t sizeDelta = info[2].As<Napi::Number>().Int64Value();
+  uint64_t newPrice = static_cast<uint64_t>(info[3].As<Napi::Number>().DoubleValue());
+
+  try {
+    return Napi::Boolean::New(env, engine_->replace_order(id, orderId, sizeDelta, newPrice));
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error replacing order: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error replacing order").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::Submit(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!IsTypedArrayOf(info[0], napi_float64_array) ||
+      !IsTypedArrayOf(info[1], napi_float64_array)) {
+    Napi::TypeError::New(env, "Expected (Float64Array, Float64Array)").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Float64Array commands = info[0].As<Napi::Float64Array>();
+  Napi::Float64Array results = info[1].As<Napi::Float64Array>();
+  if (commands.ElementLength() % Engine::COMMAND_FIELDS) {
+    Napi::RangeError::New(env, "Commands length is not a whole number of commands").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t count = commands.ElementLength() / Engine::COMMAND_FIELDS;
+  if (results.ElementLength() < count * Engine::RESULT_FIELDS) {
+    Napi::RangeError::New(env, "Results array too small").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    engine_->submit(commands.Data(), count, results.Data());
+    return Napi::Number::New(env, static_cast<double>(count));
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error submitting commands: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error submitting commands").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::GetDepth(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+
+  try {
+    // Read from the snapshot, never waiting for a command; unchanged
+    // depth is answered with the value built last time
+    Engine::SnapshotPtr snapshot = engine_->snapshot(id);
+    if (depthCache_.size() <= id) {
+      depthCache_.resize(id + 1);
+    }
+    DepthCache& cache = depthCache_[id];
+    if (cache.value.IsEmpty() || cache.version != snapshot->version) {
+      Napi::Object depth = SnapshotDepthValue(env, *snapshot);
+      FreezeDepthValue(depth);
+      cache.value = Napi::Persistent(depth);
+      cache.version = snapshot->version;
+    }
+    return cache.value.Value();
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting depth: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting depth").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::GetDepthSince(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+  if (info.Length() < 2 || !info[1].IsNumber() || info[1].As<Napi::Number>().DoubleValue() < 0) {
+    Napi::TypeError::New(env, "Expected a depth version").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    uint64_t since = static_cast<uint64_t>(info[1].As<Napi::Number>().DoubleValue());
+    return SnapshotDepthChangesValue(env, *engine_->snapshot(id), since);
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting depth changes: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting depth changes").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::GetOrderBook(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+
+  try {
+    Napi::Value result = env.Null();
+    engine_->with_book(id, [&](const NodeOrderBook& book) {
+      result = OrderBookValue(env, book);
+    });
+    return result;
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting order book: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting order book").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::GetAnalytics(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+
+  try {
+    Napi::Value result = env.Null();
+    engine_->with_book(id, [&](const NodeOrderBook& book) {
+      result = AnalyticsValue(env, book);
+    });
+    return result;
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting analytics: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting analytics").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::GetDepthJson(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+  if (info.Length() < 2 || !info[1].IsString()) {
+    Napi::TypeError::New(env, "Expected a timestamp").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    // Written from the snapshot, never waiting for a command
+    Engine::SnapshotPtr snapshot = engine_->snapshot(id);
+    json_.clear();
+    WriteDepthJson(json_, *snapshot->symbol, info[1].As<Napi::String>().Utf8Value(),
+                   snapshot->bidPrices, snapshot->bidQuantities,
+                   snapshot->askPrices, snapshot->askQuantities, Engine::DEPTH_LEVELS);
+    return Napi::Buffer<char>::Copy(env, json_.data(), json_.size());
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting depth: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting depth").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::GetOrderBookJson(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+  if (info.Length() < 2 || !info[1].IsString()) {
+    Napi::TypeError::New(env, "Expected a timestamp").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    std::string timestamp = info[1].As<Napi::String>().Utf8Value();
+    json_.clear();
+    engine_->with_book(id, [&](const NodeOrderBook& book) {
+      WriteOrderBookJson(json_, timestamp, book);
+    });
+    return Napi::Buffer<char>::Copy(env, json_.data(), json_.size());
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting order book: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting order book").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::GetLevelsJson(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+  if (info.Length() < 4 || !info[1].IsNumber() || !info[2].IsNumber() || !info[3].IsString()) {
+    Napi::TypeError::New(env, "Expected (symbolId, first, count, timestamp)").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    size_t first = info[1].As<Napi::Number>().Uint32Value();
+    size_t count = info[2].As<Napi::Number>().Uint32Value();
+    std::string timestamp = info[3].As<Napi::String>().Utf8Value();
+    json_.clear();
+    engine_->with_book(id, [&](const NodeOrderBook& book) {
+      WriteLevelsJson(json_, timestamp, book, first, count);
+    });
+    return Napi::Buffer<char>::Copy(env, json_.data(), json_.size());
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting levels: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting levels").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value EngineWrapper::SetMarketPrice(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+
+  uint64_t price = static_cast<uint64_t>(info[1].As<Napi::Number>().DoubleValue());
+  try {
+    engine_->set_market_price(id, price);
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error setting market price: ") + e.what()).ThrowAsJavaScriptException();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error setting market price").ThrowAsJavaScriptException();
+  }
+  return env.Null();
+}
+
+Napi::Value EngineWrapper::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  // Books added by another thread meanwhile are left for the next call
+  std::vector<std::string> names = engine_->symbols();
+  std::vector<double> stats(names.size() * Engine::STATS_FIELDS);
+  size_t count = engine_->write_stats(stats.data(), names.size());
+  if (count > names.size()) {
+    count = names.size();
+  }
+
+  Napi::Array books = Napi::Array::New(env, count);
+  double openOrders = 0;
+  for (uint32_t id = 0; id < count; ++id) {
+    const double* fields = &stats[id * Engine::STATS_FIELDS];
+    Napi::Object book = Napi::Object::New(env);
+    book.Set("symbolId", Napi::Number::New(env, id));
+    book.Set("symbol", Napi::String::New(env, names[id]));
+    book.Set("openOrders", Napi::Number::New(env, fields[0]));
+    book.Set("bestBid", fields[1] ? Napi::Value(Napi::Number::New(env, fields[1])) : env.Null());
+    book.Set("bestAsk", fields[2] ? Napi::Value(Napi::Number::New(env, fields[2])) : env.Null());
+    book.Set("bidQuantity", Napi::Number::New(env, fields[3]));
+    book.Set("askQuantity", Napi::Number::New(env, fields[4]));
+    book.Set("version", Napi::Number::New(env, fields[5]));
+    books.Set(id, book);
+    openOrders += fields[0];
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("books", books);
+  result.Set("bookCount", Napi::Number::New(env, count));
+  result.Set("openOrders", Napi::Number::New(env, openOrders));
+  result.Set("threads", Napi::Number::New(env, engine_->threads()));
+  return result;
+}
+
+Napi::Value EngineWrapper::GetStatsInto(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !IsTypedArrayOf(info[0], napi_float64_array)) {
+    Napi::TypeError::New(env, "Expected a Float64Array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // Returns the books in the engine; nothing is written if the target
+  // cannot hold them all
+  Napi::Float64Array target = info[0].As<Napi::Float64Array>();
+  size_t books = engine_->write_stats(target.Data(), target.ElementLength() / Engine::STATS_FIELDS);
+  return Napi::Number::New(env, static_cast<double>(books));
+}
+
+Napi::Value EngineWrapper::AttachEvents(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  uint32_t id = 0;
+  if (!ReadBookId(info, 0, id)) {
+    return env.Null();
+  }
+  if (info.Length() < 2 || !IsTypedArrayOf(info[1], napi_float64_array)) {
+    Napi::TypeError::New(env, "Expected a Float64Array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Float64Array array = info[1].As<Napi::Float64Array>();
+  std::unique_ptr<EventRing> events(
+    new EventRing(array.Data(), array.ElementLength() * sizeof(double)));
+  if (!events->capacity()) {
+    Napi::RangeError::New(env, "Event array too small").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (events_.size() <= id) {
+    events_.resize(id + 1);
+    eventsArrays_.resize(id + 1);
+  }
+  engine_->set_event_ring(id, events.get());
+  events_[id] = std::move(events);
+  eventsArrays_[id] = Napi::Persistent(array.As<Napi::Object>());
+  return Napi::Number::New(env, static_cast<double>(events_[id]->capacity()));
+}
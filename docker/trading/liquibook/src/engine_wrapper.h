@@ -0,0 +1,62 @@
+#ifndef ENGINE_WRAPPER_H
+#define ENGINE_WRAPPER_H
+
+#include <napi.h>
+#include <memory>
+#include "engine.h"
+#include "json_writer.h"
+
+// Every book of the service behind one object.  Books are addressed by the
+// symbol id returned from symbolId(), commands can be batched across books
+// with submit(), and getStats() covers all books in one call.  Objects
+// created with the same name, on any worker thread, share one engine.
+class EngineWrapper : public Napi::ObjectWrap<EngineWrapper> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  EngineWrapper(const Napi::CallbackInfo& info);
+  ~EngineWrapper();
+
+private:
+  // Instance methods
+  Napi::Value SymbolId(const Napi::CallbackInfo& info);
+  Napi::Value Symbols(const Napi::CallbackInfo& info);
+  Napi::Value AddOrder(const Napi::CallbackInfo& info);
+  Napi::Value CancelOrder(const Napi::CallbackInfo& info);
+  Napi::Value ReplaceOrder(const Napi::CallbackInfo& info);
+  Napi::Value Submit(const Napi::CallbackInfo& info);
+  Napi::Value GetDepth(const Napi::CallbackInfo& info);
+  Napi::Value GetDepthSince(const Napi::CallbackInfo& info);
+  Napi::Value GetOrderBook(const Napi::CallbackInfo& info);
+  Napi::Value GetAnalytics(const Napi::CallbackInfo& info);
+  Napi::Value GetDepthJson(const Napi::CallbackInfo& info);
+  Napi::Value GetOrderBookJson(const Napi::CallbackInfo& info);
+  Napi::Value GetLevelsJson(const Napi::CallbackInfo& info);
+  Napi::Value SetMarketPrice(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+  Napi::Value GetStatsInto(const Napi::CallbackInfo& info);
+  Napi::Value AttachEvents(const Napi::CallbackInfo& info);
+
+  // Read a symbol id argument; false with a JS exception pending if it
+  // names no book
+  bool ReadBookId(const Napi::CallbackInfo& info, size_t index, uint32_t& id);
+
+  std::shared_ptr<Engine> engine_;
+
+  // Reused for every JSON response
+  JsonWriter json_;
+
+  // Last depth value built for each book, frozen, and the depth version
+  // it shows, by symbol id
+  struct DepthCache {
+    uint64_t version;
+    Napi::ObjectReference value;
+  };
+  std::vector<DepthCache> depthCache_;
+
+  // Event rings this object attached, by symbol id, and the JS arrays
+  // holding their memory
+  std::vector<std::unique_ptr<EventRing>> events_;
+  std::vector<Napi::ObjectReference> eventsArrays_;
+};
+
+#endif // ENGINE_WRAPPER_H
@@ -0,0 +1,126 @@
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Single producer, single consumer ring of fixed-size event records laid
+// over memory the consumer also sees, typically a SharedArrayBuffer.
+//
+// The memory starts with HEADER_WORDS 64-bit words, read from JS through a
+// BigUint64Array with Atomics:
+//   [0] write position, records ever written; producer only
+//   [1] read position, records ever consumed; consumer only
+//   [2] capacity in records
+//   [3] doubles per record
+//   [4] next sequence number
+//   [5] records dropped because the ring was full
+//   [6] highest backlog seen
+// followed by capacity records of RECORD_FIELDS doubles:
+//   sequence, type, order id, matched order id, quantity, price, flags,
+//   delta
+// Every event takes a sequence number, including dropped ones, so the
+// consumer sees a gap in the sequence wherever it fell behind.
+class EventRing {
+public:
+  static const size_t HEADER_WORDS = 8;
+  static const size_t RECORD_FIELDS = 8;
+
+  enum Header {
+    h_write_pos = 0,
+    h_read_pos = 1,
+    h_capacity = 2,
+    h_record_fields = 3,
+    h_next_seq = 4,
+    h_dropped = 5,
+    h_high_water = 6
+  };
+
+  // Lay the ring over size bytes at memory, which must be 8 byte aligned
+  // and stay valid while the ring is in use
+  EventRing(void* memory, size_t size);
+
+  // Records the ring can hold, 0 if the memory is too small for one
+  size_t capacity() const { return capacity_; }
+
+  // Append one event; returns false, counting it as dropped, when the
+  // consumer has not made room
+  bool write(uint64_t type, uint64_t orderId, uint64_t matchedOrderId,
+             uint64_t quantity, uint64_t price, uint64_t flags, int64_t delta);
+
+  // Records written but not yet consumed
+  uint64_t backlog() const;
+  uint64_t dropped() const;
+
+private:
+  std::atomic<uint64_t>& word(Header index) const { return header_[index]; }
+
+  std::atomic<uint64_t>* header_;
+  double* records_;
+  size_t capacity_;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "Ring header words must match the JS BigUint64Array layout");
+
+inline EventRing::EventRing(void* memory, size_t size)
+  : header_(static_cast<std::atomic<uint64_t>*>(memory)),
+    records_(static_cast<double*>(memory) + HEADER_WORDS),
+    capacity_(0) {
+  // Too small for the header: leave the memory alone and drop everything
+  if (size < HEADER_WORDS * sizeof(uint64_t)) {
+    return;
+  }
+  capacity_ = (size / sizeof(double) - HEADER_WORDS) / RECORD_FIELDS;
+  for (size_t i = 0; i < HEADER_WORDS; ++i) {
+    header_[i].store(0, std::memory_order_relaxed);
+  }
+  word(h_capacity).store(capacity_, std::memory_order_relaxed);
+  word(h_record_fields).store(RECORD_FIELDS, std::memory_order_release);
+}
+
+inline bool EventRing::write(uint64_t type, uint64_t orderId, uint64_t matchedOrderId,
+                             uint64_t quantity, uint64_t price, uint64_t flags, int64_t delta) {
+  if (!capacity_) {
+    return false;
+  }
+  uint64_t seq = word(h_next_seq).load(std::memory_order_relaxed);
+  word(h_next_seq).store(seq + 1, std::memory_order_relaxed);
+
+  uint64_t writePos = word(h_write_pos).load(std::memory_order_relaxed);
+  uint64_t readPos = word(h_read_pos).load(std::memory_order_acquire);
+  if (writePos - readPos >= capacity_) {
+    word(h_dropped).fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  double* record = records_ + (writePos % capacity_) * RECORD_FIELDS;
+  record[0] = static_cast<double>(seq);
+  record[1] = static_cast<double>(type);
+  record[2] = static_cast<double>(orderId);
+  record[3] = static_cast<double>(matchedOrderId);
+  record[4] = static_cast<double>(quantity);
+  record[5] = static_cast<double>(price);
+  record[6] = static_cast<double>(flags);
+  record[7] = static_cast<double>(delta);
+  // Publish the record before the position that covers it
+  word(h_write_pos).store(writePos + 1, std::memory_order_release);
+
+  uint64_t pending = writePos + 1 - readPos;
+  if (pending > word(h_high_water).load(std::memory_order_relaxed)) {
+    word(h_high_water).store(pending, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+inline uint64_t EventRing::backlog() const {
+  return word(h_write_pos).load(std::memory_order_relaxed) -
+         word(h_read_pos).load(std::memory_order_acquire);
+}
+
+inline uint64_t EventRing::dropped() const {
+  return word(h_dropped).load(std::memory_order_relaxed);
+}
+
+#endif // EVENT_RING_H
@@ -0,0 +1,87 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Appends JSON text to a buffer that is kept between responses, so once
+// it has grown to the usual response size no further allocation happens.
+class JsonWriter {
+public:
+  // Start a new document, keeping the capacity
+  void clear() { out_.clear(); }
+
+  const char* data() const { return out_.data(); }
+  size_t size() const { return out_.size(); }
+
+  void raw(const char* text) { out_.append(text); }
+  void raw(char c) { out_.push_back(c); }
+
+  // Unsigned integer, two digits at a time
+  void number(uint64_t value);
+
+  // Quoted string, escaped as JSON requires
+  void string(const std::string& text);
+
+private:
+  std::string out_;
+};
+
+inline void JsonWriter::number(uint64_t value) {
+  static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+  char digits[20];
+  char* end = digits + sizeof(digits);
+  char* pos = end;
+  while (value >= 100) {
+    const char* pair = digitPairs + (value % 100) * 2;
+    value /= 100;
+    *--pos = pair[1];
+    *--pos = pair[0];
+  }
+  if (value >= 10) {
+    const char* pair = digitPairs + value * 2;
+    *--pos = pair[1];
+    *--pos = pair[0];
+  } else {
+    *--pos = static_cast<char>('0' + value);
+  }
+  out_.append(pos, end - pos);
+}
+
+inline void JsonWriter::string(const std::string& text) {
+  static const char hex[] = "0123456789abcdef";
+  out_.push_back('"');
+  for (char c : text) {
+    switch (c) {
+      case '"': out_.append("\\\""); break;
+      case '\\': out_.append("\\\\"); break;
+      case '\n': out_.append("\\n"); break;
+      case '\r': out_.append("\\r"); break;
+      case '\t': out_.append("\\t"); break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out_.append("\\u00");
+          out_.push_back(hex[(c >> 4) & 0xF]);
+          out_.push_back(hex[c & 0xF]);
+        } else {
+          out_.push_back(c);
+        }
+        break;
+    }
+  }
+  out_.push_back('"');
+}
+
+#endif // JSON_WRITER_H
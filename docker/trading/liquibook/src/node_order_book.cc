@@ -0,0 +1,158 @@
+#include "node_order_book.h"
+
+NodeOrderBook::NodeOrderBook(const std::string& symbol)
+  : liquibook::book::DepthOrderBook<OrderPtr>(symbol),
+    events_(nullptr),
+    rejected_(false) {
+}
+
+uint64_t NodeOrderBook::add_order(const std::shared_ptr<NodeOrder>& order,
+                                  liquibook::book::OrderConditions conditions,
+                                  bool& matched) {
+  uint64_t id = registry_.insert(order);
+  order->set_id(id);
+  // An order that fills, cancels or is rejected right away is released
+  // during the add
+  matched = add(order, conditions);
+  return id;
+}
+
+bool NodeOrderBook::cancel_order(uint64_t id) {
+  const OrderPtr* found = registry_.find(id);
+  if (!found) {
+    return false;
+  }
+  // Hold a reference, the registry slot is released by the cancel
+  OrderPtr order = *found;
+  cancel(order);
+  return registry_.find(id) == nullptr;
+}
+
+bool NodeOrderBook::replace_order(uint64_t id, int64_t sizeDelta, liquibook::book::Price newPrice) {
+  const OrderPtr* found = registry_.find(id);
+  if (!found) {
+    return false;
+  }
+  OrderPtr order = *found;
+  rejected_ = false;
+  replace(order, sizeDelta, newPrice);
+  return !rejected_;
+}
+
+std::shared_ptr<NodeOrder> NodeOrderBook::find_order(uint64_t id) const {
+  const OrderPtr* found = registry_.find(id);
+  return found ? std::static_pointer_cast<NodeOrder>(*found) : std::shared_ptr<NodeOrder>();
+}
+
+size_t NodeOrderBook::open_orders() const {
+  return registry_.size();
+}
+
+void NodeOrderBook::set_event_ring(EventRing* events) {
+  events_ = events;
+}
+
+EventRing* NodeOrderBook::event_ring() const {
+  return events_;
+}
+
+void NodeOrderBook::perform_callback(NodeCallback& cb) {
+  liquibook::book::DepthOrderBook<OrderPtr>::perform_callback(cb);
+  if (events_) {
+    publish(cb);
+  }
+  switch (cb.type) {
+    case NodeCallback::cb_order_accept:
+    case NodeCallback::cb_order_accept_stop:
+      static_cast<NodeOrder*>(cb.order.get())->accept();
+      break;
+    case NodeCallback::cb_order_fill:
+      static_cast<NodeOrder*>(cb.order.get())->fill(cb.quantity);
+      static_cast<NodeOrder*>(cb.matched_order.get())->fill(cb.quantity);
+      if (cb.flags & (NodeCallback::ff_inbound_filled | NodeCallback::ff_both_filled)) {
+        release(cb.order);
+      }
+      if (cb.flags & (NodeCallback::ff_matched_filled | NodeCallback::ff_both_filled)) {
+        release(cb.matched_order);
+      }
+      break;
+    case NodeCallback::cb_order_cancel:
+    case NodeCallback::cb_order_cancel_stop:
+      static_cast<NodeOrder*>(cb.order.get())->cancel();
+      release(cb.order);
+      break;
+    case NodeCallback::cb_order_reject:
+      static_cast<NodeOrder*>(cb.order.get())->reject();
+      release(cb.order);
+      break;
+    case NodeCallback::cb_order_replace:
+      // Depth has seen the old price, now the order takes the new one
+      static_cast<NodeOrder*>(cb.order.get())->replace(cb.delta, cb.price);
+      break;
+    case NodeCallback::cb_order_cancel_reject:
+    case NodeCallback::cb_order_replace_reject:
+      rejected_ = true;
+      break;
+    default:
+      break;
+  }
+}
+
+void NodeOrderBook::release(const OrderPtr& order) {
+  registry_.erase(static_cast<NodeOrder*>(order.get())->id());
+}
+
+void NodeOrderBook::publish(const NodeCallback& cb) {
+  // Depth changes are read from snapshots, only order events are streamed
+  if (cb.type == NodeCallback::cb_book_update || !cb.order) {
+    return;
+  }
+  uint64_t orderId = static_cast<NodeOrder*>(cb.order.get())->id();
+  uint64_t matchedId = cb.matched_order ?
+    static_cast<NodeOrder*>(cb.matched_order.get())->id() : 0;
+  events_->write(cb.type, orderId, matchedId, cb.quantity, cb.price, cb.flags, cb.delta);
+}
+
+// NodeOrder implementation
+NodeOrder::NodeOrder(bool isBuy, liquibook::book::Price price, liquibook::book::Quantity qty,
+                     liquibook::book::Price stopPrice, bool allOrNone, bool immediateOrCancel)
+  : isBuy_(isBuy), price_(price), qty_(qty), stopPrice_(stopPrice),
+    allOrNone_(allOrNone), immediateOrCancel_(immediateOrCancel), id_(0),
+    status_(status_new), filledQty_(0) {}
+
+bool NodeOrder::is_buy() const { return isBuy_; }
+liquibook::book::Price NodeOrder::price() const { return price_; }
+liquibook::book::Quantity NodeOrder::order_qty() const { return qty_; }
+liquibook::book::Price NodeOrder::stop_price() const { return stopPrice_; }
+bool NodeOrder::all_or_none() const { return allOrNone_; }
+bool NodeOrder::immediate_or_cancel() const { return immediateOrCancel_; }
+uint64_t NodeOrder::id() const { return id_; }
+void NodeOrder::set_id(uint64_t id) { id_ = id; }
+NodeOrder::Status NodeOrder::status() const { return status_; }
+liquibook::book::Quantity NodeOrder::filled_qty() const { return filledQty_; }
+
+void NodeOrder::accept() {
+  if (status_ == status_new) {
+    status_ = status_accepted;
+  }
+}
+
+void NodeOrder::fill(liquibook::book::Quantity fillQty) {
+  filledQty_ += fillQty;
+  if (filledQty_ >= qty_) {
+    status_ = status_filled;
+  }
+}
+
+void NodeOrder::cancel() {
+  status_ = status_cancelled;
+}
+
+void NodeOrder::reject() {
+  status_ = status_rejected;
+}
+
+void NodeOrder::replace(int64_t sizeDelta, liquibook::book::Price newPrice) {
+  qty_ += sizeDelta;
+  price_ = newPrice;
+}
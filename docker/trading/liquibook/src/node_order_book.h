@@ -0,0 +1,109 @@
+#ifndef NODE_ORDER_BOOK_H
+#define NODE_ORDER_BOOK_H
+
+#include <memory>
+#include <string>
+#include <depth_order_book.h>
+#include <order.h>
+#include "event_ring.h"
+#include "order_registry.h"
+
+// Custom Order implementation for Node.js
+class NodeOrder : public liquibook::book::Order {
+public:
+  // Lifecycle as seen through the book's callbacks; the values are
+  // reported to JS
+  enum Status {
+    status_new = 0,
+    status_accepted = 1,
+    status_filled = 2,
+    status_cancelled = 3,
+    status_rejected = 4
+  };
+
+  NodeOrder(bool isBuy, liquibook::book::Price price, liquibook::book::Quantity qty,
+            liquibook::book::Price stopPrice = 0, bool allOrNone = false, bool immediateOrCancel = false);
+
+  virtual bool is_buy() const override;
+  virtual liquibook::book::Price price() const override;
+  virtual liquibook::book::Quantity order_qty() const override;
+  virtual liquibook::book::Price stop_price() const override;
+  virtual bool all_or_none() const override;
+  virtual bool immediate_or_cancel() const override;
+
+  // Registry id, or 0 if the order was never registered
+  uint64_t id() const;
+  void set_id(uint64_t id);
+
+  Status status() const;
+  liquibook::book::Quantity filled_qty() const;
+
+  // Apply book events
+  void accept();
+  void fill(liquibook::book::Quantity fillQty);
+  void cancel();
+  void reject();
+  // Apply an accepted replace
+  void replace(int64_t sizeDelta, liquibook::book::Price newPrice);
+
+private:
+  bool isBuy_;
+  liquibook::book::Price price_;
+  liquibook::book::Quantity qty_;
+  liquibook::book::Price stopPrice_;
+  bool allOrNone_;
+  bool immediateOrCancel_;
+  uint64_t id_;
+  Status status_;
+  liquibook::book::Quantity filledQty_;
+};
+
+// Depth order book that owns its orders by id.  Orders are registered when
+// added and released when they fill, cancel or are rejected, so cancel and
+// replace by id are a hash lookup away.
+class NodeOrderBook
+  : public liquibook::book::DepthOrderBook<std::shared_ptr<liquibook::book::Order>> {
+public:
+  typedef std::shared_ptr<liquibook::book::Order> OrderPtr;
+  typedef liquibook::book::Callback<OrderPtr> NodeCallback;
+
+  NodeOrderBook(const std::string& symbol = "default");
+
+  // Register and add an order; returns its id
+  uint64_t add_order(const std::shared_ptr<NodeOrder>& order,
+                     liquibook::book::OrderConditions conditions,
+                     bool& matched);
+
+  // Cancel an open order; returns false if the id is unknown or the
+  // cancel was rejected
+  bool cancel_order(uint64_t id);
+
+  // Replace an open order; returns false if the id is unknown or the
+  // replace was rejected
+  bool replace_order(uint64_t id, int64_t sizeDelta, liquibook::book::Price newPrice);
+
+  // An open order, or nullptr if the id is unknown or closed
+  std::shared_ptr<NodeOrder> find_order(uint64_t id) const;
+
+  // Number of orders still open
+  size_t open_orders() const;
+
+  // Encode order events into a ring, or stop with nullptr.  The ring is
+  // not owned.
+  void set_event_ring(EventRing* events);
+  EventRing* event_ring() const;
+
+protected:
+  // Keep orders and the registry in step with the book
+  virtual void perform_callback(NodeCallback& cb);
+
+private:
+  void release(const OrderPtr& order);
+  void publish(const NodeCallback& cb);
+
+  OrderRegistry<OrderPtr> registry_;
+  EventRing* events_;
+  bool rejected_;
+};
+
+#endif // NODE_ORDER_BOOK_H
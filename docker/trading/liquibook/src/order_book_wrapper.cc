@@ -1,31 +1,81 @@
 #include "order_book_wrapper.h"
+#include "addon_data.h"
+#include "book_json.h"
+#include "book_values.h"
 #include <depth.h>
 #include <iostream>
 #include <sstream>
 
-Napi::FunctionReference OrderBookWrapper::constructor;
-
 Napi::Object OrderBookWrapper::Init(Napi::Env env, Napi::Object exports) {
   Napi::HandleScope scope(env);
 
   Napi::Function func = DefineClass(env, "OrderBook", {
     InstanceMethod("addOrder", &OrderBookWrapper::AddOrder),
+    InstanceMethod("addOrders", &OrderBookWrapper::AddOrders),
+    InstanceMethod("addOrdersPacked", &OrderBookWrapper::AddOrdersPacked),
     InstanceMethod("cancelOrder", &OrderBookWrapper::CancelOrder),
     InstanceMethod("replaceOrder", &OrderBookWrapper::ReplaceOrder),
     InstanceMethod("getOrderBook", &OrderBookWrapper::GetOrderBook),
     InstanceMethod("getDepth", &OrderBookWrapper::GetDepth),
-    InstanceMethod("setMarketPrice", &OrderBookWrapper::SetMarketPrice)
+    InstanceMethod("getDepthSince", &OrderBookWrapper::GetDepthSince),
+    InstanceMethod("getOrderBookInto", &OrderBookWrapper::GetOrderBookInto),
+    InstanceMethod("getDepthInto", &OrderBookWrapper::GetDepthInto),
+    InstanceMethod("getDepthJson", &OrderBookWrapper::GetDepthJson),
+    InstanceMethod("getOrderBookJson", &OrderBookWrapper::GetOrderBookJson),
+    InstanceMethod("getLevelsJson", &OrderBookWrapper::GetLevelsJson),
+    InstanceMethod("getAnalytics", &OrderBookWrapper::GetAnalytics),
+    InstanceMethod("setMarketPrice", &OrderBookWrapper::SetMarketPrice),
+    InstanceMethod("attachEvents", &OrderBookWrapper::AttachEvents),
+    InstanceMethod("detachEvents", &OrderBookWrapper::DetachEvents)
   });
 
-  constructor = Napi::Persistent(func);
-  constructor.SuppressDestruct();
+  env.GetInstanceData<AddonData>()->orderBookConstructor = Napi::Persistent(func);
 
   exports.Set("OrderBook", func);
+
+  // Layout of batch records and results, and the status codes reported
+  Napi::Object batch = Napi::Object::New(env);
+  batch.Set("RECORD_FIELDS", Napi::Number::New(env, BATCH_RECORD_FIELDS));
+  batch.Set("RESULT_FIELDS", Napi::Number::New(env, BATCH_RESULT_FIELDS));
+  batch.Set("ALL_OR_NONE", Napi::Number::New(env, liquibook::book::oc_all_or_none));
+  batch.Set("IMMEDIATE_OR_CANCEL", Napi::Number::New(env, liquibook::book::oc_immediate_or_cancel));
+  batch.Set("STATUS_NEW", Napi::Number::New(env, NodeOrder::status_new));
+  batch.Set("STATUS_ACCEPTED", Napi::Number::New(env, NodeOrder::status_accepted));
+  batch.Set("STATUS_FILLED", Napi::Number::New(env, NodeOrder::status_filled));
+  batch.Set("STATUS_CANCELLED", Napi::Number::New(env, NodeOrder::status_cancelled));
+  batch.Set("STATUS_REJECTED", Napi::Number::New(env, NodeOrder::status_rejected));
+  exports.Set("Batch", batch);
+
+  // Layout of the depth and order book snapshots
+  Napi::Object snapshot = Napi::Object::New(env);
+  snapshot.Set("DEPTH_LEVELS", Napi::Number::New(env, DEPTH_LEVELS));
+  snapshot.Set("DEPTH_HEADER_FIELDS", Napi::Number::New(env, DEPTH_HEADER_FIELDS));
+  snapshot.Set("DEPTH_FIELDS", Napi::Number::New(env, DEPTH_SNAPSHOT_FIELDS));
+  snapshot.Set("BOOK_HEADER_FIELDS", Napi::Number::New(env, BOOK_HEADER_FIELDS));
+  exports.Set("Snapshot", snapshot);
+
+  // Layout of the event ring and the event types it carries
+  typedef NodeOrderBook::NodeCallback NodeCallback;
+  Napi::Object events = Napi::Object::New(env);
+  events.Set("HEADER_WORDS", Napi::Number::New(env, EventRing::HEADER_WORDS));
+  events.Set("RECORD_FIELDS", Napi::Number::New(env, EventRing::RECORD_FIELDS));
+  events.Set("ACCEPT", Napi::Number::New(env, NodeCallback::cb_order_accept));
+  events.Set("ACCEPT_STOP", Napi::Number::New(env, NodeCallback::cb_order_accept_stop));
+  events.Set("TRIGGER_STOP", Napi::Number::New(env, NodeCallback::cb_order_trigger_stop));
+  events.Set("REJECT", Napi::Number::New(env, NodeCallback::cb_order_reject));
+  events.Set("FILL", Napi::Number::New(env, NodeCallback::cb_order_fill));
+  events.Set("CANCEL", Napi::Number::New(env, NodeCallback::cb_order_cancel));
+  events.Set("CANCEL_STOP", Napi::Number::New(env, NodeCallback::cb_order_cancel_stop));
+  events.Set("CANCEL_REJECT", Napi::Number::New(env, NodeCallback::cb_order_cancel_reject));
+  events.Set("REPLACE", Napi::Number::New(env, NodeCallback::cb_order_replace));
+  events.Set("REPLACE_REJECT", Napi::Number::New(env, NodeCallback::cb_order_replace_reject));
+  exports.Set("Events", events);
   return exports;
 }
 
 OrderBookWrapper::OrderBookWrapper(const Napi::CallbackInfo& info)
-  : Napi::ObjectWrap<OrderBookWrapper>(info) {
+  : Napi::ObjectWrap<OrderBookWrapper>(info),
+    depthCacheVersion_(0) {
   Napi::Env env = info.Env();
   Napi::HandleScope scope(env);
 
@@ -34,7 +84,7 @@ OrderBookWrapper::OrderBookWrapper(const Napi::CallbackInfo& info)
     symbol = info[0].As<Napi::String>().Utf8Value();
   }
 
-  orderBook_ = std::make_unique<liquibook::book::DepthOrderBook<std::shared_ptr<liquibook::book::Order>>>(symbol);
+  orderBook_ = std::make_unique<NodeOrderBook>(symbol);
 }
 
 Napi::Value OrderBookWrapper::AddOrder(const Napi::CallbackInfo& info) {
@@ -54,11 +104,22 @@ Napi::Value OrderBookWrapper::AddOrder(const Napi::CallbackInfo& info) {
     bool immediateOrCancel = info.Length() > 5 ? info[5].As<Napi::Boolean>().Value() : false;
 
     auto order = std::make_shared<NodeOrder>(isBuy, price, quantity, stopPrice, allOrNone, immediateOrCancel);
+    // The book only honours conditions passed with the order
     liquibook::book::OrderConditions conditions = 0;
+    if (allOrNone) {
+      conditions |= liquibook::book::oc_all_or_none;
+    }
+    if (immediateOrCancel) {
+      conditions |= liquibook::book::oc_immediate_or_cancel;
+    }
 
-    bool matched = orderBook_->add(order, conditions);
+    bool matched = false;
+    uint64_t orderId = orderBook_->add_order(order, conditions, matched);
 
-    return Napi::Boolean::New(env, matched);
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("orderId", Napi::Number::New(env, static_cast<double>(orderId)));
+    result.Set("matched", Napi::Boolean::New(env, matched));
+    return result;
   } catch (const std::exception& e) {
     Napi::Error::New(env, std::string("Error adding order: ") + e.what()).ThrowAsJavaScriptException();
     return env.Null();
@@ -68,6 +129,130 @@ Napi::Value OrderBookWrapper::AddOrder(const Napi::CallbackInfo& info) {
   }
 }
 
+void OrderBookWrapper::AddBatchOrder(bool isBuy, double price, double quantity, double stopPrice,
+                                     uint32_t conditions, double* result) {
+  auto order = std::make_shared<NodeOrder>(isBuy,
+    static_cast<uint64_t>(price),
+    static_cast<uint64_t>(quantity),
+    static_cast<uint64_t>(stopPrice),
+    (conditions & liquibook::book::oc_all_or_none) != 0,
+    (conditions & liquibook::book::oc_immediate_or_cancel) != 0);
+  bool matched = false;
+  uint64_t orderId = orderBook_->add_order(order, conditions, matched);
+  result[0] = static_cast<double>(orderId);
+  result[1] = static_cast<double>(order->filled_qty());
+  result[2] = order->status();
+}
+
+// Columnar batch: addOrders(isBuy: Uint8Array, price: Float64Array,
+//   quantity: Float64Array, stopPrice: Float64Array | null,
+//   conditions: Uint8Array | null, results: Float64Array)
+// Writes id, filled quantity and status per order to results and returns
+// the number of orders added.
+Napi::Value OrderBookWrapper::AddOrders(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 6) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!IsTypedArrayOf(info[0], napi_uint8_array) ||
+      !IsTypedArrayOf(info[1], napi_float64_array) ||
+      !IsTypedArrayOf(info[2], napi_float64_array) ||
+      !(info[3].IsNull() || IsTypedArrayOf(info[3], napi_float64_array)) ||
+      !(info[4].IsNull() || IsTypedArrayOf(info[4], napi_uint8_array)) ||
+      !IsTypedArrayOf(info[5], napi_float64_array)) {
+    Napi::TypeError::New(env, "Expected (Uint8Array, Float64Array, Float64Array, Float64Array|null, Uint8Array|null, Float64Array)").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Uint8Array isBuy = info[0].As<Napi::Uint8Array>();
+  Napi::Float64Array prices = info[1].As<Napi::Float64Array>();
+  Napi::Float64Array quantities = info[2].As<Napi::Float64Array>();
+  Napi::Float64Array results = info[5].As<Napi::Float64Array>();
+  const double* stopPrices = info[3].IsNull() ? nullptr : info[3].As<Napi::Float64Array>().Data();
+  const uint8_t* conditions = info[4].IsNull() ? nullptr : info[4].As<Napi::Uint8Array>().Data();
+
+  size_t count = isBuy.ElementLength();
+  if (prices.ElementLength() != count || quantities.ElementLength() != count ||
+      (stopPrices && info[3].As<Napi::Float64Array>().ElementLength() != count) ||
+      (conditions && info[4].As<Napi::Uint8Array>().ElementLength() != count)) {
+    Napi::RangeError::New(env, "Column lengths differ").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (results.ElementLength() < count * BATCH_RESULT_FIELDS) {
+    Napi::RangeError::New(env, "Results array too small").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    const uint8_t* buy = isBuy.Data();
+    const double* price = prices.Data();
+    const double* quantity = quantities.Data();
+    double* result = results.Data();
+    for (size_t i = 0; i < count; ++i) {
+      AddBatchOrder(buy[i] != 0, price[i], quantity[i],
+                    stopPrices ? stopPrices[i] : 0,
+                    conditions ? conditions[i] : 0,
+                    result + i * BATCH_RESULT_FIELDS);
+    }
+    return Napi::Number::New(env, static_cast<double>(count));
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error adding orders: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error adding orders").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+// Packed batch: addOrdersPacked(records: Float64Array, results: Float64Array)
+// Each record is RECORD_FIELDS doubles: isBuy (0 or 1), price, quantity,
+// stop price, condition bits.
+Napi::Value OrderBookWrapper::AddOrdersPacked(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!IsTypedArrayOf(info[0], napi_float64_array) ||
+      !IsTypedArrayOf(info[1], napi_float64_array)) {
+    Napi::TypeError::New(env, "Expected (Float64Array, Float64Array)").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Float64Array records = info[0].As<Napi::Float64Array>();
+  Napi::Float64Array results = info[1].As<Napi::Float64Array>();
+  if (records.ElementLength() % BATCH_RECORD_FIELDS) {
+    Napi::RangeError::New(env, "Records length is not a whole number of records").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t count = records.ElementLength() / BATCH_RECORD_FIELDS;
+  if (results.ElementLength() < count * BATCH_RESULT_FIELDS) {
+    Napi::RangeError::New(env, "Results array too small").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    const double* record = records.Data();
+    double* result = results.Data();
+    for (size_t i = 0; i < count; ++i) {
+      AddBatchOrder(record[0] != 0, record[1], record[2], record[3],
+                    static_cast<uint32_t>(record[4]), result);
+      record += BATCH_RECORD_FIELDS;
+      result += BATCH_RESULT_FIELDS;
+    }
+    return Napi::Number::New(env, static_cast<double>(count));
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error adding orders: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error adding orders").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
 Napi::Value OrderBookWrapper::CancelOrder(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
@@ -76,10 +261,21 @@ Napi::Value OrderBookWrapper::CancelOrder(const Napi::CallbackInfo& info) {
     return env.Null();
   }
 
-  // For simplicity, we'll need to find the order by some identifier
-  // This is a simplified implementation - in practice you'd need order tracking
-  Napi::Error::New(env, "Cancel order not fully implemented").ThrowAsJavaScriptException();
-  return env.Null();
+  uint64_t orderId = 0;
+  if (!ReadOrderId(info[0], orderId)) {
+    Napi::TypeError::New(env, "Invalid order id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    return Napi::Boolean::New(env, orderBook_->cancel_order(orderId));
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error cancelling order: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error cancelling order").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 }
 
 Napi::Value OrderBookWrapper::ReplaceOrder(const Napi::CallbackInfo& info) {
@@ -90,41 +286,160 @@ Napi::Value OrderBookWrapper::ReplaceOrder(const Napi::CallbackInfo& info) {
     return env.Null();
   }
 
-  // Simplified implementation
-  Napi::Error::New(env, "Replace order not fully implemented").ThrowAsJavaScriptException();
-  return env.Null();
+  uint64_t orderId = 0;
+  if (!ReadOrderId(info[0], orderId)) {
+    Napi::TypeError::New(env, "Invalid order id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  int64_t sizeDelta = info[1].As<Napi::Number>().Int64Value();
+  uint64_t newPrice = static_cast<uint64_t>(info[2].As<Napi::Number>().DoubleValue());
+
+  try {
+    return Napi::Boolean::New(env, orderBook_->replace_order(orderId, sizeDelta, newPrice));
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error replacing order: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error replacing order").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 }
 
 Napi::Value OrderBookWrapper::GetOrderBook(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
   try {
-    Napi::Object result = Napi::Object::New(env);
+    return OrderBookValue(env, *orderBook_);
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting order book: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting order book").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
 
-    // Get bids
-    Napi::Array bids = Napi::Array::New(env);
-    int bidIndex = 0;
-    for (auto it = orderBook_->bids().begin(); it != orderBook_->bids().end(); ++it) {
-      Napi::Object bid = Napi::Object::New(env);
-      bid.Set("price", Napi::Number::New(env, it->first.price()));
-      bid.Set("quantity", Napi::Number::New(env, it->second.open_qty()));
-      bids.Set(bidIndex++, bid);
-    }
+Napi::Value OrderBookWrapper::GetDepth(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-    // Get asks
-    Napi::Array asks = Napi::Array::New(env);
-    int askIndex = 0;
-    for (auto it = orderBook_->asks().begin(); it != orderBook_->asks().end(); ++it) {
-      Napi::Object ask = Napi::Object::New(env);
-      ask.Set("price", Napi::Number::New(env, it->first.price()));
-      ask.Set("quantity", Napi::Number::New(env, it->second.open_qty()));
-      asks.Set(askIndex++, ask);
+  try {
+    // Unchanged depth is answered with the value built last time
+    uint64_t version = orderBook_->depth().last_change();
+    if (depthCache_.IsEmpty() || depthCacheVersion_ != version) {
+      Napi::Object depth = DepthValue(env, *orderBook_);
+      FreezeDepthValue(depth);
+      depthCache_ = Napi::Persistent(depth);
+      depthCacheVersion_ = version;
     }
+    return depthCache_.Value();
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting depth: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting depth").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
 
-    result.Set("bids", bids);
-    result.Set("asks", asks);
+Napi::Value OrderBookWrapper::GetDepthSince(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-    return result;
+  if (info.Length() < 1 || !info[0].IsNumber() || info[0].As<Napi::Number>().DoubleValue() < 0) {
+    Napi::TypeError::New(env, "Expected a depth version").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    uint64_t since = static_cast<uint64_t>(info[0].As<Napi::Number>().DoubleValue());
+    return DepthChangesValue(env, *orderBook_, since);
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting depth changes: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting depth changes").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+template <typename Field>
+size_t OrderBookWrapper::WriteDepth(Field* out) const {
+  const NodeOrderBook::DepthTracker& depth = orderBook_->depth();
+  Field* bidPrices = out + DEPTH_HEADER_FIELDS;
+  Field* bidQuantities = bidPrices + DEPTH_LEVELS;
+  Field* askPrices = bidQuantities + DEPTH_LEVELS;
+  Field* askQuantities = askPrices + DEPTH_LEVELS;
+
+  // Valid levels come first on each side, the rest are zeroed
+  size_t bidCount = 0;
+  size_t askCount = 0;
+  for (size_t i = 0; i < DEPTH_LEVELS; ++i) {
+    const liquibook::book::DepthLevel& bid = depth.bids()[i];
+    const liquibook::book::DepthLevel& ask = depth.asks()[i];
+    bool bidValid = bid.price() != liquibook::book::INVALID_LEVEL_PRICE;
+    bool askValid = ask.price() != liquibook::book::INVALID_LEVEL_PRICE;
+    bidCount += bidValid;
+    askCount += askValid;
+    bidPrices[i] = static_cast<Field>(bidValid ? bid.price() : 0);
+    bidQuantities[i] = static_cast<Field>(bidValid ? bid.aggregate_qty() : 0);
+    askPrices[i] = static_cast<Field>(askValid ? ask.price() : 0);
+    askQuantities[i] = static_cast<Field>(askValid ? ask.aggregate_qty() : 0);
+  }
+  out[0] = static_cast<Field>(depth.last_change());
+  out[1] = static_cast<Field>(bidCount);
+  out[2] = static_cast<Field>(askCount);
+  return DEPTH_SNAPSHOT_FIELDS;
+}
+
+template <typename Field>
+size_t OrderBookWrapper::WriteOrderBook(Field* out, size_t capacity) const {
+  const NodeOrderBook::TrackerMap& bids = orderBook_->bids();
+  const NodeOrderBook::TrackerMap& asks = orderBook_->asks();
+  size_t required = BOOK_HEADER_FIELDS + 2 * (bids.size() + asks.size());
+  // Leave the target untouched when it cannot hold the whole book
+  if (required > capacity) {
+    return required;
+  }
+
+  out[0] = static_cast<Field>(bids.size());
+  out[1] = static_cast<Field>(asks.size());
+  Field* prices = out + BOOK_HEADER_FIELDS;
+  Field* quantities = prices + bids.size();
+  for (auto it = bids.begin(); it != bids.end(); ++it) {
+    *prices++ = static_cast<Field>(it->first.price());
+    *quantities++ = static_cast<Field>(it->second.open_qty());
+  }
+  prices = quantities;
+  quantities = prices + asks.size();
+  for (auto it = asks.begin(); it != asks.end(); ++it) {
+    *prices++ = static_cast<Field>(it->first.price());
+    *quantities++ = static_cast<Field>(it->second.open_qty());
+  }
+  return required;
+}
+
+Napi::Value OrderBookWrapper::GetOrderBookInto(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    // Returns the fields the book needs; nothing is written if the target
+    // is smaller, so the caller can grow it and call again
+    size_t required;
+    if (IsTypedArrayOf(info[0], napi_float64_array)) {
+      Napi::Float64Array target = info[0].As<Napi::Float64Array>();
+      required = WriteOrderBook(target.Data(), target.ElementLength());
+    } else if (IsTypedArrayOf(info[0], napi_biguint64_array)) {
+      Napi::BigUint64Array target = info[0].As<Napi::BigUint64Array>();
+      required = WriteOrderBook(target.Data(), target.ElementLength());
+    } else {
+      Napi::TypeError::New(env, "Expected a Float64Array or BigUint64Array").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    return Napi::Number::New(env, static_cast<double>(required));
   } catch (const std::exception& e) {
     Napi::Error::New(env, std::string("Error getting order book: ") + e.what()).ThrowAsJavaScriptException();
     return env.Null();
@@ -134,48 +449,56 @@ Napi::Value OrderBookWrapper::GetOrderBook(const Napi::CallbackInfo& info) {
   }
 }
 
-Napi::Value OrderBookWrapper::GetDepth(const Napi::CallbackInfo& info) {
+Napi::Value OrderBookWrapper::GetDepthInto(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
-  try {
-    Napi::Object result = Napi::Object::New(env);
+  if (info.Length() < 1) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-    // Get depth levels from the order book
-    auto& depth = orderBook_->depth();
-
-    Napi::Array bids = Napi::Array::New(env);
-    Napi::Array asks = Napi::Array::New(env);
-
-    // Add bid depth levels
-    int bidIndex = 0;
-    const liquibook::book::DepthLevel* bidLevels = depth.bids();
-    for (int i = 0; i < 5; ++i) {  // SIZE = 5
-      const liquibook::book::DepthLevel& level = bidLevels[i];
-      if (level.price() > 0 && level.price() != 0xFFFFFFFFFFFFFFFFULL) {  // Check for valid price
-        Napi::Object bidLevel = Napi::Object::New(env);
-        bidLevel.Set("price", Napi::Number::New(env, level.price()));
-        bidLevel.Set("quantity", Napi::Number::New(env, level.aggregate_qty()));
-        bids.Set(bidIndex++, bidLevel);
+  try {
+    size_t required;
+    if (IsTypedArrayOf(info[0], napi_float64_array)) {
+      Napi::Float64Array target = info[0].As<Napi::Float64Array>();
+      if (target.ElementLength() < DEPTH_SNAPSHOT_FIELDS) {
+        Napi::RangeError::New(env, "Depth snapshot array too small").ThrowAsJavaScriptException();
+        return env.Null();
       }
-    }
-
-    // Add ask depth levels
-    int askIndex = 0;
-    const liquibook::book::DepthLevel* askLevels = depth.asks();
-    for (int i = 0; i < 5; ++i) {  // SIZE = 5
-      const liquibook::book::DepthLevel& level = askLevels[i];
-      if (level.price() > 0 && level.price() != 0xFFFFFFFFFFFFFFFFULL) {  // Check for valid price
-        Napi::Object askLevel = Napi::Object::New(env);
-        askLevel.Set("price", Napi::Number::New(env, level.price()));
-        askLevel.Set("quantity", Napi::Number::New(env, level.aggregate_qty()));
-        asks.Set(askIndex++, askLevel);
+      required = WriteDepth(target.Data());
+    } else if (IsTypedArrayOf(info[0], napi_biguint64_array)) {
+      Napi::BigUint64Array target = info[0].As<Napi::BigUint64Array>();
+      if (target.ElementLength() < DEPTH_SNAPSHOT_FIELDS) {
+        Napi::RangeError::New(env, "Depth snapshot array too small").ThrowAsJavaScriptException();
+        return env.Null();
       }
+      required = WriteDepth(target.Data());
+    } else {
+      Napi::TypeError::New(env, "Expected a Float64Array or BigUint64Array").ThrowAsJavaScriptException();
+      return env.Null();
     }
+    return Napi::Number::New(env, static_cast<double>(required));
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting depth: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting depth").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
 
-    result.Set("bids", bids);
-    result.Set("asks", asks);
+Napi::Value OrderBookWrapper::GetDepthJson(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-    return result;
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected a timestamp").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    json_.clear();
+    WriteDepthJson(json_, info[0].As<Napi::String>().Utf8Value(), *orderBook_);
+    return Napi::Buffer<char>::Copy(env, json_.data(), json_.size());
   } catch (const std::exception& e) {
     Napi::Error::New(env, std::string("Error getting depth: ") + e.what()).ThrowAsJavaScriptException();
     return env.Null();
@@ -185,6 +508,64 @@ Napi::Value OrderBookWrapper::GetDepth(const Napi::CallbackInfo& info) {
   }
 }
 
+Napi::Value OrderBookWrapper::GetOrderBookJson(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected a timestamp").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    json_.clear();
+    WriteOrderBookJson(json_, info[0].As<Napi::String>().Utf8Value(), *orderBook_);
+    return Napi::Buffer<char>::Copy(env, json_.data(), json_.size());
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting order book: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting order book").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value OrderBookWrapper::GetLevelsJson(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsString()) {
+    Napi::TypeError::New(env, "Expected (first, count, timestamp)").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  try {
+    json_.clear();
+    WriteLevelsJson(json_, info[2].As<Napi::String>().Utf8Value(), *orderBook_,
+                    info[0].As<Napi::Number>().Uint32Value(),
+                    info[1].As<Napi::Number>().Uint32Value());
+    return Napi::Buffer<char>::Copy(env, json_.data(), json_.size());
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting levels: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting levels").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value OrderBookWrapper::GetAnalytics(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  try {
+    return AnalyticsValue(env, *orderBook_);
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, std::string("Error getting analytics: ") + e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  } catch (...) {
+    Napi::Error::New(env, "Unknown error getting analytics").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
 Napi::Value OrderBookWrapper::SetMarketPrice(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
@@ -199,15 +580,37 @@ Napi::Value OrderBookWrapper::SetMarketPrice(const Napi::CallbackInfo& info) {
   return env.Null();
 }
 
-// NodeOrder implementation
-NodeOrder::NodeOrder(bool isBuy, liquibook::book::Price price, liquibook::book::Quantity qty,
-                     liquibook::book::Price stopPrice, bool allOrNone, bool immediateOrCancel)
-  : isBuy_(isBuy), price_(price), qty_(qty), stopPrice_(stopPrice),
-    allOrNone_(allOrNone), immediateOrCancel_(immediateOrCancel) {}
+Napi::Value OrderBookWrapper::AttachEvents(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-bool NodeOrder::is_buy() const { return isBuy_; }
-liquibook::book::Price NodeOrder::price() const { return price_; }
-liquibook::book::Quantity NodeOrder::order_qty() const { return qty_; }
-liquibook::book::Price NodeOrder::stop_price() const { return stopPrice_; }
-bool NodeOrder::all_or_none() const { return allOrNone_; }
-bool NodeOrder::immediate_or_cancel() const { return immediateOrCancel_; }
\ No newline at end of file
+  if (info.Length() < 1) {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!IsTypedArrayOf(info[0], napi_float64_array)) {
+    Napi::TypeError::New(env, "Expected a Float64Array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // Usually a view of a SharedArrayBuffer, read by JS between calls or by
+  // another thread
+  Napi::Float64Array array = info[0].As<Napi::Float64Array>();
+  std::unique_ptr<EventRing> events(
+    new EventRing(array.Data(), array.ElementLength() * sizeof(double)));
+  if (!events->capacity()) {
+    Napi::RangeError::New(env, "Event array too small").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  orderBook_->set_event_ring(events.get());
+  events_ = std::move(events);
+  eventsArray_ = Napi::Persistent(array.As<Napi::Object>());
+  return Napi::Number::New(env, static_cast<double>(events_->capacity()));
+}
+
+Napi::Value OrderBookWrapper::DetachEvents(const Napi::CallbackInfo& info) {
+  orderBook_->set_event_ring(nullptr);
+  events_.reset();
+  eventsArray_.Reset();
+  return info.Env().Undefined();
+}
@@ -3,8 +3,8 @@
 
 #include <napi.h>
 #include <memory>
-#include <depth_order_book.h>
-#include <order.h>
+#include "json_writer.h"
+#include "node_order_book.h"
 
 class OrderBookWrapper : public Napi::ObjectWrap<OrderBookWrapper> {
 public:
@@ -12,41 +12,61 @@ public:
   OrderBookWrapper(const Napi::CallbackInfo& info);
 
 private:
-  // Constructor
-  static Napi::FunctionReference constructor;
+  // Doubles per packed order record and per batch result
+  static const size_t BATCH_RECORD_FIELDS = 5;
+  static const size_t BATCH_RESULT_FIELDS = 3;
+
+  // Snapshot layouts.  Depth: version, bid count, ask count, then bid
+  // prices, bid quantities, ask prices and ask quantities, DEPTH_LEVELS
+  // each.  Book: bid count, ask count, then bid prices, bid quantities,
+  // ask prices and ask quantities, one per resting order.
+  static const size_t DEPTH_LEVELS = 5;
+  static const size_t DEPTH_HEADER_FIELDS = 3;
+  static const size_t DEPTH_SNAPSHOT_FIELDS = DEPTH_HEADER_FIELDS + 4 * DEPTH_LEVELS;
+  static const size_t BOOK_HEADER_FIELDS = 2;
 
   // Instance methods
   Napi::Value AddOrder(const Napi::CallbackInfo& info);
+  Napi::Value AddOrders(const Napi::CallbackInfo& info);
+  Napi::Value AddOrdersPacked(const Napi::CallbackInfo& info);
   Napi::Value CancelOrder(const Napi::CallbackInfo& info);
   Napi::Value ReplaceOrder(const Napi::CallbackInfo& info);
   Napi::Value GetOrderBook(const Napi::CallbackInfo& info);
   Napi::Value GetDepth(const Napi::CallbackInfo& info);
+  Napi::Value GetDepthSince(const Napi::CallbackInfo& info);
+  Napi::Value GetOrderBookInto(const Napi::CallbackInfo& info);
+  Napi::Value GetDepthInto(const Napi::CallbackInfo& info);
+  Napi::Value GetDepthJson(const Napi::CallbackInfo& info);
+  Napi::Value GetOrderBookJson(const Napi::CallbackInfo& info);
+  Napi::Value GetLevelsJson(const Napi::CallbackInfo& info);
+  Napi::Value GetAnalytics(const Napi::CallbackInfo& info);
   Napi::Value SetMarketPrice(const Napi::CallbackInfo& info);
+  Napi::Value AttachEvents(const Napi::CallbackInfo& info);
+  Napi::Value DetachEvents(const Napi::CallbackInfo& info);
 
-  // Internal order book instance
-  std::unique_ptr<liquibook::book::DepthOrderBook<std::shared_ptr<liquibook::book::Order>>> orderBook_;
-};
+  // Add one order of a batch and write its id, filled quantity and status
+  void AddBatchOrder(bool isBuy, double price, double quantity, double stopPrice,
+                     uint32_t conditions, double* result);
 
-// Custom Order implementation for Node.js
-class NodeOrder : public liquibook::book::Order {
-public:
-  NodeOrder(bool isBuy, liquibook::book::Price price, liquibook::book::Quantity qty,
-            liquibook::book::Price stopPrice = 0, bool allOrNone = false, bool immediateOrCancel = false);
+  // Write snapshots in the layouts above; return the fields required
+  template <typename Field>
+  size_t WriteDepth(Field* out) const;
+  template <typename Field>
+  size_t WriteOrderBook(Field* out, size_t capacity) const;
 
-  virtual bool is_buy() const override;
-  virtual liquibook::book::Price price() const override;
-  virtual liquibook::book::Quantity order_qty() const override;
-  virtual liquibook::book::Price stop_price() const override;
-  virtual bool all_or_none() const override;
-  virtual bool immediate_or_cancel() const override;
+  // Internal order book instance, owning its orders by id
+  std::unique_ptr<NodeOrderBook> orderBook_;
 
-private:
-  bool isBuy_;
-  liquibook::book::Price price_;
-  liquibook::book::Quantity qty_;
-  liquibook::book::Price stopPrice_;
-  bool allOrNone_;
-  bool immediateOrCancel_;
+  // Reused for every JSON response
+  JsonWriter json_;
+
+  // Last depth value built, frozen, and the depth version it shows
+  Napi::ObjectReference depthCache_;
+  uint64_t depthCacheVersion_;
+
+  // Event ring and the JS array holding its memory, if attached
+  std::unique_ptr<EventRing> events_;
+  Napi::ObjectReference eventsArray_;
 };
 
 #endif // ORDER_BOOK_WRAPPER_H
\ No newline at end of file
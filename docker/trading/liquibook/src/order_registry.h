@@ -0,0 +1,146 @@
+#ifndef ORDER_REGISTRY_H
+#define ORDER_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Maps compact order ids to open orders.  Ids are assigned in sequence
+// starting at 1; 0 is never a valid id and marks an empty slot.  The table
+// uses open addressing with linear probing and backward-shift deletion, so
+// there are no tombstones and a lookup touches a few adjacent slots.
+template <typename OrderPtr>
+class OrderRegistry {
+public:
+  explicit OrderRegistry(size_t initialCapacity = 1024);
+
+  // Register an order and return its new id
+  uint64_t insert(const OrderPtr& order);
+
+  // Find an order by id, or nullptr if it is not open
+  const OrderPtr* find(uint64_t id) const;
+
+  // Remove an order; returns false if the id was not registered
+  bool erase(uint64_t id);
+
+  // Number of registered orders
+  size_t size() const { return size_; }
+
+private:
+  struct Slot {
+    uint64_t id;
+    OrderPtr order;
+  };
+
+  size_t home(uint64_t id) const;
+  void grow();
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+  int shift_;
+  size_t size_;
+  uint64_t nextId_;
+};
+
+template <typename OrderPtr>
+OrderRegistry<OrderPtr>::OrderRegistry(size_t initialCapacity)
+  : size_(0),
+    nextId_(1) {
+  size_t capacity = 16;
+  int bits = 4;
+  while (capacity < initialCapacity) {
+    capacity <<= 1;
+    ++bits;
+  }
+  slots_.resize(capacity, Slot{0, OrderPtr()});
+  mask_ = capacity - 1;
+  shift_ = 64 - bits;
+}
+
+template <typename OrderPtr>
+inline size_t OrderRegistry<OrderPtr>::home(uint64_t id) const {
+  // Fibonacci hashing spreads sequential ids across the table
+  return static_cast<size_t>((id * 0x9E3779B97F4A7C15ULL) >> shift_);
+}
+
+template <typename OrderPtr>
+uint64_t OrderRegistry<OrderPtr>::insert(const OrderPtr& order) {
+  // Keep the load factor at or below one half
+  if ((size_ + 1) * 2 > slots_.size()) {
+    grow();
+  }
+  uint64_t id = nextId_++;
+  size_t pos = home(id);
+  while (slots_[pos].id) {
+    pos = (pos + 1) & mask_;
+  }
+  slots_[pos].id = id;
+  slots_[pos].order = order;
+  ++size_;
+  return id;
+}
+
+template <typename OrderPtr>
+const OrderPtr* OrderRegistry<OrderPtr>::find(uint64_t id) const {
+  if (!id) {
+    return nullptr;
+  }
+  size_t pos = home(id);
+  while (slots_[pos].id) {
+    if (slots_[pos].id == id) {
+      return &slots_[pos].order;
+    }
+    pos = (pos + 1) & mask_;
+  }
+  return nullptr;
+}
+
+template <typename OrderPtr>
+bool OrderRegistry<OrderPtr>::erase(uint64_t id) {
+  if (!id) {
+    return false;
+  }
+  size_t hole = home(id);
+  while (slots_[hole].id != id) {
+    if (!slots_[hole].id) {
+      return false;
+    }
+    hole = (hole + 1) & mask_;
+  }
+  // Shift later entries of the probe run back into the hole, unless that
+  // would move them ahead of their home slot
+  size_t pos = (hole + 1) & mask_;
+  while (slots_[pos].id) {
+    size_t slotHome = home(slots_[pos].id);
+    if (((pos - slotHome) & mask_) >= ((pos - hole) & mask_)) {
+      slots_[hole] = std::move(slots_[pos]);
+      hole = pos;
+    }
+    pos = (pos + 1) & mask_;
+  }
+  slots_[hole].id = 0;
+  slots_[hole].order = OrderPtr();
+  --size_;
+  return true;
+}
+
+template <typename OrderPtr>
+void OrderRegistry<OrderPtr>::grow() {
+  std::vector<Slot> old;
+  old.swap(slots_);
+  slots_.resize(old.size() * 2, Slot{0, OrderPtr()});
+  mask_ = slots_.size() - 1;
+  --shift_;
+  for (Slot& slot : old) {
+    if (slot.id) {
+      size_t pos = home(slot.id);
+      while (slots_[pos].id) {
+        pos = (pos + 1) & mask_;
+      }
+      slots_[pos] = std::move(slot);
+    }
+  }
+}
+
+#endif // ORDER_REGISTRY_H